@@ -38,6 +38,11 @@ set (3RD_PARTY_LIBUV_LINK_NAME ${Libuv_LIBRARIES})
 include_directories(${3RD_PARTY_LIBUV_INC_DIR})
 
 
+# static libuv and shm_open(shm+posix channel) need librt on old glibc
+if (UNIX AND NOT APPLE AND NOT CYGWIN)
+    list(APPEND 3RD_PARTY_LIBUV_LINK_NAME rt)
+endif()
+
 # mingw
 if (MINGW)
     EchoWithColor(COLOR GREEN "-- MinGW: custom add lib ws2_32,psapi,userenv,iphlpapi ")
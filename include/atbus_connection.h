@@ -23,6 +23,7 @@
 
 #include "design_pattern/noncopyable.h"
 
+#include "detail/buffer.h"
 #include "detail/libatbus_channel_export.h"
 #include "detail/libatbus_config.h"
 #include "detail/libatbus_error.h"
@@ -33,6 +34,10 @@ namespace atbus {
     class node;
     class endpoint;
 
+    namespace detail {
+        struct connection_doorbell_data;
+    }
+
     class connection CLASS_FINAL : public util::design_pattern::noncopyable {
     public:
         typedef std::shared_ptr<connection> ptr_t;
@@ -56,6 +61,10 @@ namespace atbus {
                 ACCESS_SHARE_HOST, /** 共享物理机（共享内存通道的物理机共享） **/
                 RESETTING,         /** 正在执行重置（防止递归死循环） **/
                 DESTRUCTING,       /** 正在执行析构（屏蔽某些接口） **/
+                COMPRESS,          /** 已经和对端协商开启压缩（仅io_stream通道） **/
+                SKIP_HASH,         /** 已经和对端协商发送的帧不计算hash（仅io_stream通道） **/
+                WRITE_BLOCKED,     /** 发送队列超过了高水位，降到低水位时通知on_writable **/
+                IN_PROC,           /** 正在分发内存通道或共享内存通道批量收到的消息，嵌套的proc直接返回 **/
                 MAX
             };
         } flag_t;
@@ -123,6 +132,75 @@ namespace atbus {
          */
         int push(const void *buffer, size_t s);
 
+        /**
+         * @brief 预留发送数据区，用于直接把数据打包到通道的发送缓冲区
+         * @param s 数据块长度
+         * @param writer 输出预留的数据区
+         * @return 0或错误码
+         * @note 预留成功后必须调用push_commit，并且中间不能再调用其他发送接口
+         */
+        int push_reserve(size_t s, detail::buffer_span_writer &writer);
+
+        /**
+         * @brief 提交push_reserve预留的数据区
+         * @return 0或错误码
+         * @note 返回 EN_ATBUS_ERR_NODE_BAD_BLOCK_CSEQ_ID 或 EN_ATBUS_ERR_NODE_BAD_BLOCK_WSEQ_ID 时表示和共享通道的其他写者冲突，
+         *       数据没有发出，可以重新push_reserve后再写一次，见 is_push_conflict
+         */
+        int push_commit();
+
+        /**
+         * @brief push_commit的返回值是否是可以重试的写冲突
+         */
+        static inline bool is_push_conflict(int res) {
+            return EN_ATBUS_ERR_NODE_BAD_BLOCK_CSEQ_ID == res || EN_ATBUS_ERR_NODE_BAD_BLOCK_WSEQ_ID == res;
+        }
+
+        /**
+         * @brief 把多段数据作为一个消息发送，各段直接写入通道的发送缓冲区
+         * @param iov 数据段数组，按顺序拼接成一个消息
+         * @param iovcnt 数据段数量
+         * @return 0或错误码
+         */
+        int pushv(const channel::channel_iovec_t *iov, size_t iovcnt);
+
+        /**
+         * @brief 开启或关闭发送数据的压缩
+         * @param enable 是否开启
+         * @note 只有io_stream通道支持，并且要先和对端协商确认对端支持
+         * @return 0或错误码
+         */
+        int set_compress(bool enable);
+
+        /**
+         * @brief 获取连接接收数据时的帧校验模式
+         * @note 非io_stream连接总是返回channel::io_stream_hash_mode_t::EN_HM_REQUIRED
+         * @return channel::io_stream_hash_mode_t
+         */
+        int get_frame_hash_mode() const;
+
+        /**
+         * @brief 开启或关闭发送数据时跳过帧校验hash
+         * @param enable 是否开启
+         * @note 只有io_stream通道支持，并且要先和对端协商确认对端接受不带hash的帧
+         * @return 0或错误码
+         */
+        int set_skip_frame_hash(bool enable);
+
+        /**
+         * @brief 获取发送队列中的数据长度
+         * @note io_stream通道是发送缓冲区中还没写完的数据，内存通道和共享内存通道是对端还没取走的数据，都包含数据块的头部
+         *       io线程里的连接不能跨线程读取发送缓冲区，总是返回0
+         * @return 数据长度，未连接时返回0
+         */
+        size_t get_send_queue_bytes() const;
+
+        /**
+         * @brief 检查发送队列是否已经降到低水位，降到低水位时清除WRITE_BLOCKED
+         * @return 是否可写
+         */
+        bool check_writable();
+
         /**
          * @brief 获取连接的地址
          */
@@ -173,26 +251,92 @@ namespace atbus {
                                              void *buffer, size_t s);
         static void iostream_on_written(channel::io_stream_channel *channel, channel::io_stream_connection *connection, int status,
                                         void *buffer, size_t s);
+        static void iostream_on_writable(channel::io_stream_channel *channel, channel::io_stream_connection *connection, int status,
+                                         void *buffer, size_t s);
+
+        /**
+         * @brief 分发io线程组发来的事件，priv_data是node
+         */
+        static void iostream_workers_on_event(channel::io_stream_worker_group *group, const channel::io_stream_worker_msg_t *msg,
+                                              void *priv_data);
 
         static int shm_proc_fn(node &n, connection &conn, time_t sec, time_t usec);
 
         static int shm_free_fn(node &n, connection &conn);
 
+        static int shm_posix_free_fn(node &n, connection &conn);
+
         static int shm_push_fn(connection &conn, const void *buffer, size_t s);
 
+        static int shm_reserve_fn(connection &conn, size_t s, detail::buffer_span_writer &writer);
+
+        static int shm_commit_fn(connection &conn);
+
         static int mem_proc_fn(node &n, connection &conn, time_t sec, time_t usec);
 
         static int mem_free_fn(node &n, connection &conn);
 
         static int mem_push_fn(connection &conn, const void *buffer, size_t s);
 
+        static int mem_reserve_fn(connection &conn, size_t s, detail::buffer_span_writer &writer);
+
+        static int mem_commit_fn(connection &conn);
+
         static int ios_free_fn(node &n, connection &conn);
 
         static int ios_push_fn(connection &conn, const void *buffer, size_t s);
 
-        static bool unpack(void *res, connection &conn, atbus::protocol::msg &m, void *buffer, size_t s);
+        static int ios_reserve_fn(connection &conn, size_t s, detail::buffer_span_writer &writer);
+
+        static int ios_commit_fn(connection &conn);
+
+        static int ios_worker_free_fn(node &n, connection &conn);
+
+        static int ios_worker_push_fn(connection &conn, const void *buffer, size_t s);
+
+        static int ios_worker_reserve_fn(connection &conn, size_t s, detail::buffer_span_writer &writer);
+
+        static int ios_worker_commit_fn(connection &conn);
+
+        static bool unpack(msgpack::zone &z, connection &conn, atbus::protocol::msg &m, void *buffer, size_t s);
 
     private:
+        /**
+         * @brief 发送成功后检查是否超过了高水位
+         */
+        void check_send_watermark();
+
+        /**
+         * @brief 关联io线程里的连接
+         */
+        void bind_worker(channel::io_stream_worker_group *group, uint64_t conn_id);
+
+        /**
+         * @brief 调用free_fn释放通道
+         */
+        void free_conn_data();
+
+        /**
+         * @brief mem_proc_fn和shm_proc_fn分发消息期间设置IN_PROC标记，并临时持有连接
+         * @note 批量取出的消息分发完以后才释放通道空间，回调里嵌套调用proc时不能再取到同一批消息
+         * @note 回调里断开的连接要到析构时才释放通道，因为消息可能直接引用通道内存
+         */
+        class proc_guard {
+        public:
+            explicit proc_guard(connection &conn);
+            ~proc_guard();
+
+            inline bool is_nested() const { return nested_; }
+
+        private:
+            proc_guard(const proc_guard &);
+            proc_guard &operator=(const proc_guard &);
+
+            connection &conn_;
+            ptr_t holder_;
+            bool nested_;
+        };
+
         state_t::type state_;
         channel::channel_address_t address_;
         std::bitset<flag_t::MAX> flags_;
@@ -206,12 +350,14 @@ namespace atbus {
             channel::mem_channel *channel;
             void *buffer;
             size_t len;
+            detail::connection_doorbell_data *doorbell; // 接收端的门铃，没有开启时为NULL
         } conn_data_mem;
 
         typedef struct {
             channel::shm_channel *channel;
             key_t shm_key;
             size_t len;
+            detail::connection_doorbell_data *doorbell; // 接收端的门铃，没有开启时为NULL
         } conn_data_shm;
 
         typedef struct {
@@ -219,20 +365,40 @@ namespace atbus {
             channel::io_stream_connection *conn;
         } conn_data_ios;
 
+        typedef struct {
+            channel::io_stream_worker_group *group;
+            uint64_t conn_id;
+        } conn_data_ios_worker;
+
+        typedef struct {
+            void *buffer;
+            size_t len;
+        } reserved_data_ios;
+
         typedef struct {
             typedef union {
                 conn_data_mem mem;
                 conn_data_shm shm;
                 conn_data_ios ios_fd;
+                conn_data_ios_worker ios_worker;
             } shared_t;
+            typedef union {
+                channel::mem_reserved_block_t mem; // mem和shm通道以及io线程的命令通道共用
+                reserved_data_ios ios_fd;
+            } reserved_t;
             typedef int (*proc_fn_t)(node &n, connection &conn, time_t sec, time_t usec);
             typedef int (*free_fn_t)(node &n, connection &conn);
             typedef int (*push_fn_t)(connection &conn, const void *buffer, size_t s);
+            typedef int (*reserve_fn_t)(connection &conn, size_t s, detail::buffer_span_writer &writer);
+            typedef int (*commit_fn_t)(connection &conn);
 
             shared_t shared;
+            reserved_t reserved;
             proc_fn_t proc_fn;
             free_fn_t free_fn;
             push_fn_t push_fn;
+            reserve_fn_t reserve_fn;
+            commit_fn_t commit_fn;
         } connection_data_t;
         connection_data_t conn_data_;
         stat_t stat_;
@@ -54,6 +54,7 @@ namespace atbus {
 
                 MUTABLE_FLAGS,
                 GLOBAL_ROUTER = MUTABLE_FLAGS, /** 全局路由表 **/
+                FIXED_DATA_MSG,                /** 支持定长格式的数据转发消息 **/
                 MAX
             };
         } flag_t;
@@ -36,6 +36,12 @@ namespace atbus {
 
         static int send_msg(node &n, connection &conn, const protocol::msg &m);
 
+        /**
+         * @brief 不解包直接转发定长格式的数据转发请求，只修改头部的src_bus_id并追加路由
+         * @return 已经转发返回true，需要走完整的解包流程时返回false
+         */
+        static bool relay_data_msg(node &n, connection &conn, const void *buffer, size_t s);
+
 
         // ========================= 接收handle =========================
         static int on_recv_data_transfer_req(node &n, connection *conn, protocol::msg &, int status, int errcode);
@@ -15,6 +15,7 @@
 #include <ctime>
 #include <map>
 #include <set>
+#include <vector>
 #include <stdint.h>
 
 #ifdef _MSC_VER
@@ -42,6 +43,11 @@ namespace atbus {
         struct conf_flag_t {
             enum type {
                 EN_CONF_GLOBAL_ROUTER, /** 全局路由表 **/
+                EN_CONF_MEM_DOORBELL,  /** 内存通道和共享内存通道使用门铃唤醒，而不是只依赖proc轮询 **/
+                EN_CONF_SHM_HUGEPAGE,  /** shm+posix通道尝试使用大页 **/
+                EN_CONF_SHM_PREFAULT,  /** shm+posix通道映射时预先填充页表并锁定内存 **/
+                EN_CONF_IOS_COMPRESS,  /** 和其他物理机的io_stream连接在注册时协商开启LZ4压缩 **/
+                EN_CONF_AUTO_SHM,      /** 启动时自动创建shm+posix通道，同一台物理机上的节点注册后数据改走共享内存 **/
                 EN_CONF_MAX
             };
         };
@@ -57,6 +63,7 @@ namespace atbus {
                 EN_FT_ACTIVED,         /** 已激活 **/
                 EN_FT_PARENT_REG_DONE, /** 已通过父节点注册 **/
                 EN_FT_SHUTDOWN,        /** 已完成关闭前的资源回收 **/
+                EN_FT_IN_PROC,         /** 正在proc里处理连接，嵌套的proc不能复用proc_connections_cache_ **/
                 EN_FT_MAX,             /** flag max **/
             };
         };
@@ -81,6 +88,16 @@ namespace atbus {
             size_t recv_buffer_size;   /** 接收缓冲区，和数据包大小有关 **/
             size_t send_buffer_size;   /** 发送缓冲区限制 **/
             size_t send_buffer_number; /** 发送缓冲区静态Buffer数量限制，0则为动态缓冲区 **/
+            size_t compress_threshold; /** 开启压缩的连接上需要压缩的最小数据包大小，0则使用通道的默认值 **/
+            size_t send_high_watermark; /** 连接的发送队列超过这个长度后标记为不可写，0则关闭高低水位检查 **/
+            size_t send_low_watermark;  /** 不可写的连接的发送队列降到这个长度以下时触发on_writable **/
+            int frame_hash_mode;        /** tcp连接的帧校验模式，见channel::io_stream_hash_mode_t **/
+            int unix_frame_hash_mode;   /** unix sock和pipe连接的帧校验模式，见channel::io_stream_hash_mode_t **/
+            uint32_t mem_checksum_mode; /** 本端创建的内存和共享内存通道的消息校验方式，见channel::mem_checksum_t **/
+
+            // ===== io线程配置 =====
+            size_t io_worker_count;      /** tcp和unix sock连接的读写、拆包和校验分到多少个io线程，0则都在ev_loop里执行 **/
+            size_t io_worker_queue_size; /** 每个io线程和node之间的内存通道大小，至少要能放下一个数据包 **/
         } conf_t;
 
         typedef std::map<bus_id_t, endpoint::ptr_t> endpoint_collection_t;
@@ -99,6 +116,7 @@ namespace atbus {
                 on_custom_cmd_fn_t;
             typedef std::function<int(const node &, endpoint *, int)> on_add_endpoint_fn_t;
             typedef std::function<int(const node &, endpoint *, int)> on_remove_endpoint_fn_t;
+            typedef std::function<int(const node &, const endpoint *, const connection *)> on_writable_fn_t;
 
             on_recv_msg_fn_t on_recv_msg;
             on_send_data_failed_fn_t on_send_data_failed;
@@ -110,6 +128,7 @@ namespace atbus {
             on_custom_cmd_fn_t on_custom_cmd;
             on_add_endpoint_fn_t on_endpoint_added;
             on_remove_endpoint_fn_t on_endpoint_removed;
+            on_writable_fn_t on_writable;
         };
 
         // ================== 用这个来取代C++继承，减少层次结构 ==================
@@ -130,6 +149,10 @@ namespace atbus {
             void operator()(channel::io_stream_channel *p) const;
         };
 
+        struct io_stream_workers_del {
+            void operator()(channel::io_stream_worker_group *p) const;
+        };
+
     public:
         static ptr_t create();
         ~node();
@@ -269,6 +292,16 @@ namespace atbus {
          */
         int send_msg(bus_id_t tid, atbus::protocol::msg &mb, endpoint::get_connection_fn_t fn, endpoint **ep_out, connection **conn_out);
 
+        /**
+         * @brief 查找发往目标的下一跳连接
+         * @param tid 发送目标ID
+         * @param fn 获取有效连接的接口
+         * @param ep_out 导出下一跳的端点
+         * @param conn_out 导出下一跳的连接
+         * @return 0或错误码
+         */
+        int get_remote_channel(bus_id_t tid, endpoint::get_connection_fn_t fn, endpoint **ep_out, connection **conn_out);
+
         /**
          * @brief 根据对端ID查找直链的端点
          * @param tid 目标端点ID
@@ -277,6 +310,14 @@ namespace atbus {
         endpoint *get_endpoint(bus_id_t tid);
         const endpoint *get_endpoint(bus_id_t tid) const;
 
+        /**
+         * @brief 获取发往直连端点的数据通道中等待发送的数据长度
+         * @param tid 目标端点ID
+         * @return 数据长度，不是直连端点或者没有数据通道时返回0
+         * @note 配置了send_high_watermark时，可以和on_writable事件配合控制发送速度
+         */
+        size_t get_send_queue_bytes(bus_id_t tid) const;
+
         /**
          * @brief 添加目标端点
          * @param ep 目标端点
@@ -302,6 +343,13 @@ namespace atbus {
     public:
         channel::io_stream_channel *get_iostream_channel();
 
+        /**
+         * @brief 获取io线程组
+         * @note 没有配置io_worker_count时返回NULL，开启后监听必须在start之前
+         * @return io线程组或NULL
+         */
+        channel::io_stream_worker_group *get_iostream_workers();
+
         inline const endpoint *get_self_endpoint() const { return self_ ? self_.get() : NULL; }
 
         inline const endpoint *get_parent_endpoint() const { return node_father_.node_.get(); }
@@ -341,8 +389,26 @@ namespace atbus {
         bool add_proc_connection(connection::ptr_t conn);
         bool remove_proc_connection(const std::string &conn_key);
 
+        /**
+         * @brief 记录io线程里的连接ID和连接的关系，io线程的事件按连接ID分发
+         */
+        bool add_worker_connection(uint64_t conn_id, connection *conn);
+        bool remove_worker_connection(uint64_t conn_id);
+        connection *get_worker_connection(uint64_t conn_id) const;
+
+        /**
+         * @brief 记录通过io线程主动连接的连接，返回的token会在连接结果事件里带回
+         */
+        uint64_t add_worker_connecting(connection::ptr_t conn);
+        connection::ptr_t remove_worker_connecting(uint64_t token);
+
         bool add_connection_timer(connection::ptr_t conn);
 
+        /**
+         * @brief 添加超过高水位的连接，proc时检查是否降到低水位
+         */
+        bool add_writable_check(connection::ptr_t conn);
+
         time_t get_timer_sec() const;
 
         time_t get_timer_usec() const;
@@ -362,6 +428,7 @@ namespace atbus {
         int on_parent_reg_done();
         int on_custom_cmd(const endpoint *, const connection *, bus_id_t from,
                           const std::vector<std::pair<const void *, size_t> > &cmd_args);
+        int on_writable(const endpoint *, const connection *);
 
         /**
          * @brief 关闭node
@@ -380,6 +447,50 @@ namespace atbus {
         inline const detail::buffer_block *get_temp_static_buffer() const { return static_buffer_; }
         inline detail::buffer_block *get_temp_static_buffer() { return static_buffer_; }
 
+        /**
+         * @brief 从池里取一个构造消息用的zone，用完后要调用free_msg_zone还回去
+         * @note 消息回调里可能还会收发消息，所以用池而不是单个zone
+         */
+        msgpack::zone *alloc_msg_zone();
+
+        /**
+         * @brief 重置zone并放回池里，重置时只保留第一块内存，稳定以后收发消息不需要再分配
+         */
+        void free_msg_zone(msgpack::zone *z);
+
+        /**
+         * @brief 从池里借一个zone，析构时还回去，要在使用它的消息对象之前构造
+         */
+        class msg_zone_guard {
+        public:
+            explicit msg_zone_guard(node &n) : owner_(&n), zone_(n.alloc_msg_zone()) {}
+            ~msg_zone_guard() { owner_->free_msg_zone(zone_); }
+
+            inline msgpack::zone *get() const { return zone_; }
+
+        private:
+            msg_zone_guard(const msg_zone_guard &);
+            msg_zone_guard &operator=(const msg_zone_guard &);
+
+            node *owner_;
+            msgpack::zone *zone_;
+        };
+
+        /**
+         * @brief 使下一跳缓存全部失效，节点关系或者端点上的连接变化时调用
+         */
+        void invalidate_route_cache();
+
+        /**
+         * @brief 下一跳缓存的版本号，每次缓存失效时变化
+         */
+        inline uint32_t get_route_cache_version() const { return route_cache_version_; }
+
+        /**
+         * @brief 数据消息命中下一跳缓存的次数
+         */
+        inline size_t get_stat_route_cache_hit_times() const { return stat_.route_cache_hit_times; }
+
         int ping_endpoint(endpoint &ep);
 
         int push_node_sync();
@@ -420,6 +531,9 @@ namespace atbus {
         void set_on_remove_endpoint_handle(evt_msg_t::on_remove_endpoint_fn_t fn);
         evt_msg_t::on_remove_endpoint_fn_t get_on_remove_endpoint_handle() const;
 
+        void set_on_writable_handle(evt_msg_t::on_writable_fn_t fn);
+        evt_msg_t::on_writable_fn_t get_on_writable_handle() const;
+
         void ref_object(void *);
         void unref_object(void *);
 
@@ -443,6 +557,13 @@ namespace atbus {
          */
         void add_ping_timer(endpoint::ptr_t &ep);
 
+        /**
+         * @brief 开启EN_CONF_AUTO_SHM时创建自己的共享内存通道接收端
+         * @note 已经监听了内存通道或共享内存通道时不再创建
+         * @return 0或错误码
+         */
+        int listen_auto_shm();
+
     public:
         void stat_add_dispatch_times();
 
@@ -455,6 +576,7 @@ namespace atbus {
 
         // 配置
         conf_t conf_;
+        std::string auto_shm_name_; // EN_CONF_AUTO_SHM自动创建的共享内存通道名称
         std::weak_ptr<node> watcher_; // just like std::shared_from_this<T>
         util::lock::seq_alloc_u32 msg_seq_alloc_;
 
@@ -466,6 +588,10 @@ namespace atbus {
         adapter::loop_t *ev_loop_;
         std::unique_ptr<channel::io_stream_channel, io_stream_channel_del> iostream_channel_;
         std::unique_ptr<channel::io_stream_conf> iostream_conf_;
+        std::unique_ptr<channel::io_stream_worker_group, io_stream_workers_del> iostream_workers_;
+        detail::auto_select_map<uint64_t, connection *>::type worker_connections_;          // io线程里的连接ID -> 连接
+        detail::auto_select_map<uint64_t, connection::ptr_t>::type worker_connecting_list_; // 等待io线程返回连接结果
+        uint64_t worker_connecting_token_;
         evt_msg_t event_msg_;
 
         // ============ 定时器 ============
@@ -484,12 +610,26 @@ namespace atbus {
             timer_desc_ls<std::weak_ptr<endpoint> >::type ping_list; // 定时ping
             timer_desc_ls<connection::ptr_t>::type connecting_list;  // 未完成连接（正在网络连接或握手）
             std::list<endpoint::ptr_t> pending_check_list_;          // 待检测列表
+            std::list<connection::ptr_t> writable_check_list;        // 超过高水位的内存通道和共享内存通道连接
         } evt_timer_t;
         evt_timer_t event_timer_;
 
         // 轮训接收通道集
         detail::buffer_block *static_buffer_;
+        std::vector<msgpack::zone *> msg_zone_pool_;
+
+        // 数据消息的下一跳缓存，版本号不一致或连接已断开时重新查找
+        struct route_cache_t {
+            endpoint *ep;
+            connection *conn;
+            uint32_t version;
+
+            route_cache_t();
+        };
+        detail::auto_select_map<bus_id_t, route_cache_t>::type route_cache_;
+        uint32_t route_cache_version_;
         detail::auto_select_map<std::string, connection::ptr_t>::type proc_connections_;
+        std::vector<connection::ptr_t> proc_connections_cache_; // proc时复制一份，回调里可能会增删连接
 
         // 基于事件的通道信息
         // 基于事件的通道超时收集
@@ -512,6 +652,7 @@ namespace atbus {
         // 统计信息
         struct stat_info_t {
             size_t dispatch_times;
+            size_t route_cache_hit_times;
 
             stat_info_t();
         };
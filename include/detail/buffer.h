@@ -137,6 +137,14 @@ namespace atbus {
 
             int front(void *&pointer, size_t &nread, size_t &nwrite);
 
+            /**
+             * @brief get blocks from the head in order, the blocks will not be removed
+             * @param out output block array
+             * @param max_count max number of blocks to get
+             * @return number of blocks got
+             */
+            size_t front_blocks(buffer_block **out, size_t max_count);
+
             buffer_block *back();
 
             int back(void *&pointer, size_t &nread, size_t &nwrite);
@@ -184,6 +192,8 @@ namespace atbus {
         private:
             buffer_block *static_front();
 
+            size_t static_front_blocks(buffer_block **out, size_t max_count);
+
             buffer_block *static_back();
 
             int static_push_back(void *&pointer, size_t s);
@@ -202,6 +212,8 @@ namespace atbus {
 
             buffer_block *dynamic_front();
 
+            size_t dynamic_front_blocks(buffer_block **out, size_t max_count);
+
             buffer_block *dynamic_back();
 
             int dynamic_push_back(void *&pointer, size_t s);
@@ -233,6 +245,46 @@ namespace atbus {
 
             limit_t limit_;
         };
+
+        /**
+         * @brief 只统计写入长度的输出流，用于预先计算打包后的数据长度
+         * @note 满足msgpack::packer的Stream要求
+         */
+        class buffer_size_counter {
+        public:
+            buffer_size_counter() : size_(0) {}
+
+            inline void write(const char *, size_t s) { size_ += s; }
+            inline size_t size() const { return size_; }
+
+        private:
+            size_t size_;
+        };
+
+        /**
+         * @brief 写入到预留数据区的输出流，数据区最多由两段组成(通道尾部回绕时)
+         * @note 满足msgpack::packer的Stream要求，超出的数据会被丢弃
+         */
+        class buffer_span_writer {
+        public:
+            buffer_span_writer();
+            buffer_span_writer(void *buf1, size_t len1, void *buf2 = NULL, size_t len2 = 0);
+
+            void reset(void *buf1, size_t len1, void *buf2 = NULL, size_t len2 = 0);
+
+            void write(const char *buf, size_t s);
+
+            /** 已写入的长度 **/
+            inline size_t size() const { return used_; }
+
+            /** 可写入的总长度 **/
+            inline size_t capacity() const { return length_[0] + length_[1]; }
+
+        private:
+            char *buffer_[2];
+            size_t length_[2];
+            size_t used_;
+        };
     }
 }
 
@@ -8,7 +8,27 @@
 
 namespace atbus {
     namespace detail {
+        /**
+         * @brief CRC32(IEEE 802.3)，CPU支持PCLMULQDQ时使用折叠算法
+         * @note 不做初始值和结果的取反，由调用方处理
+         */
         uint32_t crc32(uint32_t crc, const unsigned char *s, size_t l);
+
+        /**
+         * @brief 便携版本(slicing-by-8)，输出和crc32一致
+         */
+        uint32_t crc32_portable(uint32_t crc, const unsigned char *s, size_t l);
+
+        /**
+         * @brief CRC32C(Castagnoli)，CPU支持SSE4.2时使用crc32指令，长数据优先使用PCLMULQDQ折叠
+         * @note 和crc32一样不做初始值和结果的取反，由调用方处理
+         */
+        uint32_t crc32c(uint32_t crc, const unsigned char *s, size_t l);
+
+        /**
+         * @brief 便携版本(slicing-by-8)，输出和crc32c一致
+         */
+        uint32_t crc32c_portable(uint32_t crc, const unsigned char *s, size_t l);
     }
 }
 
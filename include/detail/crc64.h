@@ -8,7 +8,16 @@
 
 namespace atbus {
     namespace detail {
+        /**
+         * @brief CRC64(Jones)，CPU支持PCLMULQDQ时使用折叠算法
+         * @note 不做初始值和结果的取反，由调用方处理
+         */
         uint64_t crc64(uint64_t crc, const unsigned char *s, size_t l);
+
+        /**
+         * @brief 便携版本(slicing-by-8)，输出和crc64一致
+         */
+        uint64_t crc64_portable(uint64_t crc, const unsigned char *s, size_t l);
     }
 }
 
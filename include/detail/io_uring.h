@@ -0,0 +1,113 @@
+﻿#pragma once
+
+#ifndef LIBATBUS_DETAIL_IO_URING_H_
+#define LIBATBUS_DETAIL_IO_URING_H_
+
+// 内核头文件里有io_uring定义时可用，运行时创建失败的话由调用方回退到其他实现
+// IORING_OP_RECV是枚举值没法直接判断，用同一版本(5.6)加入的IORING_SETUP_ATTACH_WQ代替
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#if defined(IORING_SETUP_ATTACH_WQ)
+#define ATBUS_CHANNEL_IO_URING 1
+#endif
+#endif
+#endif
+
+#ifdef ATBUS_CHANNEL_IO_URING
+
+#include <stddef.h>
+#include <stdint.h>
+
+// 5.4以前的内核头文件没有，运行时内核不支持的话对应标记位不会置上
+#ifndef IORING_FEAT_SINGLE_MMAP
+#define IORING_FEAT_SINGLE_MMAP (1U << 0)
+#endif
+
+// 5.11以前的内核头文件没有，运行时内核不支持的话对应标记位不会置上
+#ifndef IORING_SQ_CQ_OVERFLOW
+#define IORING_SQ_CQ_OVERFLOW (1U << 1)
+#endif
+
+namespace atbus {
+    namespace detail {
+        /**
+         * @brief 最简单的io_uring封装，只有提交队列和完成队列，不依赖liburing
+         * @note 非线程安全
+         */
+        class io_uring_ring {
+        public:
+            io_uring_ring();
+            ~io_uring_ring();
+
+            /**
+             * @brief 创建io_uring并映射提交队列和完成队列
+             * @param entries 提交队列长度，完成队列是它的两倍
+             * @return 0或-errno
+             */
+            int init(unsigned int entries);
+            void close();
+
+            inline int fd() const { return ring_fd_; }
+            inline bool is_inited() const { return ring_fd_ >= 0; }
+
+            /**
+             * @brief 取一个已清零的提交项
+             * @return 提交队列满时返回NULL，需要先调用submit
+             */
+            struct io_uring_sqe *get_sqe();
+
+            /**
+             * @brief 还没有被内核取走的提交项数量
+             */
+            unsigned int pending() const;
+
+            /**
+             * @brief 一次系统调用提交所有的提交项
+             * @return 内核取走的数量或-errno
+             */
+            int submit();
+
+            /**
+             * @brief 取下一个完成事件
+             * @note 处理完以后必须调用cqe_seen
+             * @return 没有完成事件时返回NULL
+             */
+            struct io_uring_cqe *peek_cqe();
+            void cqe_seen();
+
+        private:
+            io_uring_ring(const io_uring_ring &);
+            io_uring_ring &operator=(const io_uring_ring &);
+
+            int enter(unsigned int to_submit, unsigned int flags);
+
+            int ring_fd_;
+
+            void *sq_ptr_;
+            size_t sq_size_;
+            void *cq_ptr_;
+            size_t cq_size_;
+            struct io_uring_sqe *sqes_;
+            size_t sqes_size_;
+
+            unsigned int *sq_khead_;
+            unsigned int *sq_ktail_;
+            unsigned int *sq_kflags_;
+            unsigned int *sq_array_;
+            unsigned int sq_mask_;
+            unsigned int sq_entries_;
+            unsigned int sqe_head_; // 已经写入提交队列的位置
+            unsigned int sqe_tail_; // 已经分配出去的位置
+
+            unsigned int *cq_khead_;
+            unsigned int *cq_ktail_;
+            struct io_uring_cqe *cqes_;
+            unsigned int cq_mask_;
+        };
+    }
+}
+
+#endif
+
+#endif
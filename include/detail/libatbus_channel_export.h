@@ -28,11 +28,128 @@ namespace atbus {
         extern bool make_address(const char *in, channel_address_t &addr);
         extern void make_address(const char *scheme, const char *host, int port, channel_address_t &addr);
 
+        /**
+         * @brief 是否是内存通道或共享内存通道的地址
+         * @note 这些通道只能在本机使用，也不能用作控制通道
+         */
+        extern bool is_memory_channel_address(const char *in);
+
         // memory channel
         extern int mem_attach(void *buf, size_t len, mem_channel **channel, const mem_conf *conf);
         extern int mem_init(void *buf, size_t len, mem_channel **channel, const mem_conf *conf);
+
+        /**
+         * @brief 使用旧版本的通道头初始化内存通道
+         * @note mem_init创建的通道头把写端和读端的游标分到了不同的cache line，旧版本的进程无法attach
+         * @note 需要和旧版本的进程共享通道时才使用这个接口
+         * @return 0或错误码
+         */
+        extern int mem_init_v1(void *buf, size_t len, mem_channel **channel, const mem_conf *conf);
+
+        /**
+         * @brief 初始化变长记录格式的内存通道
+         * @note 数据区是按对齐单位划分的连续环形缓冲区，每个消息只有一个记录头，并且数据区一定是连续的
+         * @note 收发接口和mem_init创建的通道一致，mem_attach会根据通道头自动识别格式
+         * @return 0或错误码
+         */
+        extern int mem_init_record(void *buf, size_t len, mem_channel **channel, const mem_conf *conf);
         extern int mem_send(mem_channel *channel, const void *buf, size_t len);
+
+        /**
+         * @brief 预留发送数据区，调用方直接写入通道内存后调用mem_send_commit，可以减少一次内存拷贝
+         * @param channel 内存通道
+         * @param len 数据长度
+         * @param block 输出预留的数据区(通道尾部回绕时会拆成两段)
+         * @note 预留成功后必须调用mem_send_commit，否则接收端要等到超时才会跳过这个数据块
+         * @return 0或错误码
+         */
+        extern int mem_send_reserve(mem_channel *channel, size_t len, mem_reserved_block_t *block);
+        extern int mem_send_commit(mem_channel *channel, const mem_reserved_block_t *block);
+
+        /**
+         * @brief 把多段数据作为一个消息发送，各段直接写入通道内存，不需要先拼成连续的数据
+         * @param channel 内存通道
+         * @param iov 数据段数组，所有数据段按顺序拼接成一个消息
+         * @param iovcnt 数据段数量
+         * @return 0或错误码
+         */
+        extern int mem_sendv(mem_channel *channel, const channel_iovec_t *iov, size_t iovcnt);
+
+        /**
+         * @brief 批量发送多个消息，只用一次CAS预留所有消息的空间
+         * @param channel 内存通道
+         * @param iov 消息数组，每一项是一个独立的消息
+         * @param iovcnt 消息数量
+         * @param sent_count 输出已发送的消息数量
+         * @note 空间不足时只发送能放下的前面一部分消息，一个都放不下时返回EN_ATBUS_ERR_BUFF_LIMIT
+         * @note 出错时sent_count为已处理的消息数量
+         * @return 0或错误码
+         */
+        extern int mem_send_batch(mem_channel *channel, const channel_iovec_t *iov, size_t iovcnt, size_t *sent_count);
         extern int mem_recv(mem_channel *channel, void *buf, size_t len, size_t *recv_size);
+
+        /**
+         * @brief 取出下一个数据块但不拷贝，数据区直接指向通道内存
+         * @param channel 内存通道
+         * @param block 输出数据区(通道尾部回绕时会拆成两段)
+         * @note 取出成功后必须调用mem_recv_release才会释放通道空间，在此之前数据区一直有效
+         * @return 0或错误码
+         */
+        extern int mem_recv_peek(mem_channel *channel, mem_recv_block_t *block);
+        extern int mem_recv_release(mem_channel *channel, const mem_recv_block_t *block);
+
+        /**
+         * @brief 一次取出多个连续的数据块但不拷贝，读写游标都只读取一次
+         * @param channel 内存通道
+         * @param blocks 输出数据区数组
+         * @param max_count 最多取出的数据块数量
+         * @param count 输出实际取出的数据块数量
+         * @note 取出成功后必须调用mem_recv_batch_release一次性释放，只会写一次读游标
+         * @return 0或错误码
+         */
+        extern int mem_recv_batch(mem_channel *channel, mem_recv_block_t *blocks, size_t max_count, size_t *count);
+        extern int mem_recv_batch_release(mem_channel *channel, const mem_recv_block_t *blocks, size_t count);
+
+        /**
+         * @brief 设置通道的消息校验方式
+         * @param channel 内存通道
+         * @param mode 校验方式，见 mem_checksum_t
+         * @note 校验方式保存在通道头里，必须在初始化后、收发数据之前设置
+         * @note mem_init_v1创建的通道只支持 EN_MCS_MURMUR3
+         * @return 0或错误码
+         */
+        extern int mem_set_checksum(mem_channel *channel, uint32_t mode);
+        extern uint32_t mem_get_checksum(const mem_channel *channel);
+
+        /**
+         * @brief 设置接收端的门铃地址，发送端提交数据时如果接收端在休眠就按门铃
+         * @param channel 内存通道
+         * @param name 门铃地址，NULL或空串表示关闭门铃
+         * @note mem_init_v1创建的通道不支持门铃
+         * @return 0或错误码
+         */
+        extern int mem_set_doorbell(mem_channel *channel, const char *name);
+
+        /**
+         * @brief 接收端准备休眠前调用
+         * @return 通道为空并且已经设置了等待标记时返回true，这时可以阻塞等待门铃；否则应该继续调用mem_recv
+         */
+        extern bool mem_doorbell_sleep(mem_channel *channel);
+
+        /**
+         * @brief 接收端醒来后调用，清除等待标记，之后发送端不再按门铃
+         */
+        extern void mem_doorbell_wakeup(mem_channel *channel);
+
+        /**
+         * @brief 获取通道数据区的使用情况，发送端可以据此实现高低水位
+         * @param channel 内存通道
+         * @param used_size 输出已使用的长度(包含node头或记录头)，可以为NULL
+         * @param capacity 输出通道为空时最多可使用的长度，可以为NULL
+         * @note 接收端随时可能移动读游标，结果只是调用时的快照
+         * @return 0或错误码
+         */
+        extern int mem_get_usage(mem_channel *channel, size_t *used_size, size_t *capacity);
         extern std::pair<size_t, size_t> mem_last_action();
         extern void mem_show_channel(mem_channel *channel, std::ostream &out, bool need_node_status, size_t need_node_data);
 
@@ -40,13 +157,72 @@ namespace atbus {
         // shared memory channel
         extern int shm_attach(key_t shm_key, size_t len, shm_channel **channel, const shm_conf *conf);
         extern int shm_init(key_t shm_key, size_t len, shm_channel **channel, const shm_conf *conf);
+        extern int shm_init_v1(key_t shm_key, size_t len, shm_channel **channel, const shm_conf *conf);
+        extern int shm_init_record(key_t shm_key, size_t len, shm_channel **channel, const shm_conf *conf);
         extern int shm_close(key_t shm_key);
         extern int shm_send(shm_channel *channel, const void *buf, size_t len);
+        extern int shm_send_reserve(shm_channel *channel, size_t len, mem_reserved_block_t *block);
+        extern int shm_send_commit(shm_channel *channel, const mem_reserved_block_t *block);
+        extern int shm_sendv(shm_channel *channel, const channel_iovec_t *iov, size_t iovcnt);
+        extern int shm_send_batch(shm_channel *channel, const channel_iovec_t *iov, size_t iovcnt, size_t *sent_count);
         extern int shm_recv(shm_channel *channel, void *buf, size_t len, size_t *recv_size);
+        extern int shm_recv_peek(shm_channel *channel, mem_recv_block_t *block);
+        extern int shm_recv_release(shm_channel *channel, const mem_recv_block_t *block);
+        extern int shm_recv_batch(shm_channel *channel, mem_recv_block_t *blocks, size_t max_count, size_t *count);
+        extern int shm_recv_batch_release(shm_channel *channel, const mem_recv_block_t *blocks, size_t count);
+        extern int shm_set_checksum(shm_channel *channel, uint32_t mode);
+        extern uint32_t shm_get_checksum(const shm_channel *channel);
+        extern int shm_set_doorbell(shm_channel *channel, const char *name);
+        extern bool shm_doorbell_sleep(shm_channel *channel);
+        extern void shm_doorbell_wakeup(shm_channel *channel);
+        extern int shm_get_usage(shm_channel *channel, size_t *used_size, size_t *capacity);
         extern std::pair<size_t, size_t> shm_last_action();
         extern void shm_show_channel(shm_channel *channel, std::ostream &out, bool need_node_status, size_t need_node_data);
 #endif
 
+#ifdef ATBUS_CHANNEL_DOORBELL
+        // doorbell，用于唤醒等待内存通道和共享内存通道数据的接收端
+        /**
+         * @brief 创建门铃
+         * @param name 门铃地址，长度不能超过ATBUS_MACRO_DOORBELL_NAME_SIZE - 1
+         * @param fd 输出非阻塞的文件描述符，可以用uv_poll监听可读事件
+         * @return 0或错误码
+         */
+        extern int doorbell_open(const char *name, adapter::fd_t *fd);
+        extern int doorbell_ring(const char *name);
+        extern void doorbell_drain(adapter::fd_t fd);
+        extern int doorbell_close(adapter::fd_t fd);
+#endif
+
+#ifdef ATBUS_CHANNEL_SHM_POSIX
+        // posix shared memory channel，除了创建和关闭以外的接口和shm_*通用
+        /**
+         * @brief 打开已存在的POSIX共享内存并附加到通道
+         * @param name 共享内存名称，包含目录时当作文件路径打开（比如hugetlbfs下的文件），否则使用shm_open
+         * @param len 期望的长度，实际长度以已存在的共享内存为准
+         * @param flags 映射选项，见 shm_posix_flag_t
+         * @return 0或错误码
+         */
+        extern int shm_posix_attach(const char *name, size_t len, shm_channel **channel, const shm_conf *conf, int flags);
+
+        /**
+         * @brief 创建或打开POSIX共享内存并初始化通道
+         * @note 参数同shm_posix_attach，已存在但长度不足时会扩展长度
+         * @return 0或错误码
+         */
+        extern int shm_posix_init(const char *name, size_t len, shm_channel **channel, const shm_conf *conf, int flags);
+
+        /**
+         * @brief 解除当前进程的映射，共享内存本身仍然存在
+         */
+        extern int shm_posix_close(const char *name);
+
+        /**
+         * @brief 删除共享内存，已经映射的进程不受影响
+         */
+        extern int shm_posix_unlink(const char *name);
+#endif
+
         // stream channel(tcp,pipe(unix socket) and etc. udp is not a stream)
         extern void io_stream_init_configure(io_stream_conf *conf);
 
@@ -68,7 +244,127 @@ namespace atbus {
         extern int io_stream_try_write(io_stream_connection *connection);
         extern int io_stream_send(io_stream_connection *connection, const void *buf, size_t len);
 
+        /**
+         * @brief 在发送缓冲区中预留数据区，调用方直接写入后调用io_stream_send_commit，可以减少一次内存拷贝
+         * @param connection 连接
+         * @param len 数据长度
+         * @param buf 输出预留的数据区
+         * @note 预留和提交之间不能再对同一个连接调用其他发送接口
+         * @return 0或错误码
+         */
+        extern int io_stream_send_reserve(io_stream_connection *connection, size_t len, void **buf);
+        extern int io_stream_send_commit(io_stream_connection *connection, void *buf, size_t len);
+
+        /**
+         * @brief 把多段数据作为一个消息发送，各段依次写入同一次预留的发送缓冲区
+         * @param connection 连接
+         * @param iov 数据段数组，所有数据段按顺序拼接成一个消息
+         * @param iovcnt 数据段数量
+         * @note 32bits hash在所有数据段写入后计算，结果和拼成连续数据后调用io_stream_send一致
+         * @return 0或错误码
+         */
+        extern int io_stream_sendv(io_stream_connection *connection, const channel_iovec_t *iov, size_t iovcnt);
+
+        /**
+         * @brief 开启或关闭连接的LZ4压缩，不小于io_stream_conf::compress_threshold的数据包压缩后变小才会以压缩帧发送
+         * @param connection 连接
+         * @param enable 是否开启
+         * @note 接收端总能识别压缩帧，但是旧版本的对端不能，所以要协商确认对端支持后再开启
+         * @note 压缩帧的EN_FN_WRITEN回调传出的是压缩后的数据
+         * @return 0或错误码
+         */
+        extern int io_stream_set_compress(io_stream_connection *connection, bool enable);
+
+        /**
+         * @brief 设置连接的帧hash校验模式
+         * @param connection 连接
+         * @param mode 校验模式(io_stream_hash_mode_t)
+         * @note 对监听的连接设置后，之后accept的连接都使用这个模式
+         * @return 0或错误码
+         */
+        extern int io_stream_set_hash_mode(io_stream_connection *connection, int mode);
+
+        /**
+         * @brief 开启或关闭发送帧的hash计算
+         * @param connection 连接
+         * @param enable 是否跳过hash计算
+         * @note 旧版本的对端和EN_HM_REQUIRED模式的对端都不接受不带hash的帧，所以要协商确认后再开启
+         * @note 不能在io_stream_send_reserve和io_stream_send_commit之间调用
+         * @return 0或错误码
+         */
+        extern int io_stream_set_skip_hash(io_stream_connection *connection, bool enable);
+
+        /**
+         * @brief 获取连接发送缓冲区中等待发送的数据长度(包含每个数据块的头部)
+         * @note 配置了io_stream_conf::send_buffer_high_watermark时，超过高水位后降到低水位会触发EN_FN_WRITABLE
+         */
+        extern size_t io_stream_get_send_queue_bytes(const io_stream_connection *connection);
+
         extern void io_stream_show_channel(io_stream_channel *channel, std::ostream &out);
+
+        // io stream worker group(多个io线程分担连接的读写、拆包和校验)
+        /**
+         * @brief 创建io线程组
+         * @param group 输出io线程组
+         * @param worker_count io线程数量
+         * @param conf 每个io线程的io_stream_channel配置，NULL表示默认配置
+         * @param queue_size 每个io线程和调用方线程之间的内存通道大小
+         * @note 创建后先调用io_stream_workers_listen，再调用io_stream_workers_start启动线程
+         * @return 0或错误码
+         */
+        extern int io_stream_workers_init(io_stream_worker_group **group, size_t worker_count, const io_stream_conf *conf,
+                                          size_t queue_size);
+
+        /**
+         * @brief 监听地址，必须在io_stream_workers_start之前调用
+         * @note 系统支持SO_REUSEPORT时每个io线程都会监听tcp地址，由内核分配新连接，否则只有第一个io线程监听
+         * @return 0或错误码
+         */
+        extern int io_stream_workers_listen(io_stream_worker_group *group, const channel_address_t &addr);
+
+        /**
+         * @brief 在调用方线程的事件循环里自动处理io线程发来的事件，必须在io_stream_workers_start之前调用
+         * @note io线程发出事件后会通过uv_async唤醒ev_loop，然后在ev_loop里调用io_stream_workers_recv
+         * @return 0或错误码
+         */
+        extern int io_stream_workers_watch(io_stream_worker_group *group, adapter::loop_t *ev_loop, io_stream_worker_callback_t callback,
+                                           void *priv_data);
+        extern int io_stream_workers_start(io_stream_worker_group *group);
+
+        // 以下接口只能在调用方线程使用，结果通过io_stream_workers_recv的EN_WE_*事件返回
+        /**
+         * @brief 主动连接，连接结果通过EN_WE_CONNECTED事件返回
+         * @param token 调用方自定义的值，EN_WE_CONNECTED事件的token会原样带回
+         * @return 0或错误码
+         */
+        extern int io_stream_workers_connect(io_stream_worker_group *group, const channel_address_t &addr, uint64_t token);
+        extern int io_stream_workers_disconnect(io_stream_worker_group *group, uint64_t conn_id);
+        extern int io_stream_workers_send(io_stream_worker_group *group, uint64_t conn_id, const void *buf, size_t len);
+
+        /**
+         * @brief 预留发送数据区，用于直接把数据打包到io线程的命令通道里
+         * @param block 输出预留的数据区，数据区是连续的，只有第一段有效
+         * @note 预留成功后必须调用io_stream_workers_send_commit，并且中间不能再调用其他发送接口
+         * @return 0或错误码
+         */
+        extern int io_stream_workers_send_reserve(io_stream_worker_group *group, uint64_t conn_id, size_t len, mem_reserved_block_t *block);
+        extern int io_stream_workers_send_commit(io_stream_worker_group *group, uint64_t conn_id, mem_reserved_block_t *block);
+
+        /**
+         * @brief 处理所有io线程发来的事件
+         * @param group io线程组
+         * @param callback 事件回调
+         * @param priv_data 回调的额外参数
+         * @param max_count 每个io线程最多处理的事件数量，0表示不限制
+         * @param count 输出处理的事件数量，可以为NULL
+         * @return 0或错误码
+         */
+        extern int io_stream_workers_recv(io_stream_worker_group *group, io_stream_worker_callback_t callback, void *priv_data,
+                                          size_t max_count, size_t *count);
+
+        // 通知所有io线程关闭连接并退出，会阻塞到所有线程结束
+        extern int io_stream_workers_close(io_stream_worker_group *group);
+        extern size_t io_stream_workers_count(const io_stream_worker_group *group);
     }
 }
 
@@ -17,11 +17,13 @@
 #include <stdint.h>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "lock/seq_alloc.h"
 #include "std/smart_ptr.h"
 
 #include "buffer.h"
+#include "io_uring.h"
 #include "libatbus_adapter_libuv.h"
 #include "libatbus_config.h"
 
@@ -38,6 +40,8 @@
 #include <sys/shm.h>
 
 #define ATBUS_CHANNEL_SHM 1
+// shm_open/mmap的共享内存，地址是 shm+posix://名称 或 shm+posix://文件路径
+#define ATBUS_CHANNEL_SHM_POSIX 1
 #else
 #include <Windows.h>
 typedef long key_t;
@@ -45,6 +49,11 @@ typedef long key_t;
 #define ATBUS_CHANNEL_SHM 1
 #endif
 
+// 门铃使用Linux的抽象命名空间unix socket，可以跨进程通知并且能被libuv监听
+#if defined(__linux__)
+#define ATBUS_CHANNEL_DOORBELL 1
+#endif
+
 namespace atbus {
     namespace channel {
         // utility functions
@@ -55,10 +64,67 @@ namespace atbus {
             int port;            // 端口。（仅网络连接有效）
         };
 
+        /**
+         * @brief POSIX共享内存的映射选项
+         */
+        struct shm_posix_flag_t {
+            enum type {
+                EN_SPF_NONE = 0,
+                EN_SPF_HUGEPAGE = 0x01, // 长度超过4倍的ATBUS_MACRO_HUGETLB_SIZE时对齐并申请透明大页，hugetlbfs下的文件总是使用大页
+                EN_SPF_POPULATE = 0x02, // 映射时预先分配并填充页表(MAP_POPULATE)，避免收发时触发缺页
+                EN_SPF_MLOCK = 0x04,    // 锁定在物理内存中，不会被换出，受RLIMIT_MEMLOCK限制，失败时忽略
+            };
+        };
+
+        // 批量发送的数据段，类似iovec
+        struct channel_iovec_t {
+            const void *base; // 数据地址
+            size_t len;       // 数据长度
+        };
+
         // memory channel
         struct mem_channel;
         struct mem_conf;
 
+        /**
+         * @brief 内存通道的消息校验方式，保存在通道头里，收发两端使用同一个配置
+         */
+        struct mem_checksum_t {
+            enum type {
+                EN_MCS_MURMUR3 = 0, // murmur3(默认，和旧版本一致)
+                EN_MCS_NONE,        // 不校验
+                EN_MCS_HEADER,      // 只校验数据长度，数据区有没有写完只靠写完标记保证
+                EN_MCS_CRC32C,      // CRC32C，CPU支持SSE4.2时使用crc32指令
+                EN_MCS_XXHASH64,    // xxhash64
+                EN_MCS_MAX,
+            };
+        };
+
+        /**
+         * @brief 零拷贝发送时预留的数据区
+         * @note 数据区在通道尾部回绕时会被拆成两段，未回绕时第二段长度为0
+         */
+        struct mem_reserved_block_t {
+            void *buffer[2];        // 可写入的数据区
+            size_t length[2];       // 可写入的数据区长度
+            size_t len;             // 预留的总长度
+            size_t begin_index;     // 起始node
+            size_t end_index;       // 结束node(不包含)
+            uint32_t operation_seq; // 操作序列号
+        };
+
+        /**
+         * @brief 零拷贝接收时取到的数据区，直接指向通道内存
+         * @note 数据区在通道尾部回绕时会被拆成两段，未回绕时第二段长度为0
+         */
+        struct mem_recv_block_t {
+            const void *buffer[2]; // 数据区
+            size_t length[2];      // 数据区长度
+            size_t len;            // 数据总长度
+            size_t begin_index;    // 起始node
+            size_t end_index;      // 结束node(不包含)
+        };
+
 #ifdef ATBUS_CHANNEL_SHM
         // shared memory channel
         struct shm_channel;
@@ -68,6 +134,9 @@ namespace atbus {
         // stream channel(tcp,pipe(unix socket) and etc. udp is not a stream)
         struct io_stream_connection;
         struct io_stream_channel;
+        struct io_stream_uring;      // io_uring后端的数据，只在channel_io_stream.cpp内使用
+        struct io_stream_uring_conn; // 连接在io_uring后端里的请求数据
+        struct io_stream_cork;       // 合并发送的待刷新列表，只在channel_io_stream.cpp内使用
         typedef void (*io_stream_callback_t)(io_stream_channel *channel,       // 事件触发的channel
                                              io_stream_connection *connection, // 事件触发的连接
                                              int status,                       // libuv传入的转态码
@@ -82,12 +151,22 @@ namespace atbus {
                 EN_FN_DISCONNECTED,
                 EN_FN_RECVED,
                 EN_FN_WRITEN,
+                EN_FN_WRITABLE, // 发送缓冲区超过高水位以后又降到了低水位
                 MAX
             };
             // 回调函数
             io_stream_callback_t callbacks[MAX];
         };
 
+        // 帧的hash校验模式
+        struct io_stream_hash_mode_t {
+            enum type {
+                EN_HM_REQUIRED = 0, // 发送的帧都计算hash，收到的帧都要校验，不接受不带hash的帧
+                EN_HM_OPTIONAL,     // 发送的帧都计算hash，也接受对端发来的不带hash的帧
+                EN_HM_OFF,          // 不校验收到的帧，对端接受时发送的帧也不计算hash
+            };
+        };
+
         // 以下不是POD类型，所以不得不暴露出来
         struct io_stream_connection {
             typedef enum {
@@ -96,6 +175,10 @@ namespace atbus {
                 EN_CF_ACCEPT,
                 EN_CF_WRITING,
                 EN_CF_CLOSING,
+                EN_CF_COMPRESS,       // 超过压缩阈值的数据包使用LZ4压缩发送，必须先确认对端支持
+                EN_CF_CORKED,         // 在合并发送的待刷新列表里
+                EN_CF_HIGH_WATERMARK, // 发送缓冲区超过了高水位，降到低水位时触发EN_FN_WRITABLE
+                EN_CF_SKIP_HASH,      // 发送的帧不计算hash，必须先确认对端接受不带hash的帧
                 EN_CF_MAX,
             } flag_t;
 
@@ -120,10 +203,20 @@ namespace atbus {
                                                   */
             typedef struct {
                 char buffer[ATBUS_MACRO_DATA_SMALL_SIZE]; // varint数据暂存区和小数据包存储区
+                size_t start;                             // 未处理数据的起始位置
                 size_t len;                               // varint数据暂存区和小数据包存储区已使用长度
+                uint32_t frame_flags;                     // 正在接收的大数据包的帧标记
             } read_head_t;
             read_head_t read_head;
             ::atbus::detail::buffer_manager write_buffers; // 写数据缓冲区(两种Buffer管理方式，一种动态，一种静态)
+            io_stream_uring_conn *uring;                   // 使用io_uring收发时不为NULL
+            int hash_mode;                                 // 帧的hash校验模式(io_stream_hash_mode_t)
+            size_t cork_size;                              // 等待合并发送的数据长度
+            uint64_t cork_time;                            // 第一个等待合并发送的数据提交的时间(uv_hrtime)
+
+            // 统计信息
+            size_t stat_send_times;  // 提交发送的数据包数量
+            size_t stat_write_times; // 实际发起写操作的次数，和stat_send_times的比值就是合并发送的效果
 
             // 自定义数据区域
             void *data;
@@ -143,6 +236,28 @@ namespace atbus {
 
             time_t confirm_timeout;
             int backlog; // backlog indicates the number of connections the kernel might queue
+            bool is_reuseport;                 // tcp监听时设置SO_REUSEPORT，允许多个线程各自监听同一个地址
+            bool is_io_uring;                  // 使用io_uring收发数据，系统不支持时回退到libuv
+            size_t compress_threshold;         // 开启压缩的连接上，不小于这个长度的数据包才尝试压缩
+            bool is_cork;                      // 合并发送，一轮loop里提交的数据在loop末尾用一次writev发出
+            size_t cork_max_delay_us;          // 合并发送时数据最多等待的微秒数，0表示只合并同一轮loop里的数据
+            size_t cork_max_size;              // 等待合并发送的数据达到这个长度时立即发送，0表示不限制
+            size_t send_buffer_high_watermark; // 发送缓冲区的高水位，0表示不检查
+            size_t send_buffer_low_watermark;  // 超过高水位以后降到这个长度以下时触发EN_FN_WRITABLE
+            int frame_hash_mode;               // tcp连接的帧hash校验模式(io_stream_hash_mode_t)
+            int unix_frame_hash_mode;          // unix socket连接的帧hash校验模式，同一台物理机上的连接不会出现传输错误
+        };
+
+        struct io_stream_compress_stat_t {
+            size_t compress_times;         // 压缩后变小并以压缩帧发送的次数
+            size_t compress_skip_times;    // 压缩后没有变小而按原样发送的次数
+            size_t compress_origin_size;   // 压缩帧的原始数据总长度
+            size_t compress_size;          // 压缩帧的数据总长度
+            uint64_t compress_cost_ns;     // 压缩耗时（包括没有变小的）
+            size_t decompress_times;       // 收到并解压的压缩帧数量
+            size_t decompress_size;        // 收到的压缩帧数据总长度
+            size_t decompress_origin_size; // 解压后的数据总长度
+            uint64_t decompress_cost_ns;   // 解压耗时
         };
 
         struct io_stream_channel {
@@ -170,10 +285,47 @@ namespace atbus {
             // 统计信息
             util::lock::seq_alloc_u32 active_reqs; // 正在进行的req数量
 
+            io_stream_uring *uring; // io_uring后端，未启用时为NULL
+            io_stream_cork *cork;   // 合并发送的待刷新列表，未启用时为NULL
+
+            // 压缩和解压的临时缓冲区，解压结果在回调期间有效，所以两个缓冲区分开
+            std::vector<unsigned char> compress_buffer;
+            std::vector<unsigned char> decompress_buffer;
+            io_stream_compress_stat_t compress_stat;
+
             // 自定义数据区域
             void *data;
         };
 
+        /**
+         * @brief io线程组，每个io线程有独立的loop和io_stream_channel
+         * @note 调用方线程和每个io线程之间各有一收一发两个单生产者单消费者的内存通道
+         */
+        struct io_stream_worker_group;
+
+        struct io_stream_worker_event_t {
+            enum type {
+                EN_WE_CONNECTED = 0, // 主动连接的结果，数据为连接地址，token是调用连接时传入的值。连接失败时conn_id为0
+                EN_WE_ACCEPTED,      // 监听的地址accept了新连接，数据为连接地址
+                EN_WE_DISCONNECTED,  // 连接断开
+                EN_WE_RECVED,        // 收到数据
+                EN_WE_SEND_FAILED,   // io线程发送失败，数据为发送失败的内容
+                EN_WE_MAX,
+            };
+        };
+
+        struct io_stream_worker_msg_t {
+            uint32_t event;   // 事件类型，见 io_stream_worker_event_t
+            int32_t errcode;  // 错误码
+            int32_t status;   // libuv传入的转态码
+            uint64_t conn_id; // 连接ID，低位是io线程的序号
+            uint64_t token;   // io_stream_workers_connect传入的值，只有EN_WE_CONNECTED事件有效
+            const void *data; // 数据区，回调结束后失效
+            size_t len;       // 数据长度
+        };
+
+        typedef void (*io_stream_worker_callback_t)(io_stream_worker_group *group, const io_stream_worker_msg_t *msg, void *priv_data);
+
 #define ATBUS_CHANNEL_IOS_CHECK_FLAG(f, v) (0 != ((f) & (1 << (v))))
 #define ATBUS_CHANNEL_IOS_SET_FLAG(f, v) (f) |= (1 << (v))
 #define ATBUS_CHANNEL_IOS_UNSET_FLAG(f, v) (f) &= ~(1 << (v))
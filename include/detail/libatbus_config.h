@@ -26,6 +26,31 @@
 #define ATBUS_MACRO_DATA_SMALL_SIZE 512
 #endif
 
+// io_stream通道默认是否使用io_uring(仅Linux)
+#ifndef ATBUS_MACRO_IOS_IO_URING
+#define ATBUS_MACRO_IOS_IO_URING 0
+#endif
+
+// 预留和提交分开的发送方式遇到其他写者冲突时的重试次数，和内存通道mem_send的默认值一致
+#ifndef ATBUS_MACRO_PUSH_RETRY_TIMES
+#define ATBUS_MACRO_PUSH_RETRY_TIMES 4
+#endif
+
+// 内存通道每次批量取出的最大消息数
+#ifndef ATBUS_MACRO_MEM_RECV_BATCH_SIZE
+#define ATBUS_MACRO_MEM_RECV_BATCH_SIZE 32
+#endif
+
+// 消息内部直接存放的路由节点数，超过以后才分配内存，默认和ttl的默认值一致
+#ifndef ATBUS_MACRO_ROUTER_INLINE_SIZE
+#define ATBUS_MACRO_ROUTER_INLINE_SIZE 16
+#endif
+
+// 数据消息下一跳缓存的最大目标数，超过以后全部清空重建
+#ifndef ATBUS_MACRO_ROUTE_CACHE_SIZE
+#define ATBUS_MACRO_ROUTE_CACHE_SIZE 8192
+#endif
+
 #if defined(__cplusplus) &&                                                                                         \
     (__cplusplus >= 201103L || (defined(_MSC_VER) && (_MSC_VER == 1500 && defined(_HAS_TR1)) || _MSC_VER > 1500) || \
      (defined(__GNUC__) && defined(__GXX_EXPERIMENTAL_CXX0X__)))
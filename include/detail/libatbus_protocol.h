@@ -3,12 +3,17 @@
 
 #pragma once
 
+#include <algorithm>
 #include <cstddef>
+#include <cstring>
+#include <new>
 #include <ostream>
 #include <stdint.h>
 
 #include <msgpack.hpp>
 
+#include "detail/libatbus_config.h"
+
 enum ATBUS_PROTOCOL_CMD {
     ATBUS_CMD_INVALID = 0,
 
@@ -37,6 +42,103 @@ namespace atbus {
 #define ATBUS_MACRO_BUSID_TYPE uint64_t
 #endif
 
+        /**
+         * @brief 前N个元素直接放在对象内部，超过以后才分配堆内存
+         * @note 只用于路由表这类元素是简单类型并且通常很短的数组
+         */
+        template <typename T, size_t N>
+        class small_vector {
+        public:
+            typedef T value_type;
+            typedef T *iterator;
+            typedef const T *const_iterator;
+
+            small_vector() : data_(inline_data_), size_(0), capacity_(N) {}
+            small_vector(const small_vector &other) : data_(inline_data_), size_(0), capacity_(N) { assign(other.begin(), other.end()); }
+            ~small_vector() {
+                if (data_ != inline_data_) {
+                    delete[] data_;
+                }
+            }
+
+            small_vector &operator=(const small_vector &other) {
+                if (this != &other) {
+                    assign(other.begin(), other.end());
+                }
+                return *this;
+            }
+
+            inline size_t size() const { return size_; }
+            inline bool empty() const { return 0 == size_; }
+            inline size_t capacity() const { return capacity_; }
+
+            inline iterator begin() { return data_; }
+            inline iterator end() { return data_ + size_; }
+            inline const_iterator begin() const { return data_; }
+            inline const_iterator end() const { return data_ + size_; }
+
+            inline T &operator[](size_t i) { return data_[i]; }
+            inline const T &operator[](size_t i) const { return data_[i]; }
+            inline T &front() { return data_[0]; }
+            inline const T &front() const { return data_[0]; }
+            inline T &back() { return data_[size_ - 1]; }
+            inline const T &back() const { return data_[size_ - 1]; }
+
+            inline void clear() { size_ = 0; }
+
+            void reserve(size_t n) {
+                if (n <= capacity_) {
+                    return;
+                }
+
+                T *new_data = new T[n];
+                std::copy(data_, data_ + size_, new_data);
+                if (data_ != inline_data_) {
+                    delete[] data_;
+                }
+                data_ = new_data;
+                capacity_ = n;
+            }
+
+            void resize(size_t n) {
+                reserve(n);
+                for (size_t i = size_; i < n; ++i) {
+                    data_[i] = T();
+                }
+                size_ = n;
+            }
+
+            void push_back(const T &v) {
+                if (size_ >= capacity_) {
+                    T copy = v;
+                    reserve(capacity_ + capacity_ + 1);
+                    data_[size_++] = copy;
+                    return;
+                }
+
+                data_[size_++] = v;
+            }
+
+            void assign(const_iterator first, const_iterator last) {
+                size_ = 0;
+                reserve(static_cast<size_t>(last - first));
+                std::copy(first, last, data_);
+                size_ = static_cast<size_t>(last - first);
+            }
+
+            friend bool operator==(const small_vector &l, const small_vector &r) {
+                return l.size_ == r.size_ && std::equal(l.begin(), l.end(), r.begin());
+            }
+
+            friend bool operator!=(const small_vector &l, const small_vector &r) { return !(l == r); }
+
+        private:
+            T *data_;
+            size_t size_;
+            size_t capacity_;
+            T inline_data_[N];
+        };
+
         struct bin_data_block {
             const void *ptr;
             size_t size;
@@ -51,8 +153,10 @@ namespace atbus {
         };
 
         struct custom_command_data {
-            ATBUS_MACRO_BUSID_TYPE from;          // ID: 0
-            std::vector<bin_data_block> commands; // ID: 1
+            typedef small_vector<bin_data_block, 8> commands_t;
+
+            ATBUS_MACRO_BUSID_TYPE from; // ID: 0
+            commands_t commands;         // ID: 1
 
             custom_command_data() : from(0) {}
 
@@ -75,11 +179,13 @@ namespace atbus {
         };
 
         struct forward_data {
-            ATBUS_MACRO_BUSID_TYPE from;                // ID: 0
-            ATBUS_MACRO_BUSID_TYPE to;                  // ID: 1
-            std::vector<ATBUS_MACRO_BUSID_TYPE> router; // ID: 2
-            bin_data_block content;                     // ID: 3
-            int flags;                                  // ID: 4 | require a response message even success
+            typedef small_vector<ATBUS_MACRO_BUSID_TYPE, ATBUS_MACRO_ROUTER_INLINE_SIZE> router_t;
+
+            ATBUS_MACRO_BUSID_TYPE from; // ID: 0
+            ATBUS_MACRO_BUSID_TYPE to;   // ID: 1
+            router_t router;             // ID: 2
+            bin_data_block content;      // ID: 3
+            int flags;                   // ID: 4 | require a response message even success
 
             enum flag_t {
                 FLAG_REQUIRE_RSP = 0,
@@ -192,17 +298,23 @@ namespace atbus {
         };
 
         struct reg_data {
+            enum frame_flag_t {
+                FRAME_FLAG_LZ4 = 0x01,     // io_stream连接支持LZ4压缩帧
+                FRAME_FLAG_NO_HASH = 0x02, // 本端接受不带校验hash的帧，REQ和RSP里都是发送方自己的设置
+            };
+
             ATBUS_MACRO_BUSID_TYPE bus_id;      // ID: 0
             int32_t pid;                        // ID: 1
             std::string hostname;               // ID: 2
             std::vector<channel_data> channels; // ID: 3
             uint32_t children_id_mask;          // ID: 4
             uint32_t flags;                     // ID: 5
+            uint32_t frame_flags;               // ID: 6 | REQ里是发起方支持的帧标记，RSP里是双方协商后开启的
 
 
-            reg_data() : bus_id(0), pid(0), children_id_mask(0), flags(0){}
+            reg_data() : bus_id(0), pid(0), children_id_mask(0), flags(0), frame_flags(0) {}
 
-            MSGPACK_DEFINE(bus_id, pid, hostname, channels, children_id_mask, flags);
+            MSGPACK_DEFINE(bus_id, pid, hostname, channels, children_id_mask, flags, frame_flags);
 
             template <typename CharT, typename Traits>
             friend std::basic_ostream<CharT, Traits> &operator<<(std::basic_ostream<CharT, Traits> &os, const reg_data &mbc) {
@@ -215,6 +327,7 @@ namespace atbus {
                 }
                 os << "      children_id_mask: " << mbc.children_id_mask << std::endl
                    << "      flags: " << mbc.flags << std::endl
+                   << "      frame_flags: " << mbc.frame_flags << std::endl
                    << "    }";
 
                 return os;
@@ -243,31 +356,20 @@ namespace atbus {
             conn_data *conn;
             custom_command_data *custom;
 
-            msg_body() : forward(NULL), sync(NULL), ping(NULL), reg(NULL), conn(NULL), custom(NULL) {}
-            ~msg_body() {
-                if (NULL != forward) {
-                    delete forward;
-                }
+            msg_body() : forward(NULL), sync(NULL), ping(NULL), reg(NULL), conn(NULL), custom(NULL), zone_(NULL) {}
 
-                if (NULL != sync) {
-                    delete sync;
-                }
+            /**
+             * @brief 消息体从zone里分配，析构时只调用析构函数，内存在zone重置时统一回收
+             */
+            explicit msg_body(msgpack::zone *z) : forward(NULL), sync(NULL), ping(NULL), reg(NULL), conn(NULL), custom(NULL), zone_(z) {}
 
-                if (NULL != ping) {
-                    delete ping;
-                }
-
-                if (NULL != reg) {
-                    delete reg;
-                }
-
-                if (NULL != conn) {
-                    delete conn;
-                }
-
-                if (NULL != custom) {
-                    delete custom;
-                }
+            ~msg_body() {
+                free_body(forward);
+                free_body(sync);
+                free_body(ping);
+                free_body(reg);
+                free_body(conn);
+                free_body(custom);
             }
 
             template <typename TPtr>
@@ -276,6 +378,10 @@ namespace atbus {
                     return p;
                 }
 
+                if (NULL != zone_) {
+                    return p = new (zone_->allocate_align(sizeof(TPtr))) TPtr();
+                }
+
                 return p = new TPtr();
             }
 
@@ -327,8 +433,24 @@ namespace atbus {
             }
 
         private:
+            template <typename TPtr>
+            void free_body(TPtr *&p) {
+                if (NULL == p) {
+                    return;
+                }
+
+                if (NULL != zone_) {
+                    p->~TPtr();
+                } else {
+                    delete p;
+                }
+                p = NULL;
+            }
+
             msg_body(const msg_body &);
             msg_body &operator=(const msg_body &);
+
+            msgpack::zone *zone_;
         };
 
         struct msg_head {
@@ -361,6 +483,9 @@ namespace atbus {
             msg_head head; // map.key = 1
             msg_body body; // map.key = 2
 
+            msg() {}
+            explicit msg(msgpack::zone *z) : body(z) {}
+
             void init(ATBUS_MACRO_BUSID_TYPE src_bus_id, ATBUS_PROTOCOL_CMD cmd, int32_t type, int32_t ret, uint32_t seq) {
                 head.cmd = cmd;
                 head.type = type;
@@ -376,6 +501,206 @@ namespace atbus {
                 return os;
             }
         };
+
+        /**
+         * @brief 数据转发消息的定长二进制格式，转发时只需要读几个字段，不需要经过msgpack
+         * @note 布局(小端): magic(1) version(1) cmd(2) type(4) ret(4) sequence(4) src_bus_id(8) from(8) to(8) flags(4) router_size(4)
+         *       头部后面是router_size个8字节的bus id，剩下的全部是数据内容
+         * @note magic使用msgpack里不会出现的0xC1，所以和msgpack格式的消息可以用首字节区分
+         */
+        struct fixed_data_msg {
+            enum {
+                MAGIC = 0xC1,
+                VERSION = 1,
+                HEAD_SIZE = 48,
+                BUS_ID_SIZE = 8,
+            };
+
+            static inline bool is_fixed(const void *buf, size_t s) {
+                return NULL != buf && s > 0 && MAGIC == *reinterpret_cast<const unsigned char *>(buf);
+            }
+
+            /** 只有数据转发消息可以使用定长格式，其他控制消息还是走msgpack **/
+            static inline bool is_supported(const msg &m) {
+                return (ATBUS_CMD_DATA_TRANSFORM_REQ == m.head.cmd || ATBUS_CMD_DATA_TRANSFORM_RSP == m.head.cmd) && NULL != m.body.forward;
+            }
+
+            static inline size_t packed_size(const msg &m) {
+                return HEAD_SIZE + m.body.forward->router.size() * BUS_ID_SIZE + m.body.forward->content.size;
+            }
+
+            /**
+             * @brief 打包消息
+             * @param o 输出流，和msgpack::packer的Stream要求一样
+             * @param m 消息，调用前要先用is_supported检查
+             */
+            template <typename Stream>
+            static void pack(Stream &o, const msg &m) {
+                const forward_data &fwd = *m.body.forward;
+                unsigned char head[HEAD_SIZE];
+                unsigned char *p = head;
+                *p++ = static_cast<unsigned char>(MAGIC);
+                *p++ = static_cast<unsigned char>(VERSION);
+                p = write_le(p, static_cast<uint64_t>(m.head.cmd), 2);
+                p = write_le(p, static_cast<uint32_t>(m.head.type), 4);
+                p = write_le(p, static_cast<uint32_t>(m.head.ret), 4);
+                p = write_le(p, m.head.sequence, 4);
+                p = write_le(p, static_cast<uint64_t>(m.head.src_bus_id), 8);
+                p = write_le(p, static_cast<uint64_t>(fwd.from), 8);
+                p = write_le(p, static_cast<uint64_t>(fwd.to), 8);
+                p = write_le(p, static_cast<uint32_t>(fwd.flags), 4);
+                p = write_le(p, static_cast<uint64_t>(fwd.router.size()), 4);
+                o.write(reinterpret_cast<const char *>(head), HEAD_SIZE);
+
+                for (size_t i = 0; i < fwd.router.size(); ++i) {
+                    unsigned char id[BUS_ID_SIZE];
+                    write_le(id, static_cast<uint64_t>(fwd.router[i]), BUS_ID_SIZE);
+                    o.write(reinterpret_cast<const char *>(id), BUS_ID_SIZE);
+                }
+
+                if (NULL != fwd.content.ptr && fwd.content.size > 0) {
+                    o.write(reinterpret_cast<const char *>(fwd.content.ptr), fwd.content.size);
+                }
+            }
+
+            /**
+             * @brief 解包消息，数据内容直接引用buf，不复制
+             * @return 格式或版本不对、长度不足时返回false
+             */
+            static bool unpack(msg &m, const void *buf, size_t s) {
+                if (s < HEAD_SIZE || !is_fixed(buf, s)) {
+                    return false;
+                }
+
+                const unsigned char *p = reinterpret_cast<const unsigned char *>(buf);
+                if (VERSION != p[1]) {
+                    return false;
+                }
+
+                m.head.cmd = static_cast<ATBUS_PROTOCOL_CMD>(read_le(p + 2, 2));
+                if (ATBUS_CMD_DATA_TRANSFORM_REQ != m.head.cmd && ATBUS_CMD_DATA_TRANSFORM_RSP != m.head.cmd) {
+                    return false;
+                }
+
+                size_t router_size = static_cast<size_t>(read_le(p + 44, 4));
+                if (router_size > (s - HEAD_SIZE) / BUS_ID_SIZE) {
+                    return false;
+                }
+
+                m.head.type = static_cast<int32_t>(read_le(p + 4, 4));
+                m.head.ret = static_cast<int32_t>(read_le(p + 8, 4));
+                m.head.sequence = static_cast<uint32_t>(read_le(p + 12, 4));
+                m.head.src_bus_id = static_cast<ATBUS_MACRO_BUSID_TYPE>(read_le(p + 16, 8));
+
+                forward_data *fwd = m.body.make_body(m.body.forward);
+                fwd->from = static_cast<ATBUS_MACRO_BUSID_TYPE>(read_le(p + 24, 8));
+                fwd->to = static_cast<ATBUS_MACRO_BUSID_TYPE>(read_le(p + 32, 8));
+                fwd->flags = static_cast<int>(read_le(p + 40, 4));
+
+                p += HEAD_SIZE;
+                fwd->router.resize(router_size);
+                for (size_t i = 0; i < router_size; ++i, p += BUS_ID_SIZE) {
+                    fwd->router[i] = static_cast<ATBUS_MACRO_BUSID_TYPE>(read_le(p, BUS_ID_SIZE));
+                }
+
+                fwd->content.size = s - HEAD_SIZE - router_size * BUS_ID_SIZE;
+                fwd->content.ptr = fwd->content.size > 0 ? p : NULL;
+                return true;
+            }
+
+            /** 直接转发时需要的头部字段，不需要构造msg **/
+            struct relay_head {
+                ATBUS_PROTOCOL_CMD cmd;
+                int32_t ret;
+                ATBUS_MACRO_BUSID_TYPE src_bus_id;
+                ATBUS_MACRO_BUSID_TYPE to;
+                int flags;
+                size_t router_size;
+            };
+
+            /**
+             * @brief 只解析转发需要的头部字段，路由表和数据内容都不读
+             * @return 格式或版本不对、长度不足时返回false，校验规则和unpack一样
+             */
+            static bool unpack_relay_head(relay_head &h, const void *buf, size_t s) {
+                if (s < HEAD_SIZE || !is_fixed(buf, s)) {
+                    return false;
+                }
+
+                const unsigned char *p = reinterpret_cast<const unsigned char *>(buf);
+                if (VERSION != p[1]) {
+                    return false;
+                }
+
+                h.cmd = static_cast<ATBUS_PROTOCOL_CMD>(read_le(p + 2, 2));
+                if (ATBUS_CMD_DATA_TRANSFORM_REQ != h.cmd && ATBUS_CMD_DATA_TRANSFORM_RSP != h.cmd) {
+                    return false;
+                }
+
+                h.router_size = static_cast<size_t>(read_le(p + 44, 4));
+                if (h.router_size > (s - HEAD_SIZE) / BUS_ID_SIZE) {
+                    return false;
+                }
+
+                h.ret = static_cast<int32_t>(read_le(p + 8, 4));
+                h.src_bus_id = static_cast<ATBUS_MACRO_BUSID_TYPE>(read_le(p + 16, 8));
+                h.to = static_cast<ATBUS_MACRO_BUSID_TYPE>(read_le(p + 32, 8));
+                h.flags = static_cast<int>(read_le(p + 40, 4));
+                return true;
+            }
+
+            /** 转发后的长度，路由表末尾多一个节点 **/
+            static inline size_t relay_size(size_t s) { return s + BUS_ID_SIZE; }
+
+            /**
+             * @brief 直接转发收到的数据，复制时把头部的src_bus_id改成本节点，并在路由表末尾追加本节点
+             * @param o 输出流，和msgpack::packer的Stream要求一样
+             * @param h unpack_relay_head解析出的头部
+             * @param buf 收到的原始数据
+             * @param s 收到的原始数据长度，输出长度是relay_size(s)
+             * @param self_id 本节点ID
+             * @note 输出和解包后追加路由再pack的结果一样
+             */
+            template <typename Stream>
+            static void relay(Stream &o, const relay_head &h, const void *buf, size_t s, ATBUS_MACRO_BUSID_TYPE self_id) {
+                const unsigned char *p = reinterpret_cast<const unsigned char *>(buf);
+
+                unsigned char head[HEAD_SIZE];
+                memcpy(head, p, HEAD_SIZE);
+                write_le(head + 16, static_cast<uint64_t>(self_id), 8);
+                write_le(head + 44, static_cast<uint64_t>(h.router_size + 1), 4);
+                o.write(reinterpret_cast<const char *>(head), HEAD_SIZE);
+
+                size_t router_len = h.router_size * BUS_ID_SIZE;
+                if (router_len > 0) {
+                    o.write(reinterpret_cast<const char *>(p + HEAD_SIZE), router_len);
+                }
+
+                unsigned char id[BUS_ID_SIZE];
+                write_le(id, static_cast<uint64_t>(self_id), BUS_ID_SIZE);
+                o.write(reinterpret_cast<const char *>(id), BUS_ID_SIZE);
+
+                if (s > HEAD_SIZE + router_len) {
+                    o.write(reinterpret_cast<const char *>(p + HEAD_SIZE + router_len), s - HEAD_SIZE - router_len);
+                }
+            }
+
+        private:
+            static inline unsigned char *write_le(unsigned char *p, uint64_t v, size_t n) {
+                for (size_t i = 0; i < n; ++i) {
+                    *p++ = static_cast<unsigned char>(v >> (i * 8));
+                }
+                return p;
+            }
+
+            static inline uint64_t read_le(const unsigned char *p, size_t n) {
+                uint64_t ret = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    ret |= static_cast<uint64_t>(p[i]) << (i * 8);
+                }
+                return ret;
+            }
+        };
     }
 }
 
@@ -415,6 +740,48 @@ namespace msgpack {
                 }
             };
 
+            template <typename T, size_t N>
+            struct convert<atbus::protocol::small_vector<T, N> > {
+                msgpack::object const &operator()(msgpack::object const &o, atbus::protocol::small_vector<T, N> &v) const {
+                    if (o.type != msgpack::type::ARRAY) throw msgpack::type_error();
+
+                    v.resize(o.via.array.size);
+                    for (uint32_t i = 0; i < o.via.array.size; ++i) {
+                        o.via.array.ptr[i].convert(v[i]);
+                    }
+                    return o;
+                }
+            };
+
+            template <typename T, size_t N>
+            struct pack<atbus::protocol::small_vector<T, N> > {
+                template <typename Stream>
+                packer<Stream> &operator()(msgpack::packer<Stream> &o, atbus::protocol::small_vector<T, N> const &v) const {
+                    o.pack_array(static_cast<uint32_t>(v.size()));
+                    for (size_t i = 0; i < v.size(); ++i) {
+                        o.pack(v[i]);
+                    }
+                    return o;
+                }
+            };
+
+            template <typename T, size_t N>
+            struct object_with_zone<atbus::protocol::small_vector<T, N> > {
+                void operator()(msgpack::object::with_zone &o, atbus::protocol::small_vector<T, N> const &v) const {
+                    o.type = type::ARRAY;
+                    o.via.array.size = static_cast<uint32_t>(v.size());
+                    if (v.empty()) {
+                        o.via.array.ptr = NULL;
+                        return;
+                    }
+
+                    o.via.array.ptr = static_cast<msgpack::object *>(o.zone.allocate_align(sizeof(msgpack::object) * v.size()));
+                    for (size_t i = 0; i < v.size(); ++i) {
+                        o.via.array.ptr[i] = msgpack::object(v[i], o.zone);
+                    }
+                }
+            };
+
             template <>
             struct convert<atbus::protocol::msg> {
                 msgpack::object const &operator()(msgpack::object const &o, atbus::protocol::msg &v) const {
@@ -638,4 +1005,35 @@ namespace msgpack {
     }     // MSGPACK_API_VERSION_NAMESPACE(MSGPACK_DEFAULT_API_NS)
 } // namespace msgpack
 
+namespace atbus {
+    namespace protocol {
+        // 消息处理完之前接收缓冲区一直有效，str和bin都直接引用，不复制到zone里
+        inline bool unpack_reference_all(msgpack::type::object_type, std::size_t, void *) { return true; }
+
+        /**
+         * @brief 解包消息，定长格式和msgpack格式都支持
+         * @param z 解包使用的zone，m也要用这个zone构造，这样消息体也从zone里分配
+         * @param m 输出的消息
+         * @param buf 数据
+         * @param s 数据长度
+         * @note 数据内容直接引用buf，buf和z都要在m析构以后才能释放或重置
+         * @return 数据错误返回false
+         */
+        inline bool unpack_msg(msgpack::zone &z, msg &m, const void *buf, size_t s) {
+            if (fixed_data_msg::is_fixed(buf, s)) {
+                return fixed_data_msg::unpack(m, buf, s);
+            }
+
+            size_t off = 0;
+            msgpack::object obj = msgpack::unpack(z, reinterpret_cast<const char *>(buf), s, off, unpack_reference_all, NULL);
+            if (obj.is_nil()) {
+                return false;
+            }
+
+            obj.convert(m);
+            return true;
+        }
+    }
+}
+
 #endif // LIBATBUS_PROTOCOL_DESC_H_
@@ -0,0 +1,40 @@
+﻿#pragma once
+
+#ifndef LIBATBUS_DETAIL_LZ4_H_
+#define LIBATBUS_DETAIL_LZ4_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace atbus {
+    namespace detail {
+        /**
+         * @brief LZ4块格式压缩后的最大长度
+         * @param s 原始数据长度
+         * @return 最大压缩长度
+         */
+        size_t lz4_compress_bound(size_t s);
+
+        /**
+         * @brief LZ4块格式压缩，输出和官方实现的LZ4_decompress_safe兼容
+         * @param src 原始数据
+         * @param src_len 原始数据长度
+         * @param dst 输出缓冲区
+         * @param dst_len 输出缓冲区长度
+         * @return 压缩后的长度，输出缓冲区不足或数据过大时返回0
+         */
+        size_t lz4_compress(const void *src, size_t src_len, void *dst, size_t dst_len);
+
+        /**
+         * @brief LZ4块格式解压，会检查所有越界
+         * @param src 压缩数据
+         * @param src_len 压缩数据长度
+         * @param dst 输出缓冲区
+         * @param dst_len 原始数据长度，解压结果必须刚好是这个长度
+         * @return 成功返回true
+         */
+        bool lz4_decompress(const void *src, size_t src_len, void *dst, size_t dst_len);
+    }
+}
+
+#endif
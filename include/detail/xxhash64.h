@@ -0,0 +1,36 @@
+﻿#pragma once
+
+#ifndef LIBATBUS_DETAIL_XXHASH64_H_
+#define LIBATBUS_DETAIL_XXHASH64_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+namespace atbus {
+    namespace detail {
+        /**
+         * @brief xxHash64，输出和官方实现XXH64一致
+         * @param seed 种子
+         * @param s 数据地址
+         * @param l 数据长度
+         * @return hash值
+         */
+        uint64_t xxhash64(uint64_t seed, const void *s, size_t l);
+
+        /**
+         * @brief 分段计算xxHash64的状态，结果和把所有数据拼起来调用xxhash64一致
+         */
+        struct xxhash64_state {
+            uint64_t total_len;
+            uint64_t v[4];
+            unsigned char mem[32]; // 不满32字节的数据
+            size_t mem_size;
+        };
+
+        void xxhash64_init(xxhash64_state &state, uint64_t seed);
+        void xxhash64_update(xxhash64_state &state, const void *s, size_t l);
+        uint64_t xxhash64_digest(const xxhash64_state &state);
+    }
+}
+
+#endif
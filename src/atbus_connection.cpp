@@ -12,6 +12,7 @@
 #include "detail/buffer.h"
 
 #include "atbus_connection.h"
+#include "atbus_msg_handler.h"
 #include "atbus_node.h"
 
 #include "detail/libatbus_protocol.h"
@@ -50,6 +51,188 @@ namespace atbus {
                 return *this;
             }
         };
+
+#ifdef ATBUS_CHANNEL_SHM_POSIX
+        static int connection_shm_posix_flags(const node::conf_t &conf) {
+            int ret = channel::shm_posix_flag_t::EN_SPF_NONE;
+            if (conf.flags.test(node::conf_flag_t::EN_CONF_SHM_HUGEPAGE)) {
+                ret |= channel::shm_posix_flag_t::EN_SPF_HUGEPAGE;
+            }
+
+            if (conf.flags.test(node::conf_flag_t::EN_CONF_SHM_PREFAULT)) {
+                ret |= channel::shm_posix_flag_t::EN_SPF_POPULATE | channel::shm_posix_flag_t::EN_SPF_MLOCK;
+            }
+
+            return ret;
+        }
+#endif
+
+#ifdef ATBUS_CHANNEL_DOORBELL
+        /**
+         * @brief 内存通道和共享内存通道接收端的门铃
+         * @note 事件循环阻塞前(prepare)设置等待标记，醒来后(check)清除，所以只有真正阻塞时发送端才会按门铃
+         */
+        struct connection_doorbell_data {
+            node *owner_node;
+            connection *conn; // 连接断开时会先关闭门铃，所以这里不需要持有引用
+            channel::mem_channel *mem_channel;
+            channel::shm_channel *shm_channel;
+            adapter::fd_t fd;
+            int closing_handles;
+
+            uv_poll_t poll_handle;
+            uv_prepare_t prepare_handle;
+            uv_check_t check_handle;
+            uv_idle_t idle_handle;
+
+            connection_doorbell_data(node *o) : owner_node(o), conn(NULL), mem_channel(NULL), shm_channel(NULL), fd(-1), closing_handles(0) {
+                assert(owner_node);
+                owner_node->ref_object(reinterpret_cast<void *>(this));
+            }
+
+            ~connection_doorbell_data() { owner_node->unref_object(reinterpret_cast<void *>(this)); }
+        };
+
+        static bool connection_doorbell_sleep(connection_doorbell_data *data) {
+            if (NULL != data->mem_channel) {
+                return channel::mem_doorbell_sleep(data->mem_channel);
+            }
+
+            return channel::shm_doorbell_sleep(data->shm_channel);
+        }
+
+        static void connection_doorbell_wakeup(connection_doorbell_data *data) {
+            if (NULL != data->mem_channel) {
+                channel::mem_doorbell_wakeup(data->mem_channel);
+            } else {
+                channel::shm_doorbell_wakeup(data->shm_channel);
+            }
+        }
+
+        static void connection_doorbell_dispatch(connection_doorbell_data *data) {
+            connection_doorbell_wakeup(data);
+            if (NULL == data->conn) {
+                return;
+            }
+
+            // 回调里可能会断开连接，需要临时加引用计数
+            connection::ptr_t holder = data->conn->watch();
+            node &n = *data->owner_node;
+            holder->proc(n, n.get_timer_sec(), n.get_timer_usec());
+        }
+
+        static void connection_doorbell_on_poll(uv_poll_t *handle, int status, int events) {
+            connection_doorbell_data *data = reinterpret_cast<connection_doorbell_data *>(handle->data);
+            channel::doorbell_drain(data->fd);
+            connection_doorbell_dispatch(data);
+        }
+
+        static void connection_doorbell_on_idle(uv_idle_t *handle) {
+            uv_idle_stop(handle);
+            connection_doorbell_dispatch(reinterpret_cast<connection_doorbell_data *>(handle->data));
+        }
+
+        static void connection_doorbell_on_prepare(uv_prepare_t *handle) {
+            connection_doorbell_data *data = reinterpret_cast<connection_doorbell_data *>(handle->data);
+            // 还有没处理完的数据时不能阻塞，用idle让事件循环立即返回并处理
+            if (false == connection_doorbell_sleep(data)) {
+                uv_idle_start(&data->idle_handle, connection_doorbell_on_idle);
+            }
+        }
+
+        static void connection_doorbell_on_check(uv_check_t *handle) {
+            connection_doorbell_wakeup(reinterpret_cast<connection_doorbell_data *>(handle->data));
+        }
+
+        static void connection_doorbell_on_closed(uv_handle_t *handle) {
+            connection_doorbell_data *data = reinterpret_cast<connection_doorbell_data *>(handle->data);
+            if (--data->closing_handles > 0) {
+                return;
+            }
+
+            channel::doorbell_close(data->fd);
+            delete data;
+        }
+
+        static connection_doorbell_data *connection_doorbell_open(node *owner, connection *conn, channel::mem_channel *mem_chann,
+                                                                  channel::shm_channel *shm_chann) {
+            if (false == owner->get_conf().flags.test(node::conf_flag_t::EN_CONF_MEM_DOORBELL)) {
+                return NULL;
+            }
+
+            char name[64] = {0};
+            UTIL_STRFUNC_SNPRINTF(name, sizeof(name), "libatbus_%d_%p", node::get_pid(), reinterpret_cast<void *>(conn));
+
+            adapter::fd_t fd = -1;
+            if (channel::doorbell_open(name, &fd) < 0) {
+                return NULL;
+            }
+
+            connection_doorbell_data *data = new connection_doorbell_data(owner);
+            if (NULL == data) {
+                channel::doorbell_close(fd);
+                return NULL;
+            }
+            data->conn = conn;
+            data->mem_channel = mem_chann;
+            data->shm_channel = shm_chann;
+            data->fd = fd;
+
+            adapter::loop_t *loop = owner->get_evloop();
+            if (0 != uv_poll_init(loop, &data->poll_handle, fd)) {
+                channel::doorbell_close(fd);
+                delete data;
+                return NULL;
+            }
+            uv_prepare_init(loop, &data->prepare_handle);
+            uv_check_init(loop, &data->check_handle);
+            uv_idle_init(loop, &data->idle_handle);
+            data->poll_handle.data = data;
+            data->prepare_handle.data = data;
+            data->check_handle.data = data;
+            data->idle_handle.data = data;
+
+            // v1的通道不支持门铃，这时候仍然使用轮询
+            int res = (NULL != mem_chann) ? channel::mem_set_doorbell(mem_chann, name) : channel::shm_set_doorbell(shm_chann, name);
+            if (res >= 0) {
+                res = uv_poll_start(&data->poll_handle, UV_READABLE, connection_doorbell_on_poll);
+            }
+
+            if (res >= 0) {
+                uv_prepare_start(&data->prepare_handle, connection_doorbell_on_prepare);
+                uv_check_start(&data->check_handle, connection_doorbell_on_check);
+                return data;
+            }
+
+            data->conn = NULL;
+            data->closing_handles = 4;
+            uv_close(reinterpret_cast<uv_handle_t *>(&data->poll_handle), connection_doorbell_on_closed);
+            uv_close(reinterpret_cast<uv_handle_t *>(&data->prepare_handle), connection_doorbell_on_closed);
+            uv_close(reinterpret_cast<uv_handle_t *>(&data->check_handle), connection_doorbell_on_closed);
+            uv_close(reinterpret_cast<uv_handle_t *>(&data->idle_handle), connection_doorbell_on_closed);
+            return NULL;
+        }
+
+        static void connection_doorbell_close(connection_doorbell_data *data) {
+            if (NULL == data) {
+                return;
+            }
+
+            // 先清除通道里的门铃地址，发送端不会再按门铃
+            if (NULL != data->mem_channel) {
+                channel::mem_set_doorbell(data->mem_channel, NULL);
+            } else {
+                channel::shm_set_doorbell(data->shm_channel, NULL);
+            }
+
+            data->conn = NULL;
+            data->closing_handles = 4;
+            uv_close(reinterpret_cast<uv_handle_t *>(&data->poll_handle), connection_doorbell_on_closed);
+            uv_close(reinterpret_cast<uv_handle_t *>(&data->prepare_handle), connection_doorbell_on_closed);
+            uv_close(reinterpret_cast<uv_handle_t *>(&data->check_handle), connection_doorbell_on_closed);
+            uv_close(reinterpret_cast<uv_handle_t *>(&data->idle_handle), connection_doorbell_on_closed);
+        }
+#endif
     }
 
     connection::connection() : state_(state_t::DISCONNECTED), owner_(NULL), binding_(NULL) {
@@ -105,7 +288,10 @@ namespace atbus {
             assert(NULL == binding_);
         }
 
+        // proc里的回调重置连接时，proc结束前仍然要屏蔽嵌套的proc
+        bool in_proc = flags_.test(flag_t::IN_PROC);
         flags_.reset();
+        flags_.set(flag_t::IN_PROC, in_proc);
         // 只要connection存在，则它一定存在于owner_的某个位置。
         // 并且这个值只能在创建时指定，所以不能重置这个值
         // owner_ = NULL;
@@ -147,6 +333,10 @@ namespace atbus {
             int res = channel::mem_attach(reinterpret_cast<void *>(ad), conf.recv_buffer_size, &mem_chann, NULL);
             if (res < 0) {
                 res = channel::mem_init(reinterpret_cast<void *>(ad), conf.recv_buffer_size, &mem_chann, NULL);
+                // 本端创建的通道才写入校验方式，attach的一端使用通道头里已有的配置
+                if (res >= 0) {
+                    res = channel::mem_set_checksum(mem_chann, conf.mem_checksum_mode);
+                }
             }
 
             if (res < 0) {
@@ -160,6 +350,9 @@ namespace atbus {
             conn_data_.shared.mem.channel = mem_chann;
             conn_data_.shared.mem.buffer = reinterpret_cast<void *>(ad);
             conn_data_.shared.mem.len = conf.recv_buffer_size;
+#ifdef ATBUS_CHANNEL_DOORBELL
+            conn_data_.shared.mem.doorbell = detail::connection_doorbell_open(owner_, this, mem_chann, NULL);
+#endif
             owner_->add_proc_connection(watcher_.lock());
             flags_.set(flag_t::REG_PROC, true);
             flags_.set(flag_t::ACCESS_SHARE_ADDR, true);
@@ -170,11 +363,38 @@ namespace atbus {
             return res;
         } else if (0 == UTIL_STRFUNC_STRNCASE_CMP("shm", address_.scheme.c_str(), 3)) {
             channel::shm_channel *shm_chann = NULL;
-            key_t shm_key;
-            util::string::str2int(shm_key, address_.host.c_str());
-            int res = channel::shm_attach(shm_key, conf.recv_buffer_size, &shm_chann, NULL);
-            if (res < 0) {
-                res = channel::shm_init(shm_key, conf.recv_buffer_size, &shm_chann, NULL);
+            key_t shm_key = 0;
+            int res;
+            connection_data_t::free_fn_t free_fn = shm_free_fn;
+            if (0 == UTIL_STRFUNC_STRNCASE_CMP("shm+posix", address_.scheme.c_str(), 9)) {
+#ifdef ATBUS_CHANNEL_SHM_POSIX
+                int shm_flags = detail::connection_shm_posix_flags(conf);
+                res = channel::shm_posix_attach(address_.host.c_str(), conf.recv_buffer_size, &shm_chann, NULL, shm_flags);
+                if (res < 0) {
+                    res = channel::shm_posix_init(address_.host.c_str(), conf.recv_buffer_size, &shm_chann, NULL, shm_flags);
+                    if (res >= 0) {
+                        res = channel::shm_set_checksum(shm_chann, conf.mem_checksum_mode);
+                        if (res < 0) {
+                            channel::shm_posix_close(address_.host.c_str());
+                        }
+                    }
+                }
+                free_fn = shm_posix_free_fn;
+#else
+                res = EN_ATBUS_ERR_CHANNEL_ADDR_INVALID;
+#endif
+            } else {
+                util::string::str2int(shm_key, address_.host.c_str());
+                res = channel::shm_attach(shm_key, conf.recv_buffer_size, &shm_chann, NULL);
+                if (res < 0) {
+                    res = channel::shm_init(shm_key, conf.recv_buffer_size, &shm_chann, NULL);
+                    if (res >= 0) {
+                        res = channel::shm_set_checksum(shm_chann, conf.mem_checksum_mode);
+                        if (res < 0) {
+                            channel::shm_close(shm_key);
+                        }
+                    }
+                }
             }
 
             if (res < 0) {
@@ -182,12 +402,15 @@ namespace atbus {
             }
 
             conn_data_.proc_fn = shm_proc_fn;
-            conn_data_.free_fn = shm_free_fn;
+            conn_data_.free_fn = free_fn;
 
             // 加入轮询队列
             conn_data_.shared.shm.channel = shm_chann;
             conn_data_.shared.shm.shm_key = shm_key;
             conn_data_.shared.shm.len = conf.recv_buffer_size;
+#ifdef ATBUS_CHANNEL_DOORBELL
+            conn_data_.shared.shm.doorbell = detail::connection_doorbell_open(owner_, this, NULL, shm_chann);
+#endif
             owner_->add_proc_connection(watcher_.lock());
             flags_.set(flag_t::REG_PROC, true);
             flags_.set(flag_t::ACCESS_SHARE_HOST, true);
@@ -195,6 +418,15 @@ namespace atbus {
             ATBUS_FUNC_NODE_DEBUG(*owner_, get_binding(), this, NULL, "channel connected(listen)");
 
             return res;
+        } else if (NULL != owner_->get_iostream_workers()) {
+            // 由io线程监听，accept的连接通过EN_WE_ACCEPTED事件通知
+            int res = channel::io_stream_workers_listen(owner_->get_iostream_workers(), address_);
+            if (res < 0) {
+                return res;
+            }
+
+            state_ = state_t::CONNECTED;
+            ATBUS_FUNC_NODE_DEBUG(*owner_, get_binding(), this, NULL, "channel connected(listen by io workers)");
         } else {
             detail::connection_async_data *async_data = new detail::connection_async_data(owner_);
             if (NULL == async_data) {
@@ -235,6 +467,10 @@ namespace atbus {
             int res = channel::mem_attach(reinterpret_cast<void *>(ad), conf.recv_buffer_size, &mem_chann, NULL);
             if (res < 0) {
                 res = channel::mem_init(reinterpret_cast<void *>(ad), conf.recv_buffer_size, &mem_chann, NULL);
+                // 本端创建的通道才写入校验方式，attach的一端使用通道头里已有的配置
+                if (res >= 0) {
+                    res = channel::mem_set_checksum(mem_chann, conf.mem_checksum_mode);
+                }
             }
 
             if (res < 0) {
@@ -244,6 +480,8 @@ namespace atbus {
             conn_data_.proc_fn = mem_proc_fn;
             conn_data_.free_fn = mem_free_fn;
             conn_data_.push_fn = mem_push_fn;
+            conn_data_.reserve_fn = mem_reserve_fn;
+            conn_data_.commit_fn = mem_commit_fn;
 
             // 连接信息
             conn_data_.shared.mem.channel = mem_chann;
@@ -255,17 +493,38 @@ namespace atbus {
                 ATBUS_FUNC_NODE_DEBUG(*owner_, binding_, this, NULL, "channel handshaking(connect)");
             } else {
                 state_ = state_t::CONNECTED;
+                owner_->invalidate_route_cache();
                 ATBUS_FUNC_NODE_DEBUG(*owner_, binding_, this, NULL, "channel connected(connect)");
             }
 
             return res;
         } else if (0 == UTIL_STRFUNC_STRNCASE_CMP("shm", address_.scheme.c_str(), 3)) {
             channel::shm_channel *shm_chann = NULL;
-            key_t shm_key;
-            util::string::str2int(shm_key, address_.host.c_str());
-            int res = channel::shm_attach(shm_key, conf.recv_buffer_size, &shm_chann, NULL);
-            if (res < 0) {
-                res = channel::shm_init(shm_key, conf.recv_buffer_size, &shm_chann, NULL);
+            key_t shm_key = 0;
+            int res;
+            connection_data_t::free_fn_t free_fn = shm_free_fn;
+            if (0 == UTIL_STRFUNC_STRNCASE_CMP("shm+posix", address_.scheme.c_str(), 9)) {
+#ifdef ATBUS_CHANNEL_SHM_POSIX
+                // 接收端在listen时创建，这里只能attach
+                // 否则对端不在同一个共享内存命名空间里（比如不同的容器）时会发送到一个没有接收端的通道里
+                int shm_flags = detail::connection_shm_posix_flags(conf);
+                res = channel::shm_posix_attach(address_.host.c_str(), conf.recv_buffer_size, &shm_chann, NULL, shm_flags);
+                free_fn = shm_posix_free_fn;
+#else
+                res = EN_ATBUS_ERR_CHANNEL_ADDR_INVALID;
+#endif
+            } else {
+                util::string::str2int(shm_key, address_.host.c_str());
+                res = channel::shm_attach(shm_key, conf.recv_buffer_size, &shm_chann, NULL);
+                if (res < 0) {
+                    res = channel::shm_init(shm_key, conf.recv_buffer_size, &shm_chann, NULL);
+                    if (res >= 0) {
+                        res = channel::shm_set_checksum(shm_chann, conf.mem_checksum_mode);
+                        if (res < 0) {
+                            channel::shm_close(shm_key);
+                        }
+                    }
+                }
             }
 
             if (res < 0) {
@@ -273,8 +532,10 @@ namespace atbus {
             }
 
             conn_data_.proc_fn = shm_proc_fn;
-            conn_data_.free_fn = shm_free_fn;
+            conn_data_.free_fn = free_fn;
             conn_data_.push_fn = shm_push_fn;
+            conn_data_.reserve_fn = shm_reserve_fn;
+            conn_data_.commit_fn = shm_commit_fn;
 
             // 连接信息
             conn_data_.shared.shm.channel = shm_chann;
@@ -282,11 +543,14 @@ namespace atbus {
             conn_data_.shared.shm.len = conf.recv_buffer_size;
 
             flags_.set(flag_t::REG_PROC, true);
+            // 标记为共享物理机，这样数据通道排序时会优先于io_stream通道
+            flags_.set(flag_t::ACCESS_SHARE_HOST, true);
             if (NULL == binding_) {
                 state_ = state_t::HANDSHAKING;
                 ATBUS_FUNC_NODE_DEBUG(*owner_, binding_, this, NULL, "channel handshaking(connect)");
             } else {
                 state_ = state_t::CONNECTED;
+                owner_->invalidate_route_cache();
                 ATBUS_FUNC_NODE_DEBUG(*owner_, binding_, this, NULL, "channel connected(connect)");
             }
 
@@ -299,6 +563,20 @@ namespace atbus {
                 make_address("ipv6", "::1", address_.port, address_);
             }
 
+            channel::io_stream_worker_group *workers = owner_->get_iostream_workers();
+            if (NULL != workers) {
+                // 连接结果通过EN_WE_CONNECTED事件带回token
+                state_ = state_t::CONNECTING;
+                uint64_t token = owner_->add_worker_connecting(watcher_.lock());
+                int res = channel::io_stream_workers_connect(workers, address_, token);
+                if (res < 0) {
+                    owner_->remove_worker_connecting(token);
+                    return res;
+                }
+
+                return EN_ATBUS_ERR_SUCCESS;
+            }
+
             detail::connection_async_data *async_data = new detail::connection_async_data(owner_);
             if (NULL == async_data) {
                 return EN_ATBUS_ERR_MALLOC;
@@ -327,13 +605,10 @@ namespace atbus {
         }
 
         state_ = state_t::DISCONNECTING;
-        if (NULL != conn_data_.free_fn) {
-            if (NULL != owner_) {
-                int res = conn_data_.free_fn(*owner_, *this);
-                if (res < 0) {
-                    ATBUS_FUNC_NODE_DEBUG(*owner_, get_binding(), this, NULL, "destroy connection failed, res: %d", res);
-                }
-            }
+        // 正在分发批量收到的消息时，消息和回调里的数据指针还引用着通道内存，要等proc结束以后再释放通道
+        bool delay_free = flags_.test(flag_t::IN_PROC);
+        if (!delay_free) {
+            free_conn_data();
         }
 
         if (NULL != owner_) {
@@ -349,11 +624,27 @@ namespace atbus {
             flags_.set(flag_t::REG_PROC, false);
         }
 
+        // 保持DISCONNECTING状态，proc结束以后再释放，在这之前也不能重新连接
+        if (delay_free) {
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
         memset(&conn_data_, 0, sizeof(conn_data_));
         state_ = state_t::DISCONNECTED;
         return EN_ATBUS_ERR_SUCCESS;
     }
 
+    void connection::free_conn_data() {
+        if (NULL == conn_data_.free_fn || NULL == owner_) {
+            return;
+        }
+
+        int res = conn_data_.free_fn(*owner_, *this);
+        if (res < 0) {
+            ATBUS_FUNC_NODE_DEBUG(*owner_, get_binding(), this, NULL, "destroy connection failed, res: %d", res);
+        }
+    }
+
     int connection::push(const void *buffer, size_t s) {
         ++stat_.push_start_times;
         stat_.push_start_size += s;
@@ -372,7 +663,180 @@ namespace atbus {
             return EN_ATBUS_ERR_ACCESS_DENY;
         }
 
-        return conn_data_.push_fn(*this, buffer, s);
+        int ret = conn_data_.push_fn(*this, buffer, s);
+        if (ret >= 0) {
+            check_send_watermark();
+        }
+
+        return ret;
+    }
+
+    int connection::push_reserve(size_t s, detail::buffer_span_writer &writer) {
+        ++stat_.push_start_times;
+        stat_.push_start_size += s;
+
+        if (state_t::CONNECTED != state_ && state_t::HANDSHAKING != state_) {
+            ++stat_.push_failed_times;
+            stat_.push_failed_size += s;
+
+            return EN_ATBUS_ERR_NOT_INITED;
+        }
+
+        if (NULL == conn_data_.reserve_fn || NULL == conn_data_.commit_fn) {
+            ++stat_.push_failed_times;
+            stat_.push_failed_size += s;
+
+            return EN_ATBUS_ERR_ACCESS_DENY;
+        }
+
+        return conn_data_.reserve_fn(*this, s, writer);
+    }
+
+    int connection::push_commit() {
+        if (NULL == conn_data_.commit_fn) {
+            return EN_ATBUS_ERR_ACCESS_DENY;
+        }
+
+        int ret = conn_data_.commit_fn(*this);
+        if (ret >= 0) {
+            check_send_watermark();
+        }
+
+        return ret;
+    }
+
+    int connection::pushv(const channel::channel_iovec_t *iov, size_t iovcnt) {
+        if (NULL == iov && iovcnt > 0) {
+            return EN_ATBUS_ERR_PARAMS;
+        }
+
+        size_t s = 0;
+        for (size_t i = 0; i < iovcnt; ++i) {
+            s += iov[i].len;
+        }
+
+        int ret = 0;
+        for (int left_try_times = ATBUS_MACRO_PUSH_RETRY_TIMES; left_try_times > 0; --left_try_times) {
+            detail::buffer_span_writer writer;
+            ret = push_reserve(s, writer);
+            if (ret < 0) {
+                return ret;
+            }
+
+            for (size_t i = 0; i < iovcnt; ++i) {
+                writer.write(reinterpret_cast<const char *>(iov[i].base), iov[i].len);
+            }
+
+            // 和其他写者冲突时重新预留
+            ret = push_commit();
+            if (!is_push_conflict(ret)) {
+                break;
+            }
+        }
+
+        return ret;
+    }
+
+    int connection::set_compress(bool enable) {
+        // 内存通道和共享内存通道不压缩
+        if (!flags_.test(flag_t::REG_FD) || NULL == conn_data_.shared.ios_fd.conn) {
+            return EN_ATBUS_ERR_ACCESS_DENY;
+        }
+
+        int ret = channel::io_stream_set_compress(conn_data_.shared.ios_fd.conn, enable);
+        if (ret >= 0) {
+            flags_.set(flag_t::COMPRESS, enable);
+        }
+
+        return ret;
+    }
+
+    int connection::get_frame_hash_mode() const {
+        if (!flags_.test(flag_t::REG_FD) || NULL == conn_data_.shared.ios_fd.conn) {
+            return channel::io_stream_hash_mode_t::EN_HM_REQUIRED;
+        }
+
+        return conn_data_.shared.ios_fd.conn->hash_mode;
+    }
+
+    int connection::set_skip_frame_hash(bool enable) {
+        if (!flags_.test(flag_t::REG_FD) || NULL == conn_data_.shared.ios_fd.conn) {
+            return EN_ATBUS_ERR_ACCESS_DENY;
+        }
+
+        int ret = channel::io_stream_set_skip_hash(conn_data_.shared.ios_fd.conn, enable);
+        if (ret >= 0) {
+            flags_.set(flag_t::SKIP_HASH, enable);
+        }
+
+        return ret;
+    }
+
+    size_t connection::get_send_queue_bytes() const {
+        if (state_t::CONNECTED != state_ && state_t::HANDSHAKING != state_) {
+            return 0;
+        }
+
+        if (flags_.test(flag_t::REG_FD)) {
+            return channel::io_stream_get_send_queue_bytes(conn_data_.shared.ios_fd.conn);
+        }
+
+        // io线程里的发送缓冲区不能跨线程访问
+        if (ios_worker_push_fn == conn_data_.push_fn) {
+            return 0;
+        }
+
+        size_t ret = 0;
+        if (mem_push_fn == conn_data_.push_fn) {
+            channel::mem_get_usage(conn_data_.shared.mem.channel, &ret, NULL);
+        } else if (shm_push_fn == conn_data_.push_fn) {
+            channel::shm_get_usage(conn_data_.shared.shm.channel, &ret, NULL);
+        }
+
+        return ret;
+    }
+
+    bool connection::check_writable() {
+        if (!flags_.test(flag_t::WRITE_BLOCKED)) {
+            return true;
+        }
+
+        if (NULL == owner_ || get_send_queue_bytes() > owner_->get_conf().send_low_watermark) {
+            return false;
+        }
+
+        flags_.set(flag_t::WRITE_BLOCKED, false);
+        return true;
+    }
+
+    void connection::check_send_watermark() {
+        if (NULL == owner_ || flags_.test(flag_t::WRITE_BLOCKED)) {
+            return;
+        }
+
+        const node::conf_t &conf = owner_->get_conf();
+        if (0 == conf.send_high_watermark || get_send_queue_bytes() < conf.send_high_watermark) {
+            return;
+        }
+
+        flags_.set(flag_t::WRITE_BLOCKED, true);
+
+        // io_stream通道由写完回调通知，内存通道和共享内存通道没有写完事件，只能在proc里检查
+        if (!flags_.test(flag_t::REG_FD)) {
+            owner_->add_writable_check(watch());
+        }
+    }
+
+    void connection::bind_worker(channel::io_stream_worker_group *group, uint64_t conn_id) {
+        conn_data_.shared.ios_worker.group = group;
+        conn_data_.shared.ios_worker.conn_id = conn_id;
+
+        conn_data_.free_fn = ios_worker_free_fn;
+        conn_data_.push_fn = ios_worker_push_fn;
+        conn_data_.reserve_fn = ios_worker_reserve_fn;
+        conn_data_.commit_fn = ios_worker_commit_fn;
+
+        owner_->add_worker_connection(conn_id, this);
     }
 
     bool connection::is_connected() const { return state_t::CONNECTED == state_; }
@@ -381,6 +845,27 @@ namespace atbus {
 
     const endpoint *connection::get_binding() const { return binding_; }
 
+    connection::proc_guard::proc_guard(connection &conn) : conn_(conn), holder_(conn.watch()), nested_(conn.flags_.test(flag_t::IN_PROC)) {
+        if (!nested_) {
+            conn_.flags_.set(flag_t::IN_PROC, true);
+        }
+    }
+
+    connection::proc_guard::~proc_guard() {
+        if (nested_) {
+            return;
+        }
+
+        conn_.flags_.set(flag_t::IN_PROC, false);
+
+        // 回调里断开的连接在这里释放通道
+        if (state_t::DISCONNECTING == conn_.state_) {
+            conn_.free_conn_data();
+            memset(&conn_.conn_data_, 0, sizeof(conn_.conn_data_));
+            conn_.state_ = state_t::DISCONNECTED;
+        }
+    }
+
     connection::ptr_t connection::watch() const {
         if (flags_.test(flag_t::DESTRUCTING) || watcher_.expired()) {
             return connection::ptr_t();
@@ -445,6 +930,7 @@ namespace atbus {
                                       "channel handshaking(connect callback)");
             } else {
                 async_data->conn->state_ = state_t::CONNECTED;
+                async_data->conn->owner_->invalidate_route_cache();
                 ATBUS_FUNC_NODE_DEBUG(*async_data->conn->owner_, async_data->conn->binding_, async_data->conn.get(), NULL,
                                       "channel connected(connect callback)");
             }
@@ -454,6 +940,8 @@ namespace atbus {
 
             async_data->conn->conn_data_.free_fn = ios_free_fn;
             async_data->conn->conn_data_.push_fn = ios_push_fn;
+            async_data->conn->conn_data_.reserve_fn = ios_reserve_fn;
+            async_data->conn->conn_data_.commit_fn = ios_commit_fn;
             connection->data = async_data->conn.get();
 
             async_data->owner_node->on_new_connection(async_data->conn.get());
@@ -484,10 +972,15 @@ namespace atbus {
         ++conn->stat_.pull_times;
         conn->stat_.pull_size += s;
 
+        // 转发给其他节点的定长格式消息直接复制给下一跳，不解包
+        if (msg_handler::relay_data_msg(*_this, *conn, buffer, s)) {
+            return;
+        }
+
         // unpack
-        msgpack::unpacked result;
-        protocol::msg m;
-        if (false == unpack(&result, *conn, m, buffer, s)) {
+        node::msg_zone_guard zone(*_this);
+        protocol::msg m(zone.get());
+        if (false == unpack(*zone.get(), *conn, m, buffer, s)) {
             return;
         }
         _this->on_recv(conn, &m, status, channel->error_code);
@@ -510,6 +1003,8 @@ namespace atbus {
 
         conn->conn_data_.free_fn = ios_free_fn;
         conn->conn_data_.push_fn = ios_push_fn;
+        conn->conn_data_.reserve_fn = ios_reserve_fn;
+        conn->conn_data_.commit_fn = ios_commit_fn;
 
         conn->conn_data_.shared.ios_fd.channel = channel;
         conn->conn_data_.shared.ios_fd.conn = conn_ios;
@@ -570,7 +1065,134 @@ namespace atbus {
         }
     }
 
+    void connection::iostream_on_writable(channel::io_stream_channel *channel, channel::io_stream_connection *conn_ios, int status,
+                                          void *buffer, size_t s) {
+        node *n = reinterpret_cast<node *>(channel->data);
+        assert(NULL != n);
+        connection *conn = reinterpret_cast<connection *>(conn_ios->data);
+        if (NULL == conn) {
+            return;
+        }
+
+        conn->flags_.set(flag_t::WRITE_BLOCKED, false);
+        ATBUS_FUNC_NODE_DEBUG(*n, conn->get_binding(), conn, NULL, "send queue of %p drop to %llu bytes", conn_ios,
+                              static_cast<unsigned long long>(s));
+        n->on_writable(conn->get_binding(), conn);
+    }
+
+    void connection::iostream_workers_on_event(channel::io_stream_worker_group *group, const channel::io_stream_worker_msg_t *msg,
+                                               void *priv_data) {
+        node *n = reinterpret_cast<node *>(priv_data);
+        assert(NULL != n);
+
+        switch (msg->event) {
+        case channel::io_stream_worker_event_t::EN_WE_ACCEPTED: {
+            ptr_t conn = create(n);
+            if (!conn) {
+                channel::io_stream_workers_disconnect(group, msg->conn_id);
+                break;
+            }
+
+            conn->state_ = state_t::HANDSHAKING;
+            conn->bind_worker(group, msg->conn_id);
+            channel::make_address(std::string(reinterpret_cast<const char *>(msg->data), msg->len).c_str(), conn->address_);
+
+            ATBUS_FUNC_NODE_DEBUG(*n, NULL, conn.get(), NULL, "connection accepted by io workers");
+            n->on_new_connection(conn.get());
+            break;
+        }
+        case channel::io_stream_worker_event_t::EN_WE_CONNECTED: {
+            ptr_t conn = n->remove_worker_connecting(msg->token);
+            // 连接在等待结果时已经被重置
+            if (!conn || state_t::CONNECTING != conn->state_) {
+                if (0 != msg->conn_id) {
+                    channel::io_stream_workers_disconnect(group, msg->conn_id);
+                }
+                break;
+            }
+
+            if (msg->errcode < 0 || 0 == msg->conn_id) {
+                ATBUS_FUNC_NODE_ERROR(*n, conn->binding_, conn.get(), msg->errcode, msg->status);
+                // 连接失败，重置连接
+                conn->reset();
+                break;
+            }
+
+            if (NULL == conn->binding_) {
+                conn->state_ = state_t::HANDSHAKING;
+                ATBUS_FUNC_NODE_DEBUG(*n, conn->binding_, conn.get(), NULL, "channel handshaking(connect by io workers)");
+            } else {
+                conn->state_ = state_t::CONNECTED;
+                n->invalidate_route_cache();
+                ATBUS_FUNC_NODE_DEBUG(*n, conn->binding_, conn.get(), NULL, "channel connected(connect by io workers)");
+            }
+
+            conn->bind_worker(group, msg->conn_id);
+            n->on_new_connection(conn.get());
+            break;
+        }
+        case channel::io_stream_worker_event_t::EN_WE_DISCONNECTED: {
+            connection *conn = n->get_worker_connection(msg->conn_id);
+            // 主动关闭时会先释放connection，这时候不需要再重置
+            if (NULL == conn) {
+                break;
+            }
+
+            ATBUS_FUNC_NODE_DEBUG(*n, conn->get_binding(), conn, NULL, "connection reset by peer");
+            conn->reset();
+            break;
+        }
+        case channel::io_stream_worker_event_t::EN_WE_RECVED: {
+            connection *conn = n->get_worker_connection(msg->conn_id);
+            if (msg->errcode < 0 || NULL == msg->data || 0 == msg->len) {
+                n->on_recv(conn, NULL, msg->errcode, msg->status);
+                break;
+            }
+
+            // connection 已经释放并解除绑定，io线程里剩下的消息直接丢弃
+            if (NULL == conn) {
+                break;
+            }
+
+            // statistic
+            ++conn->stat_.pull_times;
+            conn->stat_.pull_size += msg->len;
+
+            // 转发给其他节点的定长格式消息直接复制给下一跳，不解包
+            if (msg_handler::relay_data_msg(*n, *conn, msg->data, msg->len)) {
+                break;
+            }
+
+            // unpack，数据在回调期间一直在内存通道里，可以直接解包
+            node::msg_zone_guard zone(*n);
+            protocol::msg m(zone.get());
+            if (false == unpack(*zone.get(), *conn, m, const_cast<void *>(msg->data), msg->len)) {
+                break;
+            }
+            n->on_recv(conn, &m, msg->errcode, msg->status);
+            break;
+        }
+        case channel::io_stream_worker_event_t::EN_WE_SEND_FAILED: {
+            connection *conn = n->get_worker_connection(msg->conn_id);
+            if (NULL != conn) {
+                ++conn->stat_.push_failed_times;
+                conn->stat_.push_failed_size += msg->len;
+            }
+
+            ATBUS_FUNC_NODE_ERROR(*n, NULL == conn ? NULL : conn->get_binding(), conn, msg->errcode, msg->status);
+            break;
+        }
+        default:
+            break;
+        }
+    }
+
     int connection::shm_proc_fn(node &n, connection &conn, time_t sec, time_t usec) {
+        proc_guard guard(conn);
+        if (guard.is_nested()) {
+            return 0;
+        }
+
         int ret = 0;
         size_t left_times = n.get_conf().loop_times;
         detail::buffer_block *static_buffer = n.get_temp_static_buffer();
@@ -578,9 +1200,11 @@ namespace atbus {
             return ATBUS_FUNC_NODE_ERROR(n, NULL, &conn, EN_ATBUS_ERR_NOT_INITED, 0);
         }
 
-        while (left_times-- > 0) {
-            size_t recv_len;
-            int res = channel::shm_recv(conn.conn_data_.shared.shm.channel, static_buffer->data(), static_buffer->size(), &recv_len);
+        channel::mem_recv_block_t blocks[ATBUS_MACRO_MEM_RECV_BATCH_SIZE];
+        while (left_times > 0) {
+            size_t recv_count = 0;
+            size_t batch_size = left_times < ATBUS_MACRO_MEM_RECV_BATCH_SIZE ? left_times : ATBUS_MACRO_MEM_RECV_BATCH_SIZE;
+            int res = channel::shm_recv_batch(conn.conn_data_.shared.shm.channel, blocks, batch_size, &recv_count);
 
             if (EN_ATBUS_ERR_NO_DATA == res) {
                 break;
@@ -591,27 +1215,88 @@ namespace atbus {
                 ret = res;
                 n.on_recv(&conn, NULL, res, res);
                 break;
-            } else {
+            }
+
+            left_times -= recv_count;
+            for (size_t i = 0; i < recv_count; ++i) {
+                channel::mem_recv_block_t &block = blocks[i];
+
                 // statistic
                 ++conn.stat_.pull_times;
-                conn.stat_.pull_size += recv_len;
+                conn.stat_.pull_size += block.len;
+
+                // 未回绕的数据直接在通道内存里解包，回绕的数据要先拷贝成连续内存
+                void *recv_buffer = const_cast<void *>(block.buffer[0]);
+                if (block.length[1] > 0) {
+                    if (block.len > static_buffer->size()) {
+                        ret = EN_ATBUS_ERR_BUFF_LIMIT;
+                        n.on_recv(&conn, NULL, ret, ret);
+                        if (state_t::CONNECTED != conn.state_) {
+                            channel::shm_recv_batch_release(conn.conn_data_.shared.shm.channel, blocks, i + 1);
+                            return ret;
+                        }
+                        continue;
+                    }
+
+                    recv_buffer = static_buffer->data();
+                    memcpy(recv_buffer, block.buffer[0], block.length[0]);
+                    memcpy(reinterpret_cast<char *>(recv_buffer) + block.length[0], block.buffer[1], block.length[1]);
+                }
+
+                // 转发给其他节点的定长格式消息直接复制给下一跳，不解包
+                if (msg_handler::relay_data_msg(n, conn, recv_buffer, block.len)) {
+                    if (ret >= 0) {
+                        ++ret;
+                    }
+                    continue;
+                }
 
                 // unpack
-                msgpack::unpacked result;
-                protocol::msg m;
-                if (false == unpack(&result, conn, m, static_buffer->data(), recv_len)) {
+                node::msg_zone_guard zone(n);
+                protocol::msg m(zone.get());
+                if (false == unpack(*zone.get(), conn, m, recv_buffer, block.len)) {
                     continue;
                 }
 
                 n.on_recv(&conn, &m, res, res);
-                ++ret;
+                if (ret >= 0) {
+                    ++ret;
+                }
+
+                // 回调中连接可能已经断开，通道要等proc结束以后才释放，先释放已经处理过的消息
+                if (state_t::CONNECTED != conn.state_) {
+                    channel::shm_recv_batch_release(conn.conn_data_.shared.shm.channel, blocks, i + 1);
+                    return ret;
+                }
             }
+
+            // 回调结束后才一次性释放通道空间
+            channel::shm_recv_batch_release(conn.conn_data_.shared.shm.channel, blocks, recv_count);
         }
 
         return ret;
     }
 
-    int connection::shm_free_fn(node &n, connection &conn) { return channel::shm_close(conn.conn_data_.shared.shm.shm_key); }
+    int connection::shm_free_fn(node &n, connection &conn) {
+#ifdef ATBUS_CHANNEL_DOORBELL
+        detail::connection_doorbell_close(conn.conn_data_.shared.shm.doorbell);
+        conn.conn_data_.shared.shm.doorbell = NULL;
+#endif
+        return channel::shm_close(conn.conn_data_.shared.shm.shm_key);
+    }
+
+    int connection::shm_posix_free_fn(node &n, connection &conn) {
+#ifdef ATBUS_CHANNEL_DOORBELL
+        detail::connection_doorbell_close(conn.conn_data_.shared.shm.doorbell);
+        conn.conn_data_.shared.shm.doorbell = NULL;
+#endif
+
+#ifdef ATBUS_CHANNEL_SHM_POSIX
+        return channel::shm_posix_close(conn.address_.host.c_str());
+#else
+        return EN_ATBUS_ERR_SUCCESS;
+#endif
+    }
 
     int connection::shm_push_fn(connection &conn, const void *buffer, size_t s) {
         int ret = channel::shm_send(conn.conn_data_.shared.shm.channel, buffer, s);
@@ -626,7 +1311,39 @@ namespace atbus {
         return ret;
     }
 
+    int connection::shm_reserve_fn(connection &conn, size_t s, detail::buffer_span_writer &writer) {
+        channel::mem_reserved_block_t &block = conn.conn_data_.reserved.mem;
+        int ret = channel::shm_send_reserve(conn.conn_data_.shared.shm.channel, s, &block);
+        if (ret < 0) {
+            ++conn.stat_.push_failed_times;
+            conn.stat_.push_failed_size += s;
+            return ret;
+        }
+
+        writer.reset(block.buffer[0], block.length[0], block.buffer[1], block.length[1]);
+        return ret;
+    }
+
+    int connection::shm_commit_fn(connection &conn) {
+        channel::mem_reserved_block_t &block = conn.conn_data_.reserved.mem;
+        int ret = channel::shm_send_commit(conn.conn_data_.shared.shm.channel, &block);
+        if (ret >= 0) {
+            ++conn.stat_.push_success_times;
+            conn.stat_.push_success_size += block.len;
+        } else {
+            ++conn.stat_.push_failed_times;
+            conn.stat_.push_failed_size += block.len;
+        }
+
+        return ret;
+    }
+
     int connection::mem_proc_fn(node &n, connection &conn, time_t sec, time_t usec) {
+        proc_guard guard(conn);
+        if (guard.is_nested()) {
+            return 0;
+        }
+
         int ret = 0;
         size_t left_times = n.get_conf().loop_times;
         detail::buffer_block *static_buffer = n.get_temp_static_buffer();
@@ -634,9 +1351,11 @@ namespace atbus {
             return ATBUS_FUNC_NODE_ERROR(n, NULL, &conn, EN_ATBUS_ERR_NOT_INITED, 0);
         }
 
-        while (left_times-- > 0) {
-            size_t recv_len;
-            int res = channel::mem_recv(conn.conn_data_.shared.mem.channel, static_buffer->data(), static_buffer->size(), &recv_len);
+        channel::mem_recv_block_t blocks[ATBUS_MACRO_MEM_RECV_BATCH_SIZE];
+        while (left_times > 0) {
+            size_t recv_count = 0;
+            size_t batch_size = left_times < ATBUS_MACRO_MEM_RECV_BATCH_SIZE ? left_times : ATBUS_MACRO_MEM_RECV_BATCH_SIZE;
+            int res = channel::mem_recv_batch(conn.conn_data_.shared.mem.channel, blocks, batch_size, &recv_count);
 
             if (EN_ATBUS_ERR_NO_DATA == res) {
                 break;
@@ -647,27 +1366,75 @@ namespace atbus {
                 ret = res;
                 n.on_recv(&conn, NULL, res, res);
                 break;
-            } else {
+            }
+
+            left_times -= recv_count;
+            for (size_t i = 0; i < recv_count; ++i) {
+                channel::mem_recv_block_t &block = blocks[i];
+
                 // statistic
                 ++conn.stat_.pull_times;
-                conn.stat_.pull_size += recv_len;
+                conn.stat_.pull_size += block.len;
+
+                // 未回绕的数据直接在通道内存里解包，回绕的数据要先拷贝成连续内存
+                void *recv_buffer = const_cast<void *>(block.buffer[0]);
+                if (block.length[1] > 0) {
+                    if (block.len > static_buffer->size()) {
+                        ret = EN_ATBUS_ERR_BUFF_LIMIT;
+                        n.on_recv(&conn, NULL, ret, ret);
+                        if (state_t::CONNECTED != conn.state_) {
+                            channel::mem_recv_batch_release(conn.conn_data_.shared.mem.channel, blocks, i + 1);
+                            return ret;
+                        }
+                        continue;
+                    }
+
+                    recv_buffer = static_buffer->data();
+                    memcpy(recv_buffer, block.buffer[0], block.length[0]);
+                    memcpy(reinterpret_cast<char *>(recv_buffer) + block.length[0], block.buffer[1], block.length[1]);
+                }
+
+                // 转发给其他节点的定长格式消息直接复制给下一跳，不解包
+                if (msg_handler::relay_data_msg(n, conn, recv_buffer, block.len)) {
+                    if (ret >= 0) {
+                        ++ret;
+                    }
+                    continue;
+                }
 
                 // unpack
-                msgpack::unpacked result;
-                protocol::msg m;
-                if (false == unpack(&result, conn, m, static_buffer->data(), recv_len)) {
+                node::msg_zone_guard zone(n);
+                protocol::msg m(zone.get());
+                if (false == unpack(*zone.get(), conn, m, recv_buffer, block.len)) {
                     continue;
                 }
 
                 n.on_recv(&conn, &m, res, res);
-                ++ret;
+                if (ret >= 0) {
+                    ++ret;
+                }
+
+                // 回调中连接可能已经断开，通道要等proc结束以后才释放，先释放已经处理过的消息
+                if (state_t::CONNECTED != conn.state_) {
+                    channel::mem_recv_batch_release(conn.conn_data_.shared.mem.channel, blocks, i + 1);
+                    return ret;
+                }
             }
+
+            // 回调结束后才一次性释放通道空间
+            channel::mem_recv_batch_release(conn.conn_data_.shared.mem.channel, blocks, recv_count);
         }
 
         return ret;
     }
 
-    int connection::mem_free_fn(node &n, connection &conn) { return 0; }
+    int connection::mem_free_fn(node &n, connection &conn) {
+#ifdef ATBUS_CHANNEL_DOORBELL
+        detail::connection_doorbell_close(conn.conn_data_.shared.mem.doorbell);
+        conn.conn_data_.shared.mem.doorbell = NULL;
+#endif
+        return 0;
+    }
 
     int connection::mem_push_fn(connection &conn, const void *buffer, size_t s) {
         int ret = channel::mem_send(conn.conn_data_.shared.mem.channel, buffer, s);
@@ -681,6 +1448,32 @@ namespace atbus {
         return ret;
     }
 
+    int connection::mem_reserve_fn(connection &conn, size_t s, detail::buffer_span_writer &writer) {
+        channel::mem_reserved_block_t &block = conn.conn_data_.reserved.mem;
+        int ret = channel::mem_send_reserve(conn.conn_data_.shared.mem.channel, s, &block);
+        if (ret < 0) {
+            ++conn.stat_.push_failed_times;
+            conn.stat_.push_failed_size += s;
+            return ret;
+        }
+
+        writer.reset(block.buffer[0], block.length[0], block.buffer[1], block.length[1]);
+        return ret;
+    }
+
+    int connection::mem_commit_fn(connection &conn) {
+        channel::mem_reserved_block_t &block = conn.conn_data_.reserved.mem;
+        int ret = channel::mem_send_commit(conn.conn_data_.shared.mem.channel, &block);
+        if (ret >= 0) {
+            ++conn.stat_.push_success_times;
+            conn.stat_.push_success_size += block.len;
+        } else {
+            ++conn.stat_.push_failed_times;
+            conn.stat_.push_failed_size += block.len;
+        }
+        return ret;
+    }
+
     int connection::ios_free_fn(node &n, connection &conn) {
         int ret = channel::io_stream_disconnect(conn.conn_data_.shared.ios_fd.channel, conn.conn_data_.shared.ios_fd.conn, NULL);
         // 释放后移除关联关系
@@ -698,16 +1491,87 @@ namespace atbus {
         return ret;
     }
 
-    bool connection::unpack(void *res, connection &conn, atbus::protocol::msg &m, void *buffer, size_t s) {
-        msgpack::unpacked *result = reinterpret_cast<msgpack::unpacked *>(res);
-        msgpack::unpack(*result, reinterpret_cast<const char *>(buffer), s);
-        msgpack::object obj = result->get();
-        if (obj.is_nil()) {
+    int connection::ios_reserve_fn(connection &conn, size_t s, detail::buffer_span_writer &writer) {
+        reserved_data_ios &block = conn.conn_data_.reserved.ios_fd;
+        block.buffer = NULL;
+        block.len = s;
+
+        int ret = channel::io_stream_send_reserve(conn.conn_data_.shared.ios_fd.conn, s, &block.buffer);
+        if (ret < 0) {
+            ++conn.stat_.push_failed_times;
+            conn.stat_.push_failed_size += s;
+            return ret;
+        }
+
+        writer.reset(block.buffer, block.len);
+        return ret;
+    }
+
+    int connection::ios_commit_fn(connection &conn) {
+        reserved_data_ios &block = conn.conn_data_.reserved.ios_fd;
+        // 发送成功的统计在写出回调里
+        int ret = channel::io_stream_send_commit(conn.conn_data_.shared.ios_fd.conn, block.buffer, block.len);
+        if (ret < 0) {
+            ++conn.stat_.push_failed_times;
+            conn.stat_.push_failed_size += block.len;
+        }
+        return ret;
+    }
+
+    int connection::ios_worker_free_fn(node &n, connection &conn) {
+        n.remove_worker_connection(conn.conn_data_.shared.ios_worker.conn_id);
+        return channel::io_stream_workers_disconnect(conn.conn_data_.shared.ios_worker.group, conn.conn_data_.shared.ios_worker.conn_id);
+    }
+
+    int connection::ios_worker_push_fn(connection &conn, const void *buffer, size_t s) {
+        // 写入io线程的命令通道就算发送成功，io线程里发送失败会通过EN_WE_SEND_FAILED事件通知
+        int ret = channel::io_stream_workers_send(conn.conn_data_.shared.ios_worker.group, conn.conn_data_.shared.ios_worker.conn_id,
+                                                  buffer, s);
+        if (ret >= 0) {
+            ++conn.stat_.push_success_times;
+            conn.stat_.push_success_size += s;
+        } else {
+            ++conn.stat_.push_failed_times;
+            conn.stat_.push_failed_size += s;
+        }
+        return ret;
+    }
+
+    int connection::ios_worker_reserve_fn(connection &conn, size_t s, detail::buffer_span_writer &writer) {
+        channel::mem_reserved_block_t &block = conn.conn_data_.reserved.mem;
+        int ret = channel::io_stream_workers_send_reserve(conn.conn_data_.shared.ios_worker.group,
+                                                          conn.conn_data_.shared.ios_worker.conn_id, s, &block);
+        if (ret < 0) {
+            ++conn.stat_.push_failed_times;
+            conn.stat_.push_failed_size += s;
+            return ret;
+        }
+
+        writer.reset(block.buffer[0], block.length[0]);
+        return ret;
+    }
+
+    int connection::ios_worker_commit_fn(connection &conn) {
+        channel::mem_reserved_block_t &block = conn.conn_data_.reserved.mem;
+        size_t s = block.len;
+        int ret = channel::io_stream_workers_send_commit(conn.conn_data_.shared.ios_worker.group,
+                                                         conn.conn_data_.shared.ios_worker.conn_id, &block);
+        if (ret >= 0) {
+            ++conn.stat_.push_success_times;
+            conn.stat_.push_success_size += s;
+        } else {
+            ++conn.stat_.push_failed_times;
+            conn.stat_.push_failed_size += s;
+        }
+        return ret;
+    }
+
+    bool connection::unpack(msgpack::zone &z, connection &conn, atbus::protocol::msg &m, void *buffer, size_t s) {
+        if (!protocol::unpack_msg(z, m, buffer, s)) {
             ATBUS_FUNC_NODE_ERROR(*conn.owner_, conn.binding_, &conn, EN_ATBUS_ERR_UNPACK, EN_ATBUS_ERR_UNPACK);
             return false;
         }
 
-        obj.convert(m);
         return true;
     }
 }
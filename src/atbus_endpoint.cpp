@@ -50,6 +50,9 @@ namespace atbus {
             return;
         }
         flags_.set(flag_t::RESETTING, true);
+        if (NULL != owner_) {
+            owner_->invalidate_route_cache();
+        }
 
         // 需要临时给自身加引用计数，否则后续移除的过程中可能导致数据被提前释放
         ptr_t tmp_holder = watcher_.lock();
@@ -145,6 +148,11 @@ namespace atbus {
         if (connection::state_t::HANDSHAKING == conn->get_status()) {
             conn->state_ = connection::state_t::CONNECTED;
         }
+
+        // 新的连接可能比缓存的下一跳更快
+        if (NULL != owner_) {
+            owner_->invalidate_route_cache();
+        }
         return true;
     }
 
@@ -187,6 +195,9 @@ namespace atbus {
             if ((*iter).get() == conn) {
                 conn->binding_ = NULL;
                 data_conn_.erase(iter);
+                if (NULL != owner_) {
+                    owner_->invalidate_route_cache();
+                }
 
                 // 数据节点全部离线也直接下线
                 // 内存和共享内存通道不会被动下线
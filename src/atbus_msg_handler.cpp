@@ -1,4 +1,5 @@
-﻿#include <sstream>
+﻿#include <assert.h>
+#include <sstream>
 
 #include "common/string_oprs.h"
 
@@ -127,6 +128,20 @@ namespace atbus {
         reg->children_id_mask = n.get_self_endpoint()->get_children_mask();
         reg->flags = n.get_self_endpoint()->get_flags();
 
+        // 请求包里告诉对端自己支持的帧标记，回包里是已经开启的
+        if (ATBUS_CMD_NODE_REG_REQ == msg_id) {
+            if (conn.check_flag(connection::flag_t::REG_FD) && n.get_conf().flags.test(node::conf_flag_t::EN_CONF_IOS_COMPRESS)) {
+                reg->frame_flags |= protocol::reg_data::FRAME_FLAG_LZ4;
+            }
+        } else if (conn.check_flag(connection::flag_t::COMPRESS)) {
+            reg->frame_flags |= protocol::reg_data::FRAME_FLAG_LZ4;
+        }
+
+        // 是否接受不带hash的帧和连接类型有关，请求包和回包里都带上
+        if (conn.get_frame_hash_mode() != channel::io_stream_hash_mode_t::EN_HM_REQUIRED) {
+            reg->frame_flags |= protocol::reg_data::FRAME_FLAG_NO_HASH;
+        }
+
         return send_msg(n, conn, m);
     }
 
@@ -139,20 +154,118 @@ namespace atbus {
     }
 
     int msg_handler::send_msg(node &n, connection &conn, const protocol::msg &m) {
-        std::stringstream ss;
-        msgpack::pack(ss, m);
-        std::string packed_buffer = ss.str();
+        // 对端支持时数据转发消息使用定长格式
+        bool use_fixed = protocol::fixed_data_msg::is_supported(m) && NULL != conn.get_binding() &&
+                         conn.get_binding()->get_flag(endpoint::flag_t::FIXED_DATA_MSG);
+
+        // 先计算打包后的长度，再直接打包到通道的发送缓冲区，避免中间的内存分配和拷贝
+        size_t packed_size;
+        if (use_fixed) {
+            packed_size = protocol::fixed_data_msg::packed_size(m);
+        } else {
+            detail::buffer_size_counter counter;
+            msgpack::pack(counter, m);
+            packed_size = counter.size();
+        }
 
-        if (packed_buffer.size() >= n.get_conf().msg_size) {
+        if (packed_size >= n.get_conf().msg_size) {
             return EN_ATBUS_ERR_BUFF_LIMIT;
         }
 
         ATBUS_FUNC_NODE_DEBUG(n, conn.get_binding(), &conn, &m, "node send msg(cmd=%s, type=%d, sequence=%u, ret=%d, length=%llu)",
                               detail::get_cmd_name(m.head.cmd), m.head.type, m.head.sequence, m.head.ret,
-                              static_cast<unsigned long long>(packed_buffer.size()));
+                              static_cast<unsigned long long>(packed_size));
+
+        int res = 0;
+        for (int left_try_times = ATBUS_MACRO_PUSH_RETRY_TIMES; left_try_times > 0; --left_try_times) {
+            detail::buffer_span_writer writer;
+            res = conn.push_reserve(packed_size, writer);
+            if (res < 0) {
+                return res;
+            }
+
+            if (use_fixed) {
+                protocol::fixed_data_msg::pack(writer, m);
+            } else {
+                msgpack::pack(writer, m);
+            }
+            assert(writer.size() == packed_size);
+
+            // 共享内存通道有多个写者时可能和其他写者冲突，这时候数据没有发出，重新预留并打包
+            res = conn.push_commit();
+            if (!connection::is_push_conflict(res)) {
+                break;
+            }
+        }
+
+        return res;
+    }
+
+    bool msg_handler::relay_data_msg(node &n, connection &conn, const void *buffer, size_t s) {
+        protocol::fixed_data_msg::relay_head head;
+        if (!protocol::fixed_data_msg::unpack_relay_head(head, buffer, s)) {
+            return false;
+        }
+
+        // 只直接转发不需要回包的请求，发给自己的、需要回包的和超过TTL的都走完整的解包流程
+        if (ATBUS_CMD_DATA_TRANSFORM_REQ != head.cmd || head.ret < 0 || head.to == n.get_id() ||
+            0 != (head.flags & (1 << protocol::forward_data::FLAG_REQUIRE_RSP)) ||
+            head.router_size >= static_cast<size_t>(n.get_conf().ttl)) {
+            return false;
+        }
+
+        endpoint *to_ep = NULL;
+        connection *to_conn = NULL;
+        if (n.get_remote_channel(head.to, &endpoint::get_data_connection, &to_ep, &to_conn) < 0 || NULL == to_conn) {
+            return false;
+        }
+
+        // 下一跳只支持msgpack时要重新打包
+        if (NULL == to_conn->get_binding() || !to_conn->get_binding()->get_flag(endpoint::flag_t::FIXED_DATA_MSG)) {
+            return false;
+        }
+
+        // 子节点之间转发时要通知建立直连
+        if (n.is_child_node(head.to) && NULL != to_ep && n.is_child_node(head.src_bus_id) && n.is_child_node(to_ep->get_id())) {
+            return false;
+        }
+
+        size_t packed_size = protocol::fixed_data_msg::relay_size(s);
+        if (packed_size >= n.get_conf().msg_size) {
+            return false;
+        }
+
+        ATBUS_FUNC_NODE_DEBUG(n, to_conn->get_binding(), to_conn, NULL, "node relay msg(cmd=%s, to=0x%llx, length=%llu)",
+                              detail::get_cmd_name(head.cmd), static_cast<unsigned long long>(head.to),
+                              static_cast<unsigned long long>(packed_size));
 
-        return conn.push(packed_buffer.data(), packed_buffer.size());
-        ;
+        int res = 0;
+        for (int left_try_times = ATBUS_MACRO_PUSH_RETRY_TIMES; left_try_times > 0; --left_try_times) {
+            detail::buffer_span_writer writer;
+            res = to_conn->push_reserve(packed_size, writer);
+            if (res < 0) {
+                break;
+            }
+
+            protocol::fixed_data_msg::relay(writer, head, buffer, s, n.get_id());
+            assert(writer.size() == packed_size);
+
+            res = to_conn->push_commit();
+            if (!connection::is_push_conflict(res)) {
+                break;
+            }
+        }
+
+        // 发送失败时数据没有发出，走完整流程重试、转给父节点或回包
+        if (res < 0) {
+            return false;
+        }
+
+        n.stat_add_dispatch_times();
+        if (NULL != conn.get_binding()) {
+            conn.get_binding()->clear_stat_fault();
+        }
+        return true;
     }
 
     int msg_handler::on_recv_data_transfer_req(node &n, connection *conn, protocol::msg &m, int status, int errcode) {
@@ -198,8 +311,7 @@ namespace atbus {
                 const std::list<std::string> &listen_addrs = to_ep->get_listen();
                 for (std::list<std::string>::const_iterator iter = listen_addrs.begin(); iter != listen_addrs.end(); ++iter) {
                     // 通知连接控制通道，控制通道不能是（共享）内存通道
-                    if (0 != UTIL_STRFUNC_STRNCASE_CMP("mem:", iter->c_str(), 4) &&
-                        0 != UTIL_STRFUNC_STRNCASE_CMP("shm:", iter->c_str(), 4)) {
+                    if (!channel::is_memory_channel_address(iter->c_str())) {
                         new_conn->address.address = *iter;
                         break;
                     }
@@ -349,6 +461,8 @@ namespace atbus {
                 break;
             }
             ep->set_flag(endpoint::flag_t::GLOBAL_ROUTER, reg_flags.test(endpoint::flag_t::GLOBAL_ROUTER));
+            // 老版本的节点不会设置这个标记，发给它们的数据消息还是用msgpack
+            ep->set_flag(endpoint::flag_t::FIXED_DATA_MSG, reg_flags.test(endpoint::flag_t::FIXED_DATA_MSG));
 
             ATBUS_FUNC_NODE_DEBUG(n, ep, conn, &m, "node add a new endpoint, res: %d", res);
             // 新的endpoint要建立所有连接
@@ -359,8 +473,7 @@ namespace atbus {
             bool has_ios_listen = false;
             for (std::list<std::string>::const_iterator iter = n.get_listen_list().begin();
                 !has_ios_listen && iter != n.get_listen_list().end(); ++iter) {
-                if (0 != UTIL_STRFUNC_STRNCASE_CMP("mem:", iter->c_str(), 4) &&
-                    0 != UTIL_STRFUNC_STRNCASE_CMP("shm:", iter->c_str(), 4)) {
+                if (!channel::is_memory_channel_address(iter->c_str())) {
                     has_ios_listen = true;
                 }
             }
@@ -373,14 +486,15 @@ namespace atbus {
                 if (has_ios_listen && n.get_id() > ep->get_id()) {
                     // wait peer to connect n, do not check and close endpoint
                     has_data_conn = true;
-                    if (0 != UTIL_STRFUNC_STRNCASE_CMP("mem:", chan.address.c_str(), 4) &&
-                        0 != UTIL_STRFUNC_STRNCASE_CMP("shm:", chan.address.c_str(), 4)) {
+                    if (!channel::is_memory_channel_address(chan.address.c_str())) {
                         continue;
                     }
                 }
 
-                // unix sock only available in the same host
-                if (0 == UTIL_STRFUNC_STRNCASE_CMP("unix:", chan.address.c_str(), 5) &&
+                // unix sock and shm only available in the same host
+                // 自动创建的共享内存通道会发给所有节点，这里过滤掉其他物理机的，这些节点仍然使用io_stream通道
+                if ((0 == UTIL_STRFUNC_STRNCASE_CMP("unix:", chan.address.c_str(), 5) ||
+                     0 == UTIL_STRFUNC_STRNCASE_CMP("shm", chan.address.c_str(), 3)) &&
                     ep->get_hostname() != n.get_hostname()) {
                     continue;
                 }
@@ -409,6 +523,18 @@ namespace atbus {
 
         // 仅fd连接发回注册回包，否则忽略（内存和共享内存通道为单工通道）
         if (NULL != conn && conn->check_flag(connection::flag_t::REG_FD)) {
+            // 双方都支持并且不在同一台物理机上时开启压缩，对端收到回包后也开启
+            if (rsp_code >= 0 && NULL != ep && n.get_conf().flags.test(node::conf_flag_t::EN_CONF_IOS_COMPRESS) &&
+                0 != (m.body.reg->frame_flags & protocol::reg_data::FRAME_FLAG_LZ4) && ep->get_hostname() != n.get_hostname()) {
+                conn->set_compress(true);
+            }
+
+            // 本端不需要校验并且对端接受时，发送的数据不再计算hash
+            if (rsp_code >= 0 && 0 != (m.body.reg->frame_flags & protocol::reg_data::FRAME_FLAG_NO_HASH) &&
+                channel::io_stream_hash_mode_t::EN_HM_OFF == conn->get_frame_hash_mode()) {
+                conn->set_skip_frame_hash(true);
+            }
+
             int ret = send_reg(ATBUS_CMD_NODE_REG_RSP, n, *conn, rsp_code, m.head.sequence);
             if (rsp_code < 0) {
                 ATBUS_FUNC_NODE_ERROR(n, ep, conn, ret, errcode);
@@ -429,6 +555,17 @@ namespace atbus {
         endpoint *ep = conn->get_binding();
         n.on_reg(ep, conn, m.head.ret);
 
+        // 对端确认开启压缩后，本端发送的数据也开始压缩
+        if (m.head.ret >= 0 && NULL != m.body.reg && 0 != (m.body.reg->frame_flags & protocol::reg_data::FRAME_FLAG_LZ4) &&
+            n.get_conf().flags.test(node::conf_flag_t::EN_CONF_IOS_COMPRESS)) {
+            conn->set_compress(true);
+        }
+
+        if (m.head.ret >= 0 && NULL != m.body.reg && 0 != (m.body.reg->frame_flags & protocol::reg_data::FRAME_FLAG_NO_HASH) &&
+            channel::io_stream_hash_mode_t::EN_HM_OFF == conn->get_frame_hash_mode()) {
+            conn->set_skip_frame_hash(true);
+        }
+
         if (m.head.ret < 0) {
             if (NULL != ep) {
                 n.add_check_list(ep->watch());
@@ -34,7 +34,11 @@
 #include "detail/libatbus_protocol.h"
 
 namespace atbus {
-    node::node() : state_(state_t::CREATED), ev_loop_(NULL), static_buffer_(NULL), on_debug(NULL) {
+    node::route_cache_t::route_cache_t() : ep(NULL), conn(NULL), version(0) {}
+
+    node::node()
+        : state_(state_t::CREATED), ev_loop_(NULL), worker_connecting_token_(0), static_buffer_(NULL), route_cache_version_(1),
+          on_debug(NULL) {
         event_timer_.sec = 0;
         event_timer_.usec = 0;
         event_timer_.node_sync_push = 0;
@@ -48,11 +52,18 @@ namespace atbus {
         delete p;
     }
 
+    void node::io_stream_workers_del::operator()(channel::io_stream_worker_group *p) const { channel::io_stream_workers_close(p); }
+
     node::~node() {
         if (state_t::CREATED != state_) {
             reset();
         }
 
+        for (size_t i = 0; i < msg_zone_pool_.size(); ++i) {
+            delete msg_zone_pool_[i];
+        }
+        msg_zone_pool_.clear();
+
         ATBUS_FUNC_NODE_DEBUG(*this, NULL, NULL, NULL, "node destroyed");
     }
 
@@ -72,6 +83,14 @@ namespace atbus {
         conf->recv_buffer_size = ATBUS_MACRO_MSG_LIMIT * 32; // default for 3 times of ATBUS_MACRO_MSG_LIMIT = 2MB
         conf->send_buffer_size = ATBUS_MACRO_MSG_LIMIT;
         conf->send_buffer_number = 0;
+        conf->compress_threshold = 0;
+        conf->send_high_watermark = 0;
+        conf->send_low_watermark = 0;
+        conf->frame_hash_mode = channel::io_stream_hash_mode_t::EN_HM_REQUIRED;
+        conf->unix_frame_hash_mode = channel::io_stream_hash_mode_t::EN_HM_OPTIONAL;
+        conf->mem_checksum_mode = channel::mem_checksum_t::EN_MCS_MURMUR3;
+        conf->io_worker_count = 0;
+        conf->io_worker_queue_size = ATBUS_MACRO_MSG_LIMIT * 32;
 
         conf->flags.reset();
     }
@@ -104,6 +123,7 @@ namespace atbus {
         }
         // 复制配置
         self_->set_flag(endpoint::flag_t::GLOBAL_ROUTER, conf_.flags.test(conf_flag_t::EN_CONF_GLOBAL_ROUTER));
+        self_->set_flag(endpoint::flag_t::FIXED_DATA_MSG, true);
 
         static_buffer_ = detail::buffer_block::malloc(conf_.msg_size + detail::buffer_block::head_size(conf_.msg_size) +
                                                       16); // 预留hash码32位长度和vint长度);
@@ -120,6 +140,23 @@ namespace atbus {
         // 初始化时间
         event_timer_.sec = time(NULL);
 
+        // 启动io线程，之前的监听已经分配到各个io线程里
+        if (NULL != get_iostream_workers()) {
+            int res = channel::io_stream_workers_start(iostream_workers_.get());
+            if (res < 0 && EN_ATBUS_ERR_ALREADY_INITED != res) {
+                ATBUS_FUNC_NODE_ERROR(*this, self_.get(), NULL, res, 0);
+                return res;
+            }
+        }
+
+        // 要在连接父节点之前创建，注册时才会通过reg_data::channels发给对端
+        if (conf_.flags.test(conf_flag_t::EN_CONF_AUTO_SHM)) {
+            int res = listen_auto_shm();
+            if (res < 0) {
+                ATBUS_FUNC_NODE_ERROR(*this, self_.get(), NULL, res, 0);
+            }
+        }
+
         // 连接父节点
         if (!conf_.father_address.empty()) {
             if (!node_father_.node_) {
@@ -172,10 +209,12 @@ namespace atbus {
         // endpoint 不应该游离在node以外，所以这里就应该要触发endpoint::reset
         remove_collection(node_brother_);
         remove_collection(node_children_);
+        route_cache_.clear();
 
         // 清空检测列表和ping列表
         event_timer_.pending_check_list_.clear();
         event_timer_.ping_list.clear();
+        event_timer_.writable_check_list.clear();
 
         // 清空正在连接或握手的列表
         // 必须显式指定断开，以保证会主动断开正在进行的连接
@@ -186,6 +225,7 @@ namespace atbus {
         }
 
         event_timer_.connecting_list.clear();
+        worker_connecting_list_.clear();
 
         // 重置自身的endpoint
         if (self_) {
@@ -193,6 +233,14 @@ namespace atbus {
             self_->reset();
         }
 
+#ifdef ATBUS_CHANNEL_SHM_POSIX
+        // 自动创建的共享内存通道只有自己使用，接收端关闭后直接删除
+        if (!auto_shm_name_.empty()) {
+            channel::shm_posix_unlink(auto_shm_name_.c_str());
+            auto_shm_name_.clear();
+        }
+#endif
+
         // 引用的数据(正在进行的连接)也必须全部释放完成
         // 保证延迟释放的连接也释放完成
         while (!ref_objs_.empty()) {
@@ -201,6 +249,8 @@ namespace atbus {
 
         // 基础数据
         iostream_channel_.reset(); // 这里结束后就不会再触发回调了
+        iostream_workers_.reset(); // 会等待所有io线程退出
+        worker_connections_.clear();
         iostream_conf_.reset();
 
         if (NULL != ev_loop_) {
@@ -214,7 +264,10 @@ namespace atbus {
 
         conf_.flags.reset();
         state_ = state_t::CREATED;
+        // proc的回调里重置节点时，proc结束前仍然要保留标记
+        bool in_proc = flags_.test(flag_t::EN_FT_IN_PROC);
         flags_.reset();
+        flags_.set(flag_t::EN_FT_IN_PROC, in_proc);
         return EN_ATBUS_ERR_SUCCESS;
     }
 
@@ -236,11 +289,43 @@ namespace atbus {
         }
 
         int ret = 0;
-        // TODO 以后可以优化成event_fd通知，这样就不需要轮询了
+        // 开启EN_CONF_MEM_DOORBELL后内存通道和共享内存通道有数据时会由门铃唤醒事件循环并立即处理
+        // 这里的轮询保留作为兜底，v1通道和不支持门铃的平台仍然依赖它
         // 点对点IO流通道
+        // 回调里可能会断开连接甚至重置节点，所以先复制一份再处理
+        // 嵌套调用时外层还在使用proc_connections_cache_，只能用临时数组
+        std::vector<connection::ptr_t> nested_connections;
+        bool is_nested = flags_.test(flag_t::EN_FT_IN_PROC);
+        std::vector<connection::ptr_t> &proc_connections = is_nested ? nested_connections : proc_connections_cache_;
+        flags_.set(flag_t::EN_FT_IN_PROC, true);
         for (detail::auto_select_map<std::string, connection::ptr_t>::type::iterator iter = proc_connections_.begin();
              iter != proc_connections_.end(); ++iter) {
-            ret += iter->second->proc(*this, sec, usec);
+            proc_connections.push_back(iter->second);
+        }
+
+        for (size_t i = 0; i < proc_connections.size(); ++i) {
+            ret += proc_connections[i]->proc(*this, sec, usec);
+        }
+        proc_connections.clear();
+        flags_.set(flag_t::EN_FT_IN_PROC, is_nested);
+
+        // 内存通道和共享内存通道没有写完事件，超过高水位的连接在这里检查是否已经降到低水位
+        for (std::list<connection::ptr_t>::iterator iter = event_timer_.writable_check_list.begin();
+             iter != event_timer_.writable_check_list.end();) {
+            connection::ptr_t conn = *iter;
+            if (!conn || !conn->is_connected() || !conn->check_flag(connection::flag_t::WRITE_BLOCKED)) {
+                iter = event_timer_.writable_check_list.erase(iter);
+                continue;
+            }
+
+            if (!conn->check_writable()) {
+                ++iter;
+                continue;
+            }
+
+            // 回调里可能再次超过高水位并重新加入列表，所以先移除
+            iter = event_timer_.writable_check_list.erase(iter);
+            on_writable(conn->get_binding(), conn.get());
         }
 
         // connection超时下线
@@ -352,6 +437,12 @@ namespace atbus {
             --loop_left;
         }
 
+        // io线程的事件平时由ev_loop里的uv_async分发，这里顺便处理掉已经到达的
+        if (iostream_workers_) {
+            channel::io_stream_workers_recv(iostream_workers_.get(), connection::iostream_workers_on_event, this,
+                                            static_cast<size_t>(conf_.loop_times), NULL);
+        }
+
         return static_cast<int>(stat_.dispatch_times - stat_dispatch);
     }
 
@@ -419,7 +510,7 @@ namespace atbus {
 
         ATBUS_FUNC_NODE_DEBUG(*this, ep, conn.get(), NULL, "connect to %s and bind to a endpoint, res: %d", addr_str, ret);
 
-        if (0 == UTIL_STRFUNC_STRNCASE_CMP("mem:", addr_str, 4) || 0 == UTIL_STRFUNC_STRNCASE_CMP("shm:", addr_str, 4)) {
+        if (channel::is_memory_channel_address(addr_str)) {
             if (ep->add_connection(conn.get(), true)) {
                 return EN_ATBUS_ERR_SUCCESS;
             }
@@ -436,6 +527,7 @@ namespace atbus {
         if (node_father_.node_ && id == node_father_.node_->get_id()) {
             node_father_.node_->reset();
             node_father_.node_.reset();
+            invalidate_route_cache();
             return EN_ATBUS_ERR_SUCCESS;
         }
 
@@ -467,9 +559,9 @@ namespace atbus {
             return EN_ATBUS_ERR_BUFF_LIMIT;
         }
 
-        atbus::protocol::msg m;
         if (tid == get_id()) {
             // 发送给自己的数据直接回调数据接口
+            atbus::protocol::msg m;
             m.init(tid, ATBUS_CMD_DATA_TRANSFORM_REQ, type, 0, alloc_msg_seq());
 
             // fake body
@@ -496,6 +588,9 @@ namespace atbus {
             return EN_ATBUS_ERR_SUCCESS;
         }
 
+        // 消息体从zone池里分配，路由表在消息体内部，发送数据不需要再分配内存
+        msg_zone_guard zone(*this);
+        atbus::protocol::msg m(zone.get());
         m.init(get_id(), ATBUS_CMD_DATA_TRANSFORM_REQ, type, 0, alloc_msg_seq());
 
         if (NULL == m.body.make_body(m.body.forward)) {
@@ -529,7 +624,8 @@ namespace atbus {
             return EN_ATBUS_ERR_BUFF_LIMIT;
         }
 
-        atbus::protocol::msg m;
+        msg_zone_guard zone(*this);
+        atbus::protocol::msg m(zone.get());
         m.init(get_id(), ATBUS_CMD_CUSTOM_CMD_REQ, 0, 0, alloc_msg_seq());
 
         if (NULL == m.body.make_body(m.body.custom)) {
@@ -566,13 +662,50 @@ namespace atbus {
             return EN_ATBUS_ERR_SUCCESS;
         }
 
+        connection *conn = NULL;
+        int res = get_remote_channel(tid, fn, ep_out, &conn);
+        if (NULL != conn_out) {
+            *conn_out = conn;
+        }
+
+        if (res < 0) {
+            return res;
+        }
+
+        if (NULL != m.body.forward) {
+            m.body.forward->router.push_back(get_id());
+        }
+
+        // head 里永远是发起方bus_id
+        m.head.src_bus_id = get_id();
+
+        return msg_handler::send_msg(*this, *conn, m);
+    }
+
+    int node::get_remote_channel(bus_id_t tid, endpoint::get_connection_fn_t fn, endpoint **ep_out, connection **conn_out) {
 #define ASSIGN_EPCONN(tar_var)                  \
     {                                           \
         if (NULL != ep_out) *ep_out = tar_var;  \
         if (NULL != conn_out) *conn_out = conn; \
+        target_ep = tar_var;                    \
     }
 
+        // 只缓存数据通道，控制消息量很少并且要走控制连接
+        bool use_cache = static_cast<endpoint::get_connection_fn_t>(&endpoint::get_data_connection) == fn;
+        detail::auto_select_map<bus_id_t, route_cache_t>::type::iterator iter = route_cache_.end();
+        if (use_cache) {
+            iter = route_cache_.find(tid);
+            if (iter != route_cache_.end() && iter->second.version == route_cache_version_ && NULL != iter->second.conn &&
+                connection::state_t::CONNECTED == iter->second.conn->get_status()) {
+                ++stat_.route_cache_hit_times;
+                if (NULL != ep_out) *ep_out = iter->second.ep;
+                if (NULL != conn_out) *conn_out = iter->second.conn;
+                return EN_ATBUS_ERR_SUCCESS;
+            }
+        }
+
         connection *conn = NULL;
+        endpoint *target_ep = NULL;
         do {
             // 父节点单独判定，防止父节点被判定为兄弟节点
             if (node_father_.node_ && is_parent_node(tid)) {
@@ -636,19 +769,27 @@ namespace atbus {
             }
         } while (false);
 
+#undef ASSIGN_EPCONN
+
         if (NULL == conn) {
             return EN_ATBUS_ERR_ATNODE_NO_CONNECTION;
         }
 
-        if (NULL != m.body.forward) {
-            m.body.forward->router.push_back(get_id());
-        }
+        // 只有查找成功的结果才写入缓存
+        if (use_cache) {
+            if (iter == route_cache_.end()) {
+                if (route_cache_.size() >= ATBUS_MACRO_ROUTE_CACHE_SIZE) {
+                    route_cache_.clear();
+                }
+                iter = route_cache_.insert(std::make_pair(tid, route_cache_t())).first;
+            }
 
-        // head 里永远是发起方bus_id
-        m.head.src_bus_id = get_id();
+            iter->second.ep = target_ep;
+            iter->second.conn = conn;
+            iter->second.version = route_cache_version_;
+        }
 
-#undef ASSIGN_EPCONN
-        return msg_handler::send_msg(*this, *conn, m);
+        return EN_ATBUS_ERR_SUCCESS;
     }
 
     endpoint *node::get_endpoint(bus_id_t tid) {
@@ -679,6 +820,24 @@ namespace atbus {
 
     const endpoint *node::get_endpoint(bus_id_t tid) const { return const_cast<node *>(this)->get_endpoint(tid); }
 
+    size_t node::get_send_queue_bytes(bus_id_t tid) const {
+        if (!self_) {
+            return 0;
+        }
+
+        endpoint *ep = const_cast<endpoint *>(get_endpoint(tid));
+        if (NULL == ep) {
+            return 0;
+        }
+
+        connection *conn = self_->get_data_connection(ep);
+        if (NULL == conn) {
+            return 0;
+        }
+
+        return conn->get_send_queue_bytes();
+    }
+
     int node::add_endpoint(endpoint::ptr_t ep) {
         if (!ep) {
             return EN_ATBUS_ERR_PARAMS;
@@ -692,6 +851,7 @@ namespace atbus {
         if (ep->get_children_mask() > self_->get_children_mask() && ep->is_child_node(get_id())) {
             if (!node_father_.node_) {
                 node_father_.node_ = ep;
+                invalidate_route_cache();
                 add_ping_timer(ep);
 
                 if ((state_t::LOST_PARENT == get_state() || state_t::CONNECTING_PARENT == get_state()) &&
@@ -745,6 +905,7 @@ namespace atbus {
             endpoint::ptr_t ep = node_father_.node_;
 
             node_father_.node_.reset();
+            invalidate_route_cache();
             state_ = state_t::LOST_PARENT;
 
             // set reconnect to father into retry interval
@@ -904,6 +1065,47 @@ namespace atbus {
         return true;
     }
 
+    bool node::add_worker_connection(uint64_t conn_id, connection *conn) {
+        if (NULL == conn || worker_connections_.end() != worker_connections_.find(conn_id)) {
+            return false;
+        }
+
+        worker_connections_[conn_id] = conn;
+        return true;
+    }
+
+    bool node::remove_worker_connection(uint64_t conn_id) { return worker_connections_.erase(conn_id) > 0; }
+
+    connection *node::get_worker_connection(uint64_t conn_id) const {
+        detail::auto_select_map<uint64_t, connection *>::type::const_iterator iter = worker_connections_.find(conn_id);
+        if (iter == worker_connections_.end()) {
+            return NULL;
+        }
+
+        return iter->second;
+    }
+
+    uint64_t node::add_worker_connecting(connection::ptr_t conn) {
+        // 0 表示没有token
+        if (0 == ++worker_connecting_token_) {
+            ++worker_connecting_token_;
+        }
+
+        worker_connecting_list_[worker_connecting_token_] = conn;
+        return worker_connecting_token_;
+    }
+
+    connection::ptr_t node::remove_worker_connecting(uint64_t token) {
+        detail::auto_select_map<uint64_t, connection::ptr_t>::type::iterator iter = worker_connecting_list_.find(token);
+        if (iter == worker_connecting_list_.end()) {
+            return connection::ptr_t();
+        }
+
+        connection::ptr_t ret = iter->second;
+        worker_connecting_list_.erase(iter);
+        return ret;
+    }
+
     bool node::add_connection_timer(connection::ptr_t conn) {
         if (!conn) {
             return false;
@@ -916,6 +1118,15 @@ namespace atbus {
         return true;
     }
 
+    bool node::add_writable_check(connection::ptr_t conn) {
+        if (!conn) {
+            return false;
+        }
+
+        event_timer_.writable_check_list.push_back(conn);
+        return true;
+    }
+
     time_t node::get_timer_sec() const { return event_timer_.sec; }
 
     time_t node::get_timer_usec() const { return event_timer_.usec; }
@@ -1098,6 +1309,32 @@ namespace atbus {
         return 0;
     }
 
+    msgpack::zone *node::alloc_msg_zone() {
+        if (msg_zone_pool_.empty()) {
+            return new msgpack::zone();
+        }
+
+        msgpack::zone *ret = msg_zone_pool_.back();
+        msg_zone_pool_.pop_back();
+        return ret;
+    }
+
+    void node::invalidate_route_cache() {
+        // 0是缓存项的初始版本号，要跳过
+        if (0 == ++route_cache_version_) {
+            ++route_cache_version_;
+        }
+    }
+
+    void node::free_msg_zone(msgpack::zone *z) {
+        if (NULL == z) {
+            return;
+        }
+
+        z->clear();
+        msg_zone_pool_.push_back(z);
+    }
+
     int node::ping_endpoint(endpoint &ep) {
         // 检测上一次ping是否返回
         if (0 != ep.get_stat_ping()) {
@@ -1131,6 +1368,18 @@ namespace atbus {
         return EN_ATBUS_ERR_SUCCESS;
     }
 
+    int node::on_writable(const endpoint *ep, const connection *conn) {
+        if (NULL == ep && NULL != conn) {
+            ep = conn->get_binding();
+        }
+
+        if (event_msg_.on_writable) {
+            event_msg_.on_writable(std::cref(*this), ep, conn);
+        }
+
+        return EN_ATBUS_ERR_SUCCESS;
+    }
+
     int node::push_node_sync() {
         // TODO 防止短时间内批量上报注册协议，所以合并上报数据包
 
@@ -1193,6 +1442,9 @@ namespace atbus {
     void node::set_on_remove_endpoint_handle(evt_msg_t::on_remove_endpoint_fn_t fn) { event_msg_.on_endpoint_removed = fn; }
     node::evt_msg_t::on_remove_endpoint_fn_t node::get_on_remove_endpoint_handle() const { return event_msg_.on_endpoint_removed; }
 
+    void node::set_on_writable_handle(evt_msg_t::on_writable_fn_t fn) { event_msg_.on_writable = fn; }
+    node::evt_msg_t::on_writable_fn_t node::get_on_writable_handle() const { return event_msg_.on_writable; }
+
     void node::ref_object(void *obj) {
         if (NULL == obj) {
             return;
@@ -1240,6 +1492,7 @@ namespace atbus {
             }
 
             coll[maskv] = ep;
+            invalidate_route_cache();
 
             // event
             if (event_msg_.on_endpoint_added) {
@@ -1267,6 +1520,7 @@ namespace atbus {
         }
 
         coll[maskv] = ep;
+        invalidate_route_cache();
 
         // event
         if (event_msg_.on_endpoint_added) {
@@ -1287,6 +1541,7 @@ namespace atbus {
 
         endpoint::ptr_t ep = iter->second;
         coll.erase(iter);
+        invalidate_route_cache();
 
         // event
         if (event_msg_.on_endpoint_removed) {
@@ -1298,6 +1553,7 @@ namespace atbus {
     bool node::remove_collection(endpoint_collection_t &coll) {
         endpoint_collection_t ec;
         ec.swap(coll);
+        invalidate_route_cache();
 
         if (event_msg_.on_endpoint_removed) {
             for (endpoint_collection_t::iterator iter = ec.begin(); iter != ec.end(); ++iter) {
@@ -1318,6 +1574,39 @@ namespace atbus {
         return false;
     }
 
+    int node::listen_auto_shm() {
+#ifdef ATBUS_CHANNEL_SHM_POSIX
+        // 临时节点不注册，不需要数据通道
+        if (0 == get_id() || !auto_shm_name_.empty()) {
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        for (std::list<std::string>::const_iterator iter = get_listen_list().begin(); iter != get_listen_list().end(); ++iter) {
+            if (channel::is_memory_channel_address(iter->c_str())) {
+                return EN_ATBUS_ERR_SUCCESS;
+            }
+        }
+
+        // 同一台机器上可能有其他集群或者共享/dev/shm的容器使用相同的ID，名字里加上pid和启动时间区分实例
+        // 不能删除已存在的同名通道，否则会把其他进程正在使用的接收端删掉
+        char name[64] = {0};
+        UTIL_STRFUNC_SNPRINTF(name, sizeof(name), "libatbus_auto_%llx_%x_%llx", static_cast<unsigned long long>(get_id()),
+                              static_cast<unsigned int>(get_pid()), static_cast<unsigned long long>(uv_hrtime()));
+
+        std::string addr = "shm+posix://";
+        addr += name;
+        int ret = listen(addr.c_str());
+        if (ret < 0) {
+            return ret;
+        }
+
+        auto_shm_name_ = name;
+        return ret;
+#else
+        return EN_ATBUS_ERR_SUCCESS;
+#endif
+    }
+
     void node::add_ping_timer(endpoint::ptr_t &ep) {
         if (!ep) {
             return;
@@ -1347,10 +1636,37 @@ namespace atbus {
         iostream_channel_->evt.callbacks[channel::io_stream_callback_evt_t::EN_FN_DISCONNECTED] = connection::iostream_on_disconnected;
         iostream_channel_->evt.callbacks[channel::io_stream_callback_evt_t::EN_FN_RECVED] = connection::iostream_on_recv_cb;
         iostream_channel_->evt.callbacks[channel::io_stream_callback_evt_t::EN_FN_WRITEN] = connection::iostream_on_written;
+        iostream_channel_->evt.callbacks[channel::io_stream_callback_evt_t::EN_FN_WRITABLE] = connection::iostream_on_writable;
 
         return iostream_channel_.get();
     }
 
+    channel::io_stream_worker_group *node::get_iostream_workers() {
+        if (iostream_workers_) {
+            return iostream_workers_.get();
+        }
+
+        if (0 == conf_.io_worker_count) {
+            return NULL;
+        }
+
+        channel::io_stream_worker_group *group = NULL;
+        int res = channel::io_stream_workers_init(&group, conf_.io_worker_count, get_iostream_conf(), conf_.io_worker_queue_size);
+        if (res < 0) {
+            ATBUS_FUNC_NODE_ERROR(*this, self_.get(), NULL, res, 0);
+            return NULL;
+        }
+        iostream_workers_.reset(group);
+
+        // io线程发来的事件在ev_loop里分发，和io_stream通道的回调在同一个线程
+        res = channel::io_stream_workers_watch(group, get_evloop(), connection::iostream_workers_on_event, this);
+        if (res < 0) {
+            ATBUS_FUNC_NODE_ERROR(*this, self_.get(), NULL, res, 0);
+        }
+
+        return group;
+    }
+
     node::ptr_t node::get_watcher() { return watcher_.lock(); }
 
     channel::io_stream_conf *node::get_iostream_conf() {
@@ -1370,9 +1686,16 @@ namespace atbus {
         iostream_conf_->send_buffer_limit_size = conf_.msg_size;
         iostream_conf_->confirm_timeout = conf_.first_idle_timeout;
         iostream_conf_->backlog = conf_.backlog;
+        if (conf_.compress_threshold > 0) {
+            iostream_conf_->compress_threshold = conf_.compress_threshold;
+        }
+        iostream_conf_->send_buffer_high_watermark = conf_.send_high_watermark;
+        iostream_conf_->send_buffer_low_watermark = conf_.send_low_watermark;
+        iostream_conf_->frame_hash_mode = conf_.frame_hash_mode;
+        iostream_conf_->unix_frame_hash_mode = conf_.unix_frame_hash_mode;
 
         return iostream_conf_.get();
     }
 
-    node::stat_info_t::stat_info_t() : dispatch_times(0) {}
+    node::stat_info_t::stat_info_t() : dispatch_times(0), route_cache_hit_times(0) {}
 }
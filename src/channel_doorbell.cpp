@@ -0,0 +1,140 @@
+﻿/**
+ * @brief 所有channel文件的模式均为 c + channel<br />
+ *        使用c的模式是为了简单、结构清晰并且避免异常<br />
+ *        附带c++的部分是为了避免命名空间污染并且c++的跨平台适配更加简单
+ * @note 门铃用于唤醒等待内存通道或共享内存通道数据的接收端<br />
+ *       futex不能被libuv监听，eventfd又没办法传给不相关的进程，所以这里使用Linux抽象命名空间的unix数据报socket<br />
+ *       接收端绑定地址并用uv_poll监听可读事件，发送端只需要知道地址就可以发一个字节唤醒接收端
+ */
+
+#include "detail/libatbus_channel_export.h"
+
+#ifdef ATBUS_CHANNEL_DOORBELL
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "detail/libatbus_error.h"
+#include "lock/atomic_int_type.h"
+
+namespace atbus {
+    namespace channel {
+        namespace detail {
+            // 所有门铃共用一个发送socket，保存的是fd + 1，0表示还没有创建
+            static util::lock::atomic_int_type<int> doorbell_sender_fd;
+
+            static socklen_t doorbell_make_address(const char *name, sockaddr_un *addr) {
+                size_t len = strlen(name);
+                if (0 == len || len + 1 > sizeof(addr->sun_path)) {
+                    return 0;
+                }
+
+                memset(addr, 0, sizeof(sockaddr_un));
+                addr->sun_family = AF_UNIX;
+                // sun_path[0] == 0 表示抽象命名空间，不会在文件系统里留下文件，进程退出后自动释放
+                memcpy(addr->sun_path + 1, name, len);
+                return static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + len);
+            }
+
+            static int doorbell_create_socket() { return socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0); }
+
+            static int doorbell_get_sender() {
+                int ret = doorbell_sender_fd.load();
+                if (0 != ret) {
+                    return ret - 1;
+                }
+
+                int fd = doorbell_create_socket();
+                if (fd < 0) {
+                    return -1;
+                }
+
+                // 并发创建时只保留一个
+                int expect = 0;
+                if (doorbell_sender_fd.compare_exchange_strong(expect, fd + 1)) {
+                    return fd;
+                }
+
+                close(fd);
+                return expect - 1;
+            }
+        }
+
+        int doorbell_open(const char *name, adapter::fd_t *fd) {
+            if (NULL == name || NULL == fd) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            sockaddr_un addr;
+            socklen_t addr_len = detail::doorbell_make_address(name, &addr);
+            if (0 == addr_len) {
+                return EN_ATBUS_ERR_CHANNEL_ADDR_INVALID;
+            }
+
+            int sfd = detail::doorbell_create_socket();
+            if (sfd < 0) {
+                return EN_ATBUS_ERR_SOCK_CONNECT_FAILED;
+            }
+
+            if (0 != bind(sfd, reinterpret_cast<sockaddr *>(&addr), addr_len)) {
+                close(sfd);
+                return EN_ATBUS_ERR_SOCK_BIND_FAILED;
+            }
+
+            *fd = sfd;
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        int doorbell_ring(const char *name) {
+            if (NULL == name) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            sockaddr_un addr;
+            socklen_t addr_len = detail::doorbell_make_address(name, &addr);
+            if (0 == addr_len) {
+                return EN_ATBUS_ERR_CHANNEL_ADDR_INVALID;
+            }
+
+            int sfd = detail::doorbell_get_sender();
+            if (sfd < 0) {
+                return EN_ATBUS_ERR_SOCK_CONNECT_FAILED;
+            }
+
+            char c = 0;
+            if (sendto(sfd, &c, 1, MSG_DONTWAIT | MSG_NOSIGNAL, reinterpret_cast<sockaddr *>(&addr), addr_len) < 0) {
+                // 接收队列满说明还有没处理的门铃，接收端一定会被唤醒
+                if (EAGAIN == errno || EWOULDBLOCK == errno) {
+                    return EN_ATBUS_ERR_SUCCESS;
+                }
+
+                return EN_ATBUS_ERR_WRITE_FAILED;
+            }
+
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        void doorbell_drain(adapter::fd_t fd) {
+            char buf[64];
+            while (recv(fd, buf, sizeof(buf), MSG_DONTWAIT) > 0)
+                ;
+        }
+
+        int doorbell_close(adapter::fd_t fd) {
+            if (fd < 0) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            close(fd);
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+    }
+}
+
+#endif
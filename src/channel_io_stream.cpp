@@ -4,7 +4,9 @@
  *        附带c++的部分是为了避免命名空间污染并且c++的跨平台适配更加简单
  */
 
+#include <algorithm>
 #include <assert.h>
+#include <cerrno>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
@@ -14,8 +16,11 @@
 #include <vector>
 
 #ifndef _MSC_VER
+#include <limits.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/uio.h>
 #include <unistd.h>
 #endif
 
@@ -29,6 +34,7 @@
 #include "detail/buffer.h"
 #include "detail/libatbus_channel_export.h"
 #include "detail/libatbus_error.h"
+#include "detail/lz4.h"
 
 
 #ifdef ATBUS_MACRO_ENABLE_STATIC_ASSERT
@@ -49,52 +55,28 @@
 #endif
 #endif
 
-#define ATBUS_MACRO_TLS_MERGE_BUFFER_LEN (ATBUS_MACRO_MSG_LIMIT - sizeof(ATBUS_MACRO_DATA_ALIGN_TYPE) - sizeof(uv_write_t))
-
-#if defined(UTIL_CONFIG_THREAD_LOCAL)
-namespace atbus {
-    namespace channel {
-        namespace detail {
-            static char *io_stream_get_msg_buffer() {
-                static UTIL_CONFIG_THREAD_LOCAL char ret[ATBUS_MACRO_TLS_MERGE_BUFFER_LEN];
-                return ret;
-            }
-        }
-    }
-}
+// 一次uv_write最多提交的数据块数量，libuv内部会再按系统的IOV_MAX拆分writev
+#ifndef ATBUS_MACRO_IOS_WRITEV_MAX
+#if defined(IOV_MAX)
+#define ATBUS_MACRO_IOS_WRITEV_MAX IOV_MAX
 #else
+#define ATBUS_MACRO_IOS_WRITEV_MAX 1024
+#endif
+#endif
 
-#include <pthread.h>
-namespace atbus {
-    namespace channel {
-        namespace detail {
-            static pthread_once_t gt_io_stream_get_msg_buffer_tls_once = PTHREAD_ONCE_INIT;
-            static pthread_key_t gt_io_stream_get_msg_buffer_tls_key;
-
-            static void dtor_pthread_io_stream_get_msg_buffer_tls(void *p) {
-                char *res = reinterpret_cast<char *>(p);
-                if (NULL != res) {
-                    delete[] res;
-                }
-            }
-
-            static void init_pthread_io_stream_get_msg_buffer_tls() {
-                (void)pthread_key_create(&gt_io_stream_get_msg_buffer_tls_key, dtor_pthread_io_stream_get_msg_buffer_tls);
-            }
+// io_uring提交队列的长度，完成队列是它的两倍
+#ifndef ATBUS_MACRO_IOS_URING_ENTRIES
+#define ATBUS_MACRO_IOS_URING_ENTRIES 256
+#endif
 
-            static char *io_stream_get_msg_buffer() {
-                (void)pthread_once(&gt_io_stream_get_msg_buffer_tls_once, init_pthread_io_stream_get_msg_buffer_tls);
-                char *ret = reinterpret_cast<char *>(pthread_getspecific(gt_io_stream_get_msg_buffer_tls_key));
-                if (NULL == ret) {
-                    ret = new char[ATBUS_MACRO_TLS_MERGE_BUFFER_LEN];
-                    pthread_setspecific(gt_io_stream_get_msg_buffer_tls_key, ret);
-                }
-                return ret;
-            }
-        }
-    }
-}
+// 开启压缩的连接上默认的压缩阈值，太小的数据包压缩收益很低
+#ifndef ATBUS_MACRO_IOS_COMPRESS_THRESHOLD
+#define ATBUS_MACRO_IOS_COMPRESS_THRESHOLD 1024
+#endif
 
+// 合并发送时默认的最大合并长度，达到以后不再等待loop末尾
+#ifndef ATBUS_MACRO_IOS_CORK_MAX_SIZE
+#define ATBUS_MACRO_IOS_CORK_MAX_SIZE 65536
 #endif
 
 namespace atbus {
@@ -183,6 +165,16 @@ namespace atbus {
             conf->recv_buffer_limit_size = ATBUS_MACRO_MSG_LIMIT;
 
             conf->backlog = ATBUS_MACRO_CONNECTION_BACKLOG;
+            conf->is_reuseport = false;
+            conf->is_io_uring = 0 != ATBUS_MACRO_IOS_IO_URING;
+            conf->compress_threshold = ATBUS_MACRO_IOS_COMPRESS_THRESHOLD;
+            conf->is_cork = false;
+            conf->cork_max_delay_us = 0;
+            conf->cork_max_size = ATBUS_MACRO_IOS_CORK_MAX_SIZE;
+            conf->send_buffer_high_watermark = 0;
+            conf->send_buffer_low_watermark = 0;
+            conf->frame_hash_mode = io_stream_hash_mode_t::EN_HM_REQUIRED;
+            conf->unix_frame_hash_mode = io_stream_hash_mode_t::EN_HM_OPTIONAL;
         }
 
         static adapter::loop_t *io_stream_get_loop(io_stream_channel *channel) {
@@ -220,9 +212,17 @@ namespace atbus {
             memset(channel->evt.callbacks, 0, sizeof(channel->evt.callbacks));
 
             channel->error_code = 0;
+            channel->uring = NULL;
+            channel->cork = NULL;
+            memset(&channel->compress_stat, 0, sizeof(channel->compress_stat));
             return EN_ATBUS_ERR_SUCCESS;
         }
 
+#ifdef ATBUS_CHANNEL_IO_URING
+        static void io_stream_uring_destroy(io_stream_channel *channel);
+#endif
+        static void io_stream_cork_destroy(io_stream_channel *channel);
+
         int io_stream_close(io_stream_channel *channel) {
             if (NULL == channel) {
                 return EN_ATBUS_ERR_PARAMS;
@@ -253,6 +253,22 @@ namespace atbus {
             // 当然也可以用另一种方法强行结束掉所有req，但是这样会造成丢失回调
             // 并且这会要求逻辑层设计相当完善，否则可能导致内存泄漏。所以为了简化逻辑层设计，还是block并销毁所有数据
 
+#ifdef ATBUS_CHANNEL_IO_URING
+            // io_uring的请求全部完成以后连接才会释放，之后才能关闭io_uring
+            if (NULL != channel->uring) {
+                while (!channel->conn_pool.empty() || !channel->conn_gc_pool.empty() || ATBUS_CHANNEL_REQ_ACTIVE(channel)) {
+                    uv_run(channel->ev_loop, UV_RUN_ONCE);
+                }
+
+                io_stream_uring_destroy(channel);
+            }
+#endif
+
+            // 所有连接都已经断开，待发送的数据在断开时已经发出
+            if (NULL != channel->cork) {
+                io_stream_cork_destroy(channel);
+            }
+
             if (ATBUS_CHANNEL_IOS_CHECK_FLAG(channel->flags, io_stream_channel::EN_CF_IS_LOOP_OWNER) && NULL != channel->ev_loop) {
                 // 先清理掉所有可以完成的事件
                 while (uv_run(channel->ev_loop, UV_RUN_NOWAIT)) {
@@ -279,6 +295,8 @@ namespace atbus {
             }
 
             channel->ev_loop = NULL;
+            std::vector<unsigned char>().swap(channel->compress_buffer);
+            std::vector<unsigned char>().swap(channel->decompress_buffer);
 
             return EN_ATBUS_ERR_SUCCESS;
         }
@@ -297,6 +315,132 @@ namespace atbus {
         }
 
 
+        // 帧格式: 32位hash + varint(数据长度) + 数据
+        // 长度为0的帧从来不会发出，所以用来表示扩展帧: 32位hash + varint(0) + varint(帧标记) + varint(数据长度) + 数据
+        // hash只计算最后的数据部分
+        struct io_stream_frame_flag_t {
+            enum type {
+                EN_FF_LZ4 = 0x01,     // 数据部分是 varint(原始长度) + LZ4块
+                EN_FF_NO_HASH = 0x02, // 32位hash没有计算，固定填0，接收端不校验
+            };
+        };
+
+        // 32位hash之后的帧头最长是3个varint
+        static const size_t io_stream_frame_head_max = 1 + 10 + 10;
+
+        /**
+         * @brief 解析32位hash之后的帧头
+         * @return 帧头长度，数据不足时返回0
+         */
+        static size_t io_stream_read_frame_head(const char *buf, size_t len, uint64_t &data_len, uint32_t &frame_flags) {
+            frame_flags = 0;
+            size_t ret = ::atbus::detail::fn::read_vint(data_len, buf, len);
+            if (0 == ret || 0 != data_len) {
+                return ret;
+            }
+
+            uint64_t flags = 0;
+            size_t flags_len = ::atbus::detail::fn::read_vint(flags, buf + ret, len - ret);
+            if (0 == flags_len) {
+                return 0;
+            }
+            ret += flags_len;
+
+            size_t data_len_len = ::atbus::detail::fn::read_vint(data_len, buf + ret, len - ret);
+            if (0 == data_len_len) {
+                return 0;
+            }
+
+            frame_flags = static_cast<uint32_t>(flags);
+            return ret + data_len_len;
+        }
+
+        /**
+         * @brief 写入32位hash之后的帧头，有帧标记时使用扩展帧
+         * @return 帧头长度
+         */
+        static size_t io_stream_write_frame_head(char *buf, size_t len, uint32_t frame_flags, uint64_t data_len) {
+            if (0 == frame_flags) {
+                return ::atbus::detail::fn::write_vint(data_len, buf, len);
+            }
+
+            size_t ret = ::atbus::detail::fn::write_vint(0, buf, len);
+            ret += ::atbus::detail::fn::write_vint(frame_flags, buf + ret, len - ret);
+            ret += ::atbus::detail::fn::write_vint(data_len, buf + ret, len - ret);
+            return ret;
+        }
+
+        static int io_stream_decompress_frame(io_stream_channel *channel, uint32_t frame_flags, char *&data, size_t &len) {
+            // EN_FF_NO_HASH在校验时已经去掉了，这里只剩LZ4一种标记，不认识的标记都当作错误数据
+            if (io_stream_frame_flag_t::EN_FF_LZ4 != frame_flags) {
+                return EN_ATBUS_ERR_BAD_DATA;
+            }
+
+            uint64_t origin_len = 0;
+            size_t vint_len = ::atbus::detail::fn::read_vint(origin_len, data, len);
+            // LZ4的压缩率不会超过255，超过的肯定是错误数据，这样没有大小限制时也不会分配过大的内存
+            if (0 == vint_len || 0 == origin_len || origin_len / 255 > len) {
+                return EN_ATBUS_ERR_BAD_DATA;
+            }
+
+            // 先按原始长度判定大小限制，再分配解压缓冲区
+            if (channel->conf.recv_buffer_limit_size > 0 && origin_len > channel->conf.recv_buffer_limit_size) {
+                return EN_ATBUS_ERR_INVALID_SIZE;
+            }
+
+            if (channel->decompress_buffer.size() < origin_len) {
+                channel->decompress_buffer.resize(static_cast<size_t>(origin_len));
+            }
+
+            uint64_t begin_time = uv_hrtime();
+            bool res = ::atbus::detail::lz4_decompress(data + vint_len, len - vint_len, &channel->decompress_buffer[0],
+                                                       static_cast<size_t>(origin_len));
+            channel->compress_stat.decompress_cost_ns += uv_hrtime() - begin_time;
+            if (!res) {
+                return EN_ATBUS_ERR_BAD_DATA;
+            }
+
+            ++channel->compress_stat.decompress_times;
+            channel->compress_stat.decompress_size += len;
+            channel->compress_stat.decompress_origin_size += static_cast<size_t>(origin_len);
+
+            data = reinterpret_cast<char *>(&channel->decompress_buffer[0]);
+            len = static_cast<size_t>(origin_len);
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        // 校验并回调一个完整的帧，压缩帧先解压
+        // 带EN_FF_NO_HASH标记的帧只有EN_HM_REQUIRED的连接拒绝，EN_HM_OFF的连接收到的帧都不校验
+        static void io_stream_dispatch_frame(io_stream_channel *channel, io_stream_connection *conn_raw_ptr, const char *hash,
+                                             uint32_t frame_flags, char *data, size_t len) {
+            channel->error_code = 0;
+
+            int errcode = EN_ATBUS_ERR_SUCCESS;
+            if (0 != (frame_flags & io_stream_frame_flag_t::EN_FF_NO_HASH)) {
+                frame_flags &= ~static_cast<uint32_t>(io_stream_frame_flag_t::EN_FF_NO_HASH);
+                if (io_stream_hash_mode_t::EN_HM_REQUIRED == conn_raw_ptr->hash_mode) {
+                    errcode = EN_ATBUS_ERR_BAD_DATA;
+                }
+            } else if (io_stream_hash_mode_t::EN_HM_OFF != conn_raw_ptr->hash_mode) {
+                uint32_t check_hash = util::hash::murmur_hash3_x86_32(data, static_cast<int>(len), 0);
+                uint32_t expect_hash;
+                memcpy(&expect_hash, hash, sizeof(uint32_t));
+                if (check_hash != expect_hash) {
+                    errcode = EN_ATBUS_ERR_BAD_DATA;
+                }
+            }
+
+            if (EN_ATBUS_ERR_SUCCESS == errcode) {
+                if (0 != frame_flags) {
+                    errcode = io_stream_decompress_frame(channel, frame_flags, data, len);
+                } else if (channel->conf.recv_buffer_limit_size > 0 && len > channel->conf.recv_buffer_limit_size) {
+                    errcode = EN_ATBUS_ERR_INVALID_SIZE;
+                }
+            }
+
+            io_stream_channel_callback(io_stream_callback_evt_t::EN_FN_RECVED, channel, conn_raw_ptr, 0, errcode, data, len);
+        }
+
         static void io_stream_on_recv_alloc_fn(uv_handle_t *handle, size_t suggested_size, uv_buf_t *buf) {
             io_stream_connection *conn_raw_ptr = reinterpret_cast<io_stream_connection *>(handle->data);
             assert(conn_raw_ptr);
@@ -373,74 +517,75 @@ namespace atbus {
 
             // head 阶段
             if (NULL == data || 0 == swrite) {
-                assert(static_cast<size_t>(nread) <= sizeof(conn_raw_ptr->read_head.buffer) - conn_raw_ptr->read_head.len);
-                conn_raw_ptr->read_head.len += static_cast<size_t>(nread); // 写数据计数
+                io_stream_connection::read_head_t &head = conn_raw_ptr->read_head;
+                assert(static_cast<size_t>(nread) <= sizeof(head.buffer) - head.len);
+                head.len += static_cast<size_t>(nread); // 写数据计数
+
+                // 下一个数据包至少需要的连续空间，默认是32位hash+最长的帧头
+                size_t need_len = sizeof(uint32_t) + io_stream_frame_head_max;
 
-                // 尝试解出所有的head数据
-                char *buff_start = conn_raw_ptr->read_head.buffer;
-                size_t buff_left_len = conn_raw_ptr->read_head.len;
+                // 可能包含多条消息，已处理的数据只移动head.start，不需要每次都前移后续数据
+                while (head.len - head.start > sizeof(uint32_t)) {
+                    char *buff_start = head.buffer + head.start;
+                    size_t buff_left_len = head.len - head.start;
 
-                // 可能包含多条消息
-                while (buff_left_len > sizeof(uint32_t)) {
                     uint64_t msg_len = 0;
+                    uint32_t frame_flags = 0;
                     // 前4 字节为32位hash
                     size_t vint_len =
-                        ::atbus::detail::fn::read_vint(msg_len, buff_start + sizeof(uint32_t), buff_left_len - sizeof(uint32_t));
+                        io_stream_read_frame_head(buff_start + sizeof(uint32_t), buff_left_len - sizeof(uint32_t), msg_len, frame_flags);
 
-                    // 剩余数据不足以解动态长度整数，直接中断退出
+                    // 剩余数据不足以解帧头，直接中断退出
                     if (0 == vint_len) {
                         break;
                     }
 
-                    // 如果读取vint成功，判定是否有小数据包。并对小数据包直接回调
-                    if (buff_left_len >= sizeof(uint32_t) + vint_len + msg_len) {
-                        channel->error_code = 0;
-                        uint32_t check_hash =
-                            util::hash::murmur_hash3_x86_32(buff_start + sizeof(uint32_t) + vint_len, static_cast<int>(msg_len), 0);
-                        uint32_t expect_hash;
-                        memcpy(&expect_hash, buff_start, sizeof(uint32_t));
-                        int errcode = EN_ATBUS_ERR_SUCCESS;
-                        if (check_hash != expect_hash) {
-                            errcode = EN_ATBUS_ERR_BAD_DATA;
-                        } else if (channel->conf.recv_buffer_limit_size > 0 && msg_len > channel->conf.recv_buffer_limit_size) {
-                            errcode = EN_ATBUS_ERR_INVALID_SIZE;
-                        }
+                    // 如果读取帧头成功，判定是否有小数据包。并对小数据包直接回调
+                    size_t frame_len = sizeof(uint32_t) + vint_len + static_cast<size_t>(msg_len);
+                    if (buff_left_len >= frame_len) {
+                        // 这里的地址未对齐，所以buffer不能直接保存内存数据
+                        io_stream_dispatch_frame(channel, conn_raw_ptr, buff_start, frame_flags, buff_start + sizeof(uint32_t) + vint_len,
+                                                 static_cast<size_t>(msg_len));
 
-                        io_stream_channel_callback(io_stream_callback_evt_t::EN_FN_RECVED, channel, conn_raw_ptr, 0, errcode,
-                                                   buff_start + sizeof(uint32_t) + vint_len,
-                                                   // 这里的地址未对齐，所以buffer不能直接保存内存数据
-                                                   msg_len);
+                        // 32bits hash+frame head+buffer
+                        head.start += frame_len;
+                        continue;
+                    }
 
-                        // 32bits hash+vint+buffer
-                        buff_start += sizeof(uint32_t) + vint_len + msg_len;
-                        buff_left_len -= sizeof(uint32_t) + vint_len + msg_len;
+                    // 能放进head的小数据包直接留在head里等后续数据，不需要单独分配缓冲区
+                    if (frame_len <= sizeof(head.buffer)) {
+                        need_len = frame_len;
+                        break;
+                    }
+
+                    // 大数据包，按完整长度分配缓冲区，之后libuv直接读到缓冲区的剩余部分，并且剩余数据一定是在一个包内
+                    // 32位hash 也暂存在这里
+                    if (EN_ATBUS_ERR_SUCCESS == conn_raw_ptr->read_buffers.push_back(data, sizeof(uint32_t) + msg_len)) {
+                        memcpy(data, buff_start, sizeof(uint32_t)); // 32位hash
+                        memcpy(reinterpret_cast<char *>(data) + sizeof(uint32_t), buff_start + sizeof(uint32_t) + vint_len,
+                               buff_left_len - sizeof(uint32_t) - vint_len);
+                        conn_raw_ptr->read_buffers.pop_back(buff_left_len - vint_len, false); // 帧头不用保存，只记录帧标记
+                        head.frame_flags = frame_flags;
+
+                        head.start = head.len;
                     } else {
-                        // 大数据包，使用缓冲区，并且剩余数据一定是在一个包内
-                        // 32位hash 也暂存在这里
-                        if (EN_ATBUS_ERR_SUCCESS == conn_raw_ptr->read_buffers.push_back(data, sizeof(uint32_t) + msg_len)) {
-                            memcpy(data, buff_start, sizeof(uint32_t)); // 32位hash
-                            memcpy(reinterpret_cast<char *>(data) + sizeof(uint32_t), buff_start + sizeof(uint32_t) + vint_len,
-                                   buff_left_len - sizeof(uint32_t) - vint_len);
-                            conn_raw_ptr->read_buffers.pop_back(buff_left_len - vint_len, false); // vint_len不用保存
-
-                            buff_start += buff_left_len;
-                            buff_left_len = 0; // 循环退出
-                        } else {
-                            // 追加大缓冲区失败，可能是到达缓冲区限制
-                            // 读缓冲区一般只有一个正在处理的数据包，如果发生创建失败则是数据错误或者这个包就是超出大小限制的
-                            is_free = true;
-                            buff_start += sizeof(uint32_t) + vint_len;
-                            buff_left_len -= sizeof(uint32_t) + vint_len;
-                            break;
-                        }
+                        // 追加大缓冲区失败，可能是到达缓冲区限制
+                        // 读缓冲区一般只有一个正在处理的数据包，如果发生创建失败则是数据错误或者这个包就是超出大小限制的
+                        is_free = true;
+                        head.start += sizeof(uint32_t) + vint_len;
                     }
+                    break;
                 }
 
-                // 后续数据前移
-                if (buff_start != conn_raw_ptr->read_head.buffer && buff_left_len > 0) {
-                    memmove(conn_raw_ptr->read_head.buffer, buff_start, buff_left_len);
+                if (head.start >= head.len) {
+                    head.start = head.len = 0;
+                } else if (!is_free && head.start > 0 &&
+                           (head.start + need_len > sizeof(head.buffer) || sizeof(head.buffer) - head.len < sizeof(head.buffer) / 4)) {
+                    // 只有剩余空间放不下下一个数据包或者剩余空间太小时才把后续数据前移
+                    memmove(head.buffer, head.buffer + head.start, head.len - head.start);
+                    head.len -= head.start;
+                    head.start = 0;
                 }
-                conn_raw_ptr->read_head.len = buff_left_len;
             } else {
                 size_t nread_s = static_cast<size_t>(nread);
                 assert(nread_s <= swrite);
@@ -452,38 +597,24 @@ namespace atbus {
             // 如果在大内存块缓冲区，判定回调
             conn_raw_ptr->read_buffers.front(data, sread, swrite);
             if (NULL != data && 0 == swrite) {
-                channel->error_code = 0;
                 data = ::atbus::detail::fn::buffer_prev(data, sread);
+                uint32_t frame_flags = conn_raw_ptr->read_head.frame_flags;
+                conn_raw_ptr->read_head.frame_flags = 0;
 
-                // 32位Hash校验和
-                uint32_t check_hash = util::hash::murmur_hash3_x86_32(reinterpret_cast<char *>(data) + sizeof(uint32_t),
-                                                                      static_cast<int>(sread - sizeof(uint32_t)), 0);
-                uint32_t expect_hash;
-                memcpy(&expect_hash, data, sizeof(uint32_t));
-                size_t msg_len = sread - sizeof(uint32_t); // - hash32 header
-
-                int errcode = EN_ATBUS_ERR_SUCCESS;
-                if (check_hash != expect_hash) {
-                    errcode = EN_ATBUS_ERR_BAD_DATA;
-                } else if (channel->conf.recv_buffer_limit_size > 0 && msg_len > channel->conf.recv_buffer_limit_size) {
-                    errcode = EN_ATBUS_ERR_INVALID_SIZE;
-                }
-
-                io_stream_channel_callback(io_stream_callback_evt_t::EN_FN_RECVED, channel, conn_raw_ptr, 0, errcode,
-                                           reinterpret_cast<char *>(data) + sizeof(uint32_t), // + hash32 header
-                                           // 由于buffer_block内取出的数据已经保证了字节对齐，所以这里一定是4字节对齐
-                                           msg_len);
+                // 32位Hash校验和，由于buffer_block内取出的数据已经保证了字节对齐，所以数据一定是4字节对齐
+                io_stream_dispatch_frame(channel, conn_raw_ptr, reinterpret_cast<char *>(data), frame_flags,
+                                         reinterpret_cast<char *>(data) + sizeof(uint32_t), // + hash32 header
+                                         sread - sizeof(uint32_t));
 
                 // 回调并释放缓冲区
                 conn_raw_ptr->read_buffers.pop_front(0, true);
             }
 
             if (is_free) {
-                if (conn_raw_ptr->read_head.len > 0) {
+                if (conn_raw_ptr->read_head.len > conn_raw_ptr->read_head.start) {
                     io_stream_channel_callback(io_stream_callback_evt_t::EN_FN_RECVED, channel, conn_raw_ptr, 0, EN_ATBUS_ERR_INVALID_SIZE,
-                                               conn_raw_ptr->read_head.buffer,
-                                               // 由于buffer_block内取出的数据已经保证了字节对齐，所以这里一定是4字节对齐
-                                               conn_raw_ptr->read_head.len);
+                                               conn_raw_ptr->read_head.buffer + conn_raw_ptr->read_head.start,
+                                               conn_raw_ptr->read_head.len - conn_raw_ptr->read_head.start);
                 }
 
                 // 强制中断
@@ -539,6 +670,26 @@ namespace atbus {
             io_stream_stream_setup(channel, reinterpret_cast<adapter::stream_t *>(handle));
         }
 
+        // 多个socket监听同一个地址，由内核把新连接分配到不同的socket上
+        static int io_stream_tcp_reuseport(adapter::tcp_t *handle) {
+#if defined(SO_REUSEPORT) && !defined(_WIN32)
+            uv_os_fd_t fd;
+            int res = uv_fileno(reinterpret_cast<adapter::handle_t *>(handle), &fd);
+            if (0 != res) {
+                return res;
+            }
+
+            int opt = 1;
+            if (0 != setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt))) {
+                return -errno;
+            }
+
+            return 0;
+#else
+            return UV_ENOTSUP;
+#endif
+        }
+
         static void io_stream_pipe_setup(io_stream_channel *channel, adapter::pipe_t *handle) {
             if (NULL == channel || NULL == handle) {
                 return;
@@ -558,6 +709,505 @@ namespace atbus {
             size_t priv_size;
         };
 
+#ifdef ATBUS_CHANNEL_IO_URING
+        // ============ io_uring 后端 ============
+        // 连接的建立、监听和关闭仍然使用libuv，已建立连接的收发使用io_uring
+        // 所有连接在一次loop迭代里产生的请求在uv_prepare_t里一次性提交，完成事件通过uv_poll_t监听ring fd收取
+
+        struct io_stream_uring {
+            ::atbus::detail::io_uring_ring ring;
+            uv_poll_t poll;       // 有完成事件时ring fd可读
+            uv_prepare_t prepare; // loop阻塞之前提交所有请求
+            size_t inflight;      // 已经发出还没完成的请求数量，大于0时poll才引用loop
+            int closing_handles;
+            std::vector<std::weak_ptr<io_stream_connection> > pending_reads; // 新建立的连接，在下一次提交前开始接收
+        };
+
+        struct io_stream_uring_conn {
+            std::shared_ptr<io_stream_connection> self; // 有未完成的请求时保证连接不被释放
+            size_t inflight;
+            bool is_reading;
+            bool is_writing;
+            uv_buf_t read_buf;
+            void *write_req; // 最后一个数据块的uv_write_t，写完以后和libuv一样移除到这个数据块为止
+            std::vector<struct iovec> write_iov;
+            size_t write_iov_offset; // 第一个没写完的iovec
+        };
+
+        // 请求的user_data是io_stream_uring_conn的地址加上请求类型，0表示不需要处理的取消请求
+        enum io_stream_uring_op_t { EN_IOS_URING_OP_READ = 1, EN_IOS_URING_OP_WRITE = 2, EN_IOS_URING_OP_MASK = 3 };
+
+        static void io_stream_on_written(io_stream_connection *connection, void *req, int status);
+
+        static io_stream_channel *io_stream_uring_channel(uv_handle_t *handle) {
+            return reinterpret_cast<io_stream_channel *>(handle->data);
+        }
+
+        static struct io_uring_sqe *io_stream_uring_get_sqe(io_stream_uring *uring) {
+            struct io_uring_sqe *ret = uring->ring.get_sqe();
+            if (NULL == ret) {
+                // 提交队列满了就先提交一次
+                uring->ring.submit();
+                ret = uring->ring.get_sqe();
+            }
+
+            return ret;
+        }
+
+        static std::shared_ptr<io_stream_connection> io_stream_uring_find_conn(io_stream_connection *connection) {
+            io_stream_channel *channel = connection->channel;
+            io_stream_channel::conn_pool_t::iterator iter = channel->conn_pool.find(connection->fd);
+            if (iter != channel->conn_pool.end() && iter->second.get() == connection) {
+                return iter->second;
+            }
+
+            io_stream_channel::conn_gc_pool_t::iterator gc_iter = channel->conn_gc_pool.find(reinterpret_cast<uintptr_t>(connection));
+            if (gc_iter != channel->conn_gc_pool.end()) {
+                return gc_iter->second;
+            }
+
+            return std::shared_ptr<io_stream_connection>();
+        }
+
+        static void io_stream_uring_op_start(io_stream_connection *connection) {
+            io_stream_uring_conn *uring_conn = connection->uring;
+            io_stream_uring *uring = connection->channel->uring;
+
+            if (0 == uring_conn->inflight++) {
+                uring_conn->self = io_stream_uring_find_conn(connection);
+            }
+
+            if (0 == uring->inflight++) {
+                uv_ref(reinterpret_cast<uv_handle_t *>(&uring->poll));
+            }
+            ATBUS_CHANNEL_REQ_START(connection->channel);
+        }
+
+        static void io_stream_uring_op_end(io_stream_connection *connection) {
+            io_stream_uring_conn *uring_conn = connection->uring;
+            io_stream_uring *uring = connection->channel->uring;
+
+            ATBUS_CHANNEL_REQ_END(connection->channel);
+            if (0 == --uring->inflight) {
+                uv_unref(reinterpret_cast<uv_handle_t *>(&uring->poll));
+            }
+
+            if (0 != --uring_conn->inflight) {
+                return;
+            }
+
+            std::shared_ptr<io_stream_connection> hold;
+            hold.swap(uring_conn->self);
+
+            // 连接已经关闭，最后一个请求完成后释放
+            if (io_stream_connection::EN_ST_DISCONNECTIED == connection->status) {
+                connection->uring = NULL;
+                delete uring_conn;
+            }
+        }
+
+        static void io_stream_uring_read(io_stream_connection *connection) {
+            io_stream_uring_conn *uring_conn = connection->uring;
+            if (uring_conn->is_reading || io_stream_connection::EN_ST_CONNECTED != connection->status ||
+                ATBUS_CHANNEL_IOS_CHECK_FLAG(connection->flags, io_stream_connection::EN_CF_LISTEN)) {
+                return;
+            }
+
+            // 和libuv使用同一个分配函数，数据直接读到head或者大数据包的缓冲区里
+            io_stream_on_recv_alloc_fn(reinterpret_cast<uv_handle_t *>(connection->handle.get()), ATBUS_MACRO_MSG_LIMIT,
+                                       &uring_conn->read_buf);
+            if (NULL == uring_conn->read_buf.base || 0 == uring_conn->read_buf.len) {
+                io_stream_on_recv_read_fn(connection->handle.get(), UV_ENOBUFS, &uring_conn->read_buf);
+                return;
+            }
+
+            struct io_uring_sqe *sqe = io_stream_uring_get_sqe(connection->channel->uring);
+            if (NULL == sqe) {
+                io_stream_on_recv_read_fn(connection->handle.get(), UV_EAGAIN, &uring_conn->read_buf);
+                return;
+            }
+
+            sqe->opcode = IORING_OP_RECV;
+            sqe->fd = connection->fd;
+            sqe->addr = reinterpret_cast<uintptr_t>(uring_conn->read_buf.base);
+            sqe->len = static_cast<uint32_t>(uring_conn->read_buf.len);
+            sqe->user_data = reinterpret_cast<uintptr_t>(uring_conn) | EN_IOS_URING_OP_READ;
+
+            uring_conn->is_reading = true;
+            io_stream_uring_op_start(connection);
+        }
+
+        static int io_stream_uring_write_next(io_stream_connection *connection) {
+            io_stream_uring_conn *uring_conn = connection->uring;
+            struct io_uring_sqe *sqe = io_stream_uring_get_sqe(connection->channel->uring);
+            if (NULL == sqe) {
+                return EN_ATBUS_ERR_BUFF_LIMIT;
+            }
+
+            sqe->opcode = IORING_OP_WRITEV;
+            sqe->fd = connection->fd;
+            sqe->addr = reinterpret_cast<uintptr_t>(&uring_conn->write_iov[uring_conn->write_iov_offset]);
+            sqe->len = static_cast<uint32_t>(uring_conn->write_iov.size() - uring_conn->write_iov_offset);
+            sqe->user_data = reinterpret_cast<uintptr_t>(uring_conn) | EN_IOS_URING_OP_WRITE;
+
+            uring_conn->is_writing = true;
+            io_stream_uring_op_start(connection);
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        static int io_stream_uring_write(io_stream_connection *connection, const uv_buf_t *bufs, size_t bufs_count, void *req) {
+            io_stream_uring_conn *uring_conn = connection->uring;
+            uring_conn->write_iov.resize(bufs_count);
+            for (size_t i = 0; i < bufs_count; ++i) {
+                uring_conn->write_iov[i].iov_base = bufs[i].base;
+                uring_conn->write_iov[i].iov_len = bufs[i].len;
+            }
+            uring_conn->write_iov_offset = 0;
+            uring_conn->write_req = req;
+
+            return io_stream_uring_write_next(connection);
+        }
+
+        static void io_stream_uring_on_read(io_stream_connection *connection, int res) {
+            connection->uring->is_reading = false;
+
+            // 关闭时取消的请求
+            if (io_stream_connection::EN_ST_CONNECTED != connection->status) {
+                return;
+            }
+
+            if (-EAGAIN == res || -EINTR == res || -ENOBUFS == res) {
+                io_stream_uring_read(connection);
+                return;
+            }
+
+            // 和libuv一样，对端关闭时是UV_EOF，错误码都是-errno
+            io_stream_on_recv_read_fn(connection->handle.get(), 0 == res ? UV_EOF : res, &connection->uring->read_buf);
+            io_stream_uring_read(connection);
+        }
+
+        static void io_stream_uring_on_write(io_stream_connection *connection, int res) {
+            io_stream_uring_conn *uring_conn = connection->uring;
+            uring_conn->is_writing = false;
+
+            int status = 0;
+            if (res < 0 && -EAGAIN != res && -EINTR != res) {
+                status = res;
+            } else if (res > 0) {
+                // 流式的socket可能只写了一部分，跳过已经写完的部分后继续写
+                size_t left = static_cast<size_t>(res);
+                while (uring_conn->write_iov_offset < uring_conn->write_iov.size() && left > 0) {
+                    struct iovec &iov = uring_conn->write_iov[uring_conn->write_iov_offset];
+                    if (left < iov.iov_len) {
+                        iov.iov_base = reinterpret_cast<char *>(iov.iov_base) + left;
+                        iov.iov_len -= left;
+                        break;
+                    }
+
+                    left -= iov.iov_len;
+                    ++uring_conn->write_iov_offset;
+                }
+            }
+
+            if (0 == status && uring_conn->write_iov_offset < uring_conn->write_iov.size()) {
+                if (EN_ATBUS_ERR_SUCCESS == io_stream_uring_write_next(connection)) {
+                    return;
+                }
+                status = UV_ENOBUFS;
+            }
+
+            io_stream_on_written(connection, uring_conn->write_req, status);
+        }
+
+        static void io_stream_uring_on_poll(uv_poll_t *handle, int, int) {
+            io_stream_channel *channel = io_stream_uring_channel(reinterpret_cast<uv_handle_t *>(handle));
+            io_stream_uring *uring = channel->uring;
+
+            struct io_uring_cqe *cqe;
+            while (NULL != uring && NULL != (cqe = uring->ring.peek_cqe())) {
+                uint64_t user_data = cqe->user_data;
+                int res = cqe->res;
+                uring->ring.cqe_seen();
+
+                io_stream_uring_conn *uring_conn = reinterpret_cast<io_stream_uring_conn *>(
+                    static_cast<uintptr_t>(user_data & ~static_cast<uint64_t>(EN_IOS_URING_OP_MASK)));
+                if (NULL == uring_conn) {
+                    continue;
+                }
+
+                // 回调过程中连接可能被释放，先持有一次
+                std::shared_ptr<io_stream_connection> connection = uring_conn->self;
+                assert(connection);
+                if (EN_IOS_URING_OP_READ == (user_data & EN_IOS_URING_OP_MASK)) {
+                    io_stream_uring_on_read(connection.get(), res);
+                } else {
+                    io_stream_uring_on_write(connection.get(), res);
+                }
+
+                io_stream_uring_op_end(connection.get());
+            }
+        }
+
+        static void io_stream_uring_on_prepare(uv_prepare_t *handle) {
+            io_stream_channel *channel = io_stream_uring_channel(reinterpret_cast<uv_handle_t *>(handle));
+            io_stream_uring *uring = channel->uring;
+            if (NULL == uring) {
+                return;
+            }
+
+            if (!uring->pending_reads.empty()) {
+                std::vector<std::weak_ptr<io_stream_connection> > pending_reads;
+                pending_reads.swap(uring->pending_reads);
+                for (size_t i = 0; i < pending_reads.size(); ++i) {
+                    std::shared_ptr<io_stream_connection> connection = pending_reads[i].lock();
+                    if (connection && NULL != connection->uring) {
+                        io_stream_uring_read(connection.get());
+                    }
+                }
+            }
+
+            if (uring->ring.pending() > 0) {
+                uring->ring.submit();
+            }
+        }
+
+        static io_stream_uring *io_stream_uring_get(io_stream_channel *channel) {
+            if (!channel->conf.is_io_uring || NULL == channel->ev_loop) {
+                return NULL;
+            }
+
+            if (NULL != channel->uring) {
+                return channel->uring;
+            }
+
+            io_stream_uring *uring = new io_stream_uring();
+            if (NULL == uring) {
+                return NULL;
+            }
+
+            // 内核不支持或者被禁用时回退到libuv
+            if (0 != uring->ring.init(ATBUS_MACRO_IOS_URING_ENTRIES)) {
+                delete uring;
+                channel->conf.is_io_uring = false;
+                return NULL;
+            }
+
+            uring->inflight = 0;
+            uring->closing_handles = 0;
+            uv_poll_init(channel->ev_loop, &uring->poll, uring->ring.fd());
+            uv_prepare_init(channel->ev_loop, &uring->prepare);
+            uring->poll.data = channel;
+            uring->prepare.data = channel;
+            uv_poll_start(&uring->poll, UV_READABLE, io_stream_uring_on_poll);
+            uv_prepare_start(&uring->prepare, io_stream_uring_on_prepare);
+
+            // 没有未完成的请求时不阻止loop退出
+            uv_unref(reinterpret_cast<uv_handle_t *>(&uring->poll));
+            uv_unref(reinterpret_cast<uv_handle_t *>(&uring->prepare));
+
+            channel->uring = uring;
+            return uring;
+        }
+
+        static void io_stream_uring_on_close(uv_handle_t *handle) {
+            io_stream_uring *uring = reinterpret_cast<io_stream_uring *>(handle->data);
+            --uring->closing_handles;
+        }
+
+        // 所有连接都释放以后才能调用
+        static void io_stream_uring_destroy(io_stream_channel *channel) {
+            io_stream_uring *uring = channel->uring;
+            if (NULL == uring) {
+                return;
+            }
+
+            channel->uring = NULL;
+            uring->poll.data = uring;
+            uring->prepare.data = uring;
+            uring->closing_handles = 2;
+            uv_close(reinterpret_cast<uv_handle_t *>(&uring->poll), io_stream_uring_on_close);
+            uv_close(reinterpret_cast<uv_handle_t *>(&uring->prepare), io_stream_uring_on_close);
+            while (uring->closing_handles > 0) {
+                uv_run(channel->ev_loop, UV_RUN_ONCE);
+            }
+
+            uring->ring.close();
+            delete uring;
+        }
+
+        static void io_stream_uring_cancel(io_stream_connection *connection) {
+            io_stream_uring_conn *uring_conn = connection->uring;
+            if (NULL == uring_conn || NULL == connection->channel->uring) {
+                return;
+            }
+
+            // 正在进行的请求会持有socket，不取消的话关闭fd以后对端收不到断开
+            for (int op = EN_IOS_URING_OP_READ; op <= EN_IOS_URING_OP_WRITE; ++op) {
+                if ((EN_IOS_URING_OP_READ == op && !uring_conn->is_reading) || (EN_IOS_URING_OP_WRITE == op && !uring_conn->is_writing)) {
+                    continue;
+                }
+
+                struct io_uring_sqe *sqe = io_stream_uring_get_sqe(connection->channel->uring);
+                if (NULL == sqe) {
+                    break;
+                }
+
+                sqe->opcode = IORING_OP_ASYNC_CANCEL;
+                sqe->fd = -1;
+                sqe->addr = reinterpret_cast<uintptr_t>(uring_conn) | op;
+                sqe->user_data = 0;
+            }
+        }
+
+        // 连接关闭回调时调用，还有未完成的请求时等最后一个请求完成后释放
+        static void io_stream_uring_release(io_stream_connection *connection) {
+            io_stream_uring_conn *uring_conn = connection->uring;
+            if (NULL == uring_conn || uring_conn->inflight > 0) {
+                return;
+            }
+
+            connection->uring = NULL;
+            delete uring_conn;
+        }
+#endif
+
+        // ============ 合并发送 ============
+        // 开启合并发送时提交的数据先不写出，连接加入待刷新列表，在uv_prepare_t和uv_check_t里一次writev发出
+        // prepare在loop阻塞之前执行，check在处理完IO事件以后执行，所以任何阶段提交的数据都不会等到下一次IO事件
+
+        struct io_stream_cork {
+            uv_prepare_t prepare;
+            uv_check_t check;
+            uv_timer_t timer; // 有连接没到最大延迟时用来唤醒loop
+            int closing_handles;
+            std::vector<io_stream_connection *> pending; // 带EN_CF_CORKED标记的连接，连接关闭时移除
+        };
+
+        static void io_stream_cork_flush(io_stream_channel *channel);
+
+        static void io_stream_cork_on_timer(uv_timer_t *handle) {
+            io_stream_cork_flush(reinterpret_cast<io_stream_channel *>(handle->data));
+        }
+
+        static void io_stream_cork_on_prepare(uv_prepare_t *handle) {
+            io_stream_cork_flush(reinterpret_cast<io_stream_channel *>(handle->data));
+        }
+
+        static void io_stream_cork_on_check(uv_check_t *handle) {
+            io_stream_cork_flush(reinterpret_cast<io_stream_channel *>(handle->data));
+        }
+
+        static void io_stream_cork_flush(io_stream_channel *channel) {
+            io_stream_cork *cork = channel->cork;
+            if (NULL == cork || cork->pending.empty()) {
+                return;
+            }
+
+            io_stream_flag_guard flag_guard(channel->flags, io_stream_channel::EN_CF_IN_CALLBACK);
+
+            uint64_t now = uv_hrtime();
+            uint64_t max_delay = static_cast<uint64_t>(channel->conf.cork_max_delay_us) * 1000;
+            uint64_t wait_time = 0;
+
+            // 写数据可能触发回调，回调里提交的数据会重新加入待刷新列表
+            std::vector<io_stream_connection *> pending;
+            pending.swap(cork->pending);
+            for (size_t i = 0; i < pending.size(); ++i) {
+                io_stream_connection *connection = pending[i];
+                if (connection->cork_size > 0 && now - connection->cork_time < max_delay) {
+                    uint64_t left_time = max_delay - (now - connection->cork_time);
+                    if (0 == wait_time || left_time < wait_time) {
+                        wait_time = left_time;
+                    }
+
+                    cork->pending.push_back(connection);
+                    continue;
+                }
+
+                // 数据已经被其他流程发出去时cork_size为0，直接移除
+                ATBUS_CHANNEL_IOS_UNSET_FLAG(connection->flags, io_stream_connection::EN_CF_CORKED);
+                if (connection->cork_size > 0) {
+                    io_stream_try_write(connection);
+                }
+            }
+
+            if (0 == wait_time) {
+                uv_timer_stop(&cork->timer);
+            } else {
+                // libuv的定时器精度是毫秒，向上取整
+                uv_timer_start(&cork->timer, io_stream_cork_on_timer, (wait_time + 999999) / 1000000, 0);
+            }
+        }
+
+        static io_stream_cork *io_stream_cork_get(io_stream_channel *channel) {
+            if (!channel->conf.is_cork || NULL == channel->ev_loop ||
+                ATBUS_CHANNEL_IOS_CHECK_FLAG(channel->flags, io_stream_channel::EN_CF_CLOSING)) {
+                return NULL;
+            }
+
+            if (NULL != channel->cork) {
+                return channel->cork;
+            }
+
+            io_stream_cork *cork = new io_stream_cork();
+            if (NULL == cork) {
+                return NULL;
+            }
+
+            cork->closing_handles = 0;
+            uv_prepare_init(channel->ev_loop, &cork->prepare);
+            uv_check_init(channel->ev_loop, &cork->check);
+            uv_timer_init(channel->ev_loop, &cork->timer);
+            cork->prepare.data = channel;
+            cork->check.data = channel;
+            cork->timer.data = channel;
+            uv_prepare_start(&cork->prepare, io_stream_cork_on_prepare);
+            uv_check_start(&cork->check, io_stream_cork_on_check);
+
+            // 一直运行的handle不能让loop无法退出
+            uv_unref(reinterpret_cast<uv_handle_t *>(&cork->prepare));
+            uv_unref(reinterpret_cast<uv_handle_t *>(&cork->check));
+
+            channel->cork = cork;
+            return cork;
+        }
+
+        static void io_stream_cork_on_close(uv_handle_t *handle) {
+            io_stream_cork *cork = reinterpret_cast<io_stream_cork *>(handle->data);
+            --cork->closing_handles;
+        }
+
+        static void io_stream_cork_destroy(io_stream_channel *channel) {
+            io_stream_cork *cork = channel->cork;
+            if (NULL == cork) {
+                return;
+            }
+
+            channel->cork = NULL;
+            cork->prepare.data = cork;
+            cork->check.data = cork;
+            cork->timer.data = cork;
+            cork->closing_handles = 3;
+            uv_close(reinterpret_cast<uv_handle_t *>(&cork->prepare), io_stream_cork_on_close);
+            uv_close(reinterpret_cast<uv_handle_t *>(&cork->check), io_stream_cork_on_close);
+            uv_close(reinterpret_cast<uv_handle_t *>(&cork->timer), io_stream_cork_on_close);
+            while (cork->closing_handles > 0) {
+                uv_run(channel->ev_loop, UV_RUN_ONCE);
+            }
+
+            delete cork;
+        }
+
+        static void io_stream_cork_remove(io_stream_connection *connection) {
+            io_stream_cork *cork = connection->channel->cork;
+            if (NULL == cork || !ATBUS_CHANNEL_IOS_CHECK_FLAG(connection->flags, io_stream_connection::EN_CF_CORKED)) {
+                return;
+            }
+
+            ATBUS_CHANNEL_IOS_UNSET_FLAG(connection->flags, io_stream_connection::EN_CF_CORKED);
+            cork->pending.erase(std::remove(cork->pending.begin(), cork->pending.end(), connection), cork->pending.end());
+        }
+
         static void io_stream_connection_on_close(uv_handle_t *handle) {
             io_stream_connection *conn_raw_ptr = reinterpret_cast<io_stream_connection *>(handle->data);
             // connect not completed, directly exit
@@ -582,6 +1232,10 @@ namespace atbus {
                 conn_raw_ptr->act_disc_cbk(channel, conn_raw_ptr, EN_ATBUS_ERR_SUCCESS, NULL, 0);
             }
 
+#ifdef ATBUS_CHANNEL_IO_URING
+            io_stream_uring_release(conn_raw_ptr);
+#endif
+            io_stream_cork_remove(conn_raw_ptr);
             channel->conn_gc_pool.erase(iter);
         }
 
@@ -616,6 +1270,10 @@ namespace atbus {
             conn->channel->conn_gc_pool[reinterpret_cast<uintptr_t>(conn)] = iter->second;
             conn->channel->conn_pool.erase(iter);
 
+#ifdef ATBUS_CHANNEL_IO_URING
+            io_stream_uring_cancel(conn);
+#endif
+
             // ATBUS_CHANNEL_REQ_START(conn->channel);
             // 被动断开也会触发回调，这里的流程不计数active的req
             uv_close(reinterpret_cast<uv_handle_t *>(conn->handle.get()), io_stream_connection_on_close);
@@ -665,6 +1323,12 @@ namespace atbus {
 
             ret->handle = handle;
             ret->data = NULL;
+            ret->uring = NULL;
+            ret->cork_size = 0;
+            ret->cork_time = 0;
+            ret->stat_send_times = 0;
+            ret->stat_write_times = 0;
+            ret->hash_mode = channel->conf.frame_hash_mode;
             ATBUS_CHANNEL_IOS_CLEAR_FLAG(ret->flags);
             handle->data = ret.get();
 
@@ -677,7 +1341,9 @@ namespace atbus {
             if (channel->conf.recv_buffer_max_size > 0 && channel->conf.recv_buffer_static > 0) {
                 ret->read_buffers.set_mode(channel->conf.recv_buffer_max_size, channel->conf.recv_buffer_static);
             }
+            ret->read_head.start = 0;
             ret->read_head.len = 0;
+            ret->read_head.frame_flags = 0;
 
             ret->write_buffers.set_limit(channel->conf.send_buffer_max_size, 0);
             if (channel->conf.send_buffer_max_size > 0 && channel->conf.send_buffer_static > 0) {
@@ -690,6 +1356,23 @@ namespace atbus {
             // 监听关闭事件，用于释放资源
             handle->close_cb = io_stream_connection_on_close;
 
+#ifdef ATBUS_CHANNEL_IO_URING
+            io_stream_uring *uring = io_stream_uring_get(channel);
+            if (NULL != uring) {
+                ret->uring = new io_stream_uring_conn();
+                ret->uring->inflight = 0;
+                ret->uring->is_reading = false;
+                ret->uring->is_writing = false;
+                ret->uring->read_buf = uv_buf_init(NULL, 0);
+                ret->uring->write_req = NULL;
+                ret->uring->write_iov_offset = 0;
+
+                // 连接建立后才能开始接收，监听的连接不接收数据
+                uring->pending_reads.push_back(ret);
+                return ret;
+            }
+#endif
+
             // 监听可读事件
             uv_read_start(handle.get(), io_stream_on_recv_alloc_fn, io_stream_on_recv_read_fn);
 
@@ -783,6 +1466,7 @@ namespace atbus {
                 // 后面不会再失败了
 
                 conn->status = io_stream_connection::EN_ST_CONNECTED;
+                conn->hash_mode = conn_raw_ptr->hash_mode;
                 ATBUS_CHANNEL_IOS_SET_FLAG(conn->flags, io_stream_connection::EN_CF_ACCEPT);
 
                 union io_stream_sockaddr_switcher sock_addr;
@@ -857,6 +1541,7 @@ namespace atbus {
                 // 后面不会再失败了
 
                 conn->status = io_stream_connection::EN_ST_CONNECTED;
+                conn->hash_mode = conn_raw_ptr->hash_mode;
 
                 io_stream_pipe_setup(channel, pipe_conn);
                 io_stream_pipe_init(channel, conn.get(), pipe_conn);
@@ -976,11 +1661,23 @@ namespace atbus {
                     return EN_ATBUS_ERR_MALLOC;
                 }
 
-                uv_tcp_init(ev_loop, handle);
+                if (channel->conf.is_reuseport) {
+                    // 要在bind之前设置socket选项，所以必须先创建socket
+                    if (0 != (channel->error_code = uv_tcp_init_ex(ev_loop, handle, '4' == addr.scheme[3] ? AF_INET : AF_INET6))) {
+                        return EN_ATBUS_ERR_SOCK_BIND_FAILED;
+                    }
+                } else {
+                    uv_tcp_init(ev_loop, handle);
+                }
                 int ret = EN_ATBUS_ERR_SUCCESS;
                 do {
                     io_stream_tcp_setup(channel, handle);
 
+                    if (channel->conf.is_reuseport && 0 != (channel->error_code = io_stream_tcp_reuseport(handle))) {
+                        ret = EN_ATBUS_ERR_SOCK_BIND_FAILED;
+                        break;
+                    }
+
                     if ('4' == addr.scheme[3]) {
                         sockaddr_in sock_addr;
                         uv_ip4_addr(addr.host.c_str(), addr.port, &sock_addr);
@@ -1058,6 +1755,7 @@ namespace atbus {
 
                     conn->addr = addr;
                     conn->status = io_stream_connection::EN_ST_CONNECTED;
+                    conn->hash_mode = channel->conf.unix_frame_hash_mode;
                     ATBUS_CHANNEL_IOS_SET_FLAG(conn->flags, io_stream_connection::EN_CF_LISTEN);
 
                     io_stream_pipe_init(channel, conn.get(), handle);
@@ -1133,6 +1831,7 @@ namespace atbus {
                 conn->addr = async_data->addr;
 
                 if (async_data->pipe) {
+                    conn->hash_mode = async_data->channel->conf.unix_frame_hash_mode;
                     io_stream_pipe_init(async_data->channel, conn.get(), reinterpret_cast<adapter::pipe_t *>(req->handle));
                 } else {
                     io_stream_tcp_init(async_data->channel, conn.get(), reinterpret_cast<adapter::tcp_t *>(req->handle));
@@ -1385,6 +2084,11 @@ namespace atbus {
 
             connection->status = io_stream_connection::EN_ST_DISCONNECTING;
 
+            // 等待合并发送的数据先发出去
+            if (connection->cork_size > 0) {
+                io_stream_try_write(connection);
+            }
+
             // if there is any writing data, closing this connection later
             if (ATBUS_CHANNEL_IOS_CHECK_FLAG(connection->flags, io_stream_connection::EN_CF_WRITING)) {
                 return EN_ATBUS_ERR_SUCCESS;
@@ -1406,22 +2110,14 @@ namespace atbus {
             return io_stream_disconnect(channel, iter->second.get(), callback);
         }
 
-        static void io_stream_on_written_fn(uv_write_t *req, int status) {
-            // req is at the begin of the data block, and will not be used any more, we can delete it here
-            // if uv_write2 return 0, this will always be called, so free all data here
-
-            io_stream_connection *connection = reinterpret_cast<io_stream_connection *>(req->data);
-            assert(connection);
-            assert(connection->channel);
-
-            ATBUS_CHANNEL_REQ_END(connection->channel);
-
+        // req is the uv_write_t at the begin of the last written block
+        static void io_stream_on_written(io_stream_connection *connection, void *req, int status) {
             io_stream_flag_guard flag_guard(connection->channel->flags, io_stream_channel::EN_CF_IN_CALLBACK);
 
             void *data = NULL;
             size_t nread, nwrite;
 
-            // popup the lost callback
+            // req is at the last block of this write, all blocks before it are written together
             while (true) {
                 connection->write_buffers.front(data, nread, nwrite);
                 if (NULL == data) {
@@ -1429,7 +2125,6 @@ namespace atbus {
                 }
 
                 assert(0 == nread);
-                assert(req == data);
 
                 if (0 == nwrite) {
                     connection->write_buffers.pop_front(0, true);
@@ -1437,15 +2132,16 @@ namespace atbus {
                 }
 
                 // nwrite = sizeof(uv_write_t) + [data block...]
-                // data block = 32bits hash+vint+data length
+                // data block = 32bits hash+frame head+data length
                 char *buff_start = reinterpret_cast<char *>(data) + sizeof(uv_write_t);
                 size_t left_length = nwrite - sizeof(uv_write_t);
                 while (left_length > 0) {
                     // skip 32bits hash
                     buff_start += sizeof(uint32_t);
                     uint64_t out;
-                    size_t vint_len = ::atbus::detail::fn::read_vint(out, buff_start, left_length - sizeof(uint32_t));
-                    // skip varint
+                    uint32_t frame_flags;
+                    size_t vint_len = io_stream_read_frame_head(buff_start, left_length - sizeof(uint32_t), out, frame_flags);
+                    // skip frame head
                     buff_start += vint_len;
 
                     // data length should be enough to hold all data
@@ -1455,11 +2151,11 @@ namespace atbus {
                     }
 
                     io_stream_channel_callback(io_stream_callback_evt_t::EN_FN_WRITEN, connection->channel, connection, status,
-                                               req == data ? EN_ATBUS_ERR_SUCCESS : EN_ATBUS_ERR_NODE_TIMEOUT, buff_start, out);
+                                               EN_ATBUS_ERR_SUCCESS, buff_start, out);
 
                     buff_start += static_cast<size_t>(out);
 
-                    // 32bits hash+vint+data length
+                    // 32bits hash+frame head+data length
                     left_length -= sizeof(uint32_t) + vint_len + static_cast<size_t>(out);
                 }
 
@@ -1475,6 +2171,16 @@ namespace atbus {
             // unset writing mode
             ATBUS_CHANNEL_IOS_UNSET_FLAG(connection->flags, io_stream_connection::EN_CF_WRITING);
 
+            // 降到低水位以后通知上层可以继续发送，回调里发送的数据和剩下的数据一起写出
+            if (ATBUS_CHANNEL_IOS_CHECK_FLAG(connection->flags, io_stream_connection::EN_CF_HIGH_WATERMARK) &&
+                connection->write_buffers.limit().cost_size_ <= connection->channel->conf.send_buffer_low_watermark) {
+                ATBUS_CHANNEL_IOS_UNSET_FLAG(connection->flags, io_stream_connection::EN_CF_HIGH_WATERMARK);
+                if (0 == status && io_stream_connection::EN_ST_CONNECTED == connection->status) {
+                    io_stream_channel_callback(io_stream_callback_evt_t::EN_FN_WRITABLE, connection->channel, connection, 0,
+                                               EN_ATBUS_ERR_SUCCESS, NULL, connection->write_buffers.limit().cost_size_);
+                }
+            }
+
             // write left data
             io_stream_try_write(connection);
 
@@ -1486,6 +2192,19 @@ namespace atbus {
             }
         }
 
+        static void io_stream_on_written_fn(uv_write_t *req, int status) {
+            // req is at the begin of the data block, and will not be used any more, we can delete it here
+            // if uv_write2 return 0, this will always be called, so free all data here
+
+            io_stream_connection *connection = reinterpret_cast<io_stream_connection *>(req->data);
+            assert(connection);
+            assert(connection->channel);
+
+            ATBUS_CHANNEL_REQ_END(connection->channel);
+
+            io_stream_on_written(connection, req, status);
+        }
+
         int io_stream_try_write(io_stream_connection *connection) {
             if (NULL == connection) {
                 return EN_ATBUS_ERR_PARAMS;
@@ -1503,19 +2222,21 @@ namespace atbus {
 
             // closing or closed, cancle writing
             if (ATBUS_CHANNEL_IOS_CHECK_FLAG(connection->flags, io_stream_connection::EN_CF_CLOSING)) {
+                connection->cork_size = 0;
                 while (!connection->write_buffers.empty()) {
                     ::atbus::detail::buffer_block *bb = connection->write_buffers.front();
                     size_t nwrite = bb->raw_size();
                     // nwrite = sizeof(uv_write_t) + [data block...]
-                    // data block = 32bits hash+vint+data length
+                    // data block = 32bits hash+frame head+data length
                     char *buff_start = reinterpret_cast<char *>(bb->raw_data()) + sizeof(uv_write_t);
                     size_t left_length = nwrite - sizeof(uv_write_t);
                     while (left_length > 0) {
                         // skip 32bits hash
                         buff_start += sizeof(uint32_t);
                         uint64_t out;
-                        size_t vint_len = ::atbus::detail::fn::read_vint(out, buff_start, left_length - sizeof(uint32_t));
-                        // skip varint
+                        uint32_t frame_flags;
+                        size_t vint_len = io_stream_read_frame_head(buff_start, left_length - sizeof(uint32_t), out, frame_flags);
+                        // skip frame head
                         buff_start += vint_len;
 
                         // data length should be enough to hold all data
@@ -1528,7 +2249,7 @@ namespace atbus {
 
                         buff_start += static_cast<size_t>(out);
 
-                        // 32bits hash+vint+data length
+                        // 32bits hash+frame head+data length
                         left_length -= sizeof(uint32_t) + vint_len + static_cast<size_t>(out);
                     }
 
@@ -1539,92 +2260,88 @@ namespace atbus {
                 return ret;
             }
 
-            // if not in writing mode, try to merge and write data
-            // merge only if message is smaller than read buffer
-            if (connection->write_buffers.limit().cost_number_ > 1 &&
-                connection->write_buffers.front()->raw_size() <= ATBUS_MACRO_DATA_SMALL_SIZE) {
-                size_t available_bytes = ATBUS_MACRO_TLS_MERGE_BUFFER_LEN;
-                char *buffer_start = ::atbus::channel::detail::io_stream_get_msg_buffer();
-                char *free_buffer = buffer_start;
-
-                ::atbus::detail::buffer_block *preview_bb = NULL;
-                while (!connection->write_buffers.empty() && available_bytes > 0) {
-                    ::atbus::detail::buffer_block *bb = connection->write_buffers.front();
-                    if (bb->raw_size() > available_bytes) {
-                        break;
-                    }
-
-                    // if connection->write_buffers is a static circle buffer, can not merge the bound blocks
-                    if (connection->write_buffers.is_static_mode() && NULL != preview_bb && preview_bb > bb) {
-                        break;
-                    }
-                    preview_bb = bb;
-
-                    // first sizeof(uv_write_t) is req, the rest is 32bits hash+varint+len
-                    size_t bb_size = bb->raw_size() - sizeof(uv_write_t);
-                    memcpy(free_buffer, ::atbus::detail::fn::buffer_next(bb->raw_data(), sizeof(uv_write_t)), bb_size);
-                    free_buffer += bb_size;
-                    available_bytes -= bb_size;
-
-                    connection->write_buffers.pop_front(bb->raw_size(), true);
-                }
-
-                void *data = NULL;
-                connection->write_buffers.push_front(data, sizeof(uv_write_t) + (free_buffer - buffer_start));
-
-                // already pop more data than sizeof(uv_write_t) + (free_buffer - buffer_start)
-                // so this push_front should always success
-                assert(data);
-                // at least merge one block
-                assert(free_buffer > buffer_start);
-                assert(static_cast<size_t>(free_buffer - buffer_start) <= ATBUS_MACRO_TLS_MERGE_BUFFER_LEN);
-
-                data = ::atbus::detail::fn::buffer_next(data, sizeof(uv_write_t));
-                // copy back merged data
-                memcpy(data, buffer_start, free_buffer - buffer_start);
-            }
-
-
-            ::atbus::detail::buffer_block *writing_block = connection->write_buffers.front();
+            // if not in writing mode, gather pending blocks and write them by one uv_write(writev)
+            // every block is continuous even in static mode, so there is no need to copy data
+            ::atbus::detail::buffer_block *writing_blocks[ATBUS_MACRO_IOS_WRITEV_MAX];
+            size_t writing_count = connection->write_buffers.front_blocks(writing_blocks, ATBUS_MACRO_IOS_WRITEV_MAX);
 
             // should always exist, empty will cause return before
-            if (NULL == writing_block) {
-                assert(writing_block);
+            if (0 == writing_count) {
+                assert(writing_count > 0);
                 return EN_ATBUS_ERR_NO_DATA;
             }
 
-            if (writing_block->raw_size() <= sizeof(uv_write_t)) {
-                connection->write_buffers.pop_front(writing_block->raw_size(), true);
+            if (writing_blocks[0]->raw_size() <= sizeof(uv_write_t)) {
+                connection->write_buffers.pop_front(writing_blocks[0]->raw_size(), true);
                 return io_stream_try_write(connection);
             }
 
-            // 初始化req，填充vint，复制数据区
-            uv_write_t *req = reinterpret_cast<uv_write_t *>(writing_block->raw_data());
-            req->data = connection;
+            // first sizeof(uv_write_t) of every block is req, the rest is [32bits hash+varint+data]
+            // bufs[] will be copied in libuv, but the real data will not
+            uv_buf_t bufs[ATBUS_MACRO_IOS_WRITEV_MAX];
+            size_t bufs_count = 0;
+            for (; bufs_count < writing_count; ++bufs_count) {
+                ::atbus::detail::buffer_block *bb = writing_blocks[bufs_count];
+                // empty block will be removed when it's at the front
+                if (bb->raw_size() <= sizeof(uv_write_t)) {
+                    break;
+                }
 
-            char *buff_start = reinterpret_cast<char *>(writing_block->raw_data());
-            // req
-            buff_start += sizeof(uv_write_t);
+                bufs[bufs_count] = uv_buf_init(reinterpret_cast<char *>(bb->raw_data()) + sizeof(uv_write_t),
+                                               static_cast<unsigned int>(bb->raw_size() - sizeof(uv_write_t)));
+            }
 
-            // call write ，bufs[] will be copied in libuv, but the real data will not
-            uv_buf_t bufs[1] = {uv_buf_init(buff_start, static_cast<unsigned int>(writing_block->raw_size() - sizeof(uv_write_t)))};
+            // use req of the last block, so io_stream_on_written_fn will pop all the blocks until this one
+            uv_write_t *req = reinterpret_cast<uv_write_t *>(writing_blocks[bufs_count - 1]->raw_data());
+            req->data = connection;
 
+            // 合并发送的数据都在这次写出，剩下的数据会在写完回调里继续写出
+            connection->cork_size = 0;
             ATBUS_CHANNEL_IOS_SET_FLAG(connection->flags, io_stream_connection::EN_CF_WRITING);
-            int res = uv_write(req, connection->handle.get(), bufs, 1, io_stream_on_written_fn);
+#ifdef ATBUS_CHANNEL_IO_URING
+            if (NULL != connection->uring) {
+                if (EN_ATBUS_ERR_SUCCESS != io_stream_uring_write(connection, bufs, bufs_count, req)) {
+                    ATBUS_CHANNEL_IOS_UNSET_FLAG(connection->flags, io_stream_connection::EN_CF_WRITING);
+                    return EN_ATBUS_ERR_WRITE_FAILED;
+                }
+
+                ++connection->stat_write_times;
+                return ret;
+            }
+#endif
+            int res = uv_write(req, connection->handle.get(), bufs, static_cast<unsigned int>(bufs_count), io_stream_on_written_fn);
             if (0 != res) {
                 connection->channel->error_code = res;
                 ATBUS_CHANNEL_IOS_UNSET_FLAG(connection->flags, io_stream_connection::EN_CF_WRITING);
                 return EN_ATBUS_ERR_WRITE_FAILED;
             }
             ATBUS_CHANNEL_REQ_START(connection->channel);
+            ++connection->stat_write_times;
 
             return ret;
         }
 
         int io_stream_send(io_stream_connection *connection, const void *buf, size_t len) {
-            if (NULL == connection) {
+            // push back message
+            void *data = NULL;
+            int res = io_stream_send_reserve(connection, NULL == buf ? 0 : len, &data);
+            if (res < 0) {
+                return res;
+            }
+
+            if (NULL != data) {
+                // buffer
+                memcpy(data, buf, len);
+            }
+
+            return io_stream_send_commit(connection, data, len);
+        }
+
+        int io_stream_send_reserve(io_stream_connection *connection, size_t len, void **buf) {
+            if (NULL == connection || NULL == buf) {
                 return EN_ATBUS_ERR_PARAMS;
             }
+            *buf = NULL;
 
             if (connection->channel->conf.send_buffer_limit_size > 0 && len > connection->channel->conf.send_buffer_limit_size) {
                 return EN_ATBUS_ERR_INVALID_SIZE;
@@ -1634,38 +2351,248 @@ namespace atbus {
                 return EN_ATBUS_ERR_CLOSING;
             }
 
-            // push back message
-            if (NULL != buf && len > 0) {
-                char vint[16];
-                size_t vint_len = ::atbus::detail::fn::write_vint(len, vint, sizeof(vint));
-                // 计算需要的内存块大小（uv_write_t的大小+32bits hash+vint的大小+len）
-                size_t total_buffer_size = sizeof(uv_write_t) + sizeof(uint32_t) + vint_len + len;
-
-                // 判定内存限制
-                void *data;
-                int res = connection->write_buffers.push_back(data, total_buffer_size);
+            if (0 == len) {
+                return EN_ATBUS_ERR_SUCCESS;
+            }
+
+            // 跳过hash的连接使用扩展帧，帧头在这里一次写好
+            uint32_t frame_flags = 0;
+            if (ATBUS_CHANNEL_IOS_CHECK_FLAG(connection->flags, io_stream_connection::EN_CF_SKIP_HASH)) {
+                frame_flags = io_stream_frame_flag_t::EN_FF_NO_HASH;
+            }
+            char vint[io_stream_frame_head_max];
+            size_t vint_len = io_stream_write_frame_head(vint, sizeof(vint), frame_flags, len);
+            // 计算需要的内存块大小（uv_write_t的大小+32bits hash+帧头的大小+len）
+            size_t total_buffer_size = sizeof(uv_write_t) + sizeof(uint32_t) + vint_len + len;
+
+            // 判定内存限制
+            void *data;
+            int res = connection->write_buffers.push_back(data, total_buffer_size);
+            if (res < 0) {
+                return res;
+            }
+
+            // 高水位只是标记，数据仍然可以写入，直到超过send_buffer_max_size
+            if (connection->channel->conf.send_buffer_high_watermark > 0 &&
+                connection->write_buffers.limit().cost_size_ >= connection->channel->conf.send_buffer_high_watermark) {
+                ATBUS_CHANNEL_IOS_SET_FLAG(connection->flags, io_stream_connection::EN_CF_HIGH_WATERMARK);
+            }
+
+            // 初始化req，填充vint，32bits hash在提交时填充
+            uv_write_t *req = reinterpret_cast<uv_write_t *>(data);
+            req->data = connection;
+            char *buff_start = reinterpret_cast<char *>(data);
+            // req
+            buff_start += sizeof(uv_write_t);
+
+            // vint
+            memcpy(buff_start + sizeof(uint32_t), vint, vint_len);
+
+            *buf = buff_start + sizeof(uint32_t) + vint_len;
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        /**
+         * @brief 尝试把刚预留的数据块替换成压缩帧
+         * @return 替换成功返回1，压缩后没有变小返回0，否则返回错误码
+         */
+        static int io_stream_compress_frame(io_stream_connection *connection, const void *buf, size_t len) {
+            io_stream_channel *channel = connection->channel;
+
+            char origin_vint[16];
+            size_t origin_vint_len = ::atbus::detail::fn::write_vint(len, origin_vint, sizeof(origin_vint));
+            size_t bound_len = origin_vint_len + ::atbus::detail::lz4_compress_bound(len);
+            if (channel->compress_buffer.size() < bound_len) {
+                channel->compress_buffer.resize(bound_len);
+            }
+
+            // 数据部分 = varint(原始长度) + LZ4块
+            unsigned char *compress_data = &channel->compress_buffer[0];
+            memcpy(compress_data, origin_vint, origin_vint_len);
+
+            uint64_t begin_time = uv_hrtime();
+            size_t compress_len =
+                ::atbus::detail::lz4_compress(buf, len, compress_data + origin_vint_len, channel->compress_buffer.size() - origin_vint_len);
+            channel->compress_stat.compress_cost_ns += uv_hrtime() - begin_time;
+
+            size_t data_len = origin_vint_len + compress_len;
+            bool skip_hash = ATBUS_CHANNEL_IOS_CHECK_FLAG(connection->flags, io_stream_connection::EN_CF_SKIP_HASH);
+            uint32_t frame_flags = io_stream_frame_flag_t::EN_FF_LZ4;
+            if (skip_hash) {
+                frame_flags |= io_stream_frame_flag_t::EN_FF_NO_HASH;
+            }
+            char head[io_stream_frame_head_max];
+            size_t head_len = io_stream_write_frame_head(head, sizeof(head), frame_flags, data_len);
+
+            if (0 == compress_len || head_len + data_len >= origin_vint_len + len) {
+                ++channel->compress_stat.compress_skip_times;
+                return 0;
+            }
+
+            // 预留的数据块一定是最后一个，并且还没有开始发送，直接换成更小的数据块
+            ::atbus::detail::buffer_block *reserved = connection->write_buffers.back();
+            assert(reserved && reinterpret_cast<const char *>(buf) + len ==
+                                   reinterpret_cast<const char *>(reserved->raw_data()) + reserved->raw_size());
+            connection->write_buffers.pop_back(reserved->size(), true);
+
+            void *data;
+            int res = connection->write_buffers.push_back(data, sizeof(uv_write_t) + sizeof(uint32_t) + head_len + data_len);
+            if (res < 0) {
+                return res;
+            }
+
+            uv_write_t *req = reinterpret_cast<uv_write_t *>(data);
+            req->data = connection;
+            char *buff_start = reinterpret_cast<char *>(data) + sizeof(uv_write_t);
+
+            uint32_t hash32 = 0;
+            if (!skip_hash) {
+                hash32 = util::hash::murmur_hash3_x86_32(reinterpret_cast<const char *>(compress_data), static_cast<int>(data_len), 0);
+            }
+            memcpy(buff_start, &hash32, sizeof(uint32_t));
+            memcpy(buff_start + sizeof(uint32_t), head, head_len);
+            memcpy(buff_start + sizeof(uint32_t) + head_len, compress_data, data_len);
+
+            ++channel->compress_stat.compress_times;
+            channel->compress_stat.compress_origin_size += len;
+            channel->compress_stat.compress_size += data_len;
+            return 1;
+        }
+
+        /**
+         * @brief 写出已经提交的数据，开启合并发送时只加入待刷新列表
+         */
+        static int io_stream_commit_write(io_stream_connection *connection, size_t len) {
+            io_stream_cork *cork = NULL;
+            if (len > 0) {
+                ++connection->stat_send_times;
+                cork = io_stream_cork_get(connection->channel);
+            }
+
+            if (NULL == cork) {
+                return io_stream_try_write(connection);
+            }
+
+            if (!ATBUS_CHANNEL_IOS_CHECK_FLAG(connection->flags, io_stream_connection::EN_CF_CORKED)) {
+                ATBUS_CHANNEL_IOS_SET_FLAG(connection->flags, io_stream_connection::EN_CF_CORKED);
+                connection->cork_time = uv_hrtime();
+                cork->pending.push_back(connection);
+            }
+
+            connection->cork_size += len;
+            if (connection->channel->conf.cork_max_size > 0 && connection->cork_size >= connection->channel->conf.cork_max_size) {
+                return io_stream_try_write(connection);
+            }
+
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        int io_stream_send_commit(io_stream_connection *connection, void *buf, size_t len) {
+            if (NULL == connection) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            if (NULL != buf && len > 0 && ATBUS_CHANNEL_IOS_CHECK_FLAG(connection->flags, io_stream_connection::EN_CF_COMPRESS) &&
+                len >= connection->channel->conf.compress_threshold) {
+                int res = io_stream_compress_frame(connection, buf, len);
                 if (res < 0) {
                     return res;
                 }
 
-                // 初始化req，填充vint，复制数据区
-                uv_write_t *req = reinterpret_cast<uv_write_t *>(data);
-                req->data = connection;
-                char *buff_start = reinterpret_cast<char *>(data);
-                // req
-                buff_start += sizeof(uv_write_t);
+                if (res > 0) {
+                    return io_stream_commit_write(connection, len);
+                }
+            }
+
+            if (NULL != buf && len > 0) {
+                bool skip_hash = ATBUS_CHANNEL_IOS_CHECK_FLAG(connection->flags, io_stream_connection::EN_CF_SKIP_HASH);
+                char vint[io_stream_frame_head_max];
+                size_t vint_len =
+                    io_stream_write_frame_head(vint, sizeof(vint), skip_hash ? io_stream_frame_flag_t::EN_FF_NO_HASH : 0, len);
+                char *buff_start = reinterpret_cast<char *>(buf) - vint_len - sizeof(uint32_t);
 
                 // 32bits hash
-                uint32_t hash32 = util::hash::murmur_hash3_x86_32(reinterpret_cast<const char *>(buf), static_cast<int>(len), 0);
+                uint32_t hash32 = 0;
+                if (!skip_hash) {
+                    hash32 = util::hash::murmur_hash3_x86_32(reinterpret_cast<const char *>(buf), static_cast<int>(len), 0);
+                }
                 memcpy(buff_start, &hash32, sizeof(uint32_t));
+            }
 
-                // vint
-                memcpy(buff_start + sizeof(uint32_t), vint, vint_len);
-                // buffer
-                memcpy(buff_start + sizeof(uint32_t) + vint_len, buf, len);
+            return io_stream_commit_write(connection, NULL == buf ? 0 : len);
+        }
+
+        int io_stream_sendv(io_stream_connection *connection, const channel_iovec_t *iov, size_t iovcnt) {
+            if (NULL == iov && iovcnt > 0) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            size_t len = 0;
+            for (size_t i = 0; i < iovcnt; ++i) {
+                len += iov[i].len;
             }
 
-            return io_stream_try_write(connection);
+            void *data = NULL;
+            int res = io_stream_send_reserve(connection, len, &data);
+            if (res < 0) {
+                return res;
+            }
+
+            // 所有数据段写入同一个数据块，只写一次vint
+            char *buff_start = reinterpret_cast<char *>(data);
+            for (size_t i = 0; NULL != buff_start && i < iovcnt; ++i) {
+                if (iov[i].len > 0) {
+                    memcpy(buff_start, iov[i].base, iov[i].len);
+                    buff_start += iov[i].len;
+                }
+            }
+
+            return io_stream_send_commit(connection, data, len);
+        }
+
+        int io_stream_set_compress(io_stream_connection *connection, bool enable) {
+            if (NULL == connection) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            if (enable) {
+                ATBUS_CHANNEL_IOS_SET_FLAG(connection->flags, io_stream_connection::EN_CF_COMPRESS);
+            } else {
+                ATBUS_CHANNEL_IOS_UNSET_FLAG(connection->flags, io_stream_connection::EN_CF_COMPRESS);
+            }
+
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        int io_stream_set_hash_mode(io_stream_connection *connection, int mode) {
+            if (NULL == connection || mode < io_stream_hash_mode_t::EN_HM_REQUIRED || mode > io_stream_hash_mode_t::EN_HM_OFF) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            connection->hash_mode = mode;
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        int io_stream_set_skip_hash(io_stream_connection *connection, bool enable) {
+            if (NULL == connection) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            if (enable) {
+                ATBUS_CHANNEL_IOS_SET_FLAG(connection->flags, io_stream_connection::EN_CF_SKIP_HASH);
+            } else {
+                ATBUS_CHANNEL_IOS_UNSET_FLAG(connection->flags, io_stream_connection::EN_CF_SKIP_HASH);
+            }
+
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        size_t io_stream_get_send_queue_bytes(const io_stream_connection *connection) {
+            if (NULL == connection) {
+                return 0;
+            }
+
+            return connection->write_buffers.limit().cost_size_;
         }
 
         void io_stream_show_channel(io_stream_channel *channel, std::ostream &out) {
@@ -1679,6 +2606,7 @@ namespace atbus {
                 << "is_noblock: " << channel->conf.is_noblock << std::endl
                 << "is_nodelay: " << channel->conf.is_nodelay << std::endl
                 << "backlog: " << channel->conf.backlog << std::endl
+                << "is_io_uring: " << (NULL != channel->uring) << std::endl
                 << "keepalive: " << channel->conf.keepalive << std::endl
                 << "recv_buffer_limit_size(Bytes): " << channel->conf.recv_buffer_limit_size << std::endl
                 << "recv_buffer_max_size(Bytes): " << channel->conf.recv_buffer_max_size << std::endl
@@ -1686,6 +2614,25 @@ namespace atbus {
                 << "send_buffer_limit_size(Bytes): " << channel->conf.send_buffer_limit_size << std::endl
                 << "send_buffer_max_size(Bytes): " << channel->conf.send_buffer_max_size << std::endl
                 << "send_buffer_static_max_number: " << channel->conf.send_buffer_static << std::endl
+                << "compress_threshold(Bytes): " << channel->conf.compress_threshold << std::endl
+                << "is_cork: " << channel->conf.is_cork << std::endl
+                << "cork_max_delay(us): " << channel->conf.cork_max_delay_us << std::endl
+                << "cork_max_size(Bytes): " << channel->conf.cork_max_size << std::endl
+                << "send_buffer_high_watermark(Bytes): " << channel->conf.send_buffer_high_watermark << std::endl
+                << "send_buffer_low_watermark(Bytes): " << channel->conf.send_buffer_low_watermark << std::endl
+                << "frame_hash_mode: " << channel->conf.frame_hash_mode << std::endl
+                << "unix_frame_hash_mode: " << channel->conf.unix_frame_hash_mode << std::endl
+                << std::endl;
+
+            const io_stream_compress_stat_t &stat = channel->compress_stat;
+            out << "compress:" << std::endl
+                << "compress_times: " << stat.compress_times << std::endl
+                << "compress_skip_times: " << stat.compress_skip_times << std::endl
+                << "compress_saved_size(Bytes): " << (stat.compress_origin_size - stat.compress_size) << std::endl
+                << "compress_cost(ns): " << stat.compress_cost_ns << std::endl
+                << "decompress_times: " << stat.decompress_times << std::endl
+                << "decompress_saved_size(Bytes): " << (stat.decompress_origin_size - stat.decompress_size) << std::endl
+                << "decompress_cost(ns): " << stat.decompress_cost_ns << std::endl
                 << std::endl;
 
             out << "all connections:" << std::endl;
@@ -1701,6 +2648,17 @@ namespace atbus {
                 out << "\t\tread_buffers.cost_size: " << iter->second->read_buffers.limit().cost_size_ << std::endl;
                 out << "\t\tread_buffers.limit_number: " << iter->second->read_buffers.limit().limit_number_ << std::endl;
                 out << "\t\tread_buffers.limit_size: " << iter->second->read_buffers.limit().limit_size_ << std::endl;
+
+                out << "\t\thash_mode: " << iter->second->hash_mode
+                    << (ATBUS_CHANNEL_IOS_CHECK_FLAG(iter->second->flags, io_stream_connection::EN_CF_SKIP_HASH) ? "(skip send)" : "")
+                    << std::endl;
+                out << "\t\tsend_times: " << iter->second->stat_send_times << std::endl;
+                out << "\t\twrite_times: " << iter->second->stat_write_times << std::endl;
+                if (iter->second->stat_send_times > 0) {
+                    out << "\t\twrites_per_message: "
+                        << static_cast<double>(iter->second->stat_write_times) / static_cast<double>(iter->second->stat_send_times)
+                        << std::endl;
+                }
             }
         }
     }
@@ -0,0 +1,824 @@
+﻿/**
+ * @brief io线程组，每个io线程有独立的libuv loop和io_stream_channel<br />
+ *        调用方线程和每个io线程之间各有两个单生产者单消费者的内存通道<br />
+ *        连接的读写、拆包和校验都在io线程里完成，调用方线程只处理完整的消息
+ */
+
+#include <assert.h>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+#ifndef _WIN32
+#include <sys/socket.h>
+#endif
+
+#include "common/string_oprs.h"
+#include "lock/atomic_int_type.h"
+
+#include "detail/libatbus_channel_export.h"
+#include "detail/libatbus_config.h"
+#include "detail/libatbus_error.h"
+
+// 连接ID中io线程序号占用的位数
+#ifndef ATBUS_MACRO_IOS_WORKER_INDEX_BITS
+#define ATBUS_MACRO_IOS_WORKER_INDEX_BITS 16
+#endif
+
+// 一次从内存通道批量取出的消息数量
+#ifndef ATBUS_MACRO_IOS_WORKER_BATCH
+#define ATBUS_MACRO_IOS_WORKER_BATCH 64
+#endif
+
+// 内存通道满时生产者等待的最长时间(纳秒)，只用于兜底，正常情况下消费者取走数据后会直接唤醒
+#ifndef ATBUS_MACRO_IOS_WORKER_WAIT_TIMEOUT
+#define ATBUS_MACRO_IOS_WORKER_WAIT_TIMEOUT 10000000
+#endif
+
+namespace atbus {
+    namespace channel {
+        struct io_stream_worker_cmd_t {
+            enum type {
+                EN_WC_SEND = 0,   // 发送数据
+                EN_WC_CONNECT,    // 主动连接，数据为连接地址
+                EN_WC_DISCONNECT, // 断开连接
+                EN_WC_STOP,       // 关闭所有连接并退出线程
+            };
+        };
+
+        // 内存通道里每个消息的头部，后面紧跟数据
+        struct io_stream_worker_msg_head {
+            uint32_t type; // io线程发出的是 io_stream_worker_event_t ，调用方线程发出的是 io_stream_worker_cmd_t
+            int32_t errcode;
+            int32_t status;
+            uint32_t reserve;
+            uint64_t conn_id;
+            uint64_t token; // io_stream_workers_connect传入的值，连接结果事件原样带回
+        };
+
+        // 内存通道满时生产者阻塞在这里，消费者取走数据后唤醒
+        struct io_stream_worker_waiter {
+            uv_mutex_t lock;
+            uv_cond_t cond;
+            volatile util::lock::atomic_int_type<int> is_waiting;
+        };
+
+        // 主动连接的请求，连接结果事件要带回调用方的token
+        struct io_stream_worker_connect_req {
+            std::string address;
+            uint64_t token;
+        };
+
+        struct io_stream_worker {
+            io_stream_worker_group *group;
+            size_t index;
+
+            adapter::loop_t ev_loop;
+            uv_async_t notify; // 调用方线程写入命令后通知io线程
+            uv_thread_t thread;
+            bool is_running;
+
+            io_stream_channel channel;
+
+            mem_channel *in_channel;  // io线程 -> 调用方线程
+            mem_channel *out_channel; // 调用方线程 -> io线程
+            void *in_buffer;
+            void *out_buffer;
+            io_stream_worker_waiter in_waiter;  // io线程等待调用方线程处理事件
+            io_stream_worker_waiter out_waiter; // 调用方线程等待io线程处理命令(只在关闭时)
+
+            // 以下只在io线程里访问
+            uintptr_t conn_seq;
+            typedef ATBUS_ADVANCE_TYPE_MAP(uint64_t, io_stream_connection *) conn_map_t;
+            conn_map_t conns;
+            std::vector<char> scratch; // 内存通道尾部回绕的消息拼接到这里
+        };
+
+        struct io_stream_worker_group {
+            std::vector<io_stream_worker *> workers;
+            size_t queue_size;
+            size_t connect_index; // 主动连接轮流分配给各个io线程
+            bool is_started;
+            bool is_receiving; // 调用方线程正在分发事件，回调里嵌套的io_stream_workers_recv直接返回
+            volatile util::lock::atomic_int_type<int> is_closing;
+            std::vector<char> scratch;
+
+            // io_stream_workers_watch设置的调用方线程的通知
+            uv_async_t *watcher;
+            io_stream_worker_callback_t watch_callback;
+            void *watch_priv_data;
+        };
+
+        typedef bool (*io_stream_worker_handle_fn_t)(void *ctx, const io_stream_worker_msg_head *head, const void *data, size_t len);
+
+        static void io_stream_worker_waiter_init(io_stream_worker_waiter &waiter) {
+            uv_mutex_init(&waiter.lock);
+            uv_cond_init(&waiter.cond);
+            waiter.is_waiting.store(0);
+        }
+
+        static void io_stream_worker_waiter_destroy(io_stream_worker_waiter &waiter) {
+            uv_cond_destroy(&waiter.cond);
+            uv_mutex_destroy(&waiter.lock);
+        }
+
+        // 消费者取走数据后调用，只有生产者在等待时才需要加锁
+        static void io_stream_worker_wakeup(io_stream_worker_waiter &waiter, bool force) {
+            if (!force && 0 == waiter.is_waiting.load()) {
+                return;
+            }
+
+            uv_mutex_lock(&waiter.lock);
+            uv_cond_signal(&waiter.cond);
+            uv_mutex_unlock(&waiter.lock);
+        }
+
+        static inline uint64_t io_stream_worker_conn_id(io_stream_worker *worker, io_stream_connection *connection) {
+            return (static_cast<uint64_t>(reinterpret_cast<uintptr_t>(connection->data)) << ATBUS_MACRO_IOS_WORKER_INDEX_BITS) |
+                   static_cast<uint64_t>(worker->index);
+        }
+
+        static void io_stream_worker_init_head(io_stream_worker_msg_head &head, uint32_t type, int errcode, int status, uint64_t conn_id,
+                                               uint64_t token) {
+            head.type = type;
+            head.errcode = errcode;
+            head.status = status;
+            head.reserve = 0;
+            head.conn_id = conn_id;
+            head.token = token;
+        }
+
+        static int io_stream_worker_push(mem_channel *channel, const io_stream_worker_msg_head &head, const void *buf, size_t len) {
+            channel_iovec_t iov[2];
+            iov[0].base = &head;
+            iov[0].len = sizeof(head);
+            iov[1].base = buf;
+            iov[1].len = len;
+            return mem_sendv(channel, iov, NULL == buf || 0 == len ? 1 : 2);
+        }
+
+        /**
+         * @brief 写入内存通道，通道满时阻塞到消费者取走数据
+         * @param cancel 不为NULL并且被设置时放弃写入
+         * @return 0或错误码
+         */
+        static int io_stream_worker_push_wait(io_stream_worker_waiter &waiter, mem_channel *channel, const io_stream_worker_msg_head &head,
+                                              const void *buf, size_t len, const volatile util::lock::atomic_int_type<int> *cancel) {
+            int ret = io_stream_worker_push(channel, head, buf, len);
+            while (EN_ATBUS_ERR_BUFF_LIMIT == ret && (NULL == cancel || 0 == cancel->load())) {
+                uv_mutex_lock(&waiter.lock);
+                waiter.is_waiting.store(1);
+
+                // 设置等待标记后要再试一次，否则消费者可能在设置之前已经取走了数据，不会再唤醒
+                ret = io_stream_worker_push(channel, head, buf, len);
+                if (EN_ATBUS_ERR_BUFF_LIMIT == ret && (NULL == cancel || 0 == cancel->load())) {
+                    uv_cond_timedwait(&waiter.cond, &waiter.lock, ATBUS_MACRO_IOS_WORKER_WAIT_TIMEOUT);
+                    ret = io_stream_worker_push(channel, head, buf, len);
+                }
+
+                waiter.is_waiting.store(0);
+                uv_mutex_unlock(&waiter.lock);
+            }
+
+            return ret;
+        }
+
+        // io线程发送事件，调用方线程处理不过来时阻塞io线程，对端的发送也会被tcp窗口限制住
+        static void io_stream_worker_push_event(io_stream_worker *worker, uint32_t event, int errcode, int status, uint64_t conn_id,
+                                                uint64_t token, const void *buf, size_t len) {
+            io_stream_worker_msg_head head;
+            io_stream_worker_init_head(head, event, errcode, status, conn_id, token);
+
+            // 正在关闭时调用方线程不会再处理事件，直接丢弃
+            if (EN_ATBUS_ERR_SUCCESS !=
+                io_stream_worker_push_wait(worker->in_waiter, worker->in_channel, head, buf, len, &worker->group->is_closing)) {
+                return;
+            }
+
+            if (NULL != worker->group->watcher) {
+                uv_async_send(worker->group->watcher);
+            }
+        }
+
+        /**
+         * @brief 处理内存通道里的消息
+         * @param waiter 取走数据后唤醒等待中的生产者
+         * @param max_count 最多处理的消息数量，0表示不限制
+         * @return 处理的消息数量
+         */
+        static size_t io_stream_worker_consume(mem_channel *channel, io_stream_worker_waiter &waiter, std::vector<char> &scratch,
+                                               size_t max_count, io_stream_worker_handle_fn_t fn, void *ctx) {
+            mem_recv_block_t blocks[ATBUS_MACRO_IOS_WORKER_BATCH];
+            size_t ret = 0;
+            bool is_continue = true;
+
+            while (is_continue && (0 == max_count || ret < max_count)) {
+                size_t batch = ATBUS_MACRO_IOS_WORKER_BATCH;
+                if (0 != max_count && max_count - ret < batch) {
+                    batch = max_count - ret;
+                }
+
+                size_t count = 0;
+                if (EN_ATBUS_ERR_SUCCESS != mem_recv_batch(channel, blocks, batch, &count) || 0 == count) {
+                    break;
+                }
+
+                size_t i = 0;
+                for (; is_continue && i < count; ++i) {
+                    const mem_recv_block_t &block = blocks[i];
+                    if (block.len < sizeof(io_stream_worker_msg_head)) {
+                        continue;
+                    }
+
+                    // 只有在通道尾部回绕时才需要拼接
+                    const char *msg = reinterpret_cast<const char *>(block.buffer[0]);
+                    if (block.length[1] > 0) {
+                        scratch.resize(block.len);
+                        memcpy(&scratch[0], block.buffer[0], block.length[0]);
+                        memcpy(&scratch[block.length[0]], block.buffer[1], block.length[1]);
+                        msg = &scratch[0];
+                    }
+
+                    io_stream_worker_msg_head head;
+                    memcpy(&head, msg, sizeof(head));
+                    is_continue = fn(ctx, &head, msg + sizeof(head), block.len - sizeof(head));
+                }
+
+                ret += i;
+                mem_recv_batch_release(channel, blocks, count);
+                io_stream_worker_wakeup(waiter, false);
+            }
+
+            return ret;
+        }
+
+        // ================ io线程 ================
+        static void io_stream_worker_bind(io_stream_worker *worker, io_stream_connection *connection, uint32_t event, uint64_t token) {
+            if (0 == ++worker->conn_seq) {
+                ++worker->conn_seq;
+            }
+
+            connection->data = reinterpret_cast<void *>(worker->conn_seq);
+            uint64_t conn_id = io_stream_worker_conn_id(worker, connection);
+            worker->conns[conn_id] = connection;
+            io_stream_worker_push_event(worker, event, EN_ATBUS_ERR_SUCCESS, 0, conn_id, token, connection->addr.address.c_str(),
+                                        connection->addr.address.size());
+        }
+
+        static void io_stream_worker_on_accepted(io_stream_channel *channel, io_stream_connection *connection, int errcode, void *, size_t) {
+            if (NULL == connection || EN_ATBUS_ERR_SUCCESS != errcode) {
+                return;
+            }
+
+            io_stream_worker_bind(reinterpret_cast<io_stream_worker *>(channel->data), connection,
+                                  io_stream_worker_event_t::EN_WE_ACCEPTED, 0);
+        }
+
+        static void io_stream_worker_on_connected(io_stream_channel *channel, io_stream_connection *connection, int errcode,
+                                                  void *priv_data, size_t) {
+            io_stream_worker *worker = reinterpret_cast<io_stream_worker *>(channel->data);
+            io_stream_worker_connect_req *req = reinterpret_cast<io_stream_worker_connect_req *>(priv_data);
+
+            if (NULL != connection && EN_ATBUS_ERR_SUCCESS == errcode) {
+                io_stream_worker_bind(worker, connection, io_stream_worker_event_t::EN_WE_CONNECTED, req->token);
+            } else {
+                io_stream_worker_push_event(worker, io_stream_worker_event_t::EN_WE_CONNECTED,
+                                            EN_ATBUS_ERR_SUCCESS == errcode ? EN_ATBUS_ERR_SOCK_CONNECT_FAILED : errcode,
+                                            channel->error_code, 0, req->token, req->address.c_str(), req->address.size());
+            }
+
+            delete req;
+        }
+
+        static void io_stream_worker_on_disconnected(io_stream_channel *channel, io_stream_connection *connection, int errcode, void *,
+                                                     size_t) {
+            // 监听的连接和没有分配ID的连接不需要通知
+            if (NULL == connection || NULL == connection->data) {
+                return;
+            }
+
+            io_stream_worker *worker = reinterpret_cast<io_stream_worker *>(channel->data);
+            uint64_t conn_id = io_stream_worker_conn_id(worker, connection);
+            worker->conns.erase(conn_id);
+            connection->data = NULL;
+
+            io_stream_worker_push_event(worker, io_stream_worker_event_t::EN_WE_DISCONNECTED, errcode, channel->error_code, conn_id, 0,
+                                        NULL, 0);
+        }
+
+        static void io_stream_worker_on_recved(io_stream_channel *channel, io_stream_connection *connection, int errcode, void *buffer,
+                                               size_t s) {
+            if (NULL == connection || NULL == connection->data) {
+                return;
+            }
+
+            io_stream_worker *worker = reinterpret_cast<io_stream_worker *>(channel->data);
+            io_stream_worker_push_event(worker, io_stream_worker_event_t::EN_WE_RECVED, errcode, channel->error_code,
+                                        io_stream_worker_conn_id(worker, connection), 0, buffer, NULL == buffer ? 0 : s);
+        }
+
+        static bool io_stream_worker_on_cmd(void *ctx, const io_stream_worker_msg_head *head, const void *data, size_t len) {
+            io_stream_worker *worker = reinterpret_cast<io_stream_worker *>(ctx);
+
+            switch (head->type) {
+            case io_stream_worker_cmd_t::EN_WC_SEND: {
+                io_stream_worker::conn_map_t::iterator iter = worker->conns.find(head->conn_id);
+                int res = EN_ATBUS_ERR_CONNECTION_NOT_FOUND;
+                if (iter != worker->conns.end()) {
+                    res = io_stream_send(iter->second, data, len);
+                }
+
+                if (EN_ATBUS_ERR_SUCCESS != res) {
+                    io_stream_worker_push_event(worker, io_stream_worker_event_t::EN_WE_SEND_FAILED, res, worker->channel.error_code,
+                                                head->conn_id, 0, data, len);
+                }
+                break;
+            }
+            case io_stream_worker_cmd_t::EN_WC_CONNECT: {
+                io_stream_worker_connect_req *req = new io_stream_worker_connect_req();
+                req->address.assign(reinterpret_cast<const char *>(data), len);
+                req->token = head->token;
+
+                channel_address_t addr;
+                int res = EN_ATBUS_ERR_CHANNEL_ADDR_INVALID;
+                if (make_address(req->address.c_str(), addr)) {
+                    res = io_stream_connect(&worker->channel, addr, io_stream_worker_on_connected, req, 0);
+                }
+
+                // 同步失败时不会有回调
+                if (EN_ATBUS_ERR_SUCCESS != res) {
+                    io_stream_worker_push_event(worker, io_stream_worker_event_t::EN_WE_CONNECTED, res, worker->channel.error_code, 0,
+                                                req->token, req->address.c_str(), req->address.size());
+                    delete req;
+                }
+                break;
+            }
+            case io_stream_worker_cmd_t::EN_WC_DISCONNECT: {
+                io_stream_worker::conn_map_t::iterator iter = worker->conns.find(head->conn_id);
+                if (iter != worker->conns.end()) {
+                    io_stream_disconnect(&worker->channel, iter->second, NULL);
+                }
+                break;
+            }
+            case io_stream_worker_cmd_t::EN_WC_STOP:
+                uv_stop(&worker->ev_loop);
+                return false;
+            default:
+                break;
+            }
+
+            return true;
+        }
+
+        static void io_stream_worker_on_notify(uv_async_t *handle) {
+            io_stream_worker *worker = reinterpret_cast<io_stream_worker *>(handle->data);
+            io_stream_worker_consume(worker->out_channel, worker->out_waiter, worker->scratch, 0, io_stream_worker_on_cmd, worker);
+        }
+
+        static void io_stream_worker_shutdown(io_stream_worker *worker) {
+            io_stream_close(&worker->channel);
+
+            uv_close(reinterpret_cast<adapter::handle_t *>(&worker->notify), NULL);
+            while (UV_EBUSY == uv_loop_close(&worker->ev_loop)) {
+                uv_run(&worker->ev_loop, UV_RUN_ONCE);
+            }
+        }
+
+        static void io_stream_worker_main(void *arg) {
+            io_stream_worker *worker = reinterpret_cast<io_stream_worker *>(arg);
+
+            // 启动之前可能已经有命令了
+            io_stream_worker_on_notify(&worker->notify);
+            uv_run(&worker->ev_loop, UV_RUN_DEFAULT);
+
+            io_stream_worker_shutdown(worker);
+        }
+
+        static void io_stream_worker_destroy(io_stream_worker *worker) {
+            if (NULL == worker) {
+                return;
+            }
+
+            if (NULL != worker->in_buffer) {
+                free(worker->in_buffer);
+            }
+
+            if (NULL != worker->out_buffer) {
+                free(worker->out_buffer);
+            }
+
+            io_stream_worker_waiter_destroy(worker->in_waiter);
+            io_stream_worker_waiter_destroy(worker->out_waiter);
+            delete worker;
+        }
+
+        static int io_stream_worker_init_queue(size_t queue_size, void **buffer, mem_channel **channel) {
+            *buffer = malloc(queue_size);
+            if (NULL == *buffer) {
+                return EN_ATBUS_ERR_MALLOC;
+            }
+
+            int ret = mem_init_record(*buffer, queue_size, channel, NULL);
+            if (EN_ATBUS_ERR_SUCCESS != ret) {
+                return ret;
+            }
+
+            // 同一个进程内不需要校验数据
+            return mem_set_checksum(*channel, mem_checksum_t::EN_MCS_NONE);
+        }
+
+        static int io_stream_worker_create(io_stream_worker_group *group, size_t index, const io_stream_conf *conf,
+                                           io_stream_worker **out) {
+            io_stream_worker *worker = new io_stream_worker();
+            *out = worker;
+            if (NULL == worker) {
+                return EN_ATBUS_ERR_MALLOC;
+            }
+
+            worker->group = group;
+            worker->index = index;
+            worker->is_running = false;
+            worker->in_channel = NULL;
+            worker->out_channel = NULL;
+            worker->in_buffer = NULL;
+            worker->out_buffer = NULL;
+            worker->conn_seq = 0;
+            io_stream_worker_waiter_init(worker->in_waiter);
+            io_stream_worker_waiter_init(worker->out_waiter);
+
+            int ret = io_stream_worker_init_queue(group->queue_size, &worker->in_buffer, &worker->in_channel);
+            if (EN_ATBUS_ERR_SUCCESS == ret) {
+                ret = io_stream_worker_init_queue(group->queue_size, &worker->out_buffer, &worker->out_channel);
+            }
+
+            if (EN_ATBUS_ERR_SUCCESS != ret) {
+                io_stream_worker_destroy(worker);
+                *out = NULL;
+                return ret;
+            }
+
+            uv_loop_init(&worker->ev_loop);
+            uv_async_init(&worker->ev_loop, &worker->notify, io_stream_worker_on_notify);
+            worker->notify.data = worker;
+
+            io_stream_init(&worker->channel, &worker->ev_loop, conf);
+            worker->channel.data = worker;
+            worker->channel.evt.callbacks[io_stream_callback_evt_t::EN_FN_ACCEPTED] = io_stream_worker_on_accepted;
+            worker->channel.evt.callbacks[io_stream_callback_evt_t::EN_FN_DISCONNECTED] = io_stream_worker_on_disconnected;
+            worker->channel.evt.callbacks[io_stream_callback_evt_t::EN_FN_RECVED] = io_stream_worker_on_recved;
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        // ================ 调用方线程 ================
+        static io_stream_worker *io_stream_workers_get(io_stream_worker_group *group, uint64_t conn_id) {
+            size_t index = static_cast<size_t>(conn_id & ((static_cast<uint64_t>(1) << ATBUS_MACRO_IOS_WORKER_INDEX_BITS) - 1));
+            if (index >= group->workers.size()) {
+                return NULL;
+            }
+
+            return group->workers[index];
+        }
+
+        static void io_stream_workers_notify(io_stream_worker *worker) {
+            if (worker->is_running) {
+                uv_async_send(&worker->notify);
+            }
+        }
+
+        static int io_stream_workers_push_cmd(io_stream_worker *worker, uint32_t cmd, uint64_t conn_id, uint64_t token, const void *buf,
+                                              size_t len) {
+            io_stream_worker_msg_head head;
+            io_stream_worker_init_head(head, cmd, 0, 0, conn_id, token);
+            int ret = io_stream_worker_push(worker->out_channel, head, buf, len);
+            if (EN_ATBUS_ERR_SUCCESS == ret) {
+                io_stream_workers_notify(worker);
+            }
+
+            return ret;
+        }
+
+        int io_stream_workers_init(io_stream_worker_group **group, size_t worker_count, const io_stream_conf *conf, size_t queue_size) {
+            if (NULL == group || 0 == worker_count || worker_count >= (static_cast<size_t>(1) << ATBUS_MACRO_IOS_WORKER_INDEX_BITS)) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            io_stream_worker_group *ret = new io_stream_worker_group();
+            *group = ret;
+            if (NULL == ret) {
+                return EN_ATBUS_ERR_MALLOC;
+            }
+
+            ret->queue_size = queue_size;
+            ret->connect_index = 0;
+            ret->is_started = false;
+            ret->is_receiving = false;
+            ret->is_closing.store(0);
+            ret->watcher = NULL;
+            ret->watch_callback = NULL;
+            ret->watch_priv_data = NULL;
+            ret->workers.reserve(worker_count);
+
+            for (size_t i = 0; i < worker_count; ++i) {
+                io_stream_worker *worker = NULL;
+                int res = io_stream_worker_create(ret, i, conf, &worker);
+                if (EN_ATBUS_ERR_SUCCESS != res) {
+                    io_stream_workers_close(ret);
+                    *group = NULL;
+                    return res;
+                }
+
+                ret->workers.push_back(worker);
+            }
+
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        int io_stream_workers_listen(io_stream_worker_group *group, const channel_address_t &addr) {
+            if (NULL == group) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            // io线程启动后channel只能在io线程里访问
+            if (group->is_started) {
+                return EN_ATBUS_ERR_ACCESS_DENY;
+            }
+
+            size_t listen_count = 1;
+#if defined(SO_REUSEPORT) && !defined(_WIN32)
+            if (0 == UTIL_STRFUNC_STRNCASE_CMP("ipv4", addr.scheme.c_str(), 4) ||
+                0 == UTIL_STRFUNC_STRNCASE_CMP("ipv6", addr.scheme.c_str(), 4)) {
+                listen_count = group->workers.size();
+            }
+#endif
+
+            for (size_t i = 0; i < listen_count; ++i) {
+                io_stream_channel *channel = &group->workers[i]->channel;
+                channel->conf.is_reuseport = listen_count > 1;
+                int ret = io_stream_listen(channel, addr, NULL, NULL, 0);
+                if (EN_ATBUS_ERR_SUCCESS != ret) {
+                    return ret;
+                }
+            }
+
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        int io_stream_workers_start(io_stream_worker_group *group) {
+            if (NULL == group) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            if (group->is_started) {
+                return EN_ATBUS_ERR_ALREADY_INITED;
+            }
+
+            group->is_started = true;
+            for (size_t i = 0; i < group->workers.size(); ++i) {
+                io_stream_worker *worker = group->workers[i];
+                if (0 != uv_thread_create(&worker->thread, io_stream_worker_main, worker)) {
+                    return EN_ATBUS_ERR_INNER;
+                }
+                worker->is_running = true;
+            }
+
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        int io_stream_workers_connect(io_stream_worker_group *group, const channel_address_t &addr, uint64_t token) {
+            if (NULL == group || group->workers.empty()) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            io_stream_worker *worker = group->workers[group->connect_index % group->workers.size()];
+            ++group->connect_index;
+            return io_stream_workers_push_cmd(worker, io_stream_worker_cmd_t::EN_WC_CONNECT, 0, token, addr.address.c_str(),
+                                              addr.address.size());
+        }
+
+        int io_stream_workers_disconnect(io_stream_worker_group *group, uint64_t conn_id) {
+            if (NULL == group) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            io_stream_worker *worker = io_stream_workers_get(group, conn_id);
+            if (NULL == worker) {
+                return EN_ATBUS_ERR_CONNECTION_NOT_FOUND;
+            }
+
+            return io_stream_workers_push_cmd(worker, io_stream_worker_cmd_t::EN_WC_DISCONNECT, conn_id, 0, NULL, 0);
+        }
+
+        int io_stream_workers_send(io_stream_worker_group *group, uint64_t conn_id, const void *buf, size_t len) {
+            if (NULL == group) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            io_stream_worker *worker = io_stream_workers_get(group, conn_id);
+            if (NULL == worker) {
+                return EN_ATBUS_ERR_CONNECTION_NOT_FOUND;
+            }
+
+            return io_stream_workers_push_cmd(worker, io_stream_worker_cmd_t::EN_WC_SEND, conn_id, 0, buf, len);
+        }
+
+        int io_stream_workers_send_reserve(io_stream_worker_group *group, uint64_t conn_id, size_t len, mem_reserved_block_t *block) {
+            if (NULL == group || NULL == block) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            io_stream_worker *worker = io_stream_workers_get(group, conn_id);
+            if (NULL == worker) {
+                return EN_ATBUS_ERR_CONNECTION_NOT_FOUND;
+            }
+
+            int ret = mem_send_reserve(worker->out_channel, sizeof(io_stream_worker_msg_head) + len, block);
+            if (ret < 0) {
+                return ret;
+            }
+
+            // 变长记录格式的数据区总是连续的，跳过头部后只把数据部分交给调用方
+            io_stream_worker_msg_head head;
+            io_stream_worker_init_head(head, io_stream_worker_cmd_t::EN_WC_SEND, 0, 0, conn_id, 0);
+            memcpy(block->buffer[0], &head, sizeof(head));
+            block->buffer[0] = reinterpret_cast<char *>(block->buffer[0]) + sizeof(head);
+            block->length[0] -= sizeof(head);
+            block->len -= sizeof(head);
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        int io_stream_workers_send_commit(io_stream_worker_group *group, uint64_t conn_id, mem_reserved_block_t *block) {
+            if (NULL == group || NULL == block) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            io_stream_worker *worker = io_stream_workers_get(group, conn_id);
+            if (NULL == worker) {
+                return EN_ATBUS_ERR_CONNECTION_NOT_FOUND;
+            }
+
+            // 还原io_stream_workers_send_reserve跳过的头部
+            block->buffer[0] = reinterpret_cast<char *>(block->buffer[0]) - sizeof(io_stream_worker_msg_head);
+            block->length[0] += sizeof(io_stream_worker_msg_head);
+            block->len += sizeof(io_stream_worker_msg_head);
+
+            int ret = mem_send_commit(worker->out_channel, block);
+            if (EN_ATBUS_ERR_SUCCESS == ret) {
+                io_stream_workers_notify(worker);
+            }
+
+            return ret;
+        }
+
+        struct io_stream_workers_recv_ctx {
+            io_stream_worker_group *group;
+            io_stream_worker_callback_t callback;
+            void *priv_data;
+        };
+
+        static bool io_stream_workers_on_event(void *ctx, const io_stream_worker_msg_head *head, const void *data, size_t len) {
+            io_stream_workers_recv_ctx *recv_ctx = reinterpret_cast<io_stream_workers_recv_ctx *>(ctx);
+
+            io_stream_worker_msg_t msg;
+            msg.event = head->type;
+            msg.errcode = head->errcode;
+            msg.status = head->status;
+            msg.conn_id = head->conn_id;
+            msg.token = head->token;
+            msg.data = data;
+            msg.len = len;
+            recv_ctx->callback(recv_ctx->group, &msg, recv_ctx->priv_data);
+            return true;
+        }
+
+        int io_stream_workers_recv(io_stream_worker_group *group, io_stream_worker_callback_t callback, void *priv_data, size_t max_count,
+                                   size_t *count) {
+            if (NULL != count) {
+                *count = 0;
+            }
+
+            if (NULL == group || NULL == callback) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            // 批量取出的事件分发完以后才释放通道空间，嵌套调用会再取到同一批事件
+            if (group->is_receiving) {
+                return EN_ATBUS_ERR_NO_DATA;
+            }
+
+            io_stream_workers_recv_ctx ctx;
+            ctx.group = group;
+            ctx.callback = callback;
+            ctx.priv_data = priv_data;
+
+            size_t total = 0;
+            group->is_receiving = true;
+            for (size_t i = 0; i < group->workers.size(); ++i) {
+                io_stream_worker *worker = group->workers[i];
+                total += io_stream_worker_consume(worker->in_channel, worker->in_waiter, group->scratch, max_count, io_stream_workers_on_event,
+                                                  &ctx);
+            }
+            group->is_receiving = false;
+
+            if (NULL != count) {
+                *count = total;
+            }
+
+            return 0 == total ? EN_ATBUS_ERR_NO_DATA : EN_ATBUS_ERR_SUCCESS;
+        }
+
+        static void io_stream_workers_on_watch(uv_async_t *handle) {
+            io_stream_worker_group *group = reinterpret_cast<io_stream_worker_group *>(handle->data);
+            if (NULL == group) {
+                return;
+            }
+
+            io_stream_workers_recv(group, group->watch_callback, group->watch_priv_data, 0, NULL);
+        }
+
+        static void io_stream_workers_on_watch_closed(adapter::handle_t *handle) { delete reinterpret_cast<uv_async_t *>(handle); }
+
+        int io_stream_workers_watch(io_stream_worker_group *group, adapter::loop_t *ev_loop, io_stream_worker_callback_t callback,
+                                    void *priv_data) {
+            if (NULL == group || NULL == ev_loop || NULL == callback) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            // io线程启动后会读取watcher，只能在启动前设置
+            if (group->is_started || NULL != group->watcher) {
+                return EN_ATBUS_ERR_ACCESS_DENY;
+            }
+
+            uv_async_t *watcher = new uv_async_t();
+            if (NULL == watcher) {
+                return EN_ATBUS_ERR_MALLOC;
+            }
+
+            if (0 != uv_async_init(ev_loop, watcher, io_stream_workers_on_watch)) {
+                delete watcher;
+                return EN_ATBUS_ERR_INNER;
+            }
+
+            watcher->data = group;
+            group->watcher = watcher;
+            group->watch_callback = callback;
+            group->watch_priv_data = priv_data;
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        int io_stream_workers_close(io_stream_worker_group *group) {
+            if (NULL == group) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            // 通知io线程不再等待调用方线程处理事件
+            group->is_closing.store(1);
+
+            for (size_t i = 0; i < group->workers.size(); ++i) {
+                io_stream_worker *worker = group->workers[i];
+                if (!worker->is_running) {
+                    continue;
+                }
+
+                io_stream_worker_wakeup(worker->in_waiter, true);
+
+                // 命令通道满时等io线程处理完前面的命令
+                io_stream_worker_msg_head head;
+                io_stream_worker_init_head(head, io_stream_worker_cmd_t::EN_WC_STOP, 0, 0, 0, 0);
+                io_stream_worker_push_wait(worker->out_waiter, worker->out_channel, head, NULL, 0, NULL);
+                io_stream_workers_notify(worker);
+            }
+
+            for (size_t i = 0; i < group->workers.size(); ++i) {
+                io_stream_worker *worker = group->workers[i];
+                if (worker->is_running) {
+                    uv_thread_join(&worker->thread);
+                } else {
+                    io_stream_worker_shutdown(worker);
+                }
+
+                io_stream_worker_destroy(worker);
+            }
+
+            // 所有io线程都退出后才能关闭，否则io线程可能还会通知
+            if (NULL != group->watcher) {
+                group->watcher->data = NULL;
+                uv_close(reinterpret_cast<adapter::handle_t *>(group->watcher), io_stream_workers_on_watch_closed);
+                group->watcher = NULL;
+            }
+
+            delete group;
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        size_t io_stream_workers_count(const io_stream_worker_group *group) {
+            if (NULL == group) {
+                return 0;
+            }
+
+            return group->workers.size();
+        }
+    }
+}
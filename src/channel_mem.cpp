@@ -25,11 +25,16 @@
 #include "common/string_oprs.h"
 
 
+#include "detail/buffer.h"
+#include "detail/crc32.h"
+#include "detail/libatbus_channel_export.h"
 #include "detail/libatbus_config.h"
 #include "detail/libatbus_error.h"
 #include "lock/atomic_int_type.h"
 #include "std/thread.h"
 
+#include "detail/xxhash64.h"
+
 
 #ifndef ATBUS_MACRO_DATA_NODE_SIZE
 #define ATBUS_MACRO_DATA_NODE_SIZE 128
@@ -39,7 +44,17 @@
 #define ATBUS_MACRO_DATA_ALIGN_TYPE size_t
 #endif
 
+#ifndef ATBUS_MACRO_CACHE_LINE_SIZE
+#define ATBUS_MACRO_CACHE_LINE_SIZE 64
+#endif
+
+#ifndef ATBUS_MACRO_DOORBELL_NAME_SIZE
+#define ATBUS_MACRO_DOORBELL_NAME_SIZE 64
+#endif
+
 #define MEM_CHANNEL_NAME "ATBUSMEM"
+#define MEM_CHANNEL_V2_NAME "ATBUSMM2"
+#define MEM_RECORD_CHANNEL_NAME "ATBUSREC"
 
 namespace atbus {
     namespace channel {
@@ -56,8 +71,6 @@ namespace atbus {
             struct hash_factor<false> {
                 static uint32_t hash(uint32_t seed, const void *s, size_t l) {
                     return util::hash::murmur_hash3_x86_32(s, static_cast<int>(l), seed);
-                    // CRC算法性能太差，包长度也不太可能超过2GB
-                    // return atbus::detail::crc32(crc, static_cast<const unsigned char *>(s), l);
                 }
             };
 
@@ -65,16 +78,93 @@ namespace atbus {
             struct hash_factor<true> {
                 static uint64_t hash(uint64_t seed, const void *s, size_t l) {
                     return util::hash::murmur_hash3_x86_32(s, static_cast<int>(l), static_cast<uint32_t>(seed));
-                    // CRC算法性能太差，包长度也不太可能超过2GB
-                    // return atbus::detail::crc64(crc, static_cast<const unsigned char *>(s), l);
                 }
             };
+
+            static inline uint32_t murmur3_rotl32(uint32_t x, int r) { return (x << r) | (x >> (32 - r)); }
+
+            static inline uint32_t murmur3_mix_k1(uint32_t k1) {
+                k1 *= 0xcc9e2d51;
+                k1 = murmur3_rotl32(k1, 15);
+                return k1 * 0x1b873593;
+            }
+
+            static inline uint32_t murmur3_block(uint32_t h1, const unsigned char *p) {
+                uint32_t k1;
+                memcpy(&k1, p, sizeof(k1));
+                h1 ^= murmur3_mix_k1(k1);
+                h1 = murmur3_rotl32(h1, 13);
+                return h1 * 5 + 0xe6546b64;
+            }
+
+            /**
+             * @brief 计算两段数据拼起来的murmur3_x86_32，结果和util::hash::murmur_hash3_x86_32一致
+             * @note 只有跨段的那个4字节块和尾部需要拼到栈上
+             */
+            static uint32_t murmur_hash3_x86_32_segments(uint32_t seed, const void *buf1, size_t len1, const void *buf2, size_t len2) {
+                const unsigned char *p1 = static_cast<const unsigned char *>(buf1);
+                const unsigned char *p2 = static_cast<const unsigned char *>(buf2);
+                size_t total_len = len1 + len2;
+                uint32_t h1 = seed;
+
+                const unsigned char *end1 = p1 + (len1 & ~static_cast<size_t>(3));
+                for (; p1 < end1; p1 += 4) {
+                    h1 = murmur3_block(h1, p1);
+                }
+
+                unsigned char tail[4];
+                size_t tail_len = len1 & 3;
+                memcpy(tail, p1, tail_len);
+                if (tail_len > 0 && len2 >= 4 - tail_len) {
+                    memcpy(tail + tail_len, p2, 4 - tail_len);
+                    h1 = murmur3_block(h1, tail);
+                    p2 += 4 - tail_len;
+                    len2 -= 4 - tail_len;
+                    tail_len = 0;
+                }
+
+                if (0 == tail_len) {
+                    const unsigned char *end2 = p2 + (len2 & ~static_cast<size_t>(3));
+                    for (; p2 < end2; p2 += 4) {
+                        h1 = murmur3_block(h1, p2);
+                    }
+                    tail_len = len2 & 3;
+                    memcpy(tail, p2, tail_len);
+                } else {
+                    memcpy(tail + tail_len, p2, len2);
+                    tail_len += len2;
+                }
+
+                uint32_t k1 = 0;
+                switch (tail_len) {
+                case 3:
+                    k1 ^= static_cast<uint32_t>(tail[2]) << 16;
+                    // fall through
+                case 2:
+                    k1 ^= static_cast<uint32_t>(tail[1]) << 8;
+                    // fall through
+                case 1:
+                    k1 ^= tail[0];
+                    h1 ^= murmur3_mix_k1(k1);
+                    break;
+                default:
+                    break;
+                }
+
+                h1 ^= static_cast<uint32_t>(total_len);
+                h1 ^= h1 >> 16;
+                h1 *= 0x85ebca6b;
+                h1 ^= h1 >> 13;
+                h1 *= 0xc2b2ae35;
+                h1 ^= h1 >> 16;
+                return h1;
+            }
         }
 
         typedef ATBUS_MACRO_DATA_ALIGN_TYPE data_align_type;
 
         // 配置数据结构
-        typedef struct {
+        struct mem_conf {
             size_t protect_node_count;
             size_t protect_memory_size;
             uint64_t conf_send_timeout_ms;
@@ -82,10 +172,22 @@ namespace atbus {
             size_t write_retry_times;
             // TODO 接收端校验号(用于保证只有一个接收者)
             volatile util::lock::atomic_int_type<size_t> atomic_recver_identify;
-        } mem_conf;
 
-        // 通道头
-        typedef struct {
+            uint32_t checksum_mode; // 校验方式，见 mem_checksum_t，收发两端都从通道头读取
+        };
+
+        // 旧版本的配置数据结构，v1通道头内嵌这个结构，布局不能变
+        struct mem_conf_v1 {
+            size_t protect_node_count;
+            size_t protect_memory_size;
+            uint64_t conf_send_timeout_ms;
+
+            size_t write_retry_times;
+            volatile util::lock::atomic_int_type<size_t> atomic_recver_identify;
+        };
+
+        // 通道头(v1)，读写游标和统计信息在同一个cache line里，只用于兼容旧版本创建的通道
+        struct mem_channel {
             char node_magic[8]; // 魔术串，用于标识数据类型
 
             // 数据节点
@@ -105,7 +207,7 @@ namespace atbus {
             volatile util::lock::atomic_int_type<uint32_t> atomic_operation_seq; // 操作序列号(用于保证只有一个接收者)
 
             // 配置
-            mem_conf conf;
+            mem_conf_v1 conf;
             size_t area_channel_offset;
             size_t area_head_offset;
             size_t area_data_offset;
@@ -115,17 +217,73 @@ namespace atbus {
             size_t block_bad_count;     // 读取到坏块次数
             size_t block_timeout_count; // 读取到写入超时块次数
             size_t node_bad_count;      // 读取到坏node次数
-        } mem_channel;
+        };
 
 #if (defined(__cplusplus) && __cplusplus >= 201103L) || (defined(_MSC_VER) && _MSC_VER >= 1800)
         static_assert(std::is_standard_layout<mem_channel>::value, "mem_channel must be a standard layout");
 #endif
 
+        /**
+         * @brief 通道头(v2)
+         * @note 字段和v1一致，按只读区、写端和读端分开，中间至少间隔一个cache line，避免写端和读端互相使对方的cache line失效
+         * @note 写端缓存读游标，读端缓存写游标，只有看起来满了或者空了的时候才去读对方的游标
+         */
+        struct mem_channel_v2 {
+            char node_magic[8]; // 魔术串，用于标识数据类型
+
+            // 数据节点
+            size_t node_size;
+            size_t node_size_bin_power; // (用于优化算法) node_size = 1 << node_size_bin_power
+            size_t node_count;
+
+            // 配置
+            mem_conf conf;
+            size_t area_channel_offset;
+            size_t area_head_offset;
+            size_t area_data_offset;
+            size_t area_end_offset;
+
+            char producer_padding[ATBUS_MACRO_CACHE_LINE_SIZE];
+
+            // 写端
+            volatile util::lock::atomic_int_type<size_t> atomic_write_cur;       // util::lock::atomic_int_type也是POD类型
+            volatile util::lock::atomic_int_type<size_t> atomic_cached_read_cur; // 写端缓存的读游标，只会向前移动
+            volatile util::lock::atomic_int_type<uint32_t> atomic_operation_seq; // 操作序列号(用于保证只有一个接收者)
+
+            char consumer_padding[ATBUS_MACRO_CACHE_LINE_SIZE];
+
+            // 读端
+            volatile util::lock::atomic_int_type<size_t> atomic_read_cur; // util::lock::atomic_int_type也是POD类型
+            size_t cached_write_cur;                                      // 读端缓存的写游标
+
+            // 第一次读到正在写入数据的时间
+            uint64_t first_failed_writing_time;
+
+            // 统计信息
+            size_t block_bad_count;     // 读取到坏块次数
+            size_t block_timeout_count; // 读取到写入超时块次数
+            size_t node_bad_count;      // 读取到坏node次数
+
+            char doorbell_padding[ATBUS_MACRO_CACHE_LINE_SIZE];
+
+            // 门铃，只有接收端休眠前后才会写，发送端每次提交只读一次等待标记
+            volatile util::lock::atomic_int_type<uint32_t> atomic_doorbell_waiting; // 接收端正在等待门铃
+            char doorbell_name[ATBUS_MACRO_DOORBELL_NAME_SIZE];                      // 门铃地址，空串表示未开启
+        };
+
+#if (defined(__cplusplus) && __cplusplus >= 201103L) || (defined(_MSC_VER) && _MSC_VER >= 1800)
+        static_assert(std::is_standard_layout<mem_channel_v2>::value, "mem_channel_v2 must be a standard layout");
+#endif
+
         // 对齐头
-        typedef struct {
-            mem_channel channel;
-            char align[4 * 1024 - sizeof(mem_channel)]; // 对齐到4KB,用于以后拓展
-        } mem_channel_head_align;
+        template <typename TCH>
+        struct mem_channel_head_align_t {
+            TCH channel;
+            char align[4 * 1024 - sizeof(TCH)]; // 对齐到4KB,用于以后拓展
+        };
+
+        typedef mem_channel_head_align_t<mem_channel> mem_channel_head_align;
+        typedef mem_channel_head_align_t<mem_channel_v2> mem_channel_v2_head_align;
 
 
         // 数据节点头
@@ -191,11 +349,85 @@ namespace atbus {
          */
         static inline uint32_t set_flag(uint32_t flag, MEM_FLAG checked) { return flag | checked; }
 
+        typedef enum {
+            MEM_LAYOUT_NODE_V1 = 0,
+            MEM_LAYOUT_NODE_V2,
+            MEM_LAYOUT_RECORD,
+        } MEM_LAYOUT;
+
+        /**
+         * @brief 根据魔术串判定通道头的格式，mem_attach的校验也用这里的结果，两处的判定规则必须一致
+         * @param magic 通道头里的魔术串
+         * @param layout 输出通道头的格式，未知的魔术串按v1处理
+         * @return 是否是已知的魔术串
+         */
+        static inline bool mem_match_layout(const char *magic, MEM_LAYOUT &layout) {
+            if (0 == UTIL_STRFUNC_STRNCASE_CMP(MEM_CHANNEL_V2_NAME, magic, sizeof(MEM_CHANNEL_V2_NAME) - 1)) {
+                layout = MEM_LAYOUT_NODE_V2;
+                return true;
+            }
+
+            if (0 == UTIL_STRFUNC_STRNCASE_CMP(MEM_RECORD_CHANNEL_NAME, magic, sizeof(MEM_RECORD_CHANNEL_NAME) - 1)) {
+                layout = MEM_LAYOUT_RECORD;
+                return true;
+            }
+
+            layout = MEM_LAYOUT_NODE_V1;
+            return 0 == UTIL_STRFUNC_STRNCASE_CMP(MEM_CHANNEL_NAME, magic, sizeof(MEM_CHANNEL_NAME) - 1);
+        }
+
+        static inline MEM_LAYOUT mem_get_layout(const mem_channel *channel) {
+            MEM_LAYOUT ret;
+            mem_match_layout(channel->node_magic, ret);
+            return ret;
+        }
+
+        static inline mem_channel_v2 *mem_v2_cast(mem_channel *channel) { return reinterpret_cast<mem_channel_v2 *>(channel); }
+
+        /**
+         * @brief 写端获取读游标
+         * @param channel 内存通道
+         * @param refresh 是否重新读取读端的游标
+         * @note 写端只使用缓存的读游标计算可用空间，缓存只会向前移动，所以写游标不会越过缓存的读游标
+         * @return 读游标
+         */
+        static inline size_t mem_producer_read_cur(mem_channel *channel, bool) { return channel->atomic_read_cur.load(); }
+
+        static inline size_t mem_producer_read_cur(mem_channel_v2 *channel, bool refresh) {
+            size_t ret = channel->atomic_cached_read_cur.load();
+            if (refresh) {
+                // 只有缓存没被其他写端更新过才写入，失败时ret是其他写端更新后的值
+                size_t read_cur = channel->atomic_read_cur.load();
+                if (channel->atomic_cached_read_cur.compare_exchange_strong(ret, read_cur)) {
+                    ret = read_cur;
+                }
+            }
+
+            return ret;
+        }
+
+        /**
+         * @brief 读端获取写游标，缓存的写游标已经读完时才重新读取写端的游标
+         * @param channel 内存通道
+         * @param read_cur 当前的读游标
+         * @return 写游标
+         */
+        static inline size_t mem_consumer_write_cur(mem_channel *channel, size_t) { return channel->atomic_write_cur.load(); }
+
+        static inline size_t mem_consumer_write_cur(mem_channel_v2 *channel, size_t read_cur) {
+            if (read_cur == channel->cached_write_cur) {
+                channel->cached_write_cur = channel->atomic_write_cur.load();
+            }
+
+            return channel->cached_write_cur;
+        }
+
         /**
          * @brief 生存默认配置
          * @param conf
          */
-        static void mem_default_conf(mem_channel *channel) {
+        template <typename TCH>
+        static void mem_default_conf(TCH *channel) {
             assert(channel);
 
             channel->conf.conf_send_timeout_ms = 4;
@@ -222,7 +454,8 @@ namespace atbus {
          * @param data_len 到缓冲区末尾的长度
          * @return 节点head指针
          */
-        static inline mem_node_head *mem_get_node_head(mem_channel *channel, size_t index, void **data, size_t *data_len) {
+        template <typename TCH>
+        static inline mem_node_head *mem_get_node_head(TCH *channel, size_t index, void **data, size_t *data_len) {
             assert(channel);
             assert(index < channel->node_count);
 
@@ -248,7 +481,8 @@ namespace atbus {
          * @param index 节点索引
          * @return 数据块head指针
          */
-        static inline mem_block_head *mem_get_block_head(mem_channel *channel, size_t index, void **data, size_t *data_len) {
+        template <typename TCH>
+        static inline mem_block_head *mem_get_block_head(TCH *channel, size_t index, void **data, size_t *data_len) {
             assert(channel);
             assert(index < channel->node_count);
 
@@ -270,7 +504,8 @@ namespace atbus {
          * @param offset 索引偏移
          * @return 数据块head指针
          */
-        static inline size_t mem_next_index(mem_channel *channel, size_t index, size_t offset) {
+        template <typename TCH>
+        static inline size_t mem_next_index(TCH *channel, size_t index, size_t offset) {
             assert(channel);
             return (index + offset) % channel->node_count;
         }
@@ -287,16 +522,35 @@ namespace atbus {
         //    return (index + channel->node_count - offset) % channel->node_count;
         //}
 
-        static uint32_t mem_fetch_operation_seq(mem_channel *channel) {
+        /**
+         * @brief 获取第index个操作序号，0保留给空节点，跳过
+         * @param base mem_fetch_operation_seq的返回值
+         * @param index 序号索引
+         * @return 操作序号
+         */
+        static inline uint32_t mem_get_operation_seq(uint32_t base, uint32_t index) {
+            uint32_t ret = base + 1 + index;
+            return ret > base ? ret : ret + 1;
+        }
+
+        /**
+         * @brief 一次分配多个操作序号
+         * @param channel 内存通道
+         * @param count 序号数量
+         * @return 用于mem_get_operation_seq的基准值
+         */
+        template <typename TCH>
+        static uint32_t mem_fetch_operation_seq(TCH *channel, uint32_t count) {
             uint32_t ret = channel->atomic_operation_seq.load();
             // std::atomic_thread_fence(std::memory_order_seq_cst);
             bool f = false;
             while (!f) {
                 // CAS
-                f = channel->atomic_operation_seq.compare_exchange_weak(ret, (ret + 1) ? (ret + 1) : ret + 2);
+                uint32_t next = ret + count;
+                f = channel->atomic_operation_seq.compare_exchange_weak(ret, next > ret ? next : next + 1);
             }
 
-            return (ret + 1) ? (ret + 1) : ret + 2;
+            return ret;
         }
 
         /**
@@ -304,20 +558,111 @@ namespace atbus {
          * @param len 数据长度
          * @return 数据长度需要的数据块数量
          */
-        static inline size_t mem_calc_node_num(mem_channel *channel, size_t len) {
+        template <typename TCH>
+        static inline size_t mem_calc_node_num(TCH *channel, size_t len) {
             assert(channel);
             // channel->node_size 必须是2的N次方，所以使用优化算法
             return (len + mem_block::block_head_size + channel->node_size - 1) >> channel->node_size_bin_power;
         }
 
+        /**
+         * @brief 获取通道的校验方式
+         * @note v1通道头没有这个配置，只能使用murmur3
+         */
+        static inline uint32_t mem_checksum_mode(const mem_channel *) { return mem_checksum_t::EN_MCS_MURMUR3; }
+
+        template <typename TCH>
+        static inline uint32_t mem_checksum_mode(const TCH *channel) {
+            return channel->conf.checksum_mode;
+        }
+
         /**
          * @brief 生成校验码
+         * @param mode 校验方式，见 mem_checksum_t
          * @param src 源数据
          * @param len 数据长度
-         * @note Hash 快速校验
+         * @note 同一台机器上的共享内存只需要防止写了一半的数据，所以允许只校验长度或者不校验
+         */
+        static data_align_type mem_fast_check(uint32_t mode, const void *src, size_t len) {
+            switch (mode) {
+            case mem_checksum_t::EN_MCS_NONE:
+                return 0;
+            case mem_checksum_t::EN_MCS_HEADER:
+                return ~static_cast<data_align_type>(len);
+            case mem_checksum_t::EN_MCS_CRC32C:
+                return static_cast<data_align_type>(~atbus::detail::crc32c(~static_cast<uint32_t>(0), static_cast<const unsigned char *>(src), len));
+            case mem_checksum_t::EN_MCS_XXHASH64:
+                return static_cast<data_align_type>(atbus::detail::xxhash64(0, src, len));
+            default:
+                return static_cast<data_align_type>(detail::hash_factor<sizeof(data_align_type) >= sizeof(uint64_t)>::hash(0, src, len));
+            }
+        }
+
+        /**
+         * @brief 生成回绕成两段的数据的校验码，结果和连续数据调用mem_fast_check一致
+         * @param mode 校验方式，见 mem_checksum_t
+         * @note 所有校验方式都按段增量计算，发送和接收都不需要拼成连续内存
+         */
+        static data_align_type mem_fast_check_segments(uint32_t mode, const void *buf1, size_t len1, const void *buf2, size_t len2) {
+            if (0 == len2) {
+                return mem_fast_check(mode, buf1, len1);
+            }
+
+            switch (mode) {
+            case mem_checksum_t::EN_MCS_NONE:
+            case mem_checksum_t::EN_MCS_HEADER:
+                return mem_fast_check(mode, NULL, len1 + len2);
+            case mem_checksum_t::EN_MCS_CRC32C: {
+                uint32_t crc = atbus::detail::crc32c(~static_cast<uint32_t>(0), static_cast<const unsigned char *>(buf1), len1);
+                crc = atbus::detail::crc32c(crc, static_cast<const unsigned char *>(buf2), len2);
+                return static_cast<data_align_type>(~crc);
+            }
+            case mem_checksum_t::EN_MCS_XXHASH64: {
+                atbus::detail::xxhash64_state state;
+                atbus::detail::xxhash64_init(state, 0);
+                atbus::detail::xxhash64_update(state, buf1, len1);
+                atbus::detail::xxhash64_update(state, buf2, len2);
+                return static_cast<data_align_type>(atbus::detail::xxhash64_digest(state));
+            }
+            default:
+                return static_cast<data_align_type>(detail::murmur_hash3_x86_32_segments(0, buf1, len1, buf2, len2));
+            }
+        }
+
+        /**
+         * @brief 把多段数据依次写入预留的数据区
+         */
+        static void mem_sendv_copy(const mem_reserved_block_t *block, const channel_iovec_t *iov, size_t iovcnt) {
+            ::atbus::detail::buffer_span_writer writer(block->buffer[0], block->length[0], block->buffer[1], block->length[1]);
+            for (size_t i = 0; i < iovcnt; ++i) {
+                writer.write(reinterpret_cast<const char *>(iov[i].base), iov[i].len);
+            }
+        }
+
+        /**
+         * @brief 提交数据后通知休眠中的接收端
+         * @note 写游标的CAS在接收端设置等待标记之后的话，这里一定能读到等待标记；在之前的话接收端一定能看到写游标变化而不会休眠
+         * @note v1通道头没有门铃
          */
-        static data_align_type mem_fast_check(const void *src, size_t len) {
-            return static_cast<data_align_type>(detail::hash_factor<sizeof(data_align_type) >= sizeof(uint64_t)>::hash(0, src, len));
+        static inline void mem_doorbell_notify(mem_channel *) {}
+
+        template <typename TCH>
+        static inline void mem_doorbell_notify(TCH *channel) {
+            if (0 == channel->atomic_doorbell_waiting.load()) {
+                return;
+            }
+
+            // 多个发送端同时看到等待标记时只需要通知一次
+            uint32_t waiting = 1;
+            if (!channel->atomic_doorbell_waiting.compare_exchange_strong(waiting, 0)) {
+                return;
+            }
+
+#ifdef ATBUS_CHANNEL_DOORBELL
+            if (0 != channel->doorbell_name[0]) {
+                doorbell_ring(channel->doorbell_name);
+            }
+#endif
         }
 
         // 对齐单位的大小必须是2的N次方
@@ -337,20 +682,22 @@ namespace atbus {
             mem_channel_head_align *head = (mem_channel_head_align *)buf;
             if (channel) *channel = &head->channel;
 
-            if (0 != UTIL_STRFUNC_STRNCASE_CMP(MEM_CHANNEL_NAME, head->channel.node_magic, strlen(MEM_CHANNEL_NAME))) {
+            MEM_LAYOUT layout;
+            if (!mem_match_layout(head->channel.node_magic, layout)) {
                 return EN_ATBUS_ERR_CHANNEL_BUFFER_INVALID;
             }
 
             return EN_ATBUS_ERR_SUCCESS;
         }
 
-        int mem_init(void *buf, size_t len, mem_channel **channel, const mem_conf *conf) {
+        template <typename TCH>
+        static int mem_node_init(void *buf, size_t len, TCH **channel, const mem_conf *conf, const char *magic) {
             // 缓冲区最小长度为数据头+空洞node的长度
-            if (len < sizeof(mem_channel_head_align) + mem_block::node_data_size + mem_block::node_head_size)
+            if (len < sizeof(mem_channel_head_align_t<TCH>) + mem_block::node_data_size + mem_block::node_head_size)
                 return EN_ATBUS_ERR_CHANNEL_SIZE_TOO_SMALL;
 
             memset(buf, 0x00, len);
-            mem_channel_head_align *head = (mem_channel_head_align *)buf;
+            mem_channel_head_align_t<TCH> *head = (mem_channel_head_align_t<TCH> *)buf;
 
             // 节点计算
             head->channel.node_size = mem_block::node_data_size;
@@ -366,13 +713,13 @@ namespace atbus {
 
             // 偏移位置计算
             head->channel.area_channel_offset = (char *)&head->channel - (char *)buf;
-            head->channel.area_head_offset = sizeof(mem_channel_head_align);
+            head->channel.area_head_offset = sizeof(mem_channel_head_align_t<TCH>);
             head->channel.area_data_offset = head->channel.area_head_offset + head->channel.node_count * mem_block::node_head_size;
             head->channel.area_end_offset = head->channel.area_data_offset + head->channel.node_count * head->channel.node_size;
 
             // 配置初始化
             if (NULL != conf)
-                memcpy(&head->channel.conf, &conf, sizeof(conf));
+                memcpy(&head->channel.conf, conf, sizeof(head->channel.conf));
             else
                 mem_default_conf(&head->channel);
 
@@ -381,152 +728,1256 @@ namespace atbus {
 
 #ifdef UTIL_STRFUNC_C11_SUPPORT
             static_assert(sizeof(head->channel.node_magic) >= (sizeof(MEM_CHANNEL_NAME) - 1), "magic text size error");
+            static_assert(sizeof(head->channel.node_magic) >= (sizeof(MEM_CHANNEL_V2_NAME) - 1), "magic text size error");
 
-            memcpy_s(head->channel.node_magic, sizeof(head->channel.node_magic), MEM_CHANNEL_NAME, sizeof(MEM_CHANNEL_NAME) - 1);
+            memcpy_s(head->channel.node_magic, sizeof(head->channel.node_magic), magic, sizeof(head->channel.node_magic));
 #else
-            memcpy(head->channel.node_magic, MEM_CHANNEL_NAME, sizeof(head->channel.node_magic));
+            memcpy(head->channel.node_magic, magic, sizeof(head->channel.node_magic));
 #endif
             return EN_ATBUS_ERR_SUCCESS;
         }
 
-        static int mem_send_real(mem_channel *channel, const void *buf, size_t len) {
-            // 用于调试的节点编号信息
-            detail::last_action_channel_begin_node_index = std::numeric_limits<size_t>::max();
-            detail::last_action_channel_end_node_index = std::numeric_limits<size_t>::max();
-
-            if (NULL == channel) return EN_ATBUS_ERR_PARAMS;
-
-            if (0 == len) return EN_ATBUS_ERR_SUCCESS;
+        int mem_init(void *buf, size_t len, mem_channel **channel, const mem_conf *conf) {
+            mem_channel_v2 *channel_v2 = NULL;
+            int ret = mem_node_init(buf, len, &channel_v2, conf, MEM_CHANNEL_V2_NAME);
+            if (channel) *channel = reinterpret_cast<mem_channel *>(channel_v2);
+            return ret;
+        }
 
-            size_t node_count = mem_calc_node_num(channel, len);
-            // 要写入的数据比可用的缓冲区还大
-            if (node_count >= channel->node_count - channel->conf.protect_node_count) return EN_ATBUS_ERR_BUFF_LIMIT;
+        int mem_init_v1(void *buf, size_t len, mem_channel **channel, const mem_conf *conf) {
+            return mem_node_init(buf, len, channel, conf, MEM_CHANNEL_NAME);
+        }
 
-            // 获取操作序号
-            uint32_t opr_seq = mem_fetch_operation_seq(channel);
+        // ================= variable-size record ring =================
+        // 变长记录格式: 数据区是连续的环形字节流，每个消息是一个带长度前缀的记录
+        // 读写每个消息只需要操作一个记录头，不再需要逐个node重置node head
 
-            // 游标操作
-            size_t read_cur = 0;
-            size_t new_write_cur, write_cur = channel->atomic_write_cur.load();
+        /**
+         * @brief 变长记录通道头，魔术串的位置和mem_channel一致，用于区分通道格式
+         * @note 读写游标都是单调递增的对齐单位数，取模后才是数据区的位置
+         * @note 和mem_channel_v2一样按只读区、写端和读端分开，并且缓存对方的游标
+         */
+        struct mem_record_channel {
+            char node_magic[8]; // 魔术串，用于标识数据类型
 
-            while (true) {
-                read_cur = channel->atomic_read_cur.load();
-                // std::atomic_thread_fence(std::memory_order_seq_cst);
+            // 数据区
+            size_t unit_size;  // 记录对齐单位
+            size_t unit_count; // 数据区包含的对齐单位数量
 
-                // 要留下一个node做tail, 所以多减1
-                size_t available_node = (read_cur + channel->node_count - write_cur - 1) % channel->node_count;
-                if (available_node >= channel->conf.protect_node_count)
-                    available_node -= channel->conf.protect_node_count;
-                else
-                    available_node = 0;
+            // 配置
+            mem_conf conf;
+            size_t protect_unit_count;
+            size_t area_channel_offset;
+            size_t area_data_offset;
+            size_t area_end_offset;
 
-                if (node_count > available_node) return EN_ATBUS_ERR_BUFF_LIMIT;
+            char producer_padding[ATBUS_MACRO_CACHE_LINE_SIZE];
 
-                // 新的尾部node游标
-                new_write_cur = (write_cur + node_count) % channel->node_count;
+            // 写端，[atomic_read_cur, atomic_write_cur) 内的数据都是已使用的数据
+            volatile util::lock::atomic_int_type<uint64_t> atomic_write_cur;       // util::lock::atomic_int_type也是POD类型
+            volatile util::lock::atomic_int_type<uint64_t> atomic_cached_read_cur; // 写端缓存的读游标，只会向前移动
 
-                // CAS
-                bool f = channel->atomic_write_cur.compare_exchange_weak(write_cur, new_write_cur);
+            char consumer_padding[ATBUS_MACRO_CACHE_LINE_SIZE];
 
-                if (f) break;
+            // 读端
+            volatile util::lock::atomic_int_type<uint64_t> atomic_read_cur; // util::lock::atomic_int_type也是POD类型
+            uint64_t cached_write_cur;                                      // 读端缓存的写游标
 
-                // 发现冲突原子操作失败则重试
-            }
-            detail::last_action_channel_begin_node_index = write_cur;
-            detail::last_action_channel_end_node_index = new_write_cur;
+            // 第一次读到正在写入数据的时间
+            uint64_t first_failed_writing_time;
 
-            // 数据缓冲区操作 - 初始化
-            void *buffer_start = NULL;
-            size_t buffer_len = 0;
-            mem_block_head *block_head = mem_get_block_head(channel, write_cur, &buffer_start, &buffer_len);
-            memset(block_head, 0x00, sizeof(mem_block_head));
+            // 统计信息
+            size_t block_bad_count;     // 读取到坏块次数
+            size_t block_timeout_count; // 读取到写入超时块次数
+            size_t node_bad_count;      // 读取到坏记录头次数
 
-            // 数据缓冲区操作 - 要写入的节点
-            {
-                block_head->buffer_size = 0;
+            char doorbell_padding[ATBUS_MACRO_CACHE_LINE_SIZE];
 
-                mem_node_head *first_node_head = mem_get_node_head(channel, write_cur, NULL, NULL);
-                first_node_head->flag = set_flag(first_node_head->flag, MF_START_NODE);
-                first_node_head->operation_seq = opr_seq;
+            // 门铃，和mem_channel_v2一致
+            volatile util::lock::atomic_int_type<uint32_t> atomic_doorbell_waiting; // 接收端正在等待门铃
+            char doorbell_name[ATBUS_MACRO_DOORBELL_NAME_SIZE];                      // 门铃地址，空串表示未开启
+        };
 
-                for (size_t i = mem_next_index(channel, write_cur, 1); i != new_write_cur; i = mem_next_index(channel, i, 1)) {
-                    mem_node_head *this_node_head = mem_get_node_head(channel, i, NULL, NULL);
+#if (defined(__cplusplus) && __cplusplus >= 201103L) || (defined(_MSC_VER) && _MSC_VER >= 1800)
+        static_assert(std::is_standard_layout<mem_record_channel>::value, "mem_record_channel must be a standard layout");
+#endif
 
-                    // 写数据node出现冲突
-                    if (this_node_head->operation_seq) {
-                        return EN_ATBUS_ERR_NODE_BAD_BLOCK_WSEQ_ID;
-                    }
+        // 对齐头
+        typedef struct {
+            mem_record_channel channel;
+            char align[4 * 1024 - sizeof(mem_record_channel)]; // 对齐到4KB,用于以后拓展
+        } mem_record_channel_head_align;
 
-                    this_node_head->flag = set_flag(this_node_head->flag, MF_WRITEN);
-                    this_node_head->operation_seq = opr_seq;
-                }
-            }
-            block_head->buffer_size = len;
+        // 记录头
+        typedef struct {
+            volatile util::lock::atomic_int_type<uint64_t> atomic_position; // 记录的起始游标，写完数据后最后写入
+            uint64_t reserve_position; // 预留成功后立刻写入的起始游标，用于写入超时后跳过这个记录
+            size_t buffer_size;        // 数据长度，0表示填充到数据区末尾的空记录
+            data_align_type fast_check;
+        } mem_record_head;
 
-            // 数据写入
-            // fast_memcpy
-            // 数据有回绕
-            if (new_write_cur && new_write_cur < write_cur) {
-                size_t copy_len = len > buffer_len ? buffer_len : len;
-                memcpy(buffer_start, buf, copy_len);
+        struct mem_record_block {
+            static const size_t channel_head_size = sizeof(mem_record_channel_head_align);
+            static const size_t unit_size = sizeof(data_align_type);
+            static const size_t record_head_size = ((sizeof(mem_record_head) - 1) / unit_size + 1) * unit_size;
+            static const size_t record_head_units = record_head_size / unit_size;
+        };
 
-                // 回绕nodes
-                mem_get_node_head(channel, 0, &buffer_start, NULL);
-                memcpy(buffer_start, (const char *)buf + copy_len, len - copy_len);
-            } else {
-                memcpy(buffer_start, buf, len);
-            }
-            block_head->fast_check = mem_fast_check(buf, len);
+        typedef union {
+            mem_channel *mem;
+            mem_record_channel *record;
+        } mem_record_switcher;
 
-            // 设置首node header，数据写完标记
-            {
-                mem_node_head *first_node_head = mem_get_node_head(channel, write_cur, NULL, NULL);
-                first_node_head->flag = set_flag(first_node_head->flag, MF_WRITEN);
+        static inline mem_record_channel *mem_record_cast(mem_channel *channel) {
+            mem_record_switcher switcher;
+            switcher.mem = channel;
+            return switcher.record;
+        }
 
-                // 再检查一次，以防memcpy时发生写冲突
-                if (opr_seq != first_node_head->operation_seq) {
-                    return EN_ATBUS_ERR_NODE_BAD_BLOCK_CSEQ_ID;
+        static inline uint64_t mem_producer_read_cur(mem_record_channel *channel, bool refresh) {
+            uint64_t ret = channel->atomic_cached_read_cur.load();
+            if (refresh) {
+                uint64_t read_cur = channel->atomic_read_cur.load();
+                if (channel->atomic_cached_read_cur.compare_exchange_strong(ret, read_cur)) {
+                    ret = read_cur;
                 }
             }
 
-            return EN_ATBUS_ERR_SUCCESS;
+            return ret;
         }
 
-        int mem_send(mem_channel *channel, const void *buf, size_t len) {
-            if (NULL == channel) return EN_ATBUS_ERR_PARAMS;
+        static inline uint64_t mem_consumer_write_cur(mem_record_channel *channel, uint64_t read_cur) {
+            if (read_cur == channel->cached_write_cur) {
+                channel->cached_write_cur = channel->atomic_write_cur.load();
+            }
 
-            int ret = 0;
-            size_t left_try_times = channel->conf.write_retry_times;
-            while (left_try_times-- > 0) {
-                int ret = mem_send_real(channel, buf, len);
+            return channel->cached_write_cur;
+        }
 
-                // 原子操作序列冲突，重试
-                if (EN_ATBUS_ERR_NODE_BAD_BLOCK_CSEQ_ID == ret || EN_ATBUS_ERR_NODE_BAD_BLOCK_WSEQ_ID == ret) continue;
+        /**
+         * @brief 计算一定长度数据的记录需要的对齐单位数量
+         */
+        static inline size_t mem_record_calc_units(size_t len) {
+            return (len + mem_record_block::record_head_size + mem_record_block::unit_size - 1) / mem_record_block::unit_size;
+        }
 
-                return ret;
-            }
+        /**
+         * @brief 获取记录头
+         * @param channel 内存通道
+         * @param pos 游标
+         * @param data 数据区起始地址
+         * @return 记录头指针
+         */
+        static inline mem_record_head *mem_record_get_head(mem_record_channel *channel, uint64_t pos, void **data) {
+            char *buf = (char *)channel + channel->area_data_offset - channel->area_channel_offset;
+            buf += static_cast<size_t>(pos % channel->unit_count) * mem_record_block::unit_size;
 
-            return ret;
+            if (data) (*data) = (void *)(buf + mem_record_block::record_head_size);
+            return (mem_record_head *)buf;
         }
 
-        int mem_recv(mem_channel *channel, void *buf, size_t len, size_t *recv_size) {
+        /**
+         * @brief 到数据区末尾还剩下的对齐单位数量
+         */
+        static inline size_t mem_record_tail_units(mem_record_channel *channel, uint64_t pos) {
+            return channel->unit_count - static_cast<size_t>(pos % channel->unit_count);
+        }
+
+        /**
+         * @brief 计算写入记录时需要跳过的数据区末尾的长度，数据区末尾放不下时从头开始写，保证每个记录都是连续的
+         */
+        static inline size_t mem_record_calc_padding(mem_record_channel *channel, uint64_t pos, size_t units) {
+            size_t tail_units = mem_record_tail_units(channel, pos);
+            return units > tail_units ? tail_units : 0;
+        }
+
+        /**
+         * @brief 可写入的对齐单位数量
+         */
+        static inline size_t mem_record_calc_available(mem_record_channel *channel, uint64_t read_cur, uint64_t write_cur) {
+            size_t used = static_cast<size_t>(write_cur - read_cur);
+            size_t reserved = used + channel->protect_unit_count;
+            return reserved >= channel->unit_count ? 0 : channel->unit_count - reserved;
+        }
+
+        /**
+         * @brief 单个记录的长度上限，最多用满保护区以外的整个数据区
+         * @note 数据区末尾的空记录和记录一起放不下时会先单独写入空记录，见 mem_record_pad_tail
+         */
+        static inline size_t mem_record_max_units(mem_record_channel *channel) {
+            return channel->unit_count - channel->protect_unit_count;
+        }
+
+        /**
+         * @brief 在数据区末尾写入空记录
+         * @note 末尾放不下记录头时读取端会直接跳过，不需要写空记录
+         */
+        static inline void mem_record_init_padding(mem_record_channel *channel, uint64_t pos, size_t padding_units) {
+            if (padding_units >= mem_record_block::record_head_units) {
+                mem_record_head *padding_head = mem_record_get_head(channel, pos, NULL);
+                padding_head->buffer_size = 0;
+                padding_head->fast_check = 0;
+                padding_head->reserve_position = pos;
+                padding_head->atomic_position.store(pos);
+            }
+        }
+
+        /**
+         * @brief 记录加上数据区末尾的空记录超过数据区上限时，先单独写入空记录
+         * @note 接收端跳过空记录后写游标就在数据区开头，之后这个记录最多可以用满整个数据区
+         * @param channel 内存通道
+         * @param read_cur 读游标
+         * @param write_cur 写游标
+         * @param units 记录需要的对齐单位数量
+         */
+        static void mem_record_pad_tail(mem_record_channel *channel, uint64_t read_cur, uint64_t write_cur, size_t units) {
+            size_t max_units = mem_record_max_units(channel);
+            size_t padding_units = mem_record_calc_padding(channel, write_cur, units);
+            if (0 == padding_units || units > max_units || padding_units + units <= max_units ||
+                padding_units > mem_record_calc_available(channel, read_cur, write_cur)) {
+                return;
+            }
+
+            // 其他写端已经移动了写游标时不需要再处理，下次写入会重新计算
+            if (!channel->atomic_write_cur.compare_exchange_strong(write_cur, write_cur + padding_units)) {
+                return;
+            }
+
+            mem_record_init_padding(channel, write_cur, padding_units);
+            mem_doorbell_notify(channel);
+        }
+
+        int mem_init_record(void *buf, size_t len, mem_channel **channel, const mem_conf *conf) {
+            // 缓冲区最小长度为数据头+一个记录头
+            if (len < sizeof(mem_record_channel_head_align) + 2 * mem_record_block::record_head_size)
+                return EN_ATBUS_ERR_CHANNEL_SIZE_TOO_SMALL;
+
+            memset(buf, 0x00, len);
+            mem_record_channel_head_align *head = (mem_record_channel_head_align *)buf;
+
+            head->channel.unit_size = mem_record_block::unit_size;
+            head->channel.unit_count = (len - mem_record_block::channel_head_size) / mem_record_block::unit_size;
+
+            // 偏移位置计算
+            head->channel.area_channel_offset = (char *)&head->channel - (char *)buf;
+            head->channel.area_data_offset = sizeof(mem_record_channel_head_align);
+            head->channel.area_end_offset = head->channel.area_data_offset + head->channel.unit_count * mem_record_block::unit_size;
+
+            // 配置初始化
+            if (NULL != conf) {
+                memcpy(&head->channel.conf, conf, sizeof(mem_conf));
+            } else {
+                head->channel.conf.conf_send_timeout_ms = 4;
+                head->channel.conf.write_retry_times = 4; // 默认写序列错误重试4次
+            }
+
+            // 和node格式一样优先使用保护node数量，按node的数据长度换算，默认留1/128的数据区用于保护缓冲区
+            if (head->channel.conf.protect_node_count) {
+                head->channel.protect_unit_count =
+                    (head->channel.conf.protect_node_count * mem_block::node_data_size + mem_record_block::unit_size - 1) /
+                    mem_record_block::unit_size;
+            } else if (head->channel.conf.protect_memory_size) {
+                head->channel.protect_unit_count =
+                    (head->channel.conf.protect_memory_size + mem_record_block::unit_size - 1) / mem_record_block::unit_size;
+            } else {
+                head->channel.protect_unit_count = head->channel.unit_count >> 7;
+            }
+            if (head->channel.protect_unit_count > head->channel.unit_count) head->channel.protect_unit_count = head->channel.unit_count;
+            head->channel.conf.protect_memory_size = head->channel.protect_unit_count * mem_record_block::unit_size;
+            head->channel.conf.protect_node_count =
+                (head->channel.conf.protect_memory_size + mem_block::node_data_size - 1) / mem_block::node_data_size;
+
+            // 游标从第二轮开始，避免全0的记录头被误认为已经写入
+            head->channel.atomic_read_cur.store(head->channel.unit_count);
+            head->channel.atomic_write_cur.store(head->channel.unit_count);
+            head->channel.atomic_cached_read_cur.store(head->channel.unit_count);
+            head->channel.cached_write_cur = head->channel.unit_count;
+
+            // 输出
+            if (channel) *channel = (mem_channel *)&head->channel;
+
+            memcpy(head->channel.node_magic, MEM_RECORD_CHANNEL_NAME, sizeof(head->channel.node_magic));
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        /**
+         * @brief 预留成功后初始化记录头，需要时在数据区末尾写入空记录
+         * @param channel 内存通道
+         * @param pos 预留的起始游标(包含末尾的空记录)
+         * @param padding_units 末尾空记录的长度
+         * @param len 数据长度
+         * @param block 输出预留的数据区
+         */
+        static void mem_record_init_block(mem_record_channel *channel, uint64_t pos, size_t padding_units, size_t len,
+                                          mem_reserved_block_t *block) {
+            mem_record_init_padding(channel, pos, padding_units);
+            pos += padding_units;
+
+            void *data = NULL;
+            mem_record_head *head = mem_record_get_head(channel, pos, &data);
+            head->buffer_size = len;
+            head->fast_check = 0;
+            head->reserve_position = pos;
+
+            block->buffer[0] = data;
+            block->length[0] = len;
+            block->buffer[1] = NULL;
+            block->length[1] = 0;
+            block->len = len;
+            block->begin_index = static_cast<size_t>(pos);
+            block->end_index = static_cast<size_t>(pos + mem_record_calc_units(len));
+            block->operation_seq = 0;
+        }
+
+        static int mem_record_send_reserve_real(mem_record_channel *channel, size_t len, mem_reserved_block_t *block) {
+            // 用于调试的节点编号信息
+            detail::last_action_channel_begin_node_index = std::numeric_limits<size_t>::max();
+            detail::last_action_channel_end_node_index = std::numeric_limits<size_t>::max();
+
+            memset(block, 0, sizeof(mem_reserved_block_t));
+            if (0 == len) return EN_ATBUS_ERR_SUCCESS;
+
+            size_t units = mem_record_calc_units(len);
+            // 要写入的数据比可用的缓冲区还大
+            if (units > mem_record_max_units(channel)) return EN_ATBUS_ERR_BUFF_LIMIT;
+
+            // 游标操作
+            size_t padding_units;
+            uint64_t new_write_cur, write_cur = channel->atomic_write_cur.load();
+            bool refresh_read_cur = false;
+            while (true) {
+                uint64_t read_cur = mem_producer_read_cur(channel, refresh_read_cur);
+                // std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                padding_units = mem_record_calc_padding(channel, write_cur, units);
+                if (padding_units + units > mem_record_calc_available(channel, read_cur, write_cur)) {
+                    // 缓存的读游标空间不足时重新读取一次
+                    if (!refresh_read_cur) {
+                        refresh_read_cur = true;
+                        continue;
+                    }
+
+                    mem_record_pad_tail(channel, read_cur, write_cur, units);
+                    return EN_ATBUS_ERR_BUFF_LIMIT;
+                }
+
+                new_write_cur = write_cur + padding_units + units;
+
+                // CAS
+                bool f = channel->atomic_write_cur.compare_exchange_weak(write_cur, new_write_cur);
+
+                if (f) break;
+
+                // 发现冲突原子操作失败则重试
+            }
+            detail::last_action_channel_begin_node_index = static_cast<size_t>(write_cur);
+            detail::last_action_channel_end_node_index = static_cast<size_t>(new_write_cur);
+
+            mem_record_init_block(channel, write_cur, padding_units, len, block);
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        static int mem_record_send_commit_real(mem_record_channel *channel, const mem_reserved_block_t *block, data_align_type fast_check) {
+            mem_record_head *head = (mem_record_head *)((char *)block->buffer[0] - mem_record_block::record_head_size);
+            head->fast_check = fast_check;
+
+            // 写入失败检测
+            if (static_cast<size_t>(head->reserve_position) != block->begin_index) {
+                return EN_ATBUS_ERR_NODE_BAD_BLOCK_CSEQ_ID;
+            }
+
+            // 最后写入起始游标，读取端以此判定数据写完
+            head->atomic_position.store(head->reserve_position);
+            mem_doorbell_notify(channel);
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        static int mem_record_send_batch_real(mem_record_channel *channel, const channel_iovec_t *iov, size_t iovcnt,
+                                              size_t *sent_count) {
+            // 用于调试的节点编号信息
+            detail::last_action_channel_begin_node_index = std::numeric_limits<size_t>::max();
+            detail::last_action_channel_end_node_index = std::numeric_limits<size_t>::max();
+
+            *sent_count = 0;
+            size_t max_units = mem_record_max_units(channel);
+
+            // 游标操作，只预留能放下的前面一部分消息
+            size_t batch_count;
+            uint64_t new_write_cur, write_cur = channel->atomic_write_cur.load();
+            bool refresh_read_cur = false;
+            while (true) {
+                uint64_t read_cur = mem_producer_read_cur(channel, refresh_read_cur);
+                // std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                size_t available_units = mem_record_calc_available(channel, read_cur, write_cur);
+                new_write_cur = write_cur;
+                for (batch_count = 0; batch_count < iovcnt; ++batch_count) {
+                    if (0 == iov[batch_count].len) {
+                        continue;
+                    }
+
+                    size_t units = mem_record_calc_units(iov[batch_count].len);
+                    size_t padding_units = mem_record_calc_padding(channel, new_write_cur, units);
+                    if (units > max_units || new_write_cur + padding_units + units - write_cur > available_units) {
+                        break;
+                    }
+                    new_write_cur += padding_units + units;
+                }
+
+                // 缓存的读游标放不下所有消息时重新读取一次
+                if (batch_count < iovcnt && !refresh_read_cur) {
+                    refresh_read_cur = true;
+                    continue;
+                }
+
+                if (0 == batch_count) {
+                    mem_record_pad_tail(channel, read_cur, write_cur, mem_record_calc_units(iov[0].len));
+                    return EN_ATBUS_ERR_BUFF_LIMIT;
+                }
+
+                // CAS
+                bool f = channel->atomic_write_cur.compare_exchange_weak(write_cur, new_write_cur);
+
+                if (f) break;
+
+                // 发现冲突原子操作失败则重试
+            }
+            detail::last_action_channel_begin_node_index = static_cast<size_t>(write_cur);
+            detail::last_action_channel_end_node_index = static_cast<size_t>(new_write_cur);
+
+            // 依次写入，记录头是单独的，不需要先初始化所有记录
+            for (size_t i = 0; i < batch_count; ++i) {
+                ++(*sent_count);
+                if (0 == iov[i].len) {
+                    continue;
+                }
+
+                size_t units = mem_record_calc_units(iov[i].len);
+                size_t padding_units = mem_record_calc_padding(channel, write_cur, units);
+
+                mem_reserved_block_t block;
+                mem_record_init_block(channel, write_cur, padding_units, iov[i].len, &block);
+                memcpy(block.buffer[0], iov[i].base, iov[i].len);
+                mem_record_send_commit_real(channel, &block, mem_fast_check(mem_checksum_mode(channel), iov[i].base, iov[i].len));
+
+                write_cur += padding_units + units;
+            }
+
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        static int mem_record_send(mem_record_channel *channel, const void *buf, size_t len) {
+            // 变长记录格式不会出现操作序列冲突，不需要重试
+            mem_reserved_block_t block;
+            int ret = mem_record_send_reserve_real(channel, len, &block);
+            if (ret < 0 || 0 == len) {
+                return ret;
+            }
+
+            memcpy(block.buffer[0], buf, len);
+            return mem_record_send_commit_real(channel, &block, mem_fast_check(mem_checksum_mode(channel), buf, len));
+        }
+
+        static int mem_record_sendv(mem_record_channel *channel, const channel_iovec_t *iov, size_t iovcnt, size_t len) {
+            mem_reserved_block_t block;
+            int ret = mem_record_send_reserve_real(channel, len, &block);
+            if (ret < 0 || 0 == len) {
+                return ret;
+            }
+
+            mem_sendv_copy(&block, iov, iovcnt);
+            return mem_record_send_commit_real(channel, &block, mem_fast_check(mem_checksum_mode(channel), block.buffer[0], len));
+        }
+
+        static int mem_record_send_batch(mem_record_channel *channel, const channel_iovec_t *iov, size_t iovcnt, size_t *sent_count) {
+            size_t sent = 0;
+            int ret = 0 == iovcnt ? EN_ATBUS_ERR_SUCCESS : mem_record_send_batch_real(channel, iov, iovcnt, &sent);
+            if (sent_count) *sent_count = sent;
+            return ret;
+        }
+
+        /**
+         * @brief 跳过坏记录后重新定位到下一个记录头
+         * @note 逐个对齐单位查找起始游标和自身位置一致的记录头
+         */
+        static uint64_t mem_record_resync(mem_record_channel *channel, uint64_t pos, uint64_t write_cur) {
+            while (pos != write_cur) {
+                size_t tail_units = mem_record_tail_units(channel, pos);
+                if (tail_units < mem_record_block::record_head_units) {
+                    pos += tail_units;
+                    continue;
+                }
+
+                mem_record_head *head = mem_record_get_head(channel, pos, NULL);
+                if (head->atomic_position.load() == pos || head->reserve_position == pos) {
+                    break;
+                }
+
+                ++pos;
+            }
+
+            return pos;
+        }
+
+        /**
+         * @brief 检查指定位置是否有已经写完的记录(会跳过数据区末尾的空记录)，不修改任何状态
+         */
+        static bool mem_record_check_ready(mem_record_channel *channel, uint64_t pos, uint64_t write_cur) {
+            while (pos != write_cur) {
+                size_t tail_units = mem_record_tail_units(channel, pos);
+                if (tail_units < mem_record_block::record_head_units) {
+                    pos += tail_units;
+                    continue;
+                }
+
+                size_t limit_units = static_cast<size_t>(write_cur - pos);
+                if (limit_units > tail_units) limit_units = tail_units;
+
+                mem_record_head *head = mem_record_get_head(channel, pos, NULL);
+                if (head->atomic_position.load() != pos) {
+                    return false;
+                }
+
+                if (0 == head->buffer_size && tail_units == limit_units) {
+                    pos += tail_units;
+                    continue;
+                }
+
+                return 0 != head->buffer_size && mem_record_calc_units(head->buffer_size) <= limit_units;
+            }
+
+            return false;
+        }
+
+        /**
+         * @brief 查找下一个可读取的记录
+         * @param channel 内存通道
+         * @param read_cur 开始查找的游标
+         * @param write_cur 写游标
+         * @param block 输出数据区
+         * @param fast_check 输出数据块的校验码
+         * @param begin_cur 输出记录的起始游标，出错时为跳过坏记录后的位置
+         * @param end_cur 输出记录的结束游标，出错时等于begin_cur
+         * @return 0或错误码
+         */
+        static int mem_record_recv_find_block(mem_record_channel *channel, uint64_t read_cur, uint64_t write_cur, mem_recv_block_t *block,
+                                              data_align_type *fast_check, uint64_t *begin_cur, uint64_t *end_cur) {
+            int ret = EN_ATBUS_ERR_SUCCESS;
+            memset(block, 0, sizeof(mem_recv_block_t));
+
+            mem_record_head *head = NULL;
+            void *data = NULL;
+            while (true) {
+                if (read_cur == write_cur) {
+                    ret = ret ? ret : EN_ATBUS_ERR_NO_DATA;
+                    break;
+                }
+
+                // 数据区末尾放不下记录头，直接跳过
+                size_t tail_units = mem_record_tail_units(channel, read_cur);
+                if (tail_units < mem_record_block::record_head_units) {
+                    read_cur += tail_units;
+                    continue;
+                }
+
+                head = mem_record_get_head(channel, read_cur, &data);
+                // 记录不能越过数据区末尾和写游标
+                size_t limit_units = static_cast<size_t>(write_cur - read_cur);
+                if (limit_units > tail_units) limit_units = tail_units;
+
+                // 未写入完成
+                if (head->atomic_position.load() != read_cur) {
+                    uint64_t cnow = (uint64_t)clock() * 1000 / CLOCKS_PER_SEC; // 转换到毫秒
+
+                    // 初次读取
+                    if (!channel->first_failed_writing_time) {
+                        channel->first_failed_writing_time = cnow;
+                        ret = ret ? ret : EN_ATBUS_ERR_NO_DATA;
+                        break;
+                    }
+
+                    uint64_t cd = cnow > channel->first_failed_writing_time ? cnow - channel->first_failed_writing_time
+                                                                            : channel->first_failed_writing_time - cnow;
+                    // 未到超时时间
+                    if (cd <= channel->conf.conf_send_timeout_ms) {
+                        ret = ret ? ret : EN_ATBUS_ERR_NO_DATA;
+                        break;
+                    }
+
+                    channel->first_failed_writing_time = 0;
+                    ++channel->block_bad_count;
+                    ++channel->block_timeout_count;
+                    // 写入超时，已经预留的记录可以整个跳过，否则只能重新定位
+                    if (head->reserve_position == read_cur && head->buffer_size &&
+                        mem_record_calc_units(head->buffer_size) <= limit_units) {
+                        read_cur += mem_record_calc_units(head->buffer_size);
+                    } else {
+                        ++channel->node_bad_count;
+                        read_cur = mem_record_resync(channel, read_cur + 1, write_cur);
+                    }
+                    continue;
+                }
+
+                // 数据区末尾的空记录
+                if (0 == head->buffer_size && tail_units == limit_units) {
+                    read_cur += tail_units;
+                    continue;
+                }
+
+                // 缓冲区长度异常
+                if (0 == head->buffer_size || mem_record_calc_units(head->buffer_size) > limit_units) {
+                    ret = ret ? ret : EN_ATBUS_ERR_NODE_BAD_BLOCK_BUFF_SIZE;
+                    ++channel->node_bad_count;
+                    read_cur = mem_record_resync(channel, read_cur + 1, write_cur);
+                    continue;
+                }
+
+                break;
+            }
+
+            *begin_cur = read_cur;
+            // 前面跳过了坏记录时先返回错误，有效的记录留到下一次读取
+            if (ret) {
+                *end_cur = read_cur;
+                block->begin_index = block->end_index = static_cast<size_t>(read_cur);
+                return ret;
+            }
+
+            channel->first_failed_writing_time = 0;
+
+            *end_cur = read_cur + mem_record_calc_units(head->buffer_size);
+            block->begin_index = static_cast<size_t>(*begin_cur);
+            block->end_index = static_cast<size_t>(*end_cur);
+            block->len = head->buffer_size;
+            block->buffer[0] = data;
+            block->length[0] = head->buffer_size;
+
+            if (fast_check) *fast_check = head->fast_check;
+            return ret;
+        }
+
+        /**
+         * @brief 移动读游标，不需要重置记录头
+         */
+        static void mem_record_recv_move_cursor(mem_record_channel *channel, uint64_t read_cur) {
+            detail::last_action_channel_begin_node_index = static_cast<size_t>(channel->atomic_read_cur.load());
+            detail::last_action_channel_end_node_index = static_cast<size_t>(read_cur);
+
+            // 设置游标
+            channel->atomic_read_cur.store(read_cur);
+        }
+
+        static int mem_record_recv(mem_record_channel *channel, void *buf, size_t len, size_t *recv_size) {
+            uint64_t begin_cur, end_cur;
+            mem_recv_block_t block;
+            data_align_type check_code = 0;
+            uint64_t read_cur = channel->atomic_read_cur.load();
+            int ret = mem_record_recv_find_block(channel, read_cur, mem_consumer_write_cur(channel, read_cur), &block, &check_code,
+                                                 &begin_cur, &end_cur);
+
+            do {
+                if (ret) {
+                    break;
+                }
+
+                // 写出的缓冲区不足
+                if (block.len > len) {
+                    ret = EN_ATBUS_ERR_BUFF_LIMIT;
+                    if (recv_size) *recv_size = block.len;
+
+                    end_cur = begin_cur;
+                    break;
+                }
+
+                // 接收数据
+                memcpy(buf, block.buffer[0], block.len);
+                if (recv_size) *recv_size = block.len;
+
+                // 校验不通过
+                if (mem_fast_check(mem_checksum_mode(channel), buf, block.len) != check_code) {
+                    ret = EN_ATBUS_ERR_BAD_DATA;
+                }
+            } while (false);
+
+            mem_record_recv_move_cursor(channel, end_cur);
+            return ret;
+        }
+
+        static int mem_record_recv_batch(mem_record_channel *channel, mem_recv_block_t *blocks, size_t max_count, size_t *count) {
+            // 读写游标都只读取一次
+            uint64_t ori_read_cur = channel->atomic_read_cur.load();
+            uint64_t write_cur = mem_consumer_write_cur(channel, ori_read_cur);
+            // std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            uint64_t first_begin_cur = ori_read_cur, end_cur = ori_read_cur;
+            int ret = EN_ATBUS_ERR_SUCCESS;
+            size_t n = 0;
+            for (; n < max_count; ++n) {
+                // 下一个记录还没写完就不再继续，避免重复统计坏记录
+                if (n > 0 && !mem_record_check_ready(channel, end_cur, write_cur)) {
+                    break;
+                }
+
+                uint64_t begin_cur;
+                data_align_type check_code = 0;
+                int res = mem_record_recv_find_block(channel, end_cur, write_cur, &blocks[n], &check_code, &begin_cur, &end_cur);
+                if (0 == res && mem_fast_check(mem_checksum_mode(channel), blocks[n].buffer[0], blocks[n].len) != check_code) {
+                    res = EN_ATBUS_ERR_BAD_DATA;
+                }
+
+                // 后续的数据块出错时留到下一次读取再处理
+                if (res) {
+                    if (0 == n) {
+                        ret = res;
+                        first_begin_cur = end_cur;
+                    }
+                    break;
+                }
+
+                if (0 == n) {
+                    first_begin_cur = begin_cur;
+                }
+            }
+
+            if (ret) {
+                mem_record_recv_move_cursor(channel, first_begin_cur);
+                memset(&blocks[0], 0, sizeof(mem_recv_block_t));
+                blocks[0].begin_index = blocks[0].end_index = static_cast<size_t>(first_begin_cur);
+                return ret;
+            }
+
+            // 只跳过前面的空记录和坏记录，数据块在释放时才移动读游标
+            if (ori_read_cur != first_begin_cur) {
+                mem_record_recv_move_cursor(channel, first_begin_cur);
+            }
+
+            if (count) *count = n;
+            return ret;
+        }
+
+        static int mem_record_recv_batch_release(mem_record_channel *channel, const mem_recv_block_t *blocks, size_t count) {
+            uint64_t read_cur = channel->atomic_read_cur.load();
+
+            // 只能释放最近一次取出的数据块
+            if (static_cast<size_t>(read_cur) != blocks[0].begin_index) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            // 游标是单调递增的，只有低位存在block里
+            mem_record_recv_move_cursor(channel, read_cur + (blocks[count - 1].end_index - blocks[0].begin_index));
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        static void mem_record_show_channel(mem_record_channel *channel, std::ostream &out, bool need_node_status, size_t need_node_data) {
+            uint64_t read_cur = channel->atomic_read_cur.load();
+            uint64_t write_cur = channel->atomic_write_cur.load();
+
+            out << "summary:" << std::endl
+                << "channel format: variable-size record" << std::endl
+                << "channel unit size: " << channel->unit_size << std::endl
+                << "channel unit count: " << channel->unit_count << std::endl
+                << "channel using memory size: " << (channel->area_end_offset - channel->area_channel_offset) << std::endl
+                << "channel available unit number: " << mem_record_calc_available(channel, read_cur, write_cur) << std::endl
+                << std::endl;
+
+            out << "configure:" << std::endl
+                << "send timeout(ms): " << channel->conf.conf_send_timeout_ms << std::endl
+                << "protect memory size(Bytes): " << channel->conf.protect_memory_size << std::endl
+                << "protect unit number: " << channel->protect_unit_count << std::endl
+                << "write retry times: " << channel->conf.write_retry_times << std::endl
+                << "checksum mode: " << mem_checksum_mode(channel) << std::endl
+                << std::endl;
+
+            out << "read&write:" << std::endl
+                << "first waiting time: " << channel->first_failed_writing_time << std::endl
+                << "read position: " << read_cur << std::endl
+                << "write position: " << write_cur << std::endl
+                << std::endl;
+
+            out << "stat:" << std::endl
+                << "bad block count: " << channel->block_bad_count << std::endl
+                << "bad record head count: " << channel->node_bad_count << std::endl
+                << "timeout block count: " << channel->block_timeout_count << std::endl
+                << std::endl;
+
+            if (need_node_status) {
+                out << std::endl << "record list:" << std::endl;
+                for (uint64_t pos = read_cur; pos < write_cur;) {
+                    size_t tail_units = mem_record_tail_units(channel, pos);
+                    if (tail_units < mem_record_block::record_head_units) {
+                        pos += tail_units;
+                        continue;
+                    }
+
+                    void *data_ptr = NULL;
+                    mem_record_head *head = mem_record_get_head(channel, pos, &data_ptr);
+                    bool written = head->atomic_position.load() == pos;
+                    bool reserved = head->reserve_position == pos;
+                    out << "Record position: " << std::setw(10) << pos << " => size=" << head->buffer_size
+                        << ", is written=" << (written ? "Yes" : " No") << ", data(Hex): ";
+
+                    unsigned char *data_c = (unsigned char *)data_ptr;
+                    char data_buf[4] = {0};
+                    for (size_t j = 0; (written || reserved) && j < head->buffer_size && j < need_node_data; ++j) {
+                        UTIL_STRFUNC_SNPRINTF(data_buf, sizeof(data_buf), "%02x", data_c[j]);
+                        out << data_buf;
+                    }
+                    out << std::endl;
+
+                    // 没有写入的记录无法知道长度
+                    if (!written && !reserved) {
+                        break;
+                    }
+
+                    if (0 == head->buffer_size) {
+                        pos += tail_units;
+                    } else {
+                        pos += mem_record_calc_units(head->buffer_size);
+                    }
+                }
+            }
+        }
+
+        /**
+         * @brief 初始化数据块的node head和block head
+         * @param channel 内存通道
+         * @param write_cur 起始node
+         * @param new_write_cur 结束node(不包含)
+         * @param len 数据长度
+         * @param opr_seq 操作序号
+         * @return 0或错误码
+         */
+        template <typename TCH>
+        static int mem_send_init_block(TCH *channel, size_t write_cur, size_t new_write_cur, size_t len, uint32_t opr_seq) {
+            // 数据缓冲区操作 - 初始化
+            mem_block_head *block_head = mem_get_block_head(channel, write_cur, NULL, NULL);
+            memset(block_head, 0x00, sizeof(mem_block_head));
+
+            // 数据缓冲区操作 - 要写入的节点
+            {
+                block_head->buffer_size = 0;
+
+                mem_node_head *first_node_head = mem_get_node_head(channel, write_cur, NULL, NULL);
+                first_node_head->flag = set_flag(first_node_head->flag, MF_START_NODE);
+                first_node_head->operation_seq = opr_seq;
+
+                for (size_t i = mem_next_index(channel, write_cur, 1); i != new_write_cur; i = mem_next_index(channel, i, 1)) {
+                    mem_node_head *this_node_head = mem_get_node_head(channel, i, NULL, NULL);
+
+                    // 写数据node出现冲突
+                    if (this_node_head->operation_seq) {
+                        return EN_ATBUS_ERR_NODE_BAD_BLOCK_WSEQ_ID;
+                    }
+
+                    this_node_head->flag = set_flag(this_node_head->flag, MF_WRITEN);
+                    this_node_head->operation_seq = opr_seq;
+                }
+            }
+            block_head->buffer_size = len;
+
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        /**
+         * @brief 放弃已预留但不再写入的数据块，去掉起始节点标记
+         * @param channel 内存通道
+         * @param write_cur 起始node
+         */
+        template <typename TCH>
+        static void mem_send_abandon_block(TCH *channel, size_t write_cur) {
+            mem_node_head *first_node_head = mem_get_node_head(channel, write_cur, NULL, NULL);
+            first_node_head->flag = 0;
+        }
+
+        /**
+         * @brief 获取已初始化的数据块的数据区
+         * @param channel 内存通道
+         * @param write_cur 起始node
+         * @param new_write_cur 结束node(不包含)
+         * @param len 数据长度
+         * @param opr_seq 操作序号
+         * @param block 输出预留的数据区
+         */
+        template <typename TCH>
+        static void mem_send_get_block(TCH *channel, size_t write_cur, size_t new_write_cur, size_t len, uint32_t opr_seq,
+                                       mem_reserved_block_t *block) {
+            void *buffer_start = NULL;
+            size_t buffer_len = 0;
+            mem_get_block_head(channel, write_cur, &buffer_start, &buffer_len);
+
+            block->len = len;
+            block->begin_index = write_cur;
+            block->end_index = new_write_cur;
+            block->operation_seq = opr_seq;
+
+            block->buffer[0] = buffer_start;
+            // 数据有回绕
+            if (new_write_cur && new_write_cur < write_cur) {
+                block->length[0] = len > buffer_len ? buffer_len : len;
+
+                // 回绕nodes
+                mem_get_node_head(channel, 0, &block->buffer[1], NULL);
+                block->length[1] = len - block->length[0];
+            } else {
+                block->length[0] = len;
+                block->buffer[1] = NULL;
+                block->length[1] = 0;
+            }
+        }
+
+        /**
+         * @brief 计算可写入的node数量
+         * @param channel 内存通道
+         * @param read_cur 读游标
+         * @param write_cur 写游标
+         * @return 可写入的node数量
+         */
+        template <typename TCH>
+        static inline size_t mem_calc_available_node(TCH *channel, size_t read_cur, size_t write_cur) {
+            // 要留下一个node做tail, 所以多减1
+            size_t available_node = (read_cur + channel->node_count - write_cur - 1) % channel->node_count;
+            if (available_node >= channel->conf.protect_node_count)
+                available_node -= channel->conf.protect_node_count;
+            else
+                available_node = 0;
+
+            return available_node;
+        }
+
+        /**
+         * @brief 预留数据块，移动写游标并初始化node head
+         * @param channel 内存通道
+         * @param len 数据长度
+         * @param block 预留的数据区
+         * @return 0或错误码
+         */
+        template <typename TCH>
+        static int mem_send_reserve_real(TCH *channel, size_t len, mem_reserved_block_t *block) {
+            // 用于调试的节点编号信息
+            detail::last_action_channel_begin_node_index = std::numeric_limits<size_t>::max();
+            detail::last_action_channel_end_node_index = std::numeric_limits<size_t>::max();
+
+            if (NULL == channel || NULL == block) return EN_ATBUS_ERR_PARAMS;
+
+            memset(block, 0, sizeof(mem_reserved_block_t));
+            if (0 == len) return EN_ATBUS_ERR_SUCCESS;
+
+            size_t node_count = mem_calc_node_num(channel, len);
+            // 要写入的数据比可用的缓冲区还大
+            if (node_count >= channel->node_count - channel->conf.protect_node_count) return EN_ATBUS_ERR_BUFF_LIMIT;
+
+            // 获取操作序号
+            uint32_t opr_seq = mem_get_operation_seq(mem_fetch_operation_seq(channel, 1), 0);
+
+            // 游标操作
+            size_t read_cur = 0;
+            size_t new_write_cur, write_cur = channel->atomic_write_cur.load();
+
+            bool refresh_read_cur = false;
+            while (true) {
+                read_cur = mem_producer_read_cur(channel, refresh_read_cur);
+                // std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                size_t available_node = mem_calc_available_node(channel, read_cur, write_cur);
+                if (node_count > available_node) {
+                    // 缓存的读游标空间不足时重新读取一次
+                    if (!refresh_read_cur) {
+                        refresh_read_cur = true;
+                        continue;
+                    }
+
+                    return EN_ATBUS_ERR_BUFF_LIMIT;
+                }
+
+                // 新的尾部node游标
+                new_write_cur = (write_cur + node_count) % channel->node_count;
+
+                // CAS
+                bool f = channel->atomic_write_cur.compare_exchange_weak(write_cur, new_write_cur);
+
+                if (f) break;
+
+                // 发现冲突原子操作失败则重试
+            }
+            detail::last_action_channel_begin_node_index = write_cur;
+            detail::last_action_channel_end_node_index = new_write_cur;
+
+            int ret = mem_send_init_block(channel, write_cur, new_write_cur, len, opr_seq);
+            if (ret < 0) {
+                return ret;
+            }
+
+            mem_send_get_block(channel, write_cur, new_write_cur, len, opr_seq, block);
+            return ret;
+        }
+
+        /**
+         * @brief 写入校验码并设置数据写完标记
+         * @param channel 内存通道
+         * @param block 预留的数据区
+         * @param fast_check 校验码
+         * @return 0或错误码
+         */
+        template <typename TCH>
+        static int mem_send_commit_real(TCH *channel, const mem_reserved_block_t *block, data_align_type fast_check) {
+            mem_block_head *block_head = mem_get_block_head(channel, block->begin_index, NULL, NULL);
+            block_head->fast_check = fast_check;
+
+            // 再检查一次，以防memcpy时发生写冲突
+            // 必须在设置写完标记之前检查，设置以后接收端随时可能读走数据并重置node head，这时再检查会误判并导致重复发送
+            mem_node_head *first_node_head = mem_get_node_head(channel, block->begin_index, NULL, NULL);
+            if (block->operation_seq != first_node_head->operation_seq) {
+                return EN_ATBUS_ERR_NODE_BAD_BLOCK_CSEQ_ID;
+            }
+
+            // 设置首node header，数据写完标记
+            first_node_head->flag = set_flag(first_node_head->flag, MF_WRITEN);
+            mem_doorbell_notify(channel);
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        template <typename TCH>
+        static int mem_send_real(TCH *channel, const void *buf, size_t len) {
+            mem_reserved_block_t block;
+            int ret = mem_send_reserve_real(channel, len, &block);
+            if (ret < 0 || 0 == len) {
+                return ret;
+            }
+
+            // 数据写入
+            // fast_memcpy
+            memcpy(block.buffer[0], buf, block.length[0]);
+            if (block.length[1] > 0) {
+                memcpy(block.buffer[1], (const char *)buf + block.length[0], block.length[1]);
+            }
+
+            return mem_send_commit_real(channel, &block, mem_fast_check(mem_checksum_mode(channel), buf, len));
+        }
+
+        template <typename TCH>
+        static int mem_node_send(TCH *channel, const void *buf, size_t len) {
+            int ret = 0;
+            size_t left_try_times = channel->conf.write_retry_times;
+            while (left_try_times-- > 0) {
+                int ret = mem_send_real(channel, buf, len);
+
+                // 原子操作序列冲突，重试
+                if (EN_ATBUS_ERR_NODE_BAD_BLOCK_CSEQ_ID == ret || EN_ATBUS_ERR_NODE_BAD_BLOCK_WSEQ_ID == ret) continue;
+
+                return ret;
+            }
+
+            return ret;
+        }
+
+        /**
+         * @brief 把多段数据作为一个消息发送，直接写入预留的数据区，校验码在写入后按数据区计算
+         * @param len 所有数据段的总长度
+         */
+        template <typename TCH>
+        static int mem_node_sendv(TCH *channel, const channel_iovec_t *iov, size_t iovcnt, size_t len) {
+            int ret = 0;
+            size_t left_try_times = channel->conf.write_retry_times;
+            while (left_try_times-- > 0) {
+                mem_reserved_block_t block;
+                ret = mem_send_reserve_real(channel, len, &block);
+                if (ret < 0 || 0 == len) {
+                    return ret;
+                }
+
+                mem_sendv_copy(&block, iov, iovcnt);
+
+                data_align_type fast_check = mem_fast_check_segments(mem_checksum_mode(channel), block.buffer[0], block.length[0],
+                                                                     block.buffer[1], block.length[1]);
+                ret = mem_send_commit_real(channel, &block, fast_check);
+
+                // 原子操作序列冲突，重试
+                if (EN_ATBUS_ERR_NODE_BAD_BLOCK_CSEQ_ID == ret || EN_ATBUS_ERR_NODE_BAD_BLOCK_WSEQ_ID == ret) continue;
+
+                return ret;
+            }
+
+            return ret;
+        }
+
+        /**
+         * @brief 批量发送，一次CAS预留空间
+         * @param channel 内存通道
+         * @param iov 消息数组
+         * @param iovcnt 消息数量
+         * @param sent_count 输出已处理的消息数量
+         * @return 0或错误码
+         */
+        template <typename TCH>
+        static int mem_send_batch_real(TCH *channel, const channel_iovec_t *iov, size_t iovcnt, size_t *sent_count) {
             // 用于调试的节点编号信息
             detail::last_action_channel_begin_node_index = std::numeric_limits<size_t>::max();
             detail::last_action_channel_end_node_index = std::numeric_limits<size_t>::max();
 
-            if (NULL == channel) return EN_ATBUS_ERR_PARAMS;
+            *sent_count = 0;
+            size_t max_node_count = channel->node_count - channel->conf.protect_node_count;
+
+            // 游标操作，只预留能放下的前面一部分消息
+            size_t read_cur = 0;
+            size_t batch_count, new_write_cur, write_cur = channel->atomic_write_cur.load();
+            bool refresh_read_cur = false;
+            while (true) {
+                read_cur = mem_producer_read_cur(channel, refresh_read_cur);
+                // std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                size_t available_node = mem_calc_available_node(channel, read_cur, write_cur);
+                size_t total_node_count = 0;
+                for (batch_count = 0; batch_count < iovcnt; ++batch_count) {
+                    size_t node_count = 0 == iov[batch_count].len ? 0 : mem_calc_node_num(channel, iov[batch_count].len);
+                    if (total_node_count + node_count > available_node || node_count >= max_node_count) {
+                        break;
+                    }
+                    total_node_count += node_count;
+                }
+
+                // 缓存的读游标放不下所有消息时重新读取一次
+                if (batch_count < iovcnt && !refresh_read_cur) {
+                    refresh_read_cur = true;
+                    continue;
+                }
+
+                if (0 == batch_count) return EN_ATBUS_ERR_BUFF_LIMIT;
+
+                // 新的尾部node游标
+                new_write_cur = (write_cur + total_node_count) % channel->node_count;
+
+                // CAS
+                bool f = channel->atomic_write_cur.compare_exchange_weak(write_cur, new_write_cur);
+
+                if (f) break;
+
+                // 发现冲突原子操作失败则重试
+            }
+            detail::last_action_channel_begin_node_index = write_cur;
+            detail::last_action_channel_end_node_index = new_write_cur;
+
+            // 获取操作序号，每个数据块一个
+            uint32_t opr_seq_base = mem_fetch_operation_seq(channel, static_cast<uint32_t>(batch_count));
+
+            // 先初始化所有数据块的node head，接收端看到未写完的起始节点会等待而不是当成坏节点跳过
+            int ret = EN_ATBUS_ERR_SUCCESS;
+            size_t inited_count = 0;
+            size_t block_cur = write_cur;
+            for (; inited_count < batch_count; ++inited_count) {
+                if (0 == iov[inited_count].len) {
+                    continue;
+                }
+
+                size_t block_end_cur = mem_next_index(channel, block_cur, mem_calc_node_num(channel, iov[inited_count].len));
+                ret = mem_send_init_block(channel, block_cur, block_end_cur, iov[inited_count].len,
+                                          mem_get_operation_seq(opr_seq_base, static_cast<uint32_t>(inited_count)));
+                if (ret < 0) {
+                    break;
+                }
+                block_cur = block_end_cur;
+            }
+
+            // 初始化失败的数据块不会再写入，去掉起始标记让接收端直接跳过，而不是等到写入超时
+            // 后面没有初始化的node没有起始标记，接收端也会直接跳过
+            if (inited_count < batch_count) {
+                mem_send_abandon_block(channel, block_cur);
+            }
+
+            // 依次写入数据，已初始化的数据块都要写完
+            for (size_t i = 0; i < inited_count; ++i) {
+                if (0 == iov[i].len) {
+                    ++(*sent_count);
+                    continue;
+                }
+
+                size_t block_end_cur = mem_next_index(channel, write_cur, mem_calc_node_num(channel, iov[i].len));
+
+                mem_reserved_block_t block;
+                mem_send_get_block(channel, write_cur, block_end_cur, iov[i].len,
+                                   mem_get_operation_seq(opr_seq_base, static_cast<uint32_t>(i)), &block);
+
+                // 数据写入
+                memcpy(block.buffer[0], iov[i].base, block.length[0]);
+                if (block.length[1] > 0) {
+                    memcpy(block.buffer[1], (const char *)iov[i].base + block.length[0], block.length[1]);
+                }
+
+                // 写冲突的数据块不再重发，避免重复发送后面已经写完的消息
+                int res = mem_send_commit_real(channel, &block, mem_fast_check(mem_checksum_mode(channel), iov[i].base, iov[i].len));
+                if (res < 0 && ret >= 0) {
+                    ret = res;
+                }
+                ++(*sent_count);
+
+                write_cur = block_end_cur;
+            }
+
+            return ret;
+        }
+
+        template <typename TCH>
+        static int mem_node_send_batch(TCH *channel, const channel_iovec_t *iov, size_t iovcnt, size_t *sent_count) {
+            int ret = 0;
+            size_t sent_sum = 0;
+            size_t left_try_times = channel->conf.write_retry_times;
+            while (sent_sum < iovcnt && left_try_times > 0) {
+                size_t sent = 0;
+                ret = mem_send_batch_real(channel, iov + sent_sum, iovcnt - sent_sum, &sent);
+                sent_sum += sent;
+
+                // 初始化node时序列冲突，重试没发送的部分
+                if (EN_ATBUS_ERR_NODE_BAD_BLOCK_WSEQ_ID == ret) {
+                    --left_try_times;
+                    continue;
+                }
+
+                // 空间不足或其他错误，返回已发送的部分
+                if (ret < 0) {
+                    break;
+                }
+            }
+
+            if (sent_count) *sent_count = sent_sum;
+            // 发送了一部分时不算失败
+            return sent_sum > 0 && EN_ATBUS_ERR_BUFF_LIMIT == ret ? EN_ATBUS_ERR_SUCCESS : ret;
+        }
+
+        template <typename TCH>
+        static int mem_node_send_reserve(TCH *channel, size_t len, mem_reserved_block_t *block) {
+            int ret = 0;
+            size_t left_try_times = channel->conf.write_retry_times;
+            while (left_try_times-- > 0) {
+                ret = mem_send_reserve_real(channel, len, block);
+
+                // 原子操作序列冲突，重试
+                if (EN_ATBUS_ERR_NODE_BAD_BLOCK_WSEQ_ID == ret) continue;
+
+                return ret;
+            }
 
+            return ret;
+        }
+
+        /**
+         * @brief 查找下一个可读取的数据块
+         * @param channel 内存通道
+         * @param read_begin_cur 开始查找的位置
+         * @param write_cur 写游标
+         * @param block 输出数据区，出错时begin_index为跳过坏节点后的位置，end_index等于begin_index
+         * @param fast_check 输出数据块的校验码
+         * @return 0或错误码
+         */
+        template <typename TCH>
+        static int mem_recv_find_block(TCH *channel, size_t read_begin_cur, size_t write_cur, mem_recv_block_t *block,
+                                       data_align_type *fast_check) {
             int ret = EN_ATBUS_ERR_SUCCESS;
 
             void *buffer_start = NULL;
             size_t buffer_len = 0;
             mem_block_head *block_head = NULL;
-            size_t read_begin_cur = channel->atomic_read_cur.load();
-            size_t ori_read_cur = read_begin_cur;
             size_t read_end_cur;
-            size_t write_cur = channel->atomic_write_cur.load();
-            // std::atomic_thread_fence(std::memory_order_seq_cst);
 
+            memset(block, 0, sizeof(mem_recv_block_t));
             while (true) {
                 read_end_cur = read_begin_cur;
 
@@ -584,25 +2035,13 @@ namespace atbus {
                     continue;
                 }
 
-                // 写出的缓冲区不足
-                if (block_head->buffer_size > len) {
-                    ret = ret ? ret : EN_ATBUS_ERR_BUFF_LIMIT;
-                    if (recv_size) *recv_size = block_head->buffer_size;
-
-                    break;
-                }
-
-
-                // 重置操作码（防冲突+读检测）
+                // 操作码检测，node head在释放时才重置
                 uint32_t check_opr_seq = node_head->operation_seq;
                 for (read_end_cur = read_begin_cur; read_end_cur != write_cur; read_end_cur = mem_next_index(channel, read_end_cur, 1)) {
                     mem_node_head *this_node_head = mem_get_node_head(channel, read_end_cur, NULL, NULL);
                     if (this_node_head->operation_seq != check_opr_seq) {
                         break;
                     }
-
-                    this_node_head->operation_seq = 0;
-                    this_node_head->flag = 0;
                 }
 
                 // 有效的node数量检查
@@ -620,68 +2059,189 @@ namespace atbus {
                 break;
             }
 
+            block->begin_index = read_begin_cur;
+            // 前面跳过了坏节点时先返回错误，有效的数据块留到下一次读取
+            if (ret) {
+                block->end_index = read_begin_cur;
+                return ret;
+            }
+
+            channel->first_failed_writing_time = 0;
 
-            do {
+            block->end_index = read_end_cur;
+            block->len = block_head->buffer_size;
+            block->buffer[0] = buffer_start;
+            // 数据有回绕
+            if (block_head->buffer_size > buffer_len) {
+                block->length[0] = buffer_len;
+
+                // 回绕nodes
+                mem_get_node_head(channel, 0, &buffer_start, NULL);
+                block->buffer[1] = buffer_start;
+                block->length[1] = block_head->buffer_size - buffer_len;
+            } else {
+                block->length[0] = block_head->buffer_size;
+            }
+
+            if (fast_check) *fast_check = block_head->fast_check;
+            return ret;
+        }
 
+        /**
+         * @brief 重置[ori_read_cur, read_end_cur)的node head并移动读游标
+         */
+        template <typename TCH>
+        static void mem_recv_move_cursor(TCH *channel, size_t ori_read_cur, size_t read_end_cur) {
+            mem_node_head *node_head = mem_get_node_head(channel, 0, NULL, NULL);
+            for (size_t i = ori_read_cur; i != read_end_cur; i = (i + 1) % channel->node_count) {
+                node_head[i].flag = 0;
+                node_head[i].operation_seq = 0;
+            }
+
+            // 设置游标
+            channel->atomic_read_cur.store(read_end_cur);
+            // std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            // 用于调试的节点编号信息
+            detail::last_action_channel_begin_node_index = ori_read_cur;
+            detail::last_action_channel_end_node_index = read_end_cur;
+        }
+
+        template <typename TCH>
+        static int mem_node_recv(TCH *channel, void *buf, size_t len, size_t *recv_size) {
+            // 用于调试的节点编号信息
+            detail::last_action_channel_begin_node_index = std::numeric_limits<size_t>::max();
+            detail::last_action_channel_end_node_index = std::numeric_limits<size_t>::max();
+
+            size_t ori_read_cur = channel->atomic_read_cur.load();
+            size_t write_cur = mem_consumer_write_cur(channel, ori_read_cur);
+            // std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            mem_recv_block_t block;
+            data_align_type check_code = 0;
+            int ret = mem_recv_find_block(channel, ori_read_cur, write_cur, &block, &check_code);
+
+            do {
                 // 出错退出, 移动读游标到最后读取位置
                 if (ret) {
                     break;
                 }
 
-                channel->first_failed_writing_time = 0;
-
-                // 接收数据 - 无回绕
-
-                if (block_head->buffer_size <= buffer_len) {
-                    memcpy(buf, buffer_start, block_head->buffer_size);
+                // 写出的缓冲区不足
+                if (block.len > len) {
+                    ret = EN_ATBUS_ERR_BUFF_LIMIT;
+                    if (recv_size) *recv_size = block.len;
 
-                } else { // 接收数据 - 有回绕
-                    memcpy(buf, buffer_start, buffer_len);
+                    block.end_index = block.begin_index;
+                    break;
+                }
 
-                    // 回绕nodes
-                    mem_get_node_head(channel, 0, &buffer_start, NULL);
-                    memcpy((char *)buf + buffer_len, buffer_start, block_head->buffer_size - buffer_len);
+                // 接收数据
+                memcpy(buf, block.buffer[0], block.length[0]);
+                if (block.length[1] > 0) {
+                    memcpy((char *)buf + block.length[0], block.buffer[1], block.length[1]);
                 }
-                data_align_type fast_check = mem_fast_check(buf, block_head->buffer_size);
 
-                if (recv_size) *recv_size = block_head->buffer_size;
+                data_align_type fast_check = mem_fast_check(mem_checksum_mode(channel), buf, block.len);
+
+                if (recv_size) *recv_size = block.len;
 
                 // 校验不通过
-                if (fast_check != block_head->fast_check) {
-                    ret = ret ? ret : EN_ATBUS_ERR_BAD_DATA;
+                if (fast_check != check_code) {
+                    ret = EN_ATBUS_ERR_BAD_DATA;
                 }
 
             } while (false);
 
-            // 如果有出错节点，重置出错节点的head
-            if (ori_read_cur != read_begin_cur) {
-                mem_node_head *node_head = mem_get_node_head(channel, 0, NULL, NULL);
+            mem_recv_move_cursor(channel, ori_read_cur, block.end_index);
+            return ret;
+        }
 
-                for (size_t i = ori_read_cur; i != read_begin_cur; i = (i + 1) % channel->node_count) {
-                    node_head[i].flag = 0;
-                    node_head[i].operation_seq = 0;
-                }
+        /**
+         * @brief 从指定位置取出下一个数据块并校验
+         * @return 0或错误码，出错时block->end_index为读游标可以移动到的位置
+         */
+        template <typename TCH>
+        static int mem_recv_peek_real(TCH *channel, size_t read_cur, size_t write_cur, mem_recv_block_t *block) {
+            data_align_type check_code = 0;
+            int ret = mem_recv_find_block(channel, read_cur, write_cur, block, &check_code);
+            if (ret) {
+                return ret;
             }
 
-            // 设置游标
-            channel->atomic_read_cur.store(read_end_cur);
-            // std::atomic_thread_fence(std::memory_order_seq_cst);
+            // 回绕的数据也直接在通道内存里分段校验
+            data_align_type fast_check =
+                mem_fast_check_segments(mem_checksum_mode(channel), block->buffer[0], block->length[0], block->buffer[1], block->length[1]);
+
+            // 校验不通过则直接丢弃
+            if (fast_check != check_code) {
+                return EN_ATBUS_ERR_BAD_DATA;
+            }
 
-            // 用于调试的节点编号信息
-            detail::last_action_channel_begin_node_index = ori_read_cur;
-            detail::last_action_channel_end_node_index = read_end_cur;
             return ret;
         }
 
-        std::pair<size_t, size_t> mem_last_action() {
-            return std::make_pair(detail::last_action_channel_begin_node_index, detail::last_action_channel_end_node_index);
+        template <typename TCH>
+        static int mem_node_recv_batch(TCH *channel, mem_recv_block_t *blocks, size_t max_count, size_t *count) {
+            // 用于调试的节点编号信息
+            detail::last_action_channel_begin_node_index = std::numeric_limits<size_t>::max();
+            detail::last_action_channel_end_node_index = std::numeric_limits<size_t>::max();
+
+            // 读写游标都只读取一次
+            size_t ori_read_cur = channel->atomic_read_cur.load();
+            size_t write_cur = mem_consumer_write_cur(channel, ori_read_cur);
+            // std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            int ret = mem_recv_peek_real(channel, ori_read_cur, write_cur, &blocks[0]);
+            if (ret) {
+                mem_recv_move_cursor(channel, ori_read_cur, blocks[0].end_index);
+                memset(&blocks[0], 0, sizeof(mem_recv_block_t));
+                blocks[0].begin_index = blocks[0].end_index = channel->atomic_read_cur.load();
+                return ret;
+            }
+
+            // 后续的数据块出错时留到下一次读取再处理
+            size_t n = 1;
+            for (; n < max_count; ++n) {
+                size_t next_cur = blocks[n - 1].end_index;
+                if (next_cur == write_cur) {
+                    break;
+                }
+
+                // 下一个节点还没写完就不再继续，避免重复统计坏节点
+                mem_node_head *node_head = mem_get_node_head(channel, next_cur, NULL, NULL);
+                if (!check_flag(node_head->flag, MF_START_NODE) || !check_flag(node_head->flag, MF_WRITEN)) {
+                    break;
+                }
+
+                if (0 != mem_recv_peek_real(channel, next_cur, write_cur, &blocks[n])) {
+                    break;
+                }
+            }
+
+            // 只跳过前面的坏节点，数据块在释放时才移动读游标
+            if (ori_read_cur != blocks[0].begin_index) {
+                mem_recv_move_cursor(channel, ori_read_cur, blocks[0].begin_index);
+            }
+
+            if (count) *count = n;
+            return ret;
         }
 
-        void mem_show_channel(mem_channel *channel, std::ostream &out, bool need_node_status, size_t need_node_data) {
-            if (NULL == channel) {
-                return;
+        template <typename TCH>
+        static int mem_node_recv_batch_release(TCH *channel, const mem_recv_block_t *blocks, size_t count) {
+            // 只能释放最近一次取出的数据块
+            if (channel->atomic_read_cur.load() != blocks[0].begin_index) {
+                return EN_ATBUS_ERR_PARAMS;
             }
 
+            // 只写一次读游标
+            mem_recv_move_cursor(channel, blocks[0].begin_index, blocks[count - 1].end_index);
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        template <typename TCH>
+        static void mem_node_show_channel(TCH *channel, std::ostream &out, bool need_node_status, size_t need_node_data) {
             size_t read_cur = channel->atomic_read_cur.load();
             size_t write_cur = channel->atomic_write_cur.load();
             size_t available_node = (read_cur + channel->node_count - write_cur - 1) % channel->node_count;
@@ -698,6 +2258,7 @@ namespace atbus {
                 << "protect memory size(Bytes): " << channel->conf.protect_memory_size << std::endl
                 << "protect node number: " << channel->conf.protect_node_count << std::endl
                 << "write retry times: " << channel->conf.write_retry_times << std::endl
+                << "checksum mode: " << mem_checksum_mode(channel) << std::endl
                 << std::endl;
 
             out << "read&write:" << std::endl
@@ -747,5 +2308,319 @@ namespace atbus {
                 << "operation sequence: " << channel->atomic_operation_seq << std::endl
                 << std::endl;
         }
+
+        // ================= 按通道头格式分发 =================
+        int mem_send(mem_channel *channel, const void *buf, size_t len) {
+            if (NULL == channel) return EN_ATBUS_ERR_PARAMS;
+
+            switch (mem_get_layout(channel)) {
+            case MEM_LAYOUT_RECORD:
+                return mem_record_send(mem_record_cast(channel), buf, len);
+            case MEM_LAYOUT_NODE_V2:
+                return mem_node_send(mem_v2_cast(channel), buf, len);
+            default:
+                return mem_node_send(channel, buf, len);
+            }
+        }
+
+        int mem_sendv(mem_channel *channel, const channel_iovec_t *iov, size_t iovcnt) {
+            if (NULL == channel || (NULL == iov && iovcnt > 0)) return EN_ATBUS_ERR_PARAMS;
+
+            size_t len = 0;
+            for (size_t i = 0; i < iovcnt; ++i) {
+                len += iov[i].len;
+            }
+
+            switch (mem_get_layout(channel)) {
+            case MEM_LAYOUT_RECORD:
+                return mem_record_sendv(mem_record_cast(channel), iov, iovcnt, len);
+            case MEM_LAYOUT_NODE_V2:
+                return mem_node_sendv(mem_v2_cast(channel), iov, iovcnt, len);
+            default:
+                return mem_node_sendv(channel, iov, iovcnt, len);
+            }
+        }
+
+        int mem_send_batch(mem_channel *channel, const channel_iovec_t *iov, size_t iovcnt, size_t *sent_count) {
+            if (sent_count) *sent_count = 0;
+            if (NULL == channel || (NULL == iov && iovcnt > 0)) return EN_ATBUS_ERR_PARAMS;
+
+            switch (mem_get_layout(channel)) {
+            case MEM_LAYOUT_RECORD:
+                return mem_record_send_batch(mem_record_cast(channel), iov, iovcnt, sent_count);
+            case MEM_LAYOUT_NODE_V2:
+                return mem_node_send_batch(mem_v2_cast(channel), iov, iovcnt, sent_count);
+            default:
+                return mem_node_send_batch(channel, iov, iovcnt, sent_count);
+            }
+        }
+
+        int mem_send_reserve(mem_channel *channel, size_t len, mem_reserved_block_t *block) {
+            if (NULL == channel || NULL == block) return EN_ATBUS_ERR_PARAMS;
+
+            switch (mem_get_layout(channel)) {
+            case MEM_LAYOUT_RECORD:
+                return mem_record_send_reserve_real(mem_record_cast(channel), len, block);
+            case MEM_LAYOUT_NODE_V2:
+                return mem_node_send_reserve(mem_v2_cast(channel), len, block);
+            default:
+                return mem_node_send_reserve(channel, len, block);
+            }
+        }
+
+        int mem_send_commit(mem_channel *channel, const mem_reserved_block_t *block) {
+            if (NULL == channel || NULL == block) return EN_ATBUS_ERR_PARAMS;
+
+            if (0 == block->len) return EN_ATBUS_ERR_SUCCESS;
+
+            MEM_LAYOUT layout = mem_get_layout(channel);
+            uint32_t checksum_mode;
+            switch (layout) {
+            case MEM_LAYOUT_RECORD:
+                checksum_mode = mem_checksum_mode(mem_record_cast(channel));
+                break;
+            case MEM_LAYOUT_NODE_V2:
+                checksum_mode = mem_checksum_mode(mem_v2_cast(channel));
+                break;
+            default:
+                checksum_mode = mem_checksum_mode(channel);
+                break;
+            }
+
+            data_align_type fast_check =
+                mem_fast_check_segments(checksum_mode, block->buffer[0], block->length[0], block->buffer[1], block->length[1]);
+
+            int res;
+            switch (layout) {
+            case MEM_LAYOUT_RECORD:
+                res = mem_record_send_commit_real(mem_record_cast(channel), block, fast_check);
+                break;
+            case MEM_LAYOUT_NODE_V2:
+                res = mem_send_commit_real(mem_v2_cast(channel), block, fast_check);
+                break;
+            default:
+                res = mem_send_commit_real(channel, block, fast_check);
+                break;
+            }
+            return res;
+        }
+
+        int mem_recv(mem_channel *channel, void *buf, size_t len, size_t *recv_size) {
+            if (NULL == channel) return EN_ATBUS_ERR_PARAMS;
+
+            switch (mem_get_layout(channel)) {
+            case MEM_LAYOUT_RECORD:
+                return mem_record_recv(mem_record_cast(channel), buf, len, recv_size);
+            case MEM_LAYOUT_NODE_V2:
+                return mem_node_recv(mem_v2_cast(channel), buf, len, recv_size);
+            default:
+                return mem_node_recv(channel, buf, len, recv_size);
+            }
+        }
+
+        int mem_recv_peek(mem_channel *channel, mem_recv_block_t *block) { return mem_recv_batch(channel, block, 1, NULL); }
+
+        int mem_recv_batch(mem_channel *channel, mem_recv_block_t *blocks, size_t max_count, size_t *count) {
+            if (count) *count = 0;
+            if (NULL == channel || NULL == blocks || 0 == max_count) return EN_ATBUS_ERR_PARAMS;
+
+            switch (mem_get_layout(channel)) {
+            case MEM_LAYOUT_RECORD:
+                return mem_record_recv_batch(mem_record_cast(channel), blocks, max_count, count);
+            case MEM_LAYOUT_NODE_V2:
+                return mem_node_recv_batch(mem_v2_cast(channel), blocks, max_count, count);
+            default:
+                return mem_node_recv_batch(channel, blocks, max_count, count);
+            }
+        }
+
+        int mem_recv_release(mem_channel *channel, const mem_recv_block_t *block) { return mem_recv_batch_release(channel, block, 1); }
+
+        int mem_recv_batch_release(mem_channel *channel, const mem_recv_block_t *blocks, size_t count) {
+            if (NULL == channel || NULL == blocks || 0 == count) return EN_ATBUS_ERR_PARAMS;
+
+            switch (mem_get_layout(channel)) {
+            case MEM_LAYOUT_RECORD:
+                return mem_record_recv_batch_release(mem_record_cast(channel), blocks, count);
+            case MEM_LAYOUT_NODE_V2:
+                return mem_node_recv_batch_release(mem_v2_cast(channel), blocks, count);
+            default:
+                return mem_node_recv_batch_release(channel, blocks, count);
+            }
+        }
+
+        int mem_set_checksum(mem_channel *channel, uint32_t mode) {
+            if (NULL == channel || mode >= mem_checksum_t::EN_MCS_MAX) return EN_ATBUS_ERR_PARAMS;
+
+            switch (mem_get_layout(channel)) {
+            case MEM_LAYOUT_RECORD:
+                mem_record_cast(channel)->conf.checksum_mode = mode;
+                return EN_ATBUS_ERR_SUCCESS;
+            case MEM_LAYOUT_NODE_V2:
+                mem_v2_cast(channel)->conf.checksum_mode = mode;
+                return EN_ATBUS_ERR_SUCCESS;
+            default:
+                // v1通道头没有空间保存校验方式，只能使用murmur3
+                return mem_checksum_t::EN_MCS_MURMUR3 == mode ? EN_ATBUS_ERR_SUCCESS : EN_ATBUS_ERR_PARAMS;
+            }
+        }
+
+        uint32_t mem_get_checksum(const mem_channel *channel) {
+            if (NULL == channel) return mem_checksum_t::EN_MCS_MURMUR3;
+
+            switch (mem_get_layout(channel)) {
+            case MEM_LAYOUT_RECORD:
+                return mem_checksum_mode(mem_record_cast(const_cast<mem_channel *>(channel)));
+            case MEM_LAYOUT_NODE_V2:
+                return mem_checksum_mode(mem_v2_cast(const_cast<mem_channel *>(channel)));
+            default:
+                return mem_checksum_mode(channel);
+            }
+        }
+
+        template <typename TCH>
+        static int mem_set_doorbell_real(TCH *channel, const char *name) {
+            size_t len = (NULL == name) ? 0 : strlen(name);
+            if (len >= sizeof(channel->doorbell_name)) {
+                return EN_ATBUS_ERR_PARAMS;
+            }
+
+            // 先关闭门铃再改地址，发送端只有看到等待标记才会读地址
+            channel->atomic_doorbell_waiting.store(0);
+            memset(channel->doorbell_name, 0, sizeof(channel->doorbell_name));
+            if (len > 0) {
+                memcpy(channel->doorbell_name, name, len);
+            }
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        int mem_set_doorbell(mem_channel *channel, const char *name) {
+            if (NULL == channel) return EN_ATBUS_ERR_PARAMS;
+
+            switch (mem_get_layout(channel)) {
+            case MEM_LAYOUT_RECORD:
+                return mem_set_doorbell_real(mem_record_cast(channel), name);
+            case MEM_LAYOUT_NODE_V2:
+                return mem_set_doorbell_real(mem_v2_cast(channel), name);
+            default:
+                // v1通道头没有门铃，只能轮询
+                return EN_ATBUS_ERR_ACCESS_DENY;
+            }
+        }
+
+        template <typename TCH>
+        static bool mem_doorbell_sleep_real(TCH *channel) {
+            if (0 == channel->doorbell_name[0]) {
+                return false;
+            }
+
+            channel->atomic_doorbell_waiting.store(1);
+            // 设置等待标记之后再检查真实的写游标，和mem_doorbell_notify配合保证不会漏掉通知
+            if (channel->atomic_read_cur.load() != channel->atomic_write_cur.load()) {
+                channel->atomic_doorbell_waiting.store(0);
+                return false;
+            }
+
+            return true;
+        }
+
+        bool mem_doorbell_sleep(mem_channel *channel) {
+            if (NULL == channel) return false;
+
+            switch (mem_get_layout(channel)) {
+            case MEM_LAYOUT_RECORD:
+                return mem_doorbell_sleep_real(mem_record_cast(channel));
+            case MEM_LAYOUT_NODE_V2:
+                return mem_doorbell_sleep_real(mem_v2_cast(channel));
+            default:
+                return false;
+            }
+        }
+
+        void mem_doorbell_wakeup(mem_channel *channel) {
+            if (NULL == channel) return;
+
+            switch (mem_get_layout(channel)) {
+            case MEM_LAYOUT_RECORD:
+                mem_record_cast(channel)->atomic_doorbell_waiting.store(0);
+                break;
+            case MEM_LAYOUT_NODE_V2:
+                mem_v2_cast(channel)->atomic_doorbell_waiting.store(0);
+                break;
+            default:
+                break;
+            }
+        }
+
+        template <typename TCH>
+        static void mem_node_get_usage(TCH *channel, size_t *used_size, size_t *capacity) {
+            // 先读读游标，读游标不会越过写游标
+            size_t read_cur = channel->atomic_read_cur.load();
+            size_t write_cur = channel->atomic_write_cur.load();
+            if (NULL != used_size) {
+                *used_size = ((write_cur + channel->node_count - read_cur) % channel->node_count) * channel->node_size;
+            }
+
+            if (NULL != capacity) {
+                // 要留下一个node做tail
+                size_t max_node = channel->node_count - 1;
+                max_node = max_node > channel->conf.protect_node_count ? max_node - channel->conf.protect_node_count : 0;
+                *capacity = max_node * channel->node_size;
+            }
+        }
+
+        static void mem_record_get_usage(mem_record_channel *channel, size_t *used_size, size_t *capacity) {
+            uint64_t read_cur = channel->atomic_read_cur.load();
+            uint64_t write_cur = channel->atomic_write_cur.load();
+            if (NULL != used_size) {
+                *used_size = static_cast<size_t>(write_cur - read_cur) * mem_record_block::unit_size;
+            }
+
+            if (NULL != capacity) {
+                size_t max_units = channel->unit_count > channel->protect_unit_count ? channel->unit_count - channel->protect_unit_count : 0;
+                *capacity = max_units * mem_record_block::unit_size;
+            }
+        }
+
+        int mem_get_usage(mem_channel *channel, size_t *used_size, size_t *capacity) {
+            if (NULL == channel) return EN_ATBUS_ERR_PARAMS;
+
+            switch (mem_get_layout(channel)) {
+            case MEM_LAYOUT_RECORD:
+                mem_record_get_usage(mem_record_cast(channel), used_size, capacity);
+                break;
+            case MEM_LAYOUT_NODE_V2:
+                mem_node_get_usage(mem_v2_cast(channel), used_size, capacity);
+                break;
+            default:
+                mem_node_get_usage(channel, used_size, capacity);
+                break;
+            }
+
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        std::pair<size_t, size_t> mem_last_action() {
+            return std::make_pair(detail::last_action_channel_begin_node_index, detail::last_action_channel_end_node_index);
+        }
+
+        void mem_show_channel(mem_channel *channel, std::ostream &out, bool need_node_status, size_t need_node_data) {
+            if (NULL == channel) {
+                return;
+            }
+
+            switch (mem_get_layout(channel)) {
+            case MEM_LAYOUT_RECORD:
+                mem_record_show_channel(mem_record_cast(channel), out, need_node_status, need_node_data);
+                break;
+            case MEM_LAYOUT_NODE_V2:
+                out << "channel format: node v2" << std::endl;
+                mem_node_show_channel(mem_v2_cast(channel), out, need_node_status, need_node_data);
+                break;
+            default:
+                mem_node_show_channel(channel, out, need_node_status, need_node_data);
+                break;
+            }
+        }
     }
 }
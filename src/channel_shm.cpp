@@ -6,6 +6,7 @@
 
 #include "lock/atomic_int_type.h"
 #include <assert.h>
+#include <cerrno>
 #include <cstddef>
 #include <cstdio>
 #include <cstdlib>
@@ -13,6 +14,7 @@
 #include <ctime>
 #include <map>
 #include <stdint.h>
+#include <string>
 
 
 #include "common/string_oprs.h"
@@ -38,6 +40,16 @@
 #include <unistd.h>
 #endif
 
+#ifdef ATBUS_CHANNEL_SHM_POSIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#ifdef __linux__
+#include <sys/vfs.h>
+#endif
+#endif
+
 #ifdef ATBUS_CHANNEL_SHM
 
 namespace atbus {
@@ -237,7 +249,9 @@ namespace atbus {
             return ret;
         }
 
-        int shm_init(key_t shm_key, size_t len, shm_channel **channel, const shm_conf *conf) {
+        typedef int (*shm_mem_init_fn_t)(void *buf, size_t len, mem_channel **channel, const mem_conf *conf);
+
+        static int shm_init_real(key_t shm_key, size_t len, shm_channel **channel, const shm_conf *conf, shm_mem_init_fn_t init_fn) {
             shm_channel_switcher channel_s;
             shm_conf_cswitcher conf_s;
             conf_s.shm = conf;
@@ -247,7 +261,7 @@ namespace atbus {
             int ret = shm_get_buffer(shm_key, len, &buffer, &real_size, true);
             if (ret < 0) return ret;
 
-            ret = mem_init(buffer, real_size, &channel_s.mem, conf_s.mem);
+            ret = init_fn(buffer, real_size, &channel_s.mem, conf_s.mem);
             if (ret < 0) {
                 shm_close_buffer(shm_key);
                 return ret;
@@ -258,20 +272,315 @@ namespace atbus {
             return ret;
         }
 
+        int shm_init(key_t shm_key, size_t len, shm_channel **channel, const shm_conf *conf) {
+            return shm_init_real(shm_key, len, channel, conf, mem_init);
+        }
+
+        int shm_init_v1(key_t shm_key, size_t len, shm_channel **channel, const shm_conf *conf) {
+            return shm_init_real(shm_key, len, channel, conf, mem_init_v1);
+        }
+
+        int shm_init_record(key_t shm_key, size_t len, shm_channel **channel, const shm_conf *conf) {
+            return shm_init_real(shm_key, len, channel, conf, mem_init_record);
+        }
+
         int shm_close(key_t shm_key) { return shm_close_buffer(shm_key); }
 
+#ifdef ATBUS_CHANNEL_SHM_POSIX
+        typedef struct {
+            void *buffer;
+            size_t size;
+        } shm_posix_mapped_record_type;
+
+        static std::map<std::string, shm_posix_mapped_record_type> shm_posix_mapped_records;
+
+        static bool shm_posix_is_file_path(const char *name) {
+            // 除了开头以外还有目录分隔符的当作文件路径，比如 /dev/hugepages/atbus-123
+            return NULL != strchr(name + 1, '/');
+        }
+
+        static std::string shm_posix_object_name(const char *name) {
+            // shm_open的名称必须以/开头
+            if ('/' == *name) {
+                return name;
+            }
+
+            return std::string("/") + name;
+        }
+
+        static int shm_posix_open(const char *name, bool create) {
+            int oflag = O_RDWR;
+            if (create) oflag |= O_CREAT;
+
+            if (shm_posix_is_file_path(name)) {
+                return open(name, oflag | O_CLOEXEC, 0666);
+            }
+
+            return shm_open(shm_posix_object_name(name).c_str(), oflag, 0666);
+        }
+
+        static int shm_posix_close_buffer(const char *name) {
+            std::map<std::string, shm_posix_mapped_record_type>::iterator iter = shm_posix_mapped_records.find(name);
+            if (shm_posix_mapped_records.end() == iter) return EN_ATBUS_ERR_SHM_NOT_FOUND;
+
+            shm_posix_mapped_record_type record = iter->second;
+            shm_posix_mapped_records.erase(iter);
+
+            if (0 != munmap(record.buffer, record.size)) return EN_ATBUS_ERR_SHM_GET_FAILED;
+
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        static int shm_posix_get_buffer(const char *name, size_t len, int flags, void **data, size_t *real_size, bool create) {
+            if (NULL == name || 0 == *name) return EN_ATBUS_ERR_PARAMS;
+
+            // 已经映射则直接返回
+            {
+                std::map<std::string, shm_posix_mapped_record_type>::iterator iter = shm_posix_mapped_records.find(name);
+                if (shm_posix_mapped_records.end() != iter) {
+                    if (data) *data = iter->second.buffer;
+                    if (real_size) *real_size = iter->second.size;
+                    return EN_ATBUS_ERR_SUCCESS;
+                }
+            }
+
+            int fd = shm_posix_open(name, create);
+            if (fd < 0) return (ENOENT == errno) ? EN_ATBUS_ERR_SHM_NOT_FOUND : EN_ATBUS_ERR_SHM_GET_FAILED;
+
+            // len 长度对齐到分页大小，hugetlbfs的块大小就是大页的大小
+            size_t page_size = ::sysconf(_SC_PAGESIZE);
+#ifdef __linux__
+            {
+                struct statfs fs_info;
+                if (0 == fstatfs(fd, &fs_info) && static_cast<size_t>(fs_info.f_bsize) > page_size) {
+                    page_size = static_cast<size_t>(fs_info.f_bsize);
+                }
+            }
+#endif
+
+#ifdef ATBUS_MACRO_HUGETLB_SIZE
+            // 如果大于4倍的大页表，则对齐到大页表，这样透明大页可以覆盖整个通道
+            bool use_hugepage = (flags & shm_posix_flag_t::EN_SPF_HUGEPAGE) && len > (4 * ATBUS_MACRO_HUGETLB_SIZE);
+            if (use_hugepage && page_size < ATBUS_MACRO_HUGETLB_SIZE) {
+                page_size = ATBUS_MACRO_HUGETLB_SIZE;
+            }
+#endif
+            len = (len + page_size - 1) & (~(page_size - 1));
+
+            // 获取实际长度，新创建的或者长度不足的要扩展
+            struct stat file_info;
+            if (0 != fstat(fd, &file_info)) {
+                close(fd);
+                return EN_ATBUS_ERR_SHM_GET_FAILED;
+            }
+
+            // 附加时按已存在的长度映射，长度是否足够由通道头部校验
+            size_t size = static_cast<size_t>(file_info.st_size);
+            if (create && size < len) {
+                if (0 != ftruncate(fd, static_cast<off_t>(len))) {
+                    close(fd);
+                    return EN_ATBUS_ERR_SHM_GET_FAILED;
+                }
+                size = len;
+            }
+
+            if (0 == size) {
+                close(fd);
+                return EN_ATBUS_ERR_CHANNEL_SIZE_TOO_SMALL;
+            }
+
+            int mmap_flags = MAP_SHARED;
+#ifdef MAP_POPULATE
+            if (flags & shm_posix_flag_t::EN_SPF_POPULATE) mmap_flags |= MAP_POPULATE;
+#endif
+
+            void *buffer = mmap(NULL, size, PROT_READ | PROT_WRITE, mmap_flags, fd, 0);
+            // 映射以后就不再需要fd了
+            close(fd);
+            if (MAP_FAILED == buffer) return EN_ATBUS_ERR_SHM_GET_FAILED;
+
+#if defined(ATBUS_MACRO_HUGETLB_SIZE) && defined(MADV_HUGEPAGE)
+            // tmpfs上的共享内存需要/sys/kernel/mm/transparent_hugepage/shmem_enabled是advise或always才会生效，失败时仍然使用普通分页
+            if (use_hugepage) {
+                madvise(buffer, size, MADV_HUGEPAGE);
+            }
+#endif
+
+            if (flags & shm_posix_flag_t::EN_SPF_MLOCK) {
+                mlock(buffer, size);
+            }
+
+            shm_posix_mapped_record_type shm_record;
+            shm_record.buffer = buffer;
+            shm_record.size = size;
+            shm_posix_mapped_records[name] = shm_record;
+
+            if (data) *data = buffer;
+            if (real_size) *real_size = size;
+
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+
+        int shm_posix_attach(const char *name, size_t len, shm_channel **channel, const shm_conf *conf, int flags) {
+            shm_channel_switcher channel_s;
+            shm_conf_cswitcher conf_s;
+            conf_s.shm = conf;
+
+            size_t real_size;
+            void *buffer;
+            int ret = shm_posix_get_buffer(name, len, flags, &buffer, &real_size, false);
+            if (ret < 0) return ret;
+
+            ret = mem_attach(buffer, real_size, &channel_s.mem, conf_s.mem);
+            if (ret < 0) {
+                shm_posix_close_buffer(name);
+                return ret;
+            }
+
+            if (channel) *channel = channel_s.shm;
+
+            return ret;
+        }
+
+        int shm_posix_init(const char *name, size_t len, shm_channel **channel, const shm_conf *conf, int flags) {
+            shm_channel_switcher channel_s;
+            shm_conf_cswitcher conf_s;
+            conf_s.shm = conf;
+
+            size_t real_size;
+            void *buffer;
+            int ret = shm_posix_get_buffer(name, len, flags, &buffer, &real_size, true);
+            if (ret < 0) return ret;
+
+            ret = mem_init(buffer, real_size, &channel_s.mem, conf_s.mem);
+            if (ret < 0) {
+                shm_posix_close_buffer(name);
+                return ret;
+            }
+
+            if (channel) *channel = channel_s.shm;
+
+            return ret;
+        }
+
+        int shm_posix_close(const char *name) {
+            if (NULL == name) return EN_ATBUS_ERR_PARAMS;
+
+            return shm_posix_close_buffer(name);
+        }
+
+        int shm_posix_unlink(const char *name) {
+            if (NULL == name || 0 == *name) return EN_ATBUS_ERR_PARAMS;
+
+            int res;
+            if (shm_posix_is_file_path(name)) {
+                res = unlink(name);
+            } else {
+                res = shm_unlink(shm_posix_object_name(name).c_str());
+            }
+
+            if (0 != res) return (ENOENT == errno) ? EN_ATBUS_ERR_SHM_NOT_FOUND : EN_ATBUS_ERR_SHM_GET_FAILED;
+
+            return EN_ATBUS_ERR_SUCCESS;
+        }
+#endif
+
         int shm_send(shm_channel *channel, const void *buf, size_t len) {
             shm_channel_switcher switcher;
             switcher.shm = channel;
             return mem_send(switcher.mem, buf, len);
         }
 
+        int shm_send_reserve(shm_channel *channel, size_t len, mem_reserved_block_t *block) {
+            shm_channel_switcher switcher;
+            switcher.shm = channel;
+            return mem_send_reserve(switcher.mem, len, block);
+        }
+
+        int shm_send_commit(shm_channel *channel, const mem_reserved_block_t *block) {
+            shm_channel_switcher switcher;
+            switcher.shm = channel;
+            return mem_send_commit(switcher.mem, block);
+        }
+
+        int shm_sendv(shm_channel *channel, const channel_iovec_t *iov, size_t iovcnt) {
+            shm_channel_switcher switcher;
+            switcher.shm = channel;
+            return mem_sendv(switcher.mem, iov, iovcnt);
+        }
+
+        int shm_send_batch(shm_channel *channel, const channel_iovec_t *iov, size_t iovcnt, size_t *sent_count) {
+            shm_channel_switcher switcher;
+            switcher.shm = channel;
+            return mem_send_batch(switcher.mem, iov, iovcnt, sent_count);
+        }
+
         int shm_recv(shm_channel *channel, void *buf, size_t len, size_t *recv_size) {
             shm_channel_switcher switcher;
             switcher.shm = channel;
             return mem_recv(switcher.mem, buf, len, recv_size);
         }
 
+        int shm_recv_peek(shm_channel *channel, mem_recv_block_t *block) {
+            shm_channel_switcher switcher;
+            switcher.shm = channel;
+            return mem_recv_peek(switcher.mem, block);
+        }
+
+        int shm_recv_release(shm_channel *channel, const mem_recv_block_t *block) {
+            shm_channel_switcher switcher;
+            switcher.shm = channel;
+            return mem_recv_release(switcher.mem, block);
+        }
+
+        int shm_recv_batch(shm_channel *channel, mem_recv_block_t *blocks, size_t max_count, size_t *count) {
+            shm_channel_switcher switcher;
+            switcher.shm = channel;
+            return mem_recv_batch(switcher.mem, blocks, max_count, count);
+        }
+
+        int shm_recv_batch_release(shm_channel *channel, const mem_recv_block_t *blocks, size_t count) {
+            shm_channel_switcher switcher;
+            switcher.shm = channel;
+            return mem_recv_batch_release(switcher.mem, blocks, count);
+        }
+
+        int shm_set_checksum(shm_channel *channel, uint32_t mode) {
+            shm_channel_switcher switcher;
+            switcher.shm = channel;
+            return mem_set_checksum(switcher.mem, mode);
+        }
+
+        uint32_t shm_get_checksum(const shm_channel *channel) {
+            shm_channel_switcher switcher;
+            switcher.shm = const_cast<shm_channel *>(channel);
+            return mem_get_checksum(switcher.mem);
+        }
+
+        int shm_get_usage(shm_channel *channel, size_t *used_size, size_t *capacity) {
+            shm_channel_switcher switcher;
+            switcher.shm = channel;
+            return mem_get_usage(switcher.mem, used_size, capacity);
+        }
+
+        int shm_set_doorbell(shm_channel *channel, const char *name) {
+            shm_channel_switcher switcher;
+            switcher.shm = channel;
+            return mem_set_doorbell(switcher.mem, name);
+        }
+
+        bool shm_doorbell_sleep(shm_channel *channel) {
+            shm_channel_switcher switcher;
+            switcher.shm = channel;
+            return mem_doorbell_sleep(switcher.mem);
+        }
+
+        void shm_doorbell_wakeup(shm_channel *channel) {
+            shm_channel_switcher switcher;
+            switcher.shm = channel;
+            mem_doorbell_wakeup(switcher.mem);
+        }
+
         std::pair<size_t, size_t> shm_last_action() { return mem_last_action(); }
 
         void shm_show_channel(shm_channel *channel, std::ostream &out, bool need_node_status, size_t need_node_data) {
@@ -34,6 +34,15 @@ namespace atbus {
             return true;
         }
 
+        bool is_memory_channel_address(const char *in) {
+            if (NULL == in) {
+                return false;
+            }
+
+            return 0 == UTIL_STRFUNC_STRNCASE_CMP("mem:", in, 4) || 0 == UTIL_STRFUNC_STRNCASE_CMP("shm:", in, 4) ||
+                   0 == UTIL_STRFUNC_STRNCASE_CMP("shm+posix:", in, 10);
+        }
+
         void make_address(const char *scheme, const char *host, int port, channel_address_t &addr) {
             addr.scheme = scheme;
             addr.host = host;
@@ -217,6 +217,14 @@ namespace atbus {
             return EN_ATBUS_ERR_SUCCESS;
         }
 
+        size_t buffer_manager::front_blocks(buffer_block **out, size_t max_count) {
+            if (NULL == out || 0 == max_count) {
+                return 0;
+            }
+
+            return is_dynamic_mode() ? dynamic_front_blocks(out, max_count) : static_front_blocks(out, max_count);
+        }
+
         buffer_block *buffer_manager::back() { return is_dynamic_mode() ? dynamic_back() : static_back(); }
 
         int buffer_manager::back(void *&pointer, size_t &nread, size_t &nwrite) {
@@ -326,6 +334,17 @@ namespace atbus {
             return static_buffer_.circle_index_[static_buffer_.head_];
         }
 
+        size_t buffer_manager::static_front_blocks(buffer_block **out, size_t max_count) {
+            size_t ret = 0;
+            // 环形索引的下标会回绕，但每个块本身都是连续的，所以这里不需要关心块是否跨越了缓冲区的尾部
+            for (size_t index = static_buffer_.head_; index != static_buffer_.tail_ && ret < max_count;
+                 index = (index + 1) % static_buffer_.circle_index_.size()) {
+                out[ret++] = static_buffer_.circle_index_[index];
+            }
+
+            return ret;
+        }
+
         buffer_block *buffer_manager::static_back() {
             if (static_empty()) {
                 return NULL;
@@ -762,6 +781,15 @@ namespace atbus {
             return dynamic_buffer_.front();
         }
 
+        size_t buffer_manager::dynamic_front_blocks(buffer_block **out, size_t max_count) {
+            size_t ret = 0;
+            for (std::list<buffer_block *>::iterator iter = dynamic_buffer_.begin(); iter != dynamic_buffer_.end() && ret < max_count; ++iter) {
+                out[ret++] = *iter;
+            }
+
+            return ret;
+        }
+
         buffer_block *buffer_manager::dynamic_back() {
             if (dynamic_empty()) {
                 return NULL;
@@ -956,5 +984,45 @@ namespace atbus {
                 }
             }
         }
+
+        // ================= buffer span writer =================
+        buffer_span_writer::buffer_span_writer() { reset(NULL, 0, NULL, 0); }
+
+        buffer_span_writer::buffer_span_writer(void *buf1, size_t len1, void *buf2, size_t len2) { reset(buf1, len1, buf2, len2); }
+
+        void buffer_span_writer::reset(void *buf1, size_t len1, void *buf2, size_t len2) {
+            buffer_[0] = reinterpret_cast<char *>(buf1);
+            length_[0] = NULL == buf1 ? 0 : len1;
+            buffer_[1] = reinterpret_cast<char *>(buf2);
+            length_[1] = NULL == buf2 ? 0 : len2;
+            used_ = 0;
+        }
+
+        void buffer_span_writer::write(const char *buf, size_t s) {
+            // 第一段
+            if (used_ < length_[0]) {
+                size_t copy_len = length_[0] - used_;
+                if (copy_len > s) {
+                    copy_len = s;
+                }
+
+                memcpy(buffer_[0] + used_, buf, copy_len);
+                used_ += copy_len;
+                buf += copy_len;
+                s -= copy_len;
+            }
+
+            // 第二段
+            if (s > 0 && used_ < capacity()) {
+                size_t offset = used_ - length_[0];
+                size_t copy_len = length_[1] - offset;
+                if (copy_len > s) {
+                    copy_len = s;
+                }
+
+                memcpy(buffer_[1] + offset, buf, copy_len);
+                used_ += copy_len;
+            }
+        }
     }
 }
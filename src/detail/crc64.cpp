@@ -1,6 +1,9 @@
 ﻿#include <stddef.h>
 #include <stdint.h>
 
+#include "detail/crc64.h"
+
+#include "crc_kernel.h"
 
 namespace atbus {
     namespace detail {
@@ -76,15 +79,31 @@ namespace atbus {
             UINT64_C(0xa6df411fbfb21ca3), UINT64_C(0xdc0731d78f8795da), UINT64_C(0x536fa08fdfd90e51), UINT64_C(0x29b7d047efec8728),
         };
 
-        uint64_t crc64(uint64_t crc, const unsigned char *s, size_t l) {
-            size_t j;
+        static const crc_kernel::slice8_table<uint64_t> &crc64_slice8_tab() {
+            static crc_kernel::slice8_table<uint64_t> ret(crc64_tab);
+            return ret;
+        }
 
-            for (j = 0; j < l; ++j) {
-                unsigned char byte = s[j];
-                crc = crc64_tab[static_cast<unsigned char>(crc) ^ byte] ^ (crc >> 8);
-            }
+#ifdef ATBUS_DETAIL_CRC_X86
+        // P = 0xAD93D23594C935A9 (Jones)
+        static const crc_kernel::fold_keys crc64_fold_keys = {
+            {UINT64_C(0xaf86efb16d9ab4fb), UINT64_C(0xf49784a634f014e4)}, // x^575 mod P, x^511 mod P
+            {UINT64_C(0xd9d7be7d505da32c), UINT64_C(0x381d0015c96f4444)}, // x^191 mod P, x^127 mod P
+        };
+#endif
 
-            return crc;
+        uint64_t crc64_portable(uint64_t crc, const unsigned char *s, size_t l) {
+            return crc_kernel::slice8(crc64_slice8_tab(), crc, s, l);
+        }
+
+        uint64_t crc64(uint64_t crc, const unsigned char *s, size_t l) {
+#ifdef ATBUS_DETAIL_CRC_X86
+            // 数据太短时折叠的准备工作反而更慢
+            if (l >= ATBUS_DETAIL_CRC_FOLD_MIN_SIZE && (crc_kernel::cpu_features() & crc_kernel::EN_CPU_PCLMUL)) {
+                return crc_kernel::fold_pclmul(crc64_slice8_tab(), crc64_fold_keys, crc, s, l);
+            }
+#endif
+            return crc64_portable(crc, s, l);
         }
     }
 }
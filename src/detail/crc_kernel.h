@@ -0,0 +1,191 @@
+﻿#pragma once
+
+#ifndef LIBATBUS_DETAIL_CRC_KERNEL_H_
+#define LIBATBUS_DETAIL_CRC_KERNEL_H_
+
+/**
+ * @brief crc32/crc64/crc32c共用的计算核心，只在src/detail内部使用
+ * @note 所有CRC都是反射(reflected)形式，不做初始值和结果的取反
+ * @note 便携版本使用slicing-by-8查表，x86下运行时检测CPU再选择PCLMULQDQ折叠或SSE4.2的crc32指令
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#include <emmintrin.h>
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#define ATBUS_DETAIL_CRC_X86 1
+#define ATBUS_DETAIL_CRC_SSE42_TARGET __attribute__((target("sse4.2")))
+#define ATBUS_DETAIL_CRC_PCLMUL_TARGET __attribute__((target("sse2,pclmul")))
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <emmintrin.h>
+#include <intrin.h>
+#include <nmmintrin.h>
+#include <wmmintrin.h>
+#define ATBUS_DETAIL_CRC_X86 1
+#define ATBUS_DETAIL_CRC_SSE42_TARGET
+#define ATBUS_DETAIL_CRC_PCLMUL_TARGET
+#endif
+
+// 使用PCLMULQDQ折叠的最小数据长度，不能小于64
+#ifndef ATBUS_DETAIL_CRC_FOLD_MIN_SIZE
+#define ATBUS_DETAIL_CRC_FOLD_MIN_SIZE 128
+#endif
+
+namespace atbus {
+    namespace detail {
+        namespace crc_kernel {
+            /**
+             * @brief slicing-by-8的查表数据，tab[0]就是逐字节计算用的表
+             */
+            template <typename T>
+            struct slice8_table {
+                T tab[8][256];
+
+                explicit slice8_table(const T *base) {
+                    for (int i = 0; i < 256; ++i) {
+                        tab[0][i] = base[i];
+                    }
+
+                    for (int k = 1; k < 8; ++k) {
+                        for (int i = 0; i < 256; ++i) {
+                            tab[k][i] = (tab[k - 1][i] >> 8) ^ tab[0][static_cast<unsigned char>(tab[k - 1][i])];
+                        }
+                    }
+                }
+            };
+
+            template <typename T>
+            inline T bytewise(const T *tab, T crc, const unsigned char *s, size_t l) {
+                for (size_t j = 0; j < l; ++j) {
+                    crc = tab[static_cast<unsigned char>(crc) ^ s[j]] ^ (crc >> 8);
+                }
+
+                return crc;
+            }
+
+            /**
+             * @brief slicing-by-8，每次处理8个字节
+             * @note 按字节组装数据，和CPU的字节序无关
+             */
+            template <typename T>
+            inline T slice8(const slice8_table<T> &t, T crc, const unsigned char *s, size_t l) {
+                while (l >= 8) {
+                    uint64_t v = static_cast<uint64_t>(s[0]) | (static_cast<uint64_t>(s[1]) << 8) | (static_cast<uint64_t>(s[2]) << 16) |
+                                 (static_cast<uint64_t>(s[3]) << 24) | (static_cast<uint64_t>(s[4]) << 32) |
+                                 (static_cast<uint64_t>(s[5]) << 40) | (static_cast<uint64_t>(s[6]) << 48) |
+                                 (static_cast<uint64_t>(s[7]) << 56);
+                    // crc不超过64位，8个字节查表以后原来的crc已经全部移出
+                    v ^= static_cast<uint64_t>(crc);
+                    crc = t.tab[7][v & 0xFF] ^ t.tab[6][(v >> 8) & 0xFF] ^ t.tab[5][(v >> 16) & 0xFF] ^ t.tab[4][(v >> 24) & 0xFF] ^
+                          t.tab[3][(v >> 32) & 0xFF] ^ t.tab[2][(v >> 40) & 0xFF] ^ t.tab[1][(v >> 48) & 0xFF] ^
+                          t.tab[0][(v >> 56) & 0xFF];
+
+                    s += 8;
+                    l -= 8;
+                }
+
+                return bytewise(t.tab[0], crc, s, l);
+            }
+
+#ifdef ATBUS_DETAIL_CRC_X86
+            enum cpu_feature_t {
+                EN_CPU_SSE42 = 0x01,
+                EN_CPU_PCLMUL = 0x02,
+            };
+
+            /**
+             * @brief 检测CPU支持的指令集
+             * @note 结果只和CPU有关，多线程同时初始化也是写入同样的值
+             */
+            inline int cpu_features() {
+                static int features = -1;
+                if (features < 0) {
+                    int ret = 0;
+#if defined(_MSC_VER)
+                    int cpu_info[4] = {0};
+                    __cpuid(cpu_info, 1);
+                    if (cpu_info[2] & (1 << 20)) ret |= EN_CPU_SSE42;
+                    if (cpu_info[2] & (1 << 1)) ret |= EN_CPU_PCLMUL;
+#else
+                    __builtin_cpu_init();
+                    if (__builtin_cpu_supports("sse4.2")) ret |= EN_CPU_SSE42;
+                    if (__builtin_cpu_supports("pclmul")) ret |= EN_CPU_PCLMUL;
+#endif
+                    features = ret;
+                }
+
+                return features;
+            }
+
+            /**
+             * @brief PCLMULQDQ折叠用的常量
+             * @note 反射形式，k[0]乘低64位(高次项)，k[1]乘高64位
+             * @note 折叠D位时 k[0] = x^(D+63) mod P，k[1] = x^(D-1) mod P，多出来的一次是因为反射形式的乘积少了一位
+             */
+            struct fold_keys {
+                uint64_t fold_512[2];
+                uint64_t fold_128[2];
+            };
+
+            ATBUS_DETAIL_CRC_PCLMUL_TARGET inline __m128i fold(__m128i x, __m128i k, __m128i next) {
+                __m128i lo = _mm_clmulepi64_si128(x, k, 0x00);
+                __m128i hi = _mm_clmulepi64_si128(x, k, 0x11);
+                return _mm_xor_si128(_mm_xor_si128(lo, hi), next);
+            }
+
+            /**
+             * @brief 使用PCLMULQDQ一次折叠64字节，最后剩下的16字节和尾部交给查表计算
+             * @note 输出和slice8完全一致，l至少要有64字节
+             */
+            template <typename T>
+            ATBUS_DETAIL_CRC_PCLMUL_TARGET T fold_pclmul(const slice8_table<T> &t, const fold_keys &keys, T crc, const unsigned char *s,
+                                                         size_t l) {
+                const __m128i k512 =
+                    _mm_set_epi64x(static_cast<int64_t>(keys.fold_512[1]), static_cast<int64_t>(keys.fold_512[0]));
+                const __m128i k128 =
+                    _mm_set_epi64x(static_cast<int64_t>(keys.fold_128[1]), static_cast<int64_t>(keys.fold_128[0]));
+
+                // 初始值直接异或到最前面的数据上
+                __m128i x0 = _mm_xor_si128(_mm_loadu_si128(reinterpret_cast<const __m128i *>(s)),
+                                           _mm_set_epi64x(0, static_cast<int64_t>(static_cast<uint64_t>(crc))));
+                __m128i x1 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 16));
+                __m128i x2 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 32));
+                __m128i x3 = _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 48));
+                s += 64;
+                l -= 64;
+
+                while (l >= 64) {
+                    x0 = fold(x0, k512, _mm_loadu_si128(reinterpret_cast<const __m128i *>(s)));
+                    x1 = fold(x1, k512, _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 16)));
+                    x2 = fold(x2, k512, _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 32)));
+                    x3 = fold(x3, k512, _mm_loadu_si128(reinterpret_cast<const __m128i *>(s + 48)));
+                    s += 64;
+                    l -= 64;
+                }
+
+                x1 = fold(x0, k128, x1);
+                x2 = fold(x1, k128, x2);
+                x3 = fold(x2, k128, x3);
+
+                while (l >= 16) {
+                    x3 = fold(x3, k128, _mm_loadu_si128(reinterpret_cast<const __m128i *>(s)));
+                    s += 16;
+                    l -= 16;
+                }
+
+                // 剩下的128位和原始数据模P同余，当成16字节数据用初始值0算一遍就是最终结果
+                unsigned char rest[16];
+                _mm_storeu_si128(reinterpret_cast<__m128i *>(rest), x3);
+                crc = slice8(t, static_cast<T>(0), rest, sizeof(rest));
+                return slice8(t, crc, s, l);
+            }
+#endif
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,205 @@
+﻿#include "detail/io_uring.h"
+
+#ifdef ATBUS_CHANNEL_IO_URING
+
+#include <cerrno>
+#include <cstring>
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// 老版本的libc头文件里可能没有io_uring的系统调用号，除alpha外所有架构都是统一的编号
+#if !defined(__alpha__)
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+#endif
+
+namespace atbus {
+    namespace detail {
+        // 和内核共享的游标，读对方写的游标要acquire，写自己的游标要release
+        static inline unsigned int io_uring_load_acquire(const unsigned int *p) { return __atomic_load_n(p, __ATOMIC_ACQUIRE); }
+
+        static inline void io_uring_store_release(unsigned int *p, unsigned int v) { __atomic_store_n(p, v, __ATOMIC_RELEASE); }
+
+        io_uring_ring::io_uring_ring()
+            : ring_fd_(-1), sq_ptr_(NULL), sq_size_(0), cq_ptr_(NULL), cq_size_(0), sqes_(NULL), sqes_size_(0), sq_khead_(NULL),
+              sq_ktail_(NULL), sq_kflags_(NULL), sq_array_(NULL), sq_mask_(0), sq_entries_(0), sqe_head_(0), sqe_tail_(0),
+              cq_khead_(NULL), cq_ktail_(NULL), cqes_(NULL), cq_mask_(0) {}
+
+        io_uring_ring::~io_uring_ring() { close(); }
+
+        int io_uring_ring::init(unsigned int entries) {
+            if (is_inited()) {
+                return 0;
+            }
+
+            struct io_uring_params params;
+            memset(&params, 0, sizeof(params));
+            int fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+            if (fd < 0) {
+                return -errno;
+            }
+
+            ring_fd_ = fd;
+            sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+            cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+            // 5.4以后的内核提交队列和完成队列可以一次映射
+            if (params.features & IORING_FEAT_SINGLE_MMAP) {
+                if (cq_size_ > sq_size_) {
+                    sq_size_ = cq_size_;
+                }
+                cq_size_ = 0;
+            }
+
+            sq_ptr_ = mmap(NULL, sq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+            if (MAP_FAILED == sq_ptr_) {
+                sq_ptr_ = NULL;
+                int ret = -errno;
+                close();
+                return ret;
+            }
+
+            if (0 == cq_size_) {
+                cq_ptr_ = sq_ptr_;
+            } else {
+                cq_ptr_ = mmap(NULL, cq_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+                if (MAP_FAILED == cq_ptr_) {
+                    cq_ptr_ = NULL;
+                    int ret = -errno;
+                    close();
+                    return ret;
+                }
+            }
+
+            sqes_size_ = params.sq_entries * sizeof(struct io_uring_sqe);
+            void *sqes = mmap(NULL, sqes_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+            if (MAP_FAILED == sqes) {
+                int ret = -errno;
+                close();
+                return ret;
+            }
+            sqes_ = reinterpret_cast<struct io_uring_sqe *>(sqes);
+
+            char *sq = reinterpret_cast<char *>(sq_ptr_);
+            sq_khead_ = reinterpret_cast<unsigned int *>(sq + params.sq_off.head);
+            sq_ktail_ = reinterpret_cast<unsigned int *>(sq + params.sq_off.tail);
+            sq_kflags_ = reinterpret_cast<unsigned int *>(sq + params.sq_off.flags);
+            sq_array_ = reinterpret_cast<unsigned int *>(sq + params.sq_off.array);
+            sq_mask_ = *reinterpret_cast<unsigned int *>(sq + params.sq_off.ring_mask);
+            sq_entries_ = *reinterpret_cast<unsigned int *>(sq + params.sq_off.ring_entries);
+            sqe_head_ = sqe_tail_ = *sq_ktail_;
+
+            char *cq = reinterpret_cast<char *>(cq_ptr_);
+            cq_khead_ = reinterpret_cast<unsigned int *>(cq + params.cq_off.head);
+            cq_ktail_ = reinterpret_cast<unsigned int *>(cq + params.cq_off.tail);
+            cqes_ = reinterpret_cast<struct io_uring_cqe *>(cq + params.cq_off.cqes);
+            cq_mask_ = *reinterpret_cast<unsigned int *>(cq + params.cq_off.ring_mask);
+            return 0;
+        }
+
+        void io_uring_ring::close() {
+            if (NULL != sqes_) {
+                munmap(sqes_, sqes_size_);
+                sqes_ = NULL;
+            }
+
+            if (NULL != cq_ptr_ && cq_ptr_ != sq_ptr_) {
+                munmap(cq_ptr_, cq_size_);
+            }
+            cq_ptr_ = NULL;
+
+            if (NULL != sq_ptr_) {
+                munmap(sq_ptr_, sq_size_);
+                sq_ptr_ = NULL;
+            }
+
+            if (ring_fd_ >= 0) {
+                ::close(ring_fd_);
+                ring_fd_ = -1;
+            }
+        }
+
+        struct io_uring_sqe *io_uring_ring::get_sqe() {
+            if (!is_inited()) {
+                return NULL;
+            }
+
+            if (sqe_tail_ - io_uring_load_acquire(sq_khead_) >= sq_entries_) {
+                return NULL;
+            }
+
+            struct io_uring_sqe *ret = &sqes_[sqe_tail_ & sq_mask_];
+            ++sqe_tail_;
+            memset(ret, 0, sizeof(struct io_uring_sqe));
+            return ret;
+        }
+
+        unsigned int io_uring_ring::pending() const {
+            if (!is_inited()) {
+                return 0;
+            }
+
+            return (sqe_tail_ - sqe_head_) + (*sq_ktail_ - io_uring_load_acquire(sq_khead_));
+        }
+
+        int io_uring_ring::submit() {
+            if (!is_inited()) {
+                return -EBADF;
+            }
+
+            // 把新分配的提交项放进提交队列，再一次性通知内核
+            unsigned int tail = *sq_ktail_;
+            for (; sqe_head_ != sqe_tail_; ++sqe_head_) {
+                sq_array_[tail & sq_mask_] = sqe_head_ & sq_mask_;
+                ++tail;
+            }
+            io_uring_store_release(sq_ktail_, tail);
+
+            unsigned int to_submit = tail - io_uring_load_acquire(sq_khead_);
+            if (0 == to_submit) {
+                return 0;
+            }
+
+            return enter(to_submit, 0);
+        }
+
+        struct io_uring_cqe *io_uring_ring::peek_cqe() {
+            if (!is_inited()) {
+                return NULL;
+            }
+
+            unsigned int head = *cq_khead_;
+            if (head == io_uring_load_acquire(cq_ktail_)) {
+                // 完成队列溢出时内核暂存的事件要主动取回来
+                if (0 == (io_uring_load_acquire(sq_kflags_) & IORING_SQ_CQ_OVERFLOW)) {
+                    return NULL;
+                }
+
+                enter(0, IORING_ENTER_GETEVENTS);
+                if (head == io_uring_load_acquire(cq_ktail_)) {
+                    return NULL;
+                }
+            }
+
+            return &cqes_[head & cq_mask_];
+        }
+
+        void io_uring_ring::cqe_seen() { io_uring_store_release(cq_khead_, *cq_khead_ + 1); }
+
+        int io_uring_ring::enter(unsigned int to_submit, unsigned int flags) {
+            int ret;
+            do {
+                ret = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, to_submit, 0, flags, NULL, 0));
+            } while (ret < 0 && EINTR == errno);
+
+            return ret < 0 ? -errno : ret;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,221 @@
+﻿#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "detail/lz4.h"
+
+namespace atbus {
+    namespace detail {
+        // 块格式的限制：最后5字节必须是字面量，最后一个匹配至少要在结尾12字节之前开始
+        static const size_t lz4_min_match = 4;
+        static const size_t lz4_last_literals = 5;
+        static const size_t lz4_mf_limit = 12;
+        static const size_t lz4_max_distance = 65535;
+        static const size_t lz4_max_input_size = 0x7E000000;
+
+        static const int lz4_hash_log = 12;
+        static const int lz4_skip_trigger = 6;
+
+        static inline uint32_t lz4_read32(const unsigned char *p) {
+            uint32_t ret;
+            memcpy(&ret, p, sizeof(ret));
+            return ret;
+        }
+
+        static inline uint32_t lz4_hash(uint32_t v) { return (v * 2654435761U) >> (32 - lz4_hash_log); }
+
+        // 长度超过15时token里放15，剩余部分用连续的255加一个尾字节表示
+        static inline unsigned char *lz4_write_length(unsigned char *op, size_t len) {
+            while (len >= 255) {
+                *op++ = 255;
+                len -= 255;
+            }
+            *op++ = static_cast<unsigned char>(len);
+            return op;
+        }
+
+        static inline bool lz4_read_length(const unsigned char *&ip, const unsigned char *iend, size_t &len) {
+            unsigned char b;
+            do {
+                if (ip >= iend) {
+                    return false;
+                }
+                b = *ip++;
+                len += b;
+            } while (255 == b);
+
+            return true;
+        }
+
+        // 写入一个序列的字面量部分，返回NULL表示输出缓冲区不足
+        static unsigned char *lz4_write_literals(unsigned char *op, unsigned char *oend, unsigned char *&token, const unsigned char *anchor,
+                                                 size_t lit_len, size_t reserve) {
+            if (static_cast<size_t>(oend - op) < 1 + lit_len / 255 + 1 + lit_len + reserve) {
+                return NULL;
+            }
+
+            token = op++;
+            if (lit_len >= 15) {
+                *token = static_cast<unsigned char>(15 << 4);
+                op = lz4_write_length(op, lit_len - 15);
+            } else {
+                *token = static_cast<unsigned char>(lit_len << 4);
+            }
+
+            memcpy(op, anchor, lit_len);
+            return op + lit_len;
+        }
+
+        size_t lz4_compress_bound(size_t s) { return s + s / 255 + 16; }
+
+        size_t lz4_compress(const void *src, size_t src_len, void *dst, size_t dst_len) {
+            if (NULL == src || NULL == dst || src_len > lz4_max_input_size) {
+                return 0;
+            }
+
+            const unsigned char *base = reinterpret_cast<const unsigned char *>(src);
+            const unsigned char *ip = base;
+            const unsigned char *anchor = base;
+            const unsigned char *iend = base + src_len;
+            unsigned char *op = reinterpret_cast<unsigned char *>(dst);
+            unsigned char *oend = op + dst_len;
+            unsigned char *token = NULL;
+
+            if (src_len > lz4_mf_limit) {
+                const unsigned char *mflimit = iend - lz4_mf_limit;
+                const unsigned char *matchlimit = iend - lz4_last_literals;
+
+                // 记录每个hash最后出现的位置，0也是合法位置，候选位置都会再比较一次内容
+                uint32_t table[1 << lz4_hash_log];
+                memset(table, 0, sizeof(table));
+
+                ++ip;
+                size_t search_times = 1 << lz4_skip_trigger;
+                while (ip <= mflimit) {
+                    uint32_t seq = lz4_read32(ip);
+                    uint32_t h = lz4_hash(seq);
+                    const unsigned char *ref = base + table[h];
+                    table[h] = static_cast<uint32_t>(ip - base);
+
+                    if (ref >= ip || static_cast<size_t>(ip - ref) > lz4_max_distance || lz4_read32(ref) != seq) {
+                        // 连续找不到匹配时逐渐加大步长，不可压缩的数据可以很快跳过
+                        ip += search_times++ >> lz4_skip_trigger;
+                        continue;
+                    }
+                    search_times = 1 << lz4_skip_trigger;
+
+                    while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+                        --ip;
+                        --ref;
+                    }
+
+                    size_t match_len = lz4_min_match;
+                    while (ip + match_len < matchlimit && ip[match_len] == ref[match_len]) {
+                        ++match_len;
+                    }
+
+                    // 字面量后面还有2字节偏移和匹配长度的扩展字节
+                    size_t reserve = 2 + (match_len - lz4_min_match) / 255 + 1;
+                    op = lz4_write_literals(op, oend, token, anchor, static_cast<size_t>(ip - anchor), reserve);
+                    if (NULL == op) {
+                        return 0;
+                    }
+
+                    size_t offset = static_cast<size_t>(ip - ref);
+                    *op++ = static_cast<unsigned char>(offset & 0xFF);
+                    *op++ = static_cast<unsigned char>((offset >> 8) & 0xFF);
+
+                    size_t ml = match_len - lz4_min_match;
+                    if (ml >= 15) {
+                        *token |= 15;
+                        op = lz4_write_length(op, ml - 15);
+                    } else {
+                        *token |= static_cast<unsigned char>(ml);
+                    }
+
+                    ip += match_len;
+                    anchor = ip;
+
+                    // 匹配结尾前的位置也放进hash表，提高下一次的命中率
+                    if (ip <= mflimit) {
+                        table[lz4_hash(lz4_read32(ip - 2))] = static_cast<uint32_t>(ip - 2 - base);
+                    }
+                }
+            }
+
+            // 最后一个序列只有字面量
+            op = lz4_write_literals(op, oend, token, anchor, static_cast<size_t>(iend - anchor), 0);
+            if (NULL == op) {
+                return 0;
+            }
+
+            return static_cast<size_t>(op - reinterpret_cast<unsigned char *>(dst));
+        }
+
+        bool lz4_decompress(const void *src, size_t src_len, void *dst, size_t dst_len) {
+            if (NULL == src || NULL == dst || 0 == src_len) {
+                return false;
+            }
+
+            const unsigned char *ip = reinterpret_cast<const unsigned char *>(src);
+            const unsigned char *iend = ip + src_len;
+            unsigned char *obase = reinterpret_cast<unsigned char *>(dst);
+            unsigned char *op = obase;
+            unsigned char *oend = obase + dst_len;
+
+            while (true) {
+                unsigned char token = *ip++;
+
+                size_t lit_len = token >> 4;
+                if (15 == lit_len && !lz4_read_length(ip, iend, lit_len)) {
+                    return false;
+                }
+
+                if (lit_len > static_cast<size_t>(iend - ip) || lit_len > static_cast<size_t>(oend - op)) {
+                    return false;
+                }
+                memcpy(op, ip, lit_len);
+                ip += lit_len;
+                op += lit_len;
+
+                // 输入结束时必须刚好是最后一个序列
+                if (ip == iend) {
+                    return op == oend;
+                }
+
+                if (iend - ip < 2) {
+                    return false;
+                }
+                size_t offset = static_cast<size_t>(ip[0]) | (static_cast<size_t>(ip[1]) << 8);
+                ip += 2;
+                if (0 == offset || offset > static_cast<size_t>(op - obase)) {
+                    return false;
+                }
+
+                size_t match_len = token & 0x0F;
+                if (15 == match_len && !lz4_read_length(ip, iend, match_len)) {
+                    return false;
+                }
+                match_len += lz4_min_match;
+                if (match_len > static_cast<size_t>(oend - op)) {
+                    return false;
+                }
+
+                const unsigned char *match = op - offset;
+                if (offset >= match_len) {
+                    memcpy(op, match, match_len);
+                    op += match_len;
+                } else {
+                    // 重叠的匹配要逐字节复制，这样才能重复前面的内容
+                    for (size_t i = 0; i < match_len; ++i) {
+                        *op++ = *match++;
+                    }
+                }
+
+                if (ip >= iend) {
+                    return false;
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,170 @@
+﻿#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "detail/xxhash64.h"
+
+namespace atbus {
+    namespace detail {
+        static const uint64_t xxhash64_prime1 = 0x9E3779B185EBCA87ULL;
+        static const uint64_t xxhash64_prime2 = 0xC2B2AE3D27D4EB4FULL;
+        static const uint64_t xxhash64_prime3 = 0x165667B19E3779F9ULL;
+        static const uint64_t xxhash64_prime4 = 0x85EBCA77C2B2AE63ULL;
+        static const uint64_t xxhash64_prime5 = 0x27D4EB2F165667C5ULL;
+
+        static inline uint64_t xxhash64_rotl(uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+        // 按小端序读取，和官方实现的输出保持一致
+        static inline uint64_t xxhash64_read64(const unsigned char *p) {
+            return static_cast<uint64_t>(p[0]) | (static_cast<uint64_t>(p[1]) << 8) | (static_cast<uint64_t>(p[2]) << 16) |
+                   (static_cast<uint64_t>(p[3]) << 24) | (static_cast<uint64_t>(p[4]) << 32) | (static_cast<uint64_t>(p[5]) << 40) |
+                   (static_cast<uint64_t>(p[6]) << 48) | (static_cast<uint64_t>(p[7]) << 56);
+        }
+
+        static inline uint32_t xxhash64_read32(const unsigned char *p) {
+            return static_cast<uint32_t>(p[0]) | (static_cast<uint32_t>(p[1]) << 8) | (static_cast<uint32_t>(p[2]) << 16) |
+                   (static_cast<uint32_t>(p[3]) << 24);
+        }
+
+        static inline uint64_t xxhash64_round(uint64_t acc, uint64_t input) {
+            acc += input * xxhash64_prime2;
+            acc = xxhash64_rotl(acc, 31);
+            return acc * xxhash64_prime1;
+        }
+
+        static inline uint64_t xxhash64_merge_round(uint64_t acc, uint64_t val) {
+            acc ^= xxhash64_round(0, val);
+            return acc * xxhash64_prime1 + xxhash64_prime4;
+        }
+
+        // 处理完整的32字节块，返回处理到的位置
+        static inline const unsigned char *xxhash64_stripes(uint64_t v[4], const unsigned char *p, const unsigned char *end) {
+            if (end - p < 32) {
+                return p;
+            }
+
+            const unsigned char *limit = end - 32;
+            uint64_t v1 = v[0], v2 = v[1], v3 = v[2], v4 = v[3];
+            do {
+                v1 = xxhash64_round(v1, xxhash64_read64(p));
+                v2 = xxhash64_round(v2, xxhash64_read64(p + 8));
+                v3 = xxhash64_round(v3, xxhash64_read64(p + 16));
+                v4 = xxhash64_round(v4, xxhash64_read64(p + 24));
+                p += 32;
+            } while (p <= limit);
+
+            v[0] = v1;
+            v[1] = v2;
+            v[2] = v3;
+            v[3] = v4;
+            return p;
+        }
+
+        static inline uint64_t xxhash64_merge(const uint64_t v[4]) {
+            uint64_t h64 = xxhash64_rotl(v[0], 1) + xxhash64_rotl(v[1], 7) + xxhash64_rotl(v[2], 12) + xxhash64_rotl(v[3], 18);
+            h64 = xxhash64_merge_round(h64, v[0]);
+            h64 = xxhash64_merge_round(h64, v[1]);
+            h64 = xxhash64_merge_round(h64, v[2]);
+            return xxhash64_merge_round(h64, v[3]);
+        }
+
+        static inline void xxhash64_init_acc(uint64_t v[4], uint64_t seed) {
+            v[0] = seed + xxhash64_prime1 + xxhash64_prime2;
+            v[1] = seed + xxhash64_prime2;
+            v[2] = seed;
+            v[3] = seed - xxhash64_prime1;
+        }
+
+        // 处理不足32字节的尾部数据
+        static uint64_t xxhash64_finalize(uint64_t h64, const unsigned char *p, const unsigned char *end) {
+            while (p + 8 <= end) {
+                h64 ^= xxhash64_round(0, xxhash64_read64(p));
+                h64 = xxhash64_rotl(h64, 27) * xxhash64_prime1 + xxhash64_prime4;
+                p += 8;
+            }
+
+            if (p + 4 <= end) {
+                h64 ^= static_cast<uint64_t>(xxhash64_read32(p)) * xxhash64_prime1;
+                h64 = xxhash64_rotl(h64, 23) * xxhash64_prime2 + xxhash64_prime3;
+                p += 4;
+            }
+
+            while (p < end) {
+                h64 ^= static_cast<uint64_t>(*p) * xxhash64_prime5;
+                h64 = xxhash64_rotl(h64, 11) * xxhash64_prime1;
+                ++p;
+            }
+
+            h64 ^= h64 >> 33;
+            h64 *= xxhash64_prime2;
+            h64 ^= h64 >> 29;
+            h64 *= xxhash64_prime3;
+            h64 ^= h64 >> 32;
+            return h64;
+        }
+
+        uint64_t xxhash64(uint64_t seed, const void *s, size_t l) {
+            const unsigned char *p = static_cast<const unsigned char *>(s);
+            const unsigned char *end = p + l;
+            uint64_t h64;
+
+            if (l >= 32) {
+                uint64_t v[4];
+                xxhash64_init_acc(v, seed);
+                p = xxhash64_stripes(v, p, end);
+                h64 = xxhash64_merge(v);
+            } else {
+                h64 = seed + xxhash64_prime5;
+            }
+
+            h64 += static_cast<uint64_t>(l);
+            return xxhash64_finalize(h64, p, end);
+        }
+
+        void xxhash64_init(xxhash64_state &state, uint64_t seed) {
+            state.total_len = 0;
+            xxhash64_init_acc(state.v, seed);
+            state.mem_size = 0;
+        }
+
+        void xxhash64_update(xxhash64_state &state, const void *s, size_t l) {
+            const unsigned char *p = static_cast<const unsigned char *>(s);
+            const unsigned char *end = p + l;
+            state.total_len += l;
+
+            // 先补齐上次剩下的块
+            if (state.mem_size > 0) {
+                size_t fill = sizeof(state.mem) - state.mem_size;
+                if (l < fill) {
+                    memcpy(state.mem + state.mem_size, p, l);
+                    state.mem_size += l;
+                    return;
+                }
+
+                memcpy(state.mem + state.mem_size, p, fill);
+                xxhash64_stripes(state.v, state.mem, state.mem + sizeof(state.mem));
+                p += fill;
+                state.mem_size = 0;
+            }
+
+            p = xxhash64_stripes(state.v, p, end);
+            if (p < end) {
+                memcpy(state.mem, p, static_cast<size_t>(end - p));
+                state.mem_size = static_cast<size_t>(end - p);
+            }
+        }
+
+        uint64_t xxhash64_digest(const xxhash64_state &state) {
+            uint64_t h64;
+            if (state.total_len >= 32) {
+                h64 = xxhash64_merge(state.v);
+            } else {
+                // 不足一个块时v[2]就是种子
+                h64 = state.v[2] + xxhash64_prime5;
+            }
+
+            h64 += state.total_len;
+            return xxhash64_finalize(h64, state.mem, state.mem + state.mem_size);
+        }
+    }
+}
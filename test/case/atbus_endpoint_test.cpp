@@ -11,6 +11,7 @@
 #include <common/string_oprs.h>
 
 #include <detail/libatbus_error.h>
+#include <detail/libatbus_channel_export.h>
 #include <atbus_node.h>
 #include <atbus_endpoint.h>
 #include "frame/test_macros.h"
@@ -171,3 +172,137 @@ CASE_TEST(atbus_endpoint, get_connection)
 
     delete []buffer;
 }
+
+// 多段数据直接写入内存通道，通道回绕时数据段会被拆开
+CASE_TEST(atbus_endpoint, connection_pushv)
+{
+    atbus::node::conf_t conf;
+    atbus::node::default_conf(&conf);
+    conf.children_mask = 16;
+    uv_loop_t ev_loop;
+    uv_loop_init(&ev_loop);
+
+    conf.ev_loop = &ev_loop;
+    conf.recv_buffer_size = 64 * 1024;
+
+    char* buffer = new char[conf.recv_buffer_size];
+    memset(buffer, 0, conf.recv_buffer_size);
+
+    char addr[32] = { 0 };
+    UTIL_STRFUNC_SNPRINTF(addr, sizeof(addr), "mem://0x%p", buffer);
+    if (addr[8] == '0' && addr[9] == 'x') {
+        memset(addr, 0, sizeof(addr));
+        UTIL_STRFUNC_SNPRINTF(addr, sizeof(addr), "mem://%p", buffer);
+    }
+
+    {
+        atbus::node::ptr_t node = atbus::node::create();
+        node->init(0x12345678, &conf);
+
+        atbus::connection::ptr_t conn = atbus::connection::create(node.get());
+        CASE_EXPECT_EQ(0, conn->connect(addr));
+
+        atbus::channel::mem_channel* channel = NULL;
+        CASE_EXPECT_EQ(0, atbus::channel::mem_attach(buffer, conf.recv_buffer_size, &channel, NULL));
+
+        char recv_data[4096] = { 0 };
+        size_t recv_size = 0;
+
+        // 空数组和全部是空数据段时不写入任何数据
+        atbus::channel::channel_iovec_t iov[64];
+        CASE_EXPECT_EQ(0, conn->pushv(NULL, 0));
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_PARAMS, conn->pushv(NULL, 1));
+        for (size_t i = 0; i < 64; ++i) {
+            iov[i].base = recv_data;
+            iov[i].len = 0;
+        }
+        CASE_EXPECT_EQ(0, conn->pushv(iov, 64));
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_NO_DATA, atbus::channel::mem_recv(channel, recv_data, sizeof(recv_data), &recv_size));
+
+        // 大量数据段，包含空数据段，多轮以后通道一定会回绕
+        std::string segments;
+        for (size_t i = 0; i < 256; ++i) {
+            segments.push_back(static_cast<char>('a' + i % 26));
+        }
+        for (size_t round = 0; round < 256; ++round) {
+            std::string joined;
+            for (size_t i = 0; i < 64; ++i) {
+                iov[i].base = segments.data() + (round + i) % 128;
+                iov[i].len = (round * 5 + i * 7) % 31;
+                joined.append(segments.data() + (round + i) % 128, iov[i].len);
+            }
+
+            CASE_EXPECT_EQ(0, conn->pushv(iov, 64));
+            CASE_EXPECT_EQ(0, atbus::channel::mem_recv(channel, recv_data, sizeof(recv_data), &recv_size));
+            CASE_EXPECT_EQ(joined.size(), recv_size);
+            CASE_EXPECT_EQ(0, memcmp(joined.data(), recv_data, joined.size()));
+        }
+    }
+
+    while (UV_EBUSY == uv_loop_close(&ev_loop)) {
+        uv_run(&ev_loop, UV_RUN_ONCE);
+    }
+
+    delete []buffer;
+}
+
+// 内存通道的校验方式由创建通道的一端决定
+CASE_TEST(atbus_endpoint, mem_checksum_conf)
+{
+    atbus::node::conf_t conf;
+    atbus::node::default_conf(&conf);
+    conf.children_mask = 16;
+    uv_loop_t ev_loop;
+    uv_loop_init(&ev_loop);
+
+    conf.ev_loop = &ev_loop;
+    conf.recv_buffer_size = 64 * 1024;
+    conf.mem_checksum_mode = atbus::channel::mem_checksum_t::EN_MCS_CRC32C;
+
+    char* buffer = new char[conf.recv_buffer_size];
+    memset(buffer, 0, conf.recv_buffer_size);
+
+    char addr[32] = { 0 };
+    UTIL_STRFUNC_SNPRINTF(addr, sizeof(addr), "mem://0x%p", buffer);
+    if (addr[8] == '0' && addr[9] == 'x') {
+        memset(addr, 0, sizeof(addr));
+        UTIL_STRFUNC_SNPRINTF(addr, sizeof(addr), "mem://%p", buffer);
+    }
+
+    {
+        atbus::node::ptr_t node1 = atbus::node::create();
+        node1->init(0x12345678, &conf);
+
+        atbus::connection::ptr_t conn1 = atbus::connection::create(node1.get());
+        CASE_EXPECT_EQ(0, conn1->connect(addr));
+
+        atbus::channel::mem_channel* channel = NULL;
+        CASE_EXPECT_EQ(0, atbus::channel::mem_attach(buffer, conf.recv_buffer_size, &channel, NULL));
+        CASE_EXPECT_EQ(atbus::channel::mem_checksum_t::EN_MCS_CRC32C, atbus::channel::mem_get_checksum(channel));
+
+        // attach到已有通道时不修改通道头里的配置
+        conf.mem_checksum_mode = atbus::channel::mem_checksum_t::EN_MCS_XXHASH64;
+        atbus::node::ptr_t node2 = atbus::node::create();
+        node2->init(0x12345679, &conf);
+
+        atbus::connection::ptr_t conn2 = atbus::connection::create(node2.get());
+        CASE_EXPECT_EQ(0, conn2->listen(addr));
+        CASE_EXPECT_EQ(atbus::channel::mem_checksum_t::EN_MCS_CRC32C, atbus::channel::mem_get_checksum(channel));
+
+        // 发送端和接收端使用同一个校验方式
+        const char send_data[] = "checksum crc32c";
+        CASE_EXPECT_EQ(0, atbus::channel::mem_send(channel, send_data, sizeof(send_data)));
+
+        char recv_data[64] = { 0 };
+        size_t recv_size = 0;
+        CASE_EXPECT_EQ(0, atbus::channel::mem_recv(channel, recv_data, sizeof(recv_data), &recv_size));
+        CASE_EXPECT_EQ(sizeof(send_data), recv_size);
+        CASE_EXPECT_EQ(0, memcmp(send_data, recv_data, sizeof(send_data)));
+    }
+
+    while (UV_EBUSY == uv_loop_close(&ev_loop)) {
+        uv_run(&ev_loop, UV_RUN_ONCE);
+    }
+
+    delete []buffer;
+}
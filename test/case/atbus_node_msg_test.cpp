@@ -365,6 +365,207 @@ CASE_TEST(atbus_node_msg, parent_and_child) {
     unit_test_setup_exit(&ev_loop);
 }
 
+static void node_msg_test_check_skip_hash(atbus::node::ptr_t &n, atbus::node::bus_id_t tid, bool expect_skip) {
+    atbus::endpoint *ep = n->get_endpoint(tid);
+    CASE_EXPECT_NE(NULL, ep);
+    if (NULL == ep) {
+        return;
+    }
+
+    const atbus::connection *ctrl_conn = ep->get_ctrl_connection(ep);
+    const atbus::connection *data_conn = ep->get_data_connection(ep);
+    CASE_EXPECT_NE(NULL, ctrl_conn);
+    CASE_EXPECT_NE(NULL, data_conn);
+    if (NULL != ctrl_conn) {
+        CASE_EXPECT_EQ(expect_skip, ctrl_conn->check_flag(atbus::connection::flag_t::SKIP_HASH));
+    }
+    if (NULL != data_conn) {
+        CASE_EXPECT_EQ(expect_skip, data_conn->check_flag(atbus::connection::flag_t::SKIP_HASH));
+    }
+}
+
+static void node_msg_test_frame_hash_run(int parent_mode, int child_mode, bool parent_skip, bool child_skip) {
+    atbus::node::conf_t conf;
+    atbus::node::default_conf(&conf);
+    conf.children_mask = 16;
+    uv_loop_t ev_loop;
+    uv_loop_init(&ev_loop);
+
+    conf.ev_loop = &ev_loop;
+
+    {
+        atbus::node::ptr_t node_parent = atbus::node::create();
+        atbus::node::ptr_t node_child = atbus::node::create();
+        node_parent->on_debug = node_msg_test_on_debug;
+        node_child->on_debug = node_msg_test_on_debug;
+        node_parent->set_on_error_handle(node_msg_test_on_error);
+        node_child->set_on_error_handle(node_msg_test_on_error);
+
+        conf.frame_hash_mode = parent_mode;
+        node_parent->init(0x12345678, &conf);
+
+        conf.children_mask = 8;
+        conf.father_address = "ipv4://127.0.0.1:16387";
+        conf.frame_hash_mode = child_mode;
+        node_child->init(0x12346789, &conf);
+
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node_parent->listen("ipv4://127.0.0.1:16387"));
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node_child->listen("ipv4://127.0.0.1:16388"));
+
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node_parent->start());
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node_child->start());
+
+        time_t proc_t = time(NULL) + 1;
+
+        UNITTEST_WAIT_UNTIL(conf.ev_loop, node_child->is_endpoint_available(node_parent->get_id()) &&
+                                              node_parent->is_endpoint_available(node_child->get_id()),
+                            8000, 64) {
+            node_parent->proc(proc_t, 0);
+            node_child->proc(proc_t, 0);
+            ++proc_t;
+        }
+
+        // 只有本端不校验并且对端接受不带hash的帧时才跳过hash
+        node_msg_test_check_skip_hash(node_parent, node_child->get_id(), parent_skip);
+        node_msg_test_check_skip_hash(node_child, node_parent->get_id(), child_skip);
+
+        node_child->set_on_recv_handle(node_msg_test_recv_msg_test_record_fn);
+        node_parent->set_on_recv_handle(node_msg_test_recv_msg_test_record_fn);
+
+        // 跳过hash的帧对端也能正常收到
+        {
+            std::string send_data;
+            send_data.assign("parent to child\0hello world!\n", sizeof("parent to child\0hello world!\n") - 1);
+
+            int count = recv_msg_history.count;
+            node_parent->send_data(node_child->get_id(), 0, send_data.data(), send_data.size());
+            UNITTEST_WAIT_UNTIL(conf.ev_loop, count != recv_msg_history.count, 3000, 0) {}
+
+            CASE_EXPECT_EQ(send_data, recv_msg_history.data);
+        }
+
+        {
+            std::string send_data;
+            send_data.assign("child to parent\0hello world!\n", sizeof("child to parent\0hello world!\n") - 1);
+
+            int count = recv_msg_history.count;
+            node_child->send_data(node_parent->get_id(), 0, send_data.data(), send_data.size());
+            UNITTEST_WAIT_UNTIL(conf.ev_loop, count != recv_msg_history.count, 3000, 0) {}
+
+            CASE_EXPECT_EQ(send_data, recv_msg_history.data);
+        }
+    }
+
+    unit_test_setup_exit(&ev_loop);
+}
+
+// tcp连接的帧hash协商
+CASE_TEST(atbus_node_msg, frame_hash_negotiation) {
+    node_msg_test_frame_hash_run(atbus::channel::io_stream_hash_mode_t::EN_HM_OFF, atbus::channel::io_stream_hash_mode_t::EN_HM_REQUIRED,
+                                 false, false);
+    node_msg_test_frame_hash_run(atbus::channel::io_stream_hash_mode_t::EN_HM_OFF, atbus::channel::io_stream_hash_mode_t::EN_HM_OPTIONAL,
+                                 true, false);
+    node_msg_test_frame_hash_run(atbus::channel::io_stream_hash_mode_t::EN_HM_REQUIRED, atbus::channel::io_stream_hash_mode_t::EN_HM_OFF,
+                                 false, false);
+    node_msg_test_frame_hash_run(atbus::channel::io_stream_hash_mode_t::EN_HM_OFF, atbus::channel::io_stream_hash_mode_t::EN_HM_OFF, true,
+                                 true);
+}
+
+// tcp连接的读写分到io线程里
+CASE_TEST(atbus_node_msg, parent_and_child_io_workers) {
+    atbus::node::conf_t conf;
+    atbus::node::default_conf(&conf);
+    conf.children_mask = 16;
+    conf.io_worker_count = 2;
+    uv_loop_t ev_loop;
+    uv_loop_init(&ev_loop);
+
+    conf.ev_loop = &ev_loop;
+
+    {
+        atbus::node::ptr_t node_parent = atbus::node::create();
+        atbus::node::ptr_t node_child = atbus::node::create();
+        node_parent->on_debug = node_msg_test_on_debug;
+        node_child->on_debug = node_msg_test_on_debug;
+        node_parent->set_on_error_handle(node_msg_test_on_error);
+        node_child->set_on_error_handle(node_msg_test_on_error);
+
+        node_parent->init(0x12345678, &conf);
+
+        conf.children_mask = 8;
+        conf.io_worker_count = 1;
+        conf.father_address = "ipv4://127.0.0.1:16387";
+        node_child->init(0x12346789, &conf);
+
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node_parent->listen("ipv4://127.0.0.1:16387"));
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node_child->listen("ipv4://127.0.0.1:16388"));
+
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node_parent->start());
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node_child->start());
+        CASE_EXPECT_EQ(2, atbus::channel::io_stream_workers_count(node_parent->get_iostream_workers()));
+        CASE_EXPECT_EQ(1, atbus::channel::io_stream_workers_count(node_child->get_iostream_workers()));
+
+        // 启动以后io线程里的channel不能再监听
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_ACCESS_DENY, node_parent->listen("ipv4://127.0.0.1:16389"));
+
+        time_t proc_t = time(NULL) + 1;
+
+        UNITTEST_WAIT_UNTIL(conf.ev_loop, node_child->is_endpoint_available(node_parent->get_id()) &&
+                                              node_parent->is_endpoint_available(node_child->get_id()),
+                            8000, 64) {
+            node_parent->proc(proc_t, 0);
+            node_child->proc(proc_t, 0);
+            ++proc_t;
+        }
+
+        node_child->set_on_recv_handle(node_msg_test_recv_msg_test_record_fn);
+        node_parent->set_on_recv_handle(node_msg_test_recv_msg_test_record_fn);
+
+        // 连接都不在node自己的ev_loop里读写
+        atbus::endpoint *ep = node_parent->get_endpoint(node_child->get_id());
+        CASE_EXPECT_TRUE(NULL != ep);
+        if (NULL != ep) {
+            const atbus::connection *conn = ep->get_data_connection(ep);
+            CASE_EXPECT_TRUE(NULL != conn);
+            CASE_EXPECT_TRUE(NULL != conn && !conn->check_flag(atbus::connection::flag_t::REG_FD));
+        }
+
+        // 多发几个消息，io线程按顺序转发
+        for (int i = 0; i < 16; ++i) {
+            std::string send_data;
+            send_data.assign("parent to child\0hello world!\n", sizeof("parent to child\0hello world!\n") - 1);
+            send_data.append(static_cast<size_t>(i) * 1024, static_cast<char>('a' + i));
+
+            int count = recv_msg_history.count;
+            CASE_EXPECT_EQ(0, node_parent->send_data(node_child->get_id(), 0, send_data.data(), send_data.size()));
+            UNITTEST_WAIT_UNTIL(conf.ev_loop, count != recv_msg_history.count, 3000, 0) {}
+
+            CASE_EXPECT_EQ(send_data, recv_msg_history.data);
+        }
+
+        {
+            std::string send_data;
+            send_data.assign("child to parent\0hello world!\n", sizeof("child to parent\0hello world!\n") - 1);
+
+            int count = recv_msg_history.count;
+            CASE_EXPECT_EQ(0, node_child->send_data(node_parent->get_id(), 0, send_data.data(), send_data.size()));
+            UNITTEST_WAIT_UNTIL(conf.ev_loop, count != recv_msg_history.count, 3000, 0) {}
+
+            CASE_EXPECT_EQ(send_data, recv_msg_history.data);
+        }
+
+        // 子节点关闭后父节点收到io线程的断开事件
+        node_child->reset();
+        UNITTEST_WAIT_UNTIL(conf.ev_loop, NULL == node_parent->get_endpoint(0x12346789), 8000, 64) {
+            node_parent->proc(proc_t, 0);
+            ++proc_t;
+        }
+        CASE_EXPECT_EQ(NULL, node_parent->get_endpoint(0x12346789));
+    }
+
+    unit_test_setup_exit(&ev_loop);
+}
+
 // 兄弟节点通过父节点转发消息并建立直连测试（测试路由）
 CASE_TEST(atbus_node_msg, transfer_and_connect) {
     atbus::node::conf_t conf;
@@ -636,6 +837,443 @@ CASE_TEST(atbus_node_msg, transfer_failed) {
     unit_test_setup_exit(&ev_loop);
 }
 
+static int node_msg_test_writable_count = 0;
+static const atbus::connection *node_msg_test_writable_conn = NULL;
+static int node_msg_test_on_writable_fn(const atbus::node &, const atbus::endpoint *, const atbus::connection *conn) {
+    ++node_msg_test_writable_count;
+    node_msg_test_writable_conn = conn;
+    return 0;
+}
+
+// 内存通道没有写完事件，超过高水位的连接由proc轮询，降到低水位以下时通知on_writable
+CASE_TEST(atbus_node_msg, mem_writable) {
+    atbus::node::conf_t conf;
+    atbus::node::default_conf(&conf);
+    conf.children_mask = 16;
+    conf.recv_buffer_size = 64 * 1024;
+    conf.send_high_watermark = 16 * 1024;
+    conf.send_low_watermark = 4 * 1024;
+    uv_loop_t ev_loop;
+    uv_loop_init(&ev_loop);
+
+    conf.ev_loop = &ev_loop;
+
+    char *buffer = new char[conf.recv_buffer_size];
+    memset(buffer, 0, conf.recv_buffer_size);
+
+    char addr[32] = {0};
+    UTIL_STRFUNC_SNPRINTF(addr, sizeof(addr), "mem://0x%p", buffer);
+    if (addr[8] == '0' && addr[9] == 'x') {
+        memset(addr, 0, sizeof(addr));
+        UTIL_STRFUNC_SNPRINTF(addr, sizeof(addr), "mem://%p", buffer);
+    }
+
+    {
+        atbus::node::ptr_t node = atbus::node::create();
+        node->on_debug = node_msg_test_on_debug;
+        node->set_on_error_handle(node_msg_test_on_error);
+        node->set_on_writable_handle(node_msg_test_on_writable_fn);
+        node->init(0x12345678, &conf);
+
+        atbus::endpoint::ptr_t ep = atbus::endpoint::create(node.get(), 0x12345679, 8, node->get_pid(), node->get_hostname());
+        atbus::connection::ptr_t conn = atbus::connection::create(node.get());
+        CASE_EXPECT_EQ(0, conn->connect(addr));
+        CASE_EXPECT_TRUE(ep->add_connection(conn.get(), false));
+        CASE_EXPECT_EQ(0, node->add_endpoint(ep));
+        CASE_EXPECT_TRUE(conn->is_connected());
+
+        atbus::channel::mem_channel *channel = NULL;
+        CASE_EXPECT_EQ(0, atbus::channel::mem_attach(buffer, conf.recv_buffer_size, &channel, NULL));
+
+        char data[1000];
+        memset(data, 'w', sizeof(data));
+        char recv_data[4096];
+        size_t recv_size = 0;
+        time_t proc_t = time(NULL);
+        node_msg_test_writable_count = 0;
+        node_msg_test_writable_conn = NULL;
+
+        for (int round = 0; round < 2; ++round) {
+            // 写到高水位，之前都是可写的
+            for (int i = 0; i < 64 && !conn->check_flag(atbus::connection::flag_t::WRITE_BLOCKED); ++i) {
+                CASE_EXPECT_LT(conn->get_send_queue_bytes(), conf.send_high_watermark);
+                CASE_EXPECT_EQ(0, conn->push(data, sizeof(data)));
+            }
+            CASE_EXPECT_TRUE(conn->check_flag(atbus::connection::flag_t::WRITE_BLOCKED));
+            CASE_EXPECT_GE(conn->get_send_queue_bytes(), conf.send_high_watermark);
+            CASE_EXPECT_EQ(conn->get_send_queue_bytes(), node->get_send_queue_bytes(ep->get_id()));
+
+            // 没有降到低水位时proc不会通知
+            CASE_EXPECT_FALSE(conn->check_writable());
+            node->proc(++proc_t, 0);
+            CASE_EXPECT_EQ(round, node_msg_test_writable_count);
+
+            // 接收端读到高低水位之间仍然不可写
+            while (conn->get_send_queue_bytes() >= (conf.send_high_watermark + conf.send_low_watermark) / 2) {
+                CASE_EXPECT_EQ(0, atbus::channel::mem_recv(channel, recv_data, sizeof(recv_data), &recv_size));
+            }
+            node->proc(++proc_t, 0);
+            CASE_EXPECT_EQ(round, node_msg_test_writable_count);
+            CASE_EXPECT_TRUE(conn->check_flag(atbus::connection::flag_t::WRITE_BLOCKED));
+
+            // 降到低水位以下后由proc里的轮询通知一次
+            while (conn->get_send_queue_bytes() > conf.send_low_watermark) {
+                CASE_EXPECT_EQ(0, atbus::channel::mem_recv(channel, recv_data, sizeof(recv_data), &recv_size));
+            }
+            node->proc(++proc_t, 0);
+            CASE_EXPECT_EQ(round + 1, node_msg_test_writable_count);
+            CASE_EXPECT_EQ(conn.get(), node_msg_test_writable_conn);
+            CASE_EXPECT_FALSE(conn->check_flag(atbus::connection::flag_t::WRITE_BLOCKED));
+
+            // 已经从轮询列表里移除，不会重复通知
+            node->proc(++proc_t, 0);
+            CASE_EXPECT_EQ(round + 1, node_msg_test_writable_count);
+        }
+
+        // 读完以后发送队列为空，找不到的节点也返回0
+        while (EN_ATBUS_ERR_NO_DATA != atbus::channel::mem_recv(channel, recv_data, sizeof(recv_data), &recv_size)) {
+        }
+        CASE_EXPECT_EQ(0, node->get_send_queue_bytes(ep->get_id()));
+        CASE_EXPECT_EQ(0, node->get_send_queue_bytes(0x12345680));
+    }
+
+    unit_test_setup_exit(&ev_loop);
+    delete[] buffer;
+}
+
+static atbus::node *node_msg_test_nested_node = NULL;
+static int node_msg_test_nested_recv_count = 0;
+static int node_msg_test_nested_proc_ret = -1;
+static int node_msg_test_nested_proc_fn(const atbus::node &, const atbus::endpoint *, const atbus::connection *,
+                                        const atbus::protocol::msg_head *, const void *, size_t) {
+    ++node_msg_test_nested_recv_count;
+
+    // 回调里再次调用proc，不能再收到同一批还没释放的消息
+    if (NULL != node_msg_test_nested_node) {
+        atbus::node *n = node_msg_test_nested_node;
+        node_msg_test_nested_node = NULL;
+        node_msg_test_nested_proc_ret = n->proc(time(NULL), 0);
+    }
+    return 0;
+}
+
+// 内存通道批量收到的消息在回调里嵌套proc时只分发一次
+CASE_TEST(atbus_node_msg, mem_nested_proc) {
+    atbus::node::conf_t conf;
+    atbus::node::default_conf(&conf);
+    conf.children_mask = 16;
+    conf.recv_buffer_size = 64 * 1024;
+    uv_loop_t ev_loop;
+    uv_loop_init(&ev_loop);
+
+    conf.ev_loop = &ev_loop;
+
+    char *buffer = new char[conf.recv_buffer_size];
+    memset(buffer, 0, conf.recv_buffer_size);
+
+    char addr[32] = {0};
+    UTIL_STRFUNC_SNPRINTF(addr, sizeof(addr), "mem://0x%p", buffer);
+    if (addr[8] == '0' && addr[9] == 'x') {
+        memset(addr, 0, sizeof(addr));
+        UTIL_STRFUNC_SNPRINTF(addr, sizeof(addr), "mem://%p", buffer);
+    }
+
+    {
+        atbus::node::ptr_t node = atbus::node::create();
+        node->on_debug = node_msg_test_on_debug;
+        node->set_on_error_handle(node_msg_test_on_error);
+        node->set_on_recv_handle(node_msg_test_nested_proc_fn);
+        node->init(0x12345678, &conf);
+
+        // 监听的内存通道会注册到node的proc列表里
+        atbus::connection::ptr_t conn = atbus::connection::create(node.get());
+        CASE_EXPECT_EQ(0, conn->listen(addr));
+
+        atbus::channel::mem_channel *channel = NULL;
+        CASE_EXPECT_EQ(0, atbus::channel::mem_attach(buffer, conf.recv_buffer_size, &channel, NULL));
+
+        std::string send_data = "nested proc";
+        atbus::protocol::msg m;
+        m.init(0x12345679, ATBUS_CMD_DATA_TRANSFORM_REQ, 0, 0, 1);
+        m.body.make_forward(0x12345679, node->get_id(), send_data.data(), send_data.size());
+        msgpack::sbuffer buf;
+        atbus::protocol::fixed_data_msg::pack(buf, m);
+
+        const int send_count = 8;
+        for (int i = 0; i < send_count; ++i) {
+            CASE_EXPECT_EQ(0, atbus::channel::mem_send(channel, buf.data(), buf.size()));
+        }
+
+        node_msg_test_nested_node = node.get();
+        node_msg_test_nested_recv_count = 0;
+        node_msg_test_nested_proc_ret = -1;
+        CASE_EXPECT_EQ(send_count, atbus::connection::mem_proc_fn(*node, *conn, 0, 0));
+        CASE_EXPECT_EQ(send_count, node_msg_test_nested_recv_count);
+        CASE_EXPECT_EQ(0, node_msg_test_nested_proc_ret);
+
+        // 外层释放了整批消息，通道里已经没有数据
+        CASE_EXPECT_EQ(0, atbus::connection::mem_proc_fn(*node, *conn, 0, 0));
+        CASE_EXPECT_EQ(send_count, node_msg_test_nested_recv_count);
+    }
+
+    unit_test_setup_exit(&ev_loop);
+    delete[] buffer;
+}
+
+#ifdef ATBUS_CHANNEL_SHM_POSIX
+static atbus::connection *node_msg_test_reset_conn = NULL;
+static std::string node_msg_test_reset_data;
+static int node_msg_test_reset_recv_count = 0;
+static int node_msg_test_reset_in_recv_fn(const atbus::node &, const atbus::endpoint *, const atbus::connection *,
+                                          const atbus::protocol::msg_head *, const void *buffer, size_t len) {
+    ++node_msg_test_reset_recv_count;
+
+    // 回调里重置连接以后数据还指向共享内存，要等proc结束才能解除映射
+    if (NULL != node_msg_test_reset_conn) {
+        node_msg_test_reset_conn->reset();
+        node_msg_test_reset_conn = NULL;
+    }
+
+    node_msg_test_reset_data.assign(reinterpret_cast<const char *>(buffer), len);
+    return 0;
+}
+
+// 共享内存通道的消息直接在通道内存里解包，回调里断开连接不能影响正在分发的消息
+CASE_TEST(atbus_node_msg, shm_reset_in_recv) {
+    atbus::node::conf_t conf;
+    atbus::node::default_conf(&conf);
+    conf.children_mask = 16;
+    conf.recv_buffer_size = 64 * 1024;
+    uv_loop_t ev_loop;
+    uv_loop_init(&ev_loop);
+
+    conf.ev_loop = &ev_loop;
+
+    const char *shm_name = "atbus_node_msg_shm_reset";
+    atbus::channel::shm_posix_unlink(shm_name);
+    std::string addr = "shm+posix://";
+    addr += shm_name;
+
+    {
+        atbus::node::ptr_t node = atbus::node::create();
+        node->on_debug = node_msg_test_on_debug;
+        node->set_on_error_handle(node_msg_test_on_error);
+        node->set_on_recv_handle(node_msg_test_reset_in_recv_fn);
+        node->init(0x12345678, &conf);
+
+        atbus::connection::ptr_t conn = atbus::connection::create(node.get());
+        CASE_EXPECT_EQ(0, conn->listen(addr.c_str()));
+
+        atbus::channel::shm_channel *channel = NULL;
+        CASE_EXPECT_EQ(0, atbus::channel::shm_posix_attach(shm_name, conf.recv_buffer_size, &channel, NULL, 0));
+
+        std::string send_data = "reset in recv";
+        atbus::protocol::msg m;
+        m.init(0x12345679, ATBUS_CMD_DATA_TRANSFORM_REQ, 0, 0, 1);
+        m.body.make_forward(0x12345679, node->get_id(), send_data.data(), send_data.size());
+        msgpack::sbuffer buf;
+        atbus::protocol::fixed_data_msg::pack(buf, m);
+
+        for (int i = 0; i < 4; ++i) {
+            CASE_EXPECT_EQ(0, atbus::channel::shm_send(channel, buf.data(), buf.size()));
+        }
+
+        // 重置以后通道被释放，test里attach的映射也跟着失效，不能再使用channel
+        node_msg_test_reset_conn = conn.get();
+        node_msg_test_reset_recv_count = 0;
+        node_msg_test_reset_data.clear();
+        CASE_EXPECT_EQ(1, node->proc(time(NULL), 0));
+        CASE_EXPECT_EQ(1, node_msg_test_reset_recv_count);
+        CASE_EXPECT_EQ(send_data, node_msg_test_reset_data);
+        CASE_EXPECT_EQ(atbus::connection::state_t::DISCONNECTED, conn->get_status());
+
+        // proc结束以后可以重新监听，已经分发过的消息不会再收到
+        CASE_EXPECT_EQ(0, conn->listen(addr.c_str()));
+        CASE_EXPECT_EQ(3, node->proc(time(NULL), 0));
+        CASE_EXPECT_EQ(4, node_msg_test_reset_recv_count);
+    }
+
+    unit_test_setup_exit(&ev_loop);
+    atbus::channel::shm_posix_unlink(shm_name);
+}
+#endif
+
+// 定长格式的数据转发消息打包和解包
+CASE_TEST(atbus_node_msg, fixed_data_msg) {
+    std::string send_data = "fixed data message";
+    atbus::protocol::msg m;
+    m.init(0x12345678, ATBUS_CMD_DATA_TRANSFORM_REQ, 123, -2, 0x87654321);
+    m.body.make_forward(0x12345678, 0xFEDCBA9876543210ULL, send_data.data(), send_data.size());
+    m.body.forward->router.push_back(0x12345678);
+    m.body.forward->router.push_back(0x12346789);
+    m.body.forward->set_flag(atbus::protocol::forward_data::FLAG_REQUIRE_RSP);
+
+    CASE_EXPECT_TRUE(atbus::protocol::fixed_data_msg::is_supported(m));
+    msgpack::sbuffer fixed_buf;
+    atbus::protocol::fixed_data_msg::pack(fixed_buf, m);
+    CASE_EXPECT_EQ(atbus::protocol::fixed_data_msg::packed_size(m), fixed_buf.size());
+    CASE_EXPECT_TRUE(atbus::protocol::fixed_data_msg::is_fixed(fixed_buf.data(), fixed_buf.size()));
+
+    {
+        atbus::protocol::msg res;
+        CASE_EXPECT_TRUE(atbus::protocol::fixed_data_msg::unpack(res, fixed_buf.data(), fixed_buf.size()));
+        CASE_EXPECT_EQ(m.head.cmd, res.head.cmd);
+        CASE_EXPECT_EQ(m.head.type, res.head.type);
+        CASE_EXPECT_EQ(m.head.ret, res.head.ret);
+        CASE_EXPECT_EQ(m.head.sequence, res.head.sequence);
+        CASE_EXPECT_EQ(m.head.src_bus_id, res.head.src_bus_id);
+        CASE_EXPECT_TRUE(NULL != res.body.forward);
+        if (NULL != res.body.forward) {
+            CASE_EXPECT_EQ(m.body.forward->from, res.body.forward->from);
+            CASE_EXPECT_EQ(m.body.forward->to, res.body.forward->to);
+            CASE_EXPECT_TRUE(m.body.forward->router == res.body.forward->router);
+            CASE_EXPECT_TRUE(res.body.forward->check_flag(atbus::protocol::forward_data::FLAG_REQUIRE_RSP));
+            CASE_EXPECT_EQ(send_data,
+                           std::string(reinterpret_cast<const char *>(res.body.forward->content.ptr), res.body.forward->content.size));
+        }
+    }
+
+    // 截断的数据和未知版本不能解包
+    {
+        atbus::protocol::msg res;
+        CASE_EXPECT_FALSE(atbus::protocol::fixed_data_msg::unpack(res, fixed_buf.data(), atbus::protocol::fixed_data_msg::HEAD_SIZE - 1));
+        CASE_EXPECT_FALSE(
+            atbus::protocol::fixed_data_msg::unpack(res, fixed_buf.data(), atbus::protocol::fixed_data_msg::HEAD_SIZE + 8));
+
+        std::string bad_version(fixed_buf.data(), fixed_buf.size());
+        bad_version[1] = 2;
+        CASE_EXPECT_FALSE(atbus::protocol::fixed_data_msg::unpack(res, bad_version.data(), bad_version.size()));
+    }
+
+    // msgpack格式的消息首字节不会和定长格式冲突
+    msgpack::sbuffer msgpack_buf;
+    msgpack::pack(msgpack_buf, m);
+    CASE_EXPECT_FALSE(atbus::protocol::fixed_data_msg::is_fixed(msgpack_buf.data(), msgpack_buf.size()));
+
+    atbus::protocol::msg ping;
+    ping.init(0x12345678, ATBUS_CMD_NODE_PING, 0, 0, 1);
+    ping.body.make_body(ping.body.ping);
+    CASE_EXPECT_FALSE(atbus::protocol::fixed_data_msg::is_supported(ping));
+}
+
+// 下一跳缓存测试，加入更快的连接或者连接断开以后不能再用缓存的连接
+CASE_TEST(atbus_node_msg, route_cache) {
+    atbus::node::conf_t conf;
+    atbus::node::default_conf(&conf);
+    conf.children_mask = 16;
+    uv_loop_t ev_loop;
+    uv_loop_init(&ev_loop);
+
+    conf.ev_loop = &ev_loop;
+
+    char *buffer = new char[conf.recv_buffer_size];
+    memset(buffer, 0, conf.recv_buffer_size);
+
+    char addr[32] = {0};
+    UTIL_STRFUNC_SNPRINTF(addr, sizeof(addr), "mem://0x%p", buffer);
+    if (addr[8] == '0' && addr[9] == 'x') {
+        memset(addr, 0, sizeof(addr));
+        UTIL_STRFUNC_SNPRINTF(addr, sizeof(addr), "mem://%p", buffer);
+    }
+
+    {
+        atbus::node::ptr_t node_parent = atbus::node::create();
+        atbus::node::ptr_t node_child = atbus::node::create();
+        node_parent->on_debug = node_msg_test_on_debug;
+        node_child->on_debug = node_msg_test_on_debug;
+        node_parent->set_on_error_handle(node_msg_test_on_error);
+        node_child->set_on_error_handle(node_msg_test_on_error);
+
+        node_parent->init(0x12345678, &conf);
+
+        conf.children_mask = 8;
+        conf.father_address = "ipv4://127.0.0.1:16387";
+        node_child->init(0x12346789, &conf);
+
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node_parent->listen("ipv4://127.0.0.1:16387"));
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node_child->listen("ipv4://127.0.0.1:16388"));
+
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node_parent->start());
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node_child->start());
+
+        time_t proc_t = time(NULL) + 1;
+
+        UNITTEST_WAIT_UNTIL(conf.ev_loop, node_child->is_endpoint_available(node_parent->get_id()) &&
+                                              node_parent->is_endpoint_available(node_child->get_id()),
+                            8000, 64) {
+            node_parent->proc(proc_t, 0);
+            node_child->proc(proc_t, 0);
+            ++proc_t;
+        }
+
+        node_child->set_on_recv_handle(node_msg_test_recv_msg_test_record_fn);
+
+        std::string send_data;
+        send_data.assign("route cache\0hello world!\n", sizeof("route cache\0hello world!\n") - 1);
+
+        // 第一次发送查找并写入缓存，第二次发送命中缓存，两次拿到的连接要一致
+        atbus::connection *conn_first = NULL;
+        atbus::connection *conn_second = NULL;
+        size_t hit_times = node_parent->get_stat_route_cache_hit_times();
+        uint32_t cache_version = node_parent->get_route_cache_version();
+        for (int i = 0; i < 2; ++i) {
+            atbus::protocol::msg m;
+            m.init(node_parent->get_id(), ATBUS_CMD_DATA_TRANSFORM_REQ, 0, 0, node_parent->alloc_msg_seq());
+            m.body.make_body(m.body.forward);
+            m.body.forward->from = node_parent->get_id();
+            m.body.forward->to = node_child->get_id();
+            m.body.forward->content.ptr = send_data.data();
+            m.body.forward->content.size = send_data.size();
+
+            int count = recv_msg_history.count;
+            CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS,
+                           node_parent->send_data_msg(node_child->get_id(), m, NULL, 0 == i ? &conn_first : &conn_second));
+            UNITTEST_WAIT_UNTIL(conf.ev_loop, count != recv_msg_history.count, 3000, 0) {}
+
+            CASE_EXPECT_EQ(send_data, recv_msg_history.data);
+            CASE_EXPECT_EQ(hit_times + i, node_parent->get_stat_route_cache_hit_times());
+        }
+        CASE_EXPECT_TRUE(NULL != conn_first);
+        CASE_EXPECT_EQ(conn_first, conn_second);
+        CASE_EXPECT_EQ(cache_version, node_parent->get_route_cache_version());
+
+        // 加入更快的内存通道以后缓存失效，下一次发送重新查找并选中内存通道
+        {
+            atbus::endpoint *ep_child = node_parent->get_endpoint(node_child->get_id());
+            CASE_EXPECT_TRUE(NULL != ep_child);
+
+            atbus::connection::ptr_t conn_mem = atbus::connection::create(node_parent.get());
+            CASE_EXPECT_EQ(0, conn_mem->connect(addr));
+            cache_version = node_parent->get_route_cache_version();
+            CASE_EXPECT_TRUE(ep_child->add_connection(conn_mem.get(), true));
+            CASE_EXPECT_NE(cache_version, node_parent->get_route_cache_version());
+
+            hit_times = node_parent->get_stat_route_cache_hit_times();
+            for (int i = 0; i < 2; ++i) {
+                atbus::protocol::msg m;
+                m.init(node_parent->get_id(), ATBUS_CMD_DATA_TRANSFORM_REQ, 0, 0, node_parent->alloc_msg_seq());
+                m.body.make_body(m.body.forward);
+                m.body.forward->from = node_parent->get_id();
+                m.body.forward->to = node_child->get_id();
+                m.body.forward->content.ptr = send_data.data();
+                m.body.forward->content.size = send_data.size();
+
+                atbus::connection *conn_fast = NULL;
+                CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node_parent->send_data_msg(node_child->get_id(), m, NULL, &conn_fast));
+                CASE_EXPECT_EQ(conn_mem.get(), conn_fast);
+                CASE_EXPECT_EQ(hit_times + i, node_parent->get_stat_route_cache_hit_times());
+            }
+        }
+
+        // 断开以后缓存失效
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node_parent->disconnect(node_child->get_id()));
+        CASE_EXPECT_NE(EN_ATBUS_ERR_SUCCESS, node_parent->send_data(node_child->get_id(), 0, send_data.data(), send_data.size()));
+    }
+
+    unit_test_setup_exit(&ev_loop);
+    delete[] buffer;
+}
+
 // TODO 发送给已下线兄弟节点并失败的回复通知测试（网络失败）
 
 
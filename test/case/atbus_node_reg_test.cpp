@@ -529,3 +529,154 @@ CASE_TEST(atbus_node_reg, reconnect_father_failed) {
 
     unit_test_setup_exit(&ev_loop);
 }
+
+#ifdef ATBUS_CHANNEL_SHM_POSIX
+// 同一台物理机上注册后自动使用共享内存通道
+CASE_TEST(atbus_node_reg, auto_shm) {
+    atbus::node::conf_t conf;
+    atbus::node::default_conf(&conf);
+    conf.children_mask = 16;
+    conf.flags.set(atbus::node::conf_flag_t::EN_CONF_AUTO_SHM, true);
+    uv_loop_t ev_loop;
+    uv_loop_init(&ev_loop);
+
+    conf.ev_loop = &ev_loop;
+
+    {
+        atbus::node::ptr_t node1 = atbus::node::create();
+        atbus::node::ptr_t node2 = atbus::node::create();
+        node1->on_debug = node_reg_test_on_debug;
+        node2->on_debug = node_reg_test_on_debug;
+        node1->set_on_error_handle(node_reg_test_on_error);
+        node2->set_on_error_handle(node_reg_test_on_error);
+
+        node1->init(0x12345678, &conf);
+        node2->init(0x12356789, &conf);
+
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node1->listen("ipv4://127.0.0.1:16387"));
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node2->listen("ipv4://127.0.0.1:16388"));
+
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node1->start());
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node2->start());
+        CASE_EXPECT_EQ(2, node1->get_listen_list().size());
+        CASE_EXPECT_EQ(2, node2->get_listen_list().size());
+
+        time_t proc_t = time(NULL);
+        node1->connect("ipv4://127.0.0.1:16388");
+
+        UNITTEST_WAIT_UNTIL(conf.ev_loop,
+            node1->is_endpoint_available(node2->get_id()) &&
+            node2->is_endpoint_available(node1->get_id()),
+            8000, 0) {
+        }
+
+        // 两个方向的数据通道都是共享内存通道
+        atbus::connection *conn1 = node1->get_self_endpoint()->get_data_connection(node1->get_endpoint(node2->get_id()), false);
+        atbus::connection *conn2 = node2->get_self_endpoint()->get_data_connection(node2->get_endpoint(node1->get_id()), false);
+        CASE_EXPECT_NE(NULL, conn1);
+        CASE_EXPECT_NE(NULL, conn2);
+        if (NULL != conn1 && NULL != conn2) {
+            CASE_EXPECT_TRUE(conn1->check_flag(atbus::connection::flag_t::ACCESS_SHARE_HOST));
+            CASE_EXPECT_TRUE(conn2->check_flag(atbus::connection::flag_t::ACCESS_SHARE_HOST));
+        }
+
+        std::string send_data = "hello auto shm!";
+        int count = recv_msg_history.count;
+        node2->set_on_recv_handle(node_reg_test_recv_msg_test_record_fn);
+        node1->send_data(node2->get_id(), 0, send_data.data(), send_data.size());
+
+        UNITTEST_WAIT_UNTIL(conf.ev_loop,
+            count != recv_msg_history.count,
+            8000, 64) {
+            ++proc_t;
+
+            node1->proc(proc_t, 0);
+            node2->proc(proc_t, 0);
+        }
+
+        CASE_EXPECT_EQ(send_data, recv_msg_history.data);
+        CASE_EXPECT_NE(NULL, recv_msg_history.conn);
+        if (NULL != recv_msg_history.conn) {
+            CASE_EXPECT_TRUE(recv_msg_history.conn->check_flag(atbus::connection::flag_t::ACCESS_SHARE_HOST));
+        }
+
+        node1->reset();
+        node2->reset();
+    }
+
+    unit_test_setup_exit(&ev_loop);
+}
+
+static std::string node_reg_test_get_auto_shm_name(const atbus::node &n) {
+    for (std::list<std::string>::const_iterator iter = n.get_listen_list().begin(); iter != n.get_listen_list().end(); ++iter) {
+        if (0 == UTIL_STRFUNC_STRNCASE_CMP("shm+posix://", iter->c_str(), 12)) {
+            return iter->substr(12);
+        }
+    }
+
+    return std::string();
+}
+
+// 相同ID的另一个实例启动和退出时不能删掉已有实例的共享内存通道
+CASE_TEST(atbus_node_reg, auto_shm_same_id) {
+    atbus::node::conf_t conf;
+    atbus::node::default_conf(&conf);
+    conf.children_mask = 16;
+    conf.flags.set(atbus::node::conf_flag_t::EN_CONF_AUTO_SHM, true);
+    uv_loop_t ev_loop;
+    uv_loop_init(&ev_loop);
+
+    conf.ev_loop = &ev_loop;
+
+    {
+        atbus::node::ptr_t node1 = atbus::node::create();
+        atbus::node::ptr_t node2 = atbus::node::create();
+        node1->on_debug = node_reg_test_on_debug;
+        node2->on_debug = node_reg_test_on_debug;
+        node1->set_on_error_handle(node_reg_test_on_error);
+        node2->set_on_error_handle(node_reg_test_on_error);
+        node1->set_on_recv_handle(node_reg_test_recv_msg_test_record_fn);
+
+        node1->init(0x12345678, &conf);
+        node2->init(0x12345678, &conf);
+
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node1->start());
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, node2->start());
+
+        std::string name1 = node_reg_test_get_auto_shm_name(*node1);
+        std::string name2 = node_reg_test_get_auto_shm_name(*node2);
+        CASE_EXPECT_FALSE(name1.empty());
+        CASE_EXPECT_FALSE(name2.empty());
+        CASE_EXPECT_NE(name1, name2);
+
+        // 第二个实例退出时只删除自己的通道
+        node2->reset();
+
+        atbus::channel::shm_channel *channel = NULL;
+        CASE_EXPECT_EQ(0, atbus::channel::shm_posix_attach(name1.c_str(), conf.recv_buffer_size, &channel, NULL, 0));
+        if (NULL != channel) {
+            std::string send_data = "hello same id!";
+            atbus::protocol::msg m;
+            m.init(0x12345679, ATBUS_CMD_DATA_TRANSFORM_REQ, 0, 0, 1);
+            m.body.make_forward(0x12345679, node1->get_id(), send_data.data(), send_data.size());
+            msgpack::sbuffer buf;
+            msgpack::pack(buf, m);
+
+            int count = recv_msg_history.count;
+            CASE_EXPECT_EQ(0, atbus::channel::shm_send(channel, buf.data(), buf.size()));
+
+            time_t proc_t = time(NULL);
+            UNITTEST_WAIT_UNTIL(conf.ev_loop, count != recv_msg_history.count, 3000, 64) {
+                ++proc_t;
+                node1->proc(proc_t, 0);
+            }
+
+            CASE_EXPECT_EQ(send_data, recv_msg_history.data);
+        }
+
+        node1->reset();
+    }
+
+    unit_test_setup_exit(&ev_loop);
+}
+#endif
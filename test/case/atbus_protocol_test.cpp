@@ -0,0 +1,304 @@
+﻿#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <string>
+
+#include "common/string_oprs.h"
+
+#include "detail/buffer.h"
+#include "detail/libatbus_channel_export.h"
+#include "detail/libatbus_protocol.h"
+
+#include "atbus_connection.h"
+#include "atbus_node.h"
+
+#include "std/thread.h"
+
+#include "frame/test_macros.h"
+
+// 统计operator new的调用次数，只在本线程的protocol_test_alloc_counter存在期间计数
+// 计数和开关都是线程局部的，io线程和其他用例不受影响
+// msgpack::zone的内存块直接走malloc不在统计内，zone::clear只保留第一块内存，稳定以后不会再扩展
+static THREAD_TLS bool protocol_test_alloc_enabled = false;
+static THREAD_TLS size_t protocol_test_alloc_count = 0;
+
+static void *protocol_test_alloc(std::size_t s) {
+    if (protocol_test_alloc_enabled) {
+        ++protocol_test_alloc_count;
+    }
+    return malloc(0 == s ? 1 : s);
+}
+
+void *operator new(std::size_t s) {
+    void *ret = protocol_test_alloc(s);
+    if (NULL == ret) {
+        throw std::bad_alloc();
+    }
+    return ret;
+}
+
+void *operator new[](std::size_t s) {
+    void *ret = protocol_test_alloc(s);
+    if (NULL == ret) {
+        throw std::bad_alloc();
+    }
+    return ret;
+}
+
+void *operator new(std::size_t s, const std::nothrow_t &) throw() { return protocol_test_alloc(s); }
+
+void *operator new[](std::size_t s, const std::nothrow_t &) throw() { return protocol_test_alloc(s); }
+
+void operator delete(void *p) throw() { free(p); }
+
+void operator delete[](void *p) throw() { free(p); }
+
+void operator delete(void *p, const std::nothrow_t &) throw() { free(p); }
+
+void operator delete[](void *p, const std::nothrow_t &) throw() { free(p); }
+
+class protocol_test_alloc_counter {
+public:
+    protocol_test_alloc_counter() : start_(protocol_test_alloc_count) { protocol_test_alloc_enabled = true; }
+
+    ~protocol_test_alloc_counter() { protocol_test_alloc_enabled = false; }
+
+    size_t count() const { return protocol_test_alloc_count - start_; }
+
+private:
+    size_t start_;
+};
+
+static size_t g_protocol_test_recv_count = 0;
+static size_t g_protocol_test_recv_content_count = 0;
+static const std::string g_protocol_test_send_data = "unpack with zone";
+
+static int protocol_test_on_recv(const atbus::node &, const atbus::endpoint *, const atbus::connection *,
+                                 const atbus::protocol::msg_head *, const void *buffer, size_t s) {
+    ++g_protocol_test_recv_count;
+    if (g_protocol_test_send_data.size() == s && 0 == memcmp(g_protocol_test_send_data.data(), buffer, s)) {
+        ++g_protocol_test_recv_content_count;
+    }
+    return 0;
+}
+
+// 稳定以后从内存通道和io_stream收消息都不应该再分配内存
+CASE_TEST(atbus_protocol, unpack_with_zone) {
+    atbus::node::conf_t conf;
+    atbus::node::default_conf(&conf);
+    conf.recv_buffer_size = 256 * 1024;
+
+    char *buffer = new char[conf.recv_buffer_size];
+    memset(buffer, 0, conf.recv_buffer_size);
+
+    char addr[32] = {0};
+    UTIL_STRFUNC_SNPRINTF(addr, sizeof(addr), "mem://0x%p", buffer);
+    if (addr[8] == '0' && addr[9] == 'x') {
+        memset(addr, 0, sizeof(addr));
+        UTIL_STRFUNC_SNPRINTF(addr, sizeof(addr), "mem://%p", buffer);
+    }
+
+    {
+        atbus::node::ptr_t n = atbus::node::create();
+        n->init(0x12345678, &conf);
+        n->set_on_recv_handle(protocol_test_on_recv);
+
+        // 连接内存通道，直接往通道里写消息再用mem_proc_fn收
+        atbus::connection::ptr_t conn = atbus::connection::create(n.get());
+        CASE_EXPECT_EQ(0, conn->connect(addr));
+        atbus::channel::mem_channel *channel = NULL;
+        CASE_EXPECT_EQ(0, atbus::channel::mem_attach(buffer, conf.recv_buffer_size, &channel, NULL));
+
+        // io_stream的回调只用到channel和connection上绑定的数据
+        atbus::channel::io_stream_channel ios_channel;
+        ios_channel.data = n.get();
+        ios_channel.error_code = 0;
+        atbus::channel::io_stream_connection ios_conn;
+        ios_conn.data = conn.get();
+
+        atbus::protocol::msg data;
+        data.init(0x12345679, ATBUS_CMD_DATA_TRANSFORM_REQ, 0, 0, 2);
+        data.body.make_forward(0x12345679, 0x12345678, g_protocol_test_send_data.data(), g_protocol_test_send_data.size());
+        data.body.forward->router.push_back(0x12345679);
+        data.body.forward->router.push_back(0x12340000);
+        msgpack::sbuffer data_buf;
+        msgpack::pack(data_buf, data);
+        msgpack::sbuffer fixed_buf;
+        atbus::protocol::fixed_data_msg::pack(fixed_buf, data);
+
+        std::string ios_buf[2];
+        ios_buf[0].assign(data_buf.data(), data_buf.size());
+        ios_buf[1].assign(fixed_buf.data(), fixed_buf.size());
+
+        const size_t batch_count = 64;
+        const size_t total_count = 1000000;
+        size_t alloc_count = 0;
+        size_t expect_recv_count = 0;
+        g_protocol_test_recv_count = 0;
+        g_protocol_test_recv_content_count = 0;
+        // 第一轮让zone池和通道分配好内存
+        for (size_t round = 0; round < 2; ++round) {
+            protocol_test_alloc_counter counter;
+            size_t recv_count = 0;
+            while (recv_count < (0 == round ? batch_count : total_count)) {
+                for (size_t i = 0; i < batch_count; ++i) {
+                    const msgpack::sbuffer &buf = 0 == (i & 1) ? data_buf : fixed_buf;
+                    CASE_EXPECT_EQ(0, atbus::channel::mem_send(channel, buf.data(), buf.size()));
+                }
+                CASE_EXPECT_EQ(static_cast<int>(batch_count), atbus::connection::mem_proc_fn(*n, *conn, 0, 0));
+
+                for (size_t i = 0; i < batch_count; ++i) {
+                    std::string &buf = ios_buf[i & 1];
+                    atbus::connection::iostream_on_recv_cb(&ios_channel, &ios_conn, 0, &buf[0], buf.size());
+                }
+
+                recv_count += batch_count * 2;
+            }
+
+            alloc_count = counter.count();
+            expect_recv_count += recv_count;
+        }
+
+        CASE_EXPECT_EQ(0, alloc_count);
+        CASE_EXPECT_EQ(expect_recv_count, g_protocol_test_recv_count);
+        CASE_EXPECT_EQ(g_protocol_test_recv_count, g_protocol_test_recv_content_count);
+    }
+
+    delete[] buffer;
+}
+
+// 构造和打包数据消息都不应该分配内存
+CASE_TEST(atbus_protocol, pack_with_zone) {
+    std::string send_data = "pack with zone";
+    char buffer[1024];
+    msgpack::zone z;
+
+    size_t alloc_count = 0;
+    size_t succ_count = 0;
+    protocol_test_alloc_counter *counter = NULL;
+    for (int i = 0; i < 1000001; ++i) {
+        // 第一次让zone分配好内存块
+        if (1 == i) {
+            counter = new protocol_test_alloc_counter();
+        }
+
+        {
+            atbus::protocol::msg m(&z);
+            m.init(0x12345678, ATBUS_CMD_DATA_TRANSFORM_REQ, 0, 0, static_cast<uint32_t>(i));
+            m.body.make_forward(0x12345678, 0x12345679, send_data.data(), send_data.size());
+            for (int j = 0; j < ATBUS_MACRO_ROUTER_INLINE_SIZE; ++j) {
+                m.body.forward->router.push_back(0x12345678 + j);
+            }
+
+            atbus::detail::buffer_span_writer writer(buffer, sizeof(buffer));
+            if (0 == (i & 1)) {
+                atbus::protocol::fixed_data_msg::pack(writer, m);
+                if (writer.size() == atbus::protocol::fixed_data_msg::packed_size(m)) {
+                    ++succ_count;
+                }
+            } else {
+                atbus::detail::buffer_size_counter counter;
+                msgpack::pack(counter, m);
+                msgpack::pack(writer, m);
+                if (writer.size() == counter.size()) {
+                    ++succ_count;
+                }
+            }
+        }
+        z.clear();
+    }
+
+    if (NULL != counter) {
+        alloc_count = counter->count();
+        delete counter;
+    }
+    CASE_EXPECT_EQ(0, alloc_count);
+    CASE_EXPECT_EQ(1000001, succ_count);
+}
+
+// 转发定长格式的消息时只读头部，复制时修改src_bus_id并追加路由，结果要和解包后重新打包一样
+CASE_TEST(atbus_protocol, fixed_data_relay) {
+    std::string send_data = "relay fixed data";
+    atbus::protocol::msg src;
+    src.init(0x12345678, ATBUS_CMD_DATA_TRANSFORM_REQ, 12, 0, 34);
+    src.body.make_forward(0x12345678, 0x12356789, send_data.data(), send_data.size());
+    src.body.forward->router.push_back(0x12345678);
+    src.body.forward->set_flag(atbus::protocol::forward_data::FLAG_REQUIRE_RSP);
+    msgpack::sbuffer src_buf;
+    atbus::protocol::fixed_data_msg::pack(src_buf, src);
+
+    atbus::protocol::fixed_data_msg::relay_head head;
+    CASE_EXPECT_TRUE(atbus::protocol::fixed_data_msg::unpack_relay_head(head, src_buf.data(), src_buf.size()));
+    CASE_EXPECT_EQ(ATBUS_CMD_DATA_TRANSFORM_REQ, head.cmd);
+    CASE_EXPECT_EQ(0, head.ret);
+    CASE_EXPECT_EQ(0x12345678, head.src_bus_id);
+    CASE_EXPECT_EQ(0x12356789, head.to);
+    CASE_EXPECT_EQ(1, head.router_size);
+    CASE_EXPECT_NE(0, head.flags & (1 << atbus::protocol::forward_data::FLAG_REQUIRE_RSP));
+
+    msgpack::sbuffer relay_buf;
+    atbus::protocol::fixed_data_msg::relay(relay_buf, head, src_buf.data(), src_buf.size(), 0x12340000);
+    CASE_EXPECT_EQ(atbus::protocol::fixed_data_msg::relay_size(src_buf.size()), relay_buf.size());
+
+    msgpack::zone z;
+    atbus::protocol::msg m(&z);
+    CASE_EXPECT_TRUE(atbus::protocol::unpack_msg(z, m, src_buf.data(), src_buf.size()));
+    m.body.forward->router.push_back(0x12340000);
+    m.head.src_bus_id = 0x12340000;
+
+    msgpack::sbuffer pack_buf;
+    atbus::protocol::fixed_data_msg::pack(pack_buf, m);
+    CASE_EXPECT_EQ(pack_buf.size(), relay_buf.size());
+    CASE_EXPECT_EQ(0, memcmp(pack_buf.data(), relay_buf.data(), relay_buf.size()));
+
+    // 转发后的数据还能再次转发
+    atbus::protocol::fixed_data_msg::relay_head next_head;
+    CASE_EXPECT_TRUE(atbus::protocol::fixed_data_msg::unpack_relay_head(next_head, relay_buf.data(), relay_buf.size()));
+    CASE_EXPECT_EQ(0x12340000, next_head.src_bus_id);
+    CASE_EXPECT_EQ(2, next_head.router_size);
+
+    // 格式不对或长度不足时不能直接转发
+    CASE_EXPECT_FALSE(atbus::protocol::fixed_data_msg::unpack_relay_head(head, src_buf.data(),
+                                                                         atbus::protocol::fixed_data_msg::HEAD_SIZE - 1));
+    CASE_EXPECT_FALSE(atbus::protocol::fixed_data_msg::unpack_relay_head(head, src_buf.data(), atbus::protocol::fixed_data_msg::HEAD_SIZE));
+
+    msgpack::sbuffer msgpack_buf;
+    msgpack::pack(msgpack_buf, src);
+    CASE_EXPECT_FALSE(atbus::protocol::fixed_data_msg::unpack_relay_head(head, msgpack_buf.data(), msgpack_buf.size()));
+}
+
+CASE_TEST(atbus_protocol, small_vector) {
+    typedef atbus::protocol::small_vector<int, 4> vec_t;
+    vec_t a;
+    CASE_EXPECT_TRUE(a.empty());
+    CASE_EXPECT_EQ(4, a.capacity());
+
+    // 超过内部容量以后转到堆内存，内容不变
+    for (int i = 0; i < 40; ++i) {
+        a.push_back(i);
+        a.push_back(a[0]);
+    }
+    CASE_EXPECT_EQ(80, a.size());
+    CASE_EXPECT_LE(80, a.capacity());
+    for (int i = 0; i < 40; ++i) {
+        CASE_EXPECT_EQ(i, a[i * 2]);
+        CASE_EXPECT_EQ(0, a[i * 2 + 1]);
+    }
+
+    vec_t b(a);
+    CASE_EXPECT_TRUE(a == b);
+    b.back() = 1;
+    CASE_EXPECT_TRUE(a != b);
+
+    vec_t c;
+    c.resize(3);
+    CASE_EXPECT_EQ(3, c.size());
+    CASE_EXPECT_EQ(4, c.capacity());
+    CASE_EXPECT_EQ(0, c.front());
+    CASE_EXPECT_EQ(0, c.back());
+
+    a = c;
+    CASE_EXPECT_TRUE(a == c);
+    b = vec_t();
+    CASE_EXPECT_TRUE(b.empty());
+}
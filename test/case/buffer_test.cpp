@@ -1125,3 +1125,85 @@ CASE_TEST(buffer, static_buffer_manager_merge_front)
         CHECK_BUFFER(mgr.front()->raw_data(), sr, 0xea);
     }
 }
+
+CASE_TEST(buffer, span_writer)
+{
+    char buf1[8] = {0};
+    char buf2[8] = {0};
+    const char *data = "0123456789ABCDEFXYZ";
+
+    atbus::detail::buffer_size_counter counter;
+    counter.write(data, 5);
+    counter.write(data, 11);
+    CASE_EXPECT_EQ(16, counter.size());
+
+    atbus::detail::buffer_span_writer writer(buf1, sizeof(buf1), buf2, sizeof(buf2));
+    CASE_EXPECT_EQ(16, writer.capacity());
+
+    writer.write(data, 5);
+    writer.write(data + 5, 6);
+    CASE_EXPECT_EQ(11, writer.size());
+    CASE_EXPECT_EQ(0, memcmp(buf1, data, 8));
+    CASE_EXPECT_EQ(0, memcmp(buf2, data + 8, 3));
+
+    // 超出的部分会被丢弃
+    writer.write(data + 11, 8);
+    CASE_EXPECT_EQ(16, writer.size());
+    CASE_EXPECT_EQ(0, memcmp(buf2, data + 8, 8));
+
+    writer.reset(buf2, sizeof(buf2));
+    CASE_EXPECT_EQ(0, writer.size());
+    CASE_EXPECT_EQ(8, writer.capacity());
+    writer.write(data + 2, 3);
+    CASE_EXPECT_EQ(0, memcmp(buf2, data + 2, 3));
+}
+
+CASE_TEST(buffer, buffer_manager_front_blocks)
+{
+    // 动态模式和静态模式(包含环形回绕)都应该按顺序取出头部的数据块
+    for (int mode = 0; mode < 2; ++mode) {
+        atbus::detail::buffer_manager mgr;
+        if (1 == mode) {
+            mgr.set_mode(1023, 10);
+        }
+
+        atbus::detail::buffer_block *blocks[8];
+        CASE_EXPECT_EQ(0, mgr.front_blocks(blocks, 8));
+
+        void *pointer;
+        size_t s = 200 - atbus::detail::buffer_block::head_size(200);
+        for (int i = 0; i < 5; ++i) {
+            CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, mgr.push_back(pointer, s));
+            CASE_EXPECT_NE(NULL, pointer);
+            if (NULL != pointer) {
+                memset(pointer, i, s);
+            }
+        }
+
+        // 释放头部空间后再插入，静态模式下新块会回绕到缓冲区头部
+        mgr.pop_front(s);
+        mgr.pop_front(s);
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SUCCESS, mgr.push_back(pointer, s));
+        CASE_EXPECT_NE(NULL, pointer);
+        if (NULL != pointer) {
+            memset(pointer, 5, s);
+        }
+        if (1 == mode) {
+            CASE_EXPECT_TRUE(mgr.back() < mgr.front());
+        }
+
+        CASE_EXPECT_EQ(2, mgr.front_blocks(blocks, 2));
+        CASE_EXPECT_EQ(mgr.front(), blocks[0]);
+
+        size_t n = mgr.front_blocks(blocks, 8);
+        CASE_EXPECT_EQ(4, n);
+        CASE_EXPECT_EQ(mgr.front(), blocks[0]);
+        CASE_EXPECT_EQ(mgr.back(), blocks[n - 1]);
+        for (size_t j = 0; j < n; ++j) {
+            CHECK_BUFFER(blocks[j]->raw_data(), blocks[j]->raw_size(), j + 2);
+        }
+
+        // 不会移除数据块
+        CASE_EXPECT_EQ(4, mgr.limit().cost_number_);
+    }
+}
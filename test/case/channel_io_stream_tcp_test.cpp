@@ -1,5 +1,6 @@
 ﻿#include <iostream>
 #include <fstream>
+#include <algorithm>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -8,9 +9,14 @@
 #include <memory>
 #include <chrono>
 #include <functional>
+#include <vector>
 
 #include <detail/libatbus_error.h>
+#include "algorithm/murmur_hash.h"
+#include "detail/buffer.h"
+#include "detail/io_uring.h"
 #include "detail/libatbus_channel_export.h"
+#include "detail/lz4.h"
 #include "frame/test_macros.h"
 
 static const size_t MAX_TEST_BUFFER_LEN = 1024 * 256;
@@ -18,6 +24,24 @@ static int g_check_flag = 0;
 static std::pair<size_t, size_t> g_recv_rec = std::make_pair(0, 0);
 static std::list<std::pair<size_t, size_t> > g_check_buff_sequence;
 
+// 用例在libuv和io_uring两种收发方式下各跑一次
+static void io_stream_test_init_conf(atbus::channel::io_stream_conf &conf, bool is_io_uring) {
+    atbus::channel::io_stream_init_configure(&conf);
+    conf.is_io_uring = is_io_uring;
+}
+
+// 开启了io_uring并且内核支持时必须真的用上io_uring，否则必须回退到libuv
+static void io_stream_test_check_uring(const atbus::channel::io_stream_channel &channel, bool is_io_uring) {
+    bool expect_uring = false;
+#ifdef ATBUS_CHANNEL_IO_URING
+    if (is_io_uring) {
+        atbus::detail::io_uring_ring ring;
+        expect_uring = 0 == ring.init(8);
+    }
+#endif
+    CASE_EXPECT_EQ(expect_uring, NULL != channel.uring);
+}
+
 static void disconnected_callback_test_fn(
     atbus::channel::io_stream_channel* channel,         // 事件触发的channel
     atbus::channel::io_stream_connection* connection,   // 事件触发的连接
@@ -176,14 +200,17 @@ static void recv_callback_check_fn(
     ++g_check_flag;
 }
 
-CASE_TEST(channel, io_stream_tcp_basic)
+static void io_stream_tcp_basic_run(bool is_io_uring)
 {
     atbus::adapter::loop_t loop;
     uv_loop_init(&loop);
 
+    atbus::channel::io_stream_conf conf;
+    io_stream_test_init_conf(conf, is_io_uring);
+
     atbus::channel::io_stream_channel svr, cli;
-    atbus::channel::io_stream_init(&svr, &loop, NULL);
-    atbus::channel::io_stream_init(&cli, &loop, NULL);
+    atbus::channel::io_stream_init(&svr, &loop, &conf);
+    atbus::channel::io_stream_init(&cli, &loop, &conf);
     CASE_EXPECT_EQ(&loop, svr.ev_loop);
     CASE_EXPECT_EQ(&loop, cli.ev_loop);
 
@@ -258,6 +285,451 @@ CASE_TEST(channel, io_stream_tcp_basic)
         CASE_MSG_INFO() << "recv " << g_recv_rec.second << " bytes data with " << g_recv_rec.first << " packages and checked done." << std::endl;
     }
 
+    io_stream_test_check_uring(svr, is_io_uring);
+    atbus::channel::io_stream_close(&svr);
+    atbus::channel::io_stream_close(&cli);
+    CASE_EXPECT_EQ(0, svr.conn_pool.size());
+    CASE_EXPECT_EQ(0, cli.conn_pool.size());
+
+    uv_loop_close(&loop);
+}
+
+CASE_TEST(channel, io_stream_tcp_basic) { io_stream_tcp_basic_run(false); }
+
+CASE_TEST(channel, io_stream_tcp_basic_io_uring) { io_stream_tcp_basic_run(true); }
+
+
+// 使用io_uring收发，内核不支持时回退到libuv，结果应该一致
+CASE_TEST(channel, io_stream_tcp_io_uring)
+{
+    atbus::channel::io_stream_conf conf;
+    atbus::channel::io_stream_init_configure(&conf);
+    conf.is_io_uring = true;
+
+    atbus::channel::io_stream_channel svr, cli;
+    atbus::channel::io_stream_init(&svr, NULL, &conf);
+    atbus::channel::io_stream_init(&cli, NULL, &conf);
+
+    g_check_flag = 0;
+
+    int inited_fds = 0;
+    inited_fds += setup_channel(svr, "ipv4://127.0.0.1:16390", NULL);
+    CASE_EXPECT_EQ(1, g_check_flag);
+    if (0 == inited_fds) {
+        atbus::channel::io_stream_close(&svr);
+        atbus::channel::io_stream_close(&cli);
+        return;
+    }
+
+    inited_fds = 0;
+    inited_fds += setup_channel(cli, NULL, "ipv4://127.0.0.1:16390");
+    inited_fds += setup_channel(cli, NULL, "ipv4://127.0.0.1:16390");
+
+    int check_flag = g_check_flag;
+    while (g_check_flag - check_flag < 2 * inited_fds) {
+        atbus::channel::io_stream_run(&svr, atbus::adapter::RUN_NOWAIT);
+        atbus::channel::io_stream_run(&cli, atbus::adapter::RUN_NOWAIT);
+    }
+    io_stream_test_check_uring(svr, true);
+    io_stream_test_check_uring(cli, true);
+
+    svr.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_RECVED] = recv_callback_check_fn;
+    cli.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_RECVED] = recv_callback_check_fn;
+    char* buf = get_test_buffer();
+
+    // 小数据包和大数据包交替，覆盖head缓冲区和大数据包缓冲区两种接收方式，以及一次写多个数据块
+    check_flag = g_check_flag;
+    g_recv_rec = std::make_pair(0, 0);
+    size_t sum_size = 0;
+    for (int i = 0; i < 500; ++ i) {
+        size_t s = static_cast<size_t>(rand() % 2048);
+        size_t l = (i % 5 == 0) ? static_cast<size_t>(rand() % 10240) + 20 * 1024 : static_cast<size_t>(rand() % 200) + 1;
+        int res = atbus::channel::io_stream_send(cli.conn_pool.begin()->second.get(), buf + s, l);
+        CASE_EXPECT_EQ(0, res);
+        g_check_buff_sequence.push_back(std::make_pair(s, l));
+        sum_size += l;
+    }
+
+    while (g_check_flag - check_flag < 500) {
+        atbus::channel::io_stream_run(&svr, atbus::adapter::RUN_NOWAIT);
+        atbus::channel::io_stream_run(&cli, atbus::adapter::RUN_NOWAIT);
+    }
+    CASE_EXPECT_EQ(sum_size, g_recv_rec.second);
+
+    // 客户端主动断开，服务器要能收到断开事件
+    check_flag = g_check_flag;
+    svr.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_DISCONNECTED] = disconnected_callback_test_fn;
+    atbus::channel::io_stream_disconnect(&cli, cli.conn_pool.begin()->second.get(), NULL);
+    while (g_check_flag - check_flag < 1) {
+        atbus::channel::io_stream_run(&svr, atbus::adapter::RUN_NOWAIT);
+        atbus::channel::io_stream_run(&cli, atbus::adapter::RUN_NOWAIT);
+    }
+
+    atbus::channel::io_stream_close(&cli);
+    atbus::channel::io_stream_close(&svr);
+    CASE_EXPECT_EQ(0, svr.conn_pool.size());
+    CASE_EXPECT_EQ(0, cli.conn_pool.size());
+    CASE_EXPECT_EQ(NULL, svr.uring);
+}
+
+static std::vector<char> g_compress_test_buffer;
+static int g_compress_bad_data_count = 0;
+static void recv_compress_check_fn(atbus::channel::io_stream_channel *channel, atbus::channel::io_stream_connection *connection,
+                                   int status, void *input, size_t s) {
+    if (status < 0) {
+        // 要求校验的连接收到不带hash的帧
+        if (EN_ATBUS_ERR_BAD_DATA == status) {
+            ++g_compress_bad_data_count;
+            ++g_check_flag;
+        }
+        return;
+    }
+
+    CASE_EXPECT_EQ(0, channel->error_code);
+    CASE_EXPECT_FALSE(g_check_buff_sequence.empty());
+    if (g_check_buff_sequence.empty()) {
+        return;
+    }
+
+    ++g_recv_rec.first;
+    g_recv_rec.second += s;
+
+    CASE_EXPECT_EQ(s, g_check_buff_sequence.front().second);
+    if (s == g_check_buff_sequence.front().second) {
+        CASE_EXPECT_EQ(0, memcmp(&g_compress_test_buffer[g_check_buff_sequence.front().first], input, s));
+    }
+    g_check_buff_sequence.pop_front();
+
+    ++g_check_flag;
+}
+
+// 开启压缩的连接，可压缩的数据以压缩帧发送，不可压缩的和低于阈值的按原样发送
+static void io_stream_tcp_compress_run(bool is_io_uring)
+{
+    atbus::adapter::loop_t loop;
+    uv_loop_init(&loop);
+
+    atbus::channel::io_stream_conf conf;
+    io_stream_test_init_conf(conf, is_io_uring);
+
+    atbus::channel::io_stream_channel svr, cli;
+    atbus::channel::io_stream_init(&svr, &loop, &conf);
+    atbus::channel::io_stream_init(&cli, &loop, &conf);
+
+    g_check_flag = 0;
+
+    int inited_fds = 0;
+    inited_fds += setup_channel(svr, "ipv4://127.0.0.1:16391", NULL);
+    CASE_EXPECT_EQ(1, g_check_flag);
+    if (0 == inited_fds) {
+        atbus::channel::io_stream_close(&svr);
+        atbus::channel::io_stream_close(&cli);
+        uv_loop_close(&loop);
+        return;
+    }
+
+    inited_fds = setup_channel(cli, NULL, "ipv4://127.0.0.1:16391");
+    int check_flag = g_check_flag;
+    while (g_check_flag - check_flag < 2 * inited_fds) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+
+    // 前一半是重复度很高的文本，后一半是随机字母
+    if (g_compress_test_buffer.empty()) {
+        g_compress_test_buffer.resize(MAX_TEST_BUFFER_LEN);
+        for (size_t i = 0; i < MAX_TEST_BUFFER_LEN / 2; i += 64) {
+            snprintf(&g_compress_test_buffer[i], 64, "{\"from\":%d,\"to\":%d,\"content\":\"hello world\"}", rand() % 16,
+                     rand() % 16);
+        }
+        memcpy(&g_compress_test_buffer[MAX_TEST_BUFFER_LEN / 2], get_test_buffer(), MAX_TEST_BUFFER_LEN / 2);
+    }
+
+    atbus::channel::io_stream_connection *svr_conn = NULL;
+    for (atbus::channel::io_stream_channel::conn_pool_t::iterator it = svr.conn_pool.begin(); it != svr.conn_pool.end(); ++it) {
+        if (it->second->addr.address != "ipv4://127.0.0.1:16391") {
+            svr_conn = it->second.get();
+        }
+    }
+    atbus::channel::io_stream_connection *cli_conn = cli.conn_pool.begin()->second.get();
+    CASE_EXPECT_NE(NULL, svr_conn);
+    if (NULL == svr_conn) {
+        atbus::channel::io_stream_close(&svr);
+        atbus::channel::io_stream_close(&cli);
+        uv_loop_close(&loop);
+        return;
+    }
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_set_compress(cli_conn, true));
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_set_compress(svr_conn, true));
+
+    svr.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_RECVED] = recv_compress_check_fn;
+    cli.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_RECVED] = recv_compress_check_fn;
+
+    // 低于阈值、能放进head缓冲区的压缩帧、需要大数据包缓冲区的压缩帧和不可压缩的数据交替
+    // 两个方向分开测试，保证接收顺序和发送顺序一致
+    // 第二轮两端都关闭校验并跳过hash，压缩帧也不带hash
+    for (int round = 0; round < 4; ++round) {
+        int dir = round & 1;
+        if (2 == round) {
+            CASE_EXPECT_EQ(0, atbus::channel::io_stream_set_hash_mode(cli_conn, atbus::channel::io_stream_hash_mode_t::EN_HM_OFF));
+            CASE_EXPECT_EQ(0, atbus::channel::io_stream_set_hash_mode(svr_conn, atbus::channel::io_stream_hash_mode_t::EN_HM_OFF));
+            CASE_EXPECT_EQ(0, atbus::channel::io_stream_set_skip_hash(cli_conn, true));
+            CASE_EXPECT_EQ(0, atbus::channel::io_stream_set_skip_hash(svr_conn, true));
+        }
+
+        check_flag = g_check_flag;
+        g_recv_rec = std::make_pair(0, 0);
+        size_t sum_size = 0;
+        for (int i = 0; i < 200; ++i) {
+            size_t s, l;
+            switch (i % 4) {
+            case 0:
+                s = static_cast<size_t>(rand() % 1024);
+                l = static_cast<size_t>(rand() % 512) + 1;
+                break;
+            case 1:
+                s = static_cast<size_t>(rand() % 1024);
+                l = static_cast<size_t>(rand() % 1024) + 2048;
+                break;
+            case 2:
+                s = static_cast<size_t>(rand() % 1024);
+                l = static_cast<size_t>(rand() % 10240) + 50 * 1024;
+                break;
+            default:
+                s = MAX_TEST_BUFFER_LEN / 2 + static_cast<size_t>(rand() % 1024);
+                l = static_cast<size_t>(rand() % 10240) + 20 * 1024;
+                break;
+            }
+
+            int res = atbus::channel::io_stream_send(0 == dir ? cli_conn : svr_conn, &g_compress_test_buffer[s], l);
+            CASE_EXPECT_EQ(0, res);
+            g_check_buff_sequence.push_back(std::make_pair(s, l));
+            sum_size += l;
+        }
+
+        while (g_check_flag - check_flag < 200) {
+            uv_run(&loop, UV_RUN_ONCE);
+        }
+        CASE_EXPECT_EQ(sum_size, g_recv_rec.second);
+    }
+
+    CASE_EXPECT_GT(cli.compress_stat.compress_times, 0);
+    CASE_EXPECT_GT(svr.compress_stat.compress_times, 0);
+    CASE_EXPECT_EQ(cli.compress_stat.compress_times, svr.compress_stat.decompress_times);
+    CASE_EXPECT_EQ(svr.compress_stat.compress_times, cli.compress_stat.decompress_times);
+    CASE_EXPECT_LT(cli.compress_stat.compress_size, cli.compress_stat.compress_origin_size);
+    CASE_MSG_INFO() << "compress " << cli.compress_stat.compress_origin_size << " bytes to " << cli.compress_stat.compress_size
+                    << " bytes, skip " << cli.compress_stat.compress_skip_times << " times, cost "
+                    << cli.compress_stat.compress_cost_ns / 1000 << "us" << std::endl;
+
+    // 要求校验的连接不接受不带hash的压缩帧
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_set_hash_mode(svr_conn, atbus::channel::io_stream_hash_mode_t::EN_HM_REQUIRED));
+    g_compress_bad_data_count = 0;
+    check_flag = g_check_flag;
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_send(cli_conn, &g_compress_test_buffer[0], 20 * 1024));
+    while (g_check_flag - check_flag < 1) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+    CASE_EXPECT_EQ(1, g_compress_bad_data_count);
+
+    io_stream_test_check_uring(svr, is_io_uring);
+    atbus::channel::io_stream_close(&svr);
+    atbus::channel::io_stream_close(&cli);
+    CASE_EXPECT_EQ(0, svr.conn_pool.size());
+    CASE_EXPECT_EQ(0, cli.conn_pool.size());
+
+    uv_loop_close(&loop);
+}
+
+CASE_TEST(channel, io_stream_tcp_compress) { io_stream_tcp_compress_run(false); }
+
+CASE_TEST(channel, io_stream_tcp_compress_io_uring) { io_stream_tcp_compress_run(true); }
+
+// 合并发送，同一轮loop里提交的数据应该用一次写操作发出
+static void io_stream_tcp_cork_run(bool is_io_uring)
+{
+    atbus::adapter::loop_t loop;
+    uv_loop_init(&loop);
+
+    atbus::channel::io_stream_conf conf;
+    io_stream_test_init_conf(conf, is_io_uring);
+    conf.is_cork = true;
+
+    atbus::channel::io_stream_channel svr, cli;
+    atbus::channel::io_stream_init(&svr, &loop, &conf);
+    atbus::channel::io_stream_init(&cli, &loop, &conf);
+
+    g_check_flag = 0;
+
+    int inited_fds = 0;
+    inited_fds += setup_channel(svr, "ipv4://127.0.0.1:16392", NULL);
+    CASE_EXPECT_EQ(1, g_check_flag);
+    if (0 == inited_fds) {
+        atbus::channel::io_stream_close(&svr);
+        atbus::channel::io_stream_close(&cli);
+        uv_loop_close(&loop);
+        return;
+    }
+
+    inited_fds = setup_channel(cli, NULL, "ipv4://127.0.0.1:16392");
+    int check_flag = g_check_flag;
+    while (g_check_flag - check_flag < 2 * inited_fds) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+
+    svr.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_RECVED] = recv_callback_check_fn;
+    char *buf = get_test_buffer();
+    atbus::channel::io_stream_connection *conn = cli.conn_pool.begin()->second.get();
+
+    // 同一轮loop里提交的小包
+    {
+        check_flag = g_check_flag;
+        for (int i = 0; i < 100; ++i) {
+            size_t s = static_cast<size_t>(rand() % 2048);
+            size_t l = static_cast<size_t>(rand() % 200) + 13;
+            CASE_EXPECT_EQ(0, atbus::channel::io_stream_send(conn, buf + s, l));
+            g_check_buff_sequence.push_back(std::make_pair(s, l));
+        }
+        CASE_EXPECT_EQ(100, conn->stat_send_times);
+        CASE_EXPECT_EQ(0, conn->stat_write_times);
+
+        while (g_check_flag - check_flag < 100) {
+            uv_run(&loop, UV_RUN_ONCE);
+        }
+        CASE_EXPECT_EQ(1, conn->stat_write_times);
+    }
+
+    // 最大延迟内跨多轮loop提交的数据也合并发送
+    {
+        cli.conf.cork_max_delay_us = 100000;
+        size_t write_times = conn->stat_write_times;
+        check_flag = g_check_flag;
+        for (int i = 0; i < 40; ++i) {
+            size_t s = static_cast<size_t>(rand() % 2048);
+            size_t l = static_cast<size_t>(rand() % 200) + 13;
+            CASE_EXPECT_EQ(0, atbus::channel::io_stream_send(conn, buf + s, l));
+            g_check_buff_sequence.push_back(std::make_pair(s, l));
+
+            if (0 == i % 10) {
+                uv_run(&loop, UV_RUN_NOWAIT);
+            }
+        }
+
+        while (g_check_flag - check_flag < 40) {
+            uv_run(&loop, UV_RUN_ONCE);
+        }
+        CASE_EXPECT_EQ(write_times + 1, conn->stat_write_times);
+        cli.conf.cork_max_delay_us = 0;
+    }
+
+    // 超过最大合并长度时立即发送
+    {
+        cli.conf.cork_max_size = 1024;
+        size_t write_times = conn->stat_write_times;
+        check_flag = g_check_flag;
+        for (int i = 0; i < 6; ++i) {
+            CASE_EXPECT_EQ(0, atbus::channel::io_stream_send(conn, buf + i * 200, 200));
+            g_check_buff_sequence.push_back(std::make_pair(i * 200, 200));
+        }
+        CASE_EXPECT_EQ(write_times + 1, conn->stat_write_times);
+
+        while (g_check_flag - check_flag < 6) {
+            uv_run(&loop, UV_RUN_ONCE);
+        }
+    }
+
+    CASE_MSG_INFO() << "send " << conn->stat_send_times << " packages with " << conn->stat_write_times << " writes." << std::endl;
+
+    io_stream_test_check_uring(svr, is_io_uring);
+    atbus::channel::io_stream_close(&svr);
+    atbus::channel::io_stream_close(&cli);
+    CASE_EXPECT_EQ(0, svr.conn_pool.size());
+    CASE_EXPECT_EQ(0, cli.conn_pool.size());
+
+    uv_loop_close(&loop);
+}
+
+CASE_TEST(channel, io_stream_tcp_cork) { io_stream_tcp_cork_run(false); }
+
+CASE_TEST(channel, io_stream_tcp_cork_io_uring) { io_stream_tcp_cork_run(true); }
+
+static int g_writable_times = 0;
+static void writable_callback_test_fn(atbus::channel::io_stream_channel *channel, atbus::channel::io_stream_connection *connection,
+                                      int status, void *input, size_t s) {
+    CASE_EXPECT_NE(NULL, channel);
+    CASE_EXPECT_NE(NULL, connection);
+    CASE_EXPECT_EQ(0, status);
+    CASE_EXPECT_LE(s, channel->conf.send_buffer_low_watermark);
+    CASE_EXPECT_FALSE(ATBUS_CHANNEL_IOS_CHECK_FLAG(connection->flags, atbus::channel::io_stream_connection::EN_CF_HIGH_WATERMARK));
+
+    ++g_writable_times;
+}
+
+static void io_stream_tcp_watermark_run(bool is_io_uring)
+{
+    atbus::adapter::loop_t loop;
+    uv_loop_init(&loop);
+
+    atbus::channel::io_stream_conf conf;
+    io_stream_test_init_conf(conf, is_io_uring);
+    conf.send_buffer_high_watermark = 4096;
+    conf.send_buffer_low_watermark = 1024;
+
+    atbus::channel::io_stream_channel svr, cli;
+    atbus::channel::io_stream_init(&svr, &loop, &conf);
+    atbus::channel::io_stream_init(&cli, &loop, &conf);
+
+    g_check_flag = 0;
+    g_writable_times = 0;
+
+    int inited_fds = 0;
+    inited_fds += setup_channel(svr, "ipv4://127.0.0.1:16393", NULL);
+    CASE_EXPECT_EQ(1, g_check_flag);
+    if (0 == inited_fds) {
+        atbus::channel::io_stream_close(&svr);
+        atbus::channel::io_stream_close(&cli);
+        uv_loop_close(&loop);
+        return;
+    }
+
+    inited_fds = setup_channel(cli, NULL, "ipv4://127.0.0.1:16393");
+    int check_flag = g_check_flag;
+    while (g_check_flag - check_flag < 2 * inited_fds) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+
+    svr.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_RECVED] = recv_callback_check_fn;
+    cli.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_WRITABLE] = writable_callback_test_fn;
+    char *buf = get_test_buffer();
+    atbus::channel::io_stream_connection *conn = cli.conn_pool.begin()->second.get();
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_get_send_queue_bytes(conn));
+
+    // 写完成之前发送的数据都会留在发送队列里
+    check_flag = g_check_flag;
+    int sended = 0;
+    while (!ATBUS_CHANNEL_IOS_CHECK_FLAG(conn->flags, atbus::channel::io_stream_connection::EN_CF_HIGH_WATERMARK)) {
+        CASE_EXPECT_EQ(0, atbus::channel::io_stream_send(conn, buf, 256));
+        g_check_buff_sequence.push_back(std::make_pair(0, 256));
+        ++sended;
+    }
+    CASE_EXPECT_GE(atbus::channel::io_stream_get_send_queue_bytes(conn), conf.send_buffer_high_watermark);
+    CASE_EXPECT_EQ(0, g_writable_times);
+
+    while (g_check_flag - check_flag < sended) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+    CASE_EXPECT_EQ(1, g_writable_times);
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_get_send_queue_bytes(conn));
+
+    // 没超过高水位时不触发
+    check_flag = g_check_flag;
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_send(conn, buf, 256));
+    g_check_buff_sequence.push_back(std::make_pair(0, 256));
+    while (g_check_flag - check_flag < 1) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+    CASE_EXPECT_EQ(1, g_writable_times);
+
+    io_stream_test_check_uring(svr, is_io_uring);
     atbus::channel::io_stream_close(&svr);
     atbus::channel::io_stream_close(&cli);
     CASE_EXPECT_EQ(0, svr.conn_pool.size());
@@ -266,13 +738,19 @@ CASE_TEST(channel, io_stream_tcp_basic)
     uv_loop_close(&loop);
 }
 
+CASE_TEST(channel, io_stream_tcp_watermark) { io_stream_tcp_watermark_run(false); }
+
+CASE_TEST(channel, io_stream_tcp_watermark_io_uring) { io_stream_tcp_watermark_run(true); }
 
 // reset by peer(client)
-CASE_TEST(channel, io_stream_tcp_reset_by_client)
+static void io_stream_tcp_reset_by_client_run(bool is_io_uring)
 {
+    atbus::channel::io_stream_conf conf;
+    io_stream_test_init_conf(conf, is_io_uring);
+
     atbus::channel::io_stream_channel svr, cli;
-    atbus::channel::io_stream_init(&svr, NULL, NULL);
-    atbus::channel::io_stream_init(&cli, NULL, NULL);
+    atbus::channel::io_stream_init(&svr, NULL, &conf);
+    atbus::channel::io_stream_init(&cli, NULL, &conf);
 
     svr.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_DISCONNECTED] = disconnected_callback_test_fn;
 
@@ -299,6 +777,7 @@ CASE_TEST(channel, io_stream_tcp_reset_by_client)
     CASE_EXPECT_NE(0, cli.conn_pool.size());
 
     check_flag = g_check_flag;
+    io_stream_test_check_uring(svr, is_io_uring);
     atbus::channel::io_stream_close(&cli);
     CASE_EXPECT_EQ(0, cli.conn_pool.size());
 
@@ -312,12 +791,19 @@ CASE_TEST(channel, io_stream_tcp_reset_by_client)
     CASE_EXPECT_EQ(0, svr.conn_pool.size());
 }
 
+CASE_TEST(channel, io_stream_tcp_reset_by_client) { io_stream_tcp_reset_by_client_run(false); }
+
+CASE_TEST(channel, io_stream_tcp_reset_by_client_io_uring) { io_stream_tcp_reset_by_client_run(true); }
+
 // reset by peer(server)
-CASE_TEST(channel, io_stream_tcp_reset_by_server)
+static void io_stream_tcp_reset_by_server_run(bool is_io_uring)
 {
+    atbus::channel::io_stream_conf conf;
+    io_stream_test_init_conf(conf, is_io_uring);
+
     atbus::channel::io_stream_channel svr, cli;
-    atbus::channel::io_stream_init(&svr, NULL, NULL);
-    atbus::channel::io_stream_init(&cli, NULL, NULL);
+    atbus::channel::io_stream_init(&svr, NULL, &conf);
+    atbus::channel::io_stream_init(&cli, NULL, &conf);
 
     cli.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_DISCONNECTED] = disconnected_callback_test_fn;
 
@@ -344,6 +830,7 @@ CASE_TEST(channel, io_stream_tcp_reset_by_server)
     CASE_EXPECT_NE(0, cli.conn_pool.size());
 
     check_flag = g_check_flag;
+    io_stream_test_check_uring(svr, is_io_uring);
     atbus::channel::io_stream_close(&svr);
     CASE_EXPECT_EQ(0, svr.conn_pool.size());
 
@@ -356,6 +843,10 @@ CASE_TEST(channel, io_stream_tcp_reset_by_server)
     atbus::channel::io_stream_close(&cli);
 }
 
+CASE_TEST(channel, io_stream_tcp_reset_by_server) { io_stream_tcp_reset_by_server_run(false); }
+
+CASE_TEST(channel, io_stream_tcp_reset_by_server_io_uring) { io_stream_tcp_reset_by_server_run(true); }
+
 static void recv_size_err_callback_check_fn(
     atbus::channel::io_stream_channel* channel,         // 事件触发的channel
     atbus::channel::io_stream_connection* connection,   // 事件触发的连接
@@ -383,11 +874,11 @@ static void recv_size_err_callback_check_fn(
 }
 
 // buffer recv/send size limit
-CASE_TEST(channel, io_stream_tcp_size_extended)
+static void io_stream_tcp_size_extended_run(bool is_io_uring)
 {
     atbus::channel::io_stream_channel svr, cli;
     atbus::channel::io_stream_conf conf;
-    atbus::channel::io_stream_init_configure(&conf);
+    io_stream_test_init_conf(conf, is_io_uring);
     conf.send_buffer_limit_size = conf.recv_buffer_max_size + 1;
 
     atbus::channel::io_stream_init(&svr, NULL, &conf);
@@ -444,10 +935,385 @@ CASE_TEST(channel, io_stream_tcp_size_extended)
     CASE_EXPECT_EQ(0, cli.conn_pool.size());
     CASE_EXPECT_EQ(1, svr.conn_pool.size());
 
+    io_stream_test_check_uring(svr, is_io_uring);
+    atbus::channel::io_stream_close(&cli);
+    atbus::channel::io_stream_close(&svr);
+}
+
+CASE_TEST(channel, io_stream_tcp_size_extended) { io_stream_tcp_size_extended_run(false); }
+
+CASE_TEST(channel, io_stream_tcp_size_extended_io_uring) { io_stream_tcp_size_extended_run(true); }
+
+// 直接调用libuv的读回调，模拟每次读到的数据
+static void io_stream_test_feed(atbus::channel::io_stream_connection *conn, const char *data, size_t len) {
+    uv_stream_t *stream = conn->handle.get();
+    while (len > 0) {
+        uv_buf_t buf = uv_buf_init(NULL, 0);
+        stream->alloc_cb(reinterpret_cast<uv_handle_t *>(stream), 65536, &buf);
+        CASE_EXPECT_NE(NULL, buf.base);
+        if (NULL == buf.base) {
+            return;
+        }
+
+        size_t n = len < buf.len ? len : buf.len;
+        memcpy(buf.base, data, n);
+        stream->read_cb(stream, static_cast<ssize_t>(n), &buf);
+        data += n;
+        len -= n;
+    }
+}
+
+// 帧格式: 32位hash + varint(数据长度) + 数据
+// 有帧标记时是扩展帧: 32位hash + varint(0) + varint(帧标记) + varint(数据长度) + 数据，0x01是LZ4，0x02是不带hash
+static void io_stream_test_append_frame(std::string &out, const std::string &data, uint32_t frame_flags) {
+    char head[sizeof(uint32_t) + 30];
+    uint32_t hash = 0;
+    if (0 == (frame_flags & 0x02)) {
+        hash = util::hash::murmur_hash3_x86_32(data.data(), static_cast<int>(data.size()), 0);
+    }
+    memcpy(head, &hash, sizeof(uint32_t));
+
+    size_t head_len = sizeof(uint32_t);
+    if (0 != frame_flags) {
+        head_len += atbus::detail::fn::write_vint(0, head + head_len, sizeof(head) - head_len);
+        head_len += atbus::detail::fn::write_vint(frame_flags, head + head_len, sizeof(head) - head_len);
+    }
+    head_len += atbus::detail::fn::write_vint(data.size(), head + head_len, sizeof(head) - head_len);
+
+    out.append(head, head_len);
+    out.append(data);
+}
+
+// LZ4帧的数据部分是 varint(原始长度) + LZ4块
+static std::string io_stream_test_lz4_payload(const std::string &data) {
+    std::string ret;
+    ret.resize(10 + atbus::detail::lz4_compress_bound(data.size()));
+    size_t vint_len = atbus::detail::fn::write_vint(data.size(), &ret[0], ret.size());
+    size_t compressed = atbus::detail::lz4_compress(data.data(), data.size(), &ret[vint_len], ret.size() - vint_len);
+    CASE_EXPECT_NE(0, compressed);
+    ret.resize(vint_len + compressed);
+    return ret;
+}
+
+static std::string io_stream_test_make_data(size_t len, size_t seed) {
+    std::string ret;
+    ret.resize(len);
+    for (size_t i = 0; i < len; ++i) {
+        ret[i] = static_cast<char>('a' + (seed + i) % 26);
+    }
+    return ret;
+}
+
+static std::vector<std::string> g_decoder_recv;
+static void recv_decoder_check_fn(atbus::channel::io_stream_channel *channel, atbus::channel::io_stream_connection *connection,
+                                  int status, void *input, size_t s) {
+    CASE_EXPECT_EQ(0, status);
+    CASE_EXPECT_EQ(0, channel->error_code);
+    if (status < 0) {
+        return;
+    }
+
+    g_decoder_recv.push_back(std::string(reinterpret_cast<const char *>(input), s));
+}
+
+static void io_stream_test_check_decoded(std::vector<std::string> &expect) {
+    CASE_EXPECT_EQ(expect.size(), g_decoder_recv.size());
+    for (size_t i = 0; i < expect.size() && i < g_decoder_recv.size(); ++i) {
+        CASE_EXPECT_EQ(expect[i].size(), g_decoder_recv[i].size());
+        CASE_EXPECT_TRUE(expect[i] == g_decoder_recv[i]);
+    }
+
+    expect.clear();
+    g_decoder_recv.clear();
+}
+
+// head缓冲区里的原地解帧: 跨多次读取的帧、有未完成的帧时前移数据和扩展帧头
+// io_uring收到数据后也走同样的回调，这里只用libuv
+CASE_TEST(channel, io_stream_tcp_decoder) {
+    atbus::adapter::loop_t loop;
+    uv_loop_init(&loop);
+
+    atbus::channel::io_stream_conf conf;
+    io_stream_test_init_conf(conf, false);
+
+    atbus::channel::io_stream_channel svr, cli;
+    atbus::channel::io_stream_init(&svr, &loop, &conf);
+    atbus::channel::io_stream_init(&cli, &loop, &conf);
+
+    g_check_flag = 0;
+
+    int inited_fds = 0;
+    inited_fds += setup_channel(svr, "ipv4://127.0.0.1:16394", NULL);
+    CASE_EXPECT_EQ(1, g_check_flag);
+    if (0 == inited_fds) {
+        atbus::channel::io_stream_close(&svr);
+        atbus::channel::io_stream_close(&cli);
+        uv_loop_close(&loop);
+        return;
+    }
+
+    inited_fds = setup_channel(cli, NULL, "ipv4://127.0.0.1:16394");
+    int check_flag = g_check_flag;
+    while (g_check_flag - check_flag < 2 * inited_fds) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+
+    atbus::channel::io_stream_connection *svr_conn = NULL;
+    for (atbus::channel::io_stream_channel::conn_pool_t::iterator it = svr.conn_pool.begin(); it != svr.conn_pool.end(); ++it) {
+        if (it->second->addr.address != "ipv4://127.0.0.1:16394") {
+            svr_conn = it->second.get();
+        }
+    }
+    CASE_EXPECT_NE(NULL, svr_conn);
+    if (NULL == svr_conn) {
+        atbus::channel::io_stream_close(&svr);
+        atbus::channel::io_stream_close(&cli);
+        uv_loop_close(&loop);
+        return;
+    }
+
+    svr.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_RECVED] = recv_decoder_check_fn;
+    // 接受不带hash的帧，带hash的帧仍然校验
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_set_hash_mode(svr_conn, atbus::channel::io_stream_hash_mode_t::EN_HM_OPTIONAL));
+
+    const size_t head_size = sizeof(svr_conn->read_head.buffer);
+    std::vector<std::string> expect;
+    g_decoder_recv.clear();
+
+    // 小帧和大数据包交替，每次只读到1到7个字节，hash和帧头都会被切开
+    {
+        std::string stream;
+        size_t lens[] = {1, 17, head_size / 4, head_size / 2, head_size * 4, 5, head_size - 10, head_size * 8, 64};
+        for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); ++i) {
+            expect.push_back(io_stream_test_make_data(lens[i], i));
+            io_stream_test_append_frame(stream, expect.back(), 0);
+        }
+
+        for (size_t off = 0, step = 1; off < stream.size(); off += step, step = step % 7 + 1) {
+            io_stream_test_feed(svr_conn, stream.data() + off, std::min(step, stream.size() - off));
+        }
+
+        io_stream_test_check_decoded(expect);
+        CASE_EXPECT_EQ(0, svr_conn->read_head.start);
+        CASE_EXPECT_EQ(0, svr_conn->read_head.len);
+    }
+
+    // 剩余空间足够放下未完成的帧时不移动数据，只移动start
+    {
+        std::string stream;
+        expect.push_back(io_stream_test_make_data(40, 1));
+        io_stream_test_append_frame(stream, expect.back(), 0);
+        size_t first_len = stream.size();
+        expect.push_back(io_stream_test_make_data(100, 2));
+        io_stream_test_append_frame(stream, expect.back(), 0);
+
+        io_stream_test_feed(svr_conn, stream.data(), first_len + 20);
+        CASE_EXPECT_EQ(1, g_decoder_recv.size());
+        CASE_EXPECT_EQ(first_len, svr_conn->read_head.start);
+        CASE_EXPECT_EQ(first_len + 20, svr_conn->read_head.len);
+
+        io_stream_test_feed(svr_conn, stream.data() + first_len + 20, stream.size() - first_len - 20);
+        io_stream_test_check_decoded(expect);
+        CASE_EXPECT_EQ(0, svr_conn->read_head.start);
+        CASE_EXPECT_EQ(0, svr_conn->read_head.len);
+    }
+
+    // 一次读到多个完整的帧和一个未完成的帧，剩余空间放不下这个帧时把未完成的数据前移到head开头
+    {
+        std::string stream;
+        for (size_t i = 0; stream.size() < head_size * 3 / 4; ++i) {
+            expect.push_back(io_stream_test_make_data(40, i));
+            io_stream_test_append_frame(stream, expect.back(), 0);
+        }
+        size_t done_count = expect.size();
+        size_t done_len = stream.size();
+        expect.push_back(io_stream_test_make_data(head_size / 2, 3));
+        io_stream_test_append_frame(stream, expect.back(), 0);
+
+        io_stream_test_feed(svr_conn, stream.data(), done_len + 50);
+        CASE_EXPECT_EQ(done_count, g_decoder_recv.size());
+        CASE_EXPECT_EQ(0, svr_conn->read_head.start);
+        CASE_EXPECT_EQ(50, svr_conn->read_head.len);
+
+        // 前移后的数据继续拼接
+        io_stream_test_feed(svr_conn, stream.data() + done_len + 50, 10);
+        CASE_EXPECT_EQ(done_count, g_decoder_recv.size());
+        CASE_EXPECT_EQ(60, svr_conn->read_head.len);
+
+        io_stream_test_feed(svr_conn, stream.data() + done_len + 60, stream.size() - done_len - 60);
+        io_stream_test_check_decoded(expect);
+        CASE_EXPECT_EQ(0, svr_conn->read_head.start);
+        CASE_EXPECT_EQ(0, svr_conn->read_head.len);
+    }
+
+    // 扩展帧头，帧头逐个字节到达时要等三个varint都收全才能解出数据长度
+    {
+        std::string random_data(get_test_buffer(), head_size * 4);
+        std::vector<std::string> frames;
+        // 不带hash的小帧和大数据包
+        expect.push_back(io_stream_test_make_data(100, 4));
+        frames.push_back(std::string());
+        io_stream_test_append_frame(frames.back(), expect.back(), 0x02);
+        expect.push_back(io_stream_test_make_data(head_size * 2, 5));
+        frames.push_back(std::string());
+        io_stream_test_append_frame(frames.back(), expect.back(), 0x02);
+        // 能放进head的LZ4帧和需要大数据包缓冲区的LZ4帧，hash按压缩后的数据计算
+        expect.push_back(io_stream_test_make_data(head_size * 4, 6));
+        frames.push_back(std::string());
+        io_stream_test_append_frame(frames.back(), io_stream_test_lz4_payload(expect.back()), 0x01);
+        expect.push_back(random_data);
+        frames.push_back(std::string());
+        io_stream_test_append_frame(frames.back(), io_stream_test_lz4_payload(expect.back()), 0x01);
+        // 不带hash的LZ4帧
+        expect.push_back(random_data);
+        frames.push_back(std::string());
+        io_stream_test_append_frame(frames.back(), io_stream_test_lz4_payload(expect.back()), 0x03);
+
+        for (size_t i = 0; i < frames.size(); ++i) {
+            // 32位hash + 3个varint的帧头最少7个字节
+            for (size_t j = 0; j < 7; ++j) {
+                io_stream_test_feed(svr_conn, frames[i].data() + j, 1);
+                CASE_EXPECT_EQ(i, g_decoder_recv.size());
+            }
+            io_stream_test_feed(svr_conn, frames[i].data() + 7, frames[i].size() - 7);
+            CASE_EXPECT_EQ(i + 1, g_decoder_recv.size());
+        }
+
+        io_stream_test_check_decoded(expect);
+        CASE_EXPECT_EQ(0, svr_conn->read_head.start);
+        CASE_EXPECT_EQ(0, svr_conn->read_head.len);
+        CASE_EXPECT_EQ(0, svr_conn->read_head.frame_flags);
+    }
+
+    atbus::channel::io_stream_close(&svr);
     atbus::channel::io_stream_close(&cli);
+    CASE_EXPECT_EQ(0, svr.conn_pool.size());
+    CASE_EXPECT_EQ(0, cli.conn_pool.size());
+
+    uv_loop_close(&loop);
+}
+
+// 多段数据拼成一个消息发送
+static void io_stream_tcp_sendv_run(bool is_io_uring) {
+    atbus::adapter::loop_t loop;
+    uv_loop_init(&loop);
+
+    atbus::channel::io_stream_conf conf;
+    io_stream_test_init_conf(conf, is_io_uring);
+    conf.send_buffer_limit_size = 32 * 1024;
+
+    atbus::channel::io_stream_channel svr, cli;
+    atbus::channel::io_stream_init(&svr, &loop, &conf);
+    atbus::channel::io_stream_init(&cli, &loop, &conf);
+
+    g_check_flag = 0;
+
+    int inited_fds = 0;
+    inited_fds += setup_channel(svr, "ipv4://127.0.0.1:16395", NULL);
+    CASE_EXPECT_EQ(1, g_check_flag);
+    if (0 == inited_fds) {
+        atbus::channel::io_stream_close(&svr);
+        atbus::channel::io_stream_close(&cli);
+        uv_loop_close(&loop);
+        return;
+    }
+
+    inited_fds = setup_channel(cli, NULL, "ipv4://127.0.0.1:16395");
+    int check_flag = g_check_flag;
+    while (g_check_flag - check_flag < 2 * inited_fds) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+
+    CASE_EXPECT_NE(0, cli.conn_pool.size());
+    if (cli.conn_pool.empty()) {
+        atbus::channel::io_stream_close(&svr);
+        atbus::channel::io_stream_close(&cli);
+        uv_loop_close(&loop);
+        return;
+    }
+    atbus::channel::io_stream_connection *cli_conn = cli.conn_pool.begin()->second.get();
+
+    svr.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_RECVED] = recv_decoder_check_fn;
+    g_decoder_recv.clear();
+    std::vector<std::string> expect;
+
+    // 空数组和全部是空数据段时不发送任何数据
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_sendv(cli_conn, NULL, 0));
+    CASE_EXPECT_EQ(EN_ATBUS_ERR_PARAMS, atbus::channel::io_stream_sendv(cli_conn, NULL, 1));
+    {
+        atbus::channel::channel_iovec_t iov[4];
+        for (size_t i = 0; i < 4; ++i) {
+            iov[i].base = get_test_buffer();
+            iov[i].len = 0;
+        }
+        CASE_EXPECT_EQ(0, atbus::channel::io_stream_sendv(cli_conn, iov, 4));
+    }
+
+    // 空数据段夹在中间
+    {
+        atbus::channel::channel_iovec_t iov[5];
+        iov[0].base = "hello";
+        iov[0].len = 5;
+        iov[1].base = NULL;
+        iov[1].len = 0;
+        iov[2].base = " ";
+        iov[2].len = 1;
+        iov[3].base = "";
+        iov[3].len = 0;
+        iov[4].base = "world";
+        iov[4].len = 5;
+        CASE_EXPECT_EQ(0, atbus::channel::io_stream_sendv(cli_conn, iov, 5));
+        expect.push_back("hello world");
+    }
+
+    // 大量数据段，总长度超过head缓冲区，接收端按io_stream_send的格式校验hash
+    {
+        std::vector<atbus::channel::channel_iovec_t> iov;
+        std::string joined;
+        iov.resize(1024);
+        for (size_t i = 0; i < iov.size(); ++i) {
+            iov[i].base = get_test_buffer() + i;
+            iov[i].len = (i * 7) % 13;
+            joined.append(get_test_buffer() + i, iov[i].len);
+        }
+        CASE_EXPECT_GT(joined.size(), sizeof(cli_conn->read_head.buffer));
+
+        CASE_EXPECT_EQ(0, atbus::channel::io_stream_sendv(cli_conn, &iov[0], iov.size()));
+        expect.push_back(joined);
+
+        // 和拼成连续数据后调用io_stream_send的结果一致
+        CASE_EXPECT_EQ(0, atbus::channel::io_stream_send(cli_conn, joined.data(), joined.size()));
+        expect.push_back(joined);
+    }
+
+    // 总长度超过发送限制
+    {
+        atbus::channel::channel_iovec_t iov[2];
+        iov[0].base = get_test_buffer();
+        iov[0].len = conf.send_buffer_limit_size;
+        iov[1].base = get_test_buffer();
+        iov[1].len = 1;
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_INVALID_SIZE, atbus::channel::io_stream_sendv(cli_conn, iov, 2));
+    }
+
+    while (g_decoder_recv.size() < expect.size()) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+    io_stream_test_check_decoded(expect);
+
+    io_stream_test_check_uring(svr, is_io_uring);
     atbus::channel::io_stream_close(&svr);
+    atbus::channel::io_stream_close(&cli);
+    CASE_EXPECT_EQ(0, svr.conn_pool.size());
+    CASE_EXPECT_EQ(0, cli.conn_pool.size());
+
+    uv_loop_close(&loop);
 }
 
+CASE_TEST(channel, io_stream_tcp_sendv) { io_stream_tcp_sendv_run(false); }
+
+CASE_TEST(channel, io_stream_tcp_sendv_io_uring) { io_stream_tcp_sendv_run(true); }
+
 static void connect_failed_callback_test_fn(
     atbus::channel::io_stream_channel* channel,         // 事件触发的channel
     atbus::channel::io_stream_connection* connection,   // 事件触发的连接
@@ -474,10 +1340,13 @@ static void connect_failed_callback_test_fn(
 }
 
 // connect failed
-CASE_TEST(channel, io_stream_tcp_connect_failed)
+static void io_stream_tcp_connect_failed_run(bool is_io_uring)
 {
+    atbus::channel::io_stream_conf conf;
+    io_stream_test_init_conf(conf, is_io_uring);
+
     atbus::channel::io_stream_channel cli;
-    atbus::channel::io_stream_init(&cli, NULL, NULL);
+    atbus::channel::io_stream_init(&cli, NULL, &conf);
 
     int check_flag = g_check_flag = 0;
 
@@ -513,3 +1382,159 @@ CASE_TEST(channel, io_stream_tcp_connect_failed)
 
     atbus::channel::io_stream_close(&cli);
 }
+
+CASE_TEST(channel, io_stream_tcp_connect_failed) { io_stream_tcp_connect_failed_run(false); }
+
+CASE_TEST(channel, io_stream_tcp_connect_failed_io_uring) { io_stream_tcp_connect_failed_run(true); }
+
+struct io_stream_workers_test_data {
+    std::vector<uint64_t> conns;
+    std::vector<uint64_t> tokens;
+    size_t recv_count;
+    size_t recv_bytes;
+    int failed;
+    int disconnected;
+};
+
+static void io_stream_workers_test_fn(atbus::channel::io_stream_worker_group *, const atbus::channel::io_stream_worker_msg_t *msg,
+                                      void *priv_data) {
+    io_stream_workers_test_data *data = reinterpret_cast<io_stream_workers_test_data *>(priv_data);
+    switch (msg->event) {
+    case atbus::channel::io_stream_worker_event_t::EN_WE_CONNECTED:
+        data->tokens.push_back(msg->token);
+        // fall through
+    case atbus::channel::io_stream_worker_event_t::EN_WE_ACCEPTED:
+        CASE_EXPECT_EQ(0, msg->errcode);
+        CASE_EXPECT_NE(0, msg->conn_id);
+        if (0 == msg->errcode) {
+            data->conns.push_back(msg->conn_id);
+        }
+        break;
+    case atbus::channel::io_stream_worker_event_t::EN_WE_RECVED: {
+        // 对端断开时会先收到一个读失败的事件
+        if (0 != msg->errcode) {
+            CASE_EXPECT_EQ(0, msg->len);
+            break;
+        }
+
+        const unsigned char *buf = reinterpret_cast<const unsigned char *>(msg->data);
+        bool is_ok = msg->len > 0;
+        for (size_t i = 0; i < msg->len; ++i) {
+            is_ok = is_ok && buf[i] == static_cast<unsigned char>(msg->len + i);
+        }
+        CASE_EXPECT_TRUE(is_ok);
+        ++data->recv_count;
+        data->recv_bytes += msg->len;
+        break;
+    }
+    case atbus::channel::io_stream_worker_event_t::EN_WE_DISCONNECTED:
+        ++data->disconnected;
+        break;
+    default:
+        ++data->failed;
+        break;
+    }
+}
+
+// io线程组，多个io线程各自监听同一个地址
+CASE_TEST(channel, io_stream_tcp_workers) {
+    io_stream_workers_test_data svr_data, cli_data;
+    svr_data.recv_count = cli_data.recv_count = 0;
+    svr_data.recv_bytes = cli_data.recv_bytes = 0;
+    svr_data.failed = cli_data.failed = 0;
+    svr_data.disconnected = cli_data.disconnected = 0;
+
+    atbus::channel::io_stream_worker_group *svr = NULL, *cli = NULL;
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_workers_init(&svr, 3, NULL, 1024 * 1024));
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_workers_init(&cli, 2, NULL, 1024 * 1024));
+    if (NULL == svr || NULL == cli) {
+        return;
+    }
+    CASE_EXPECT_EQ(3, atbus::channel::io_stream_workers_count(svr));
+
+    atbus::channel::channel_address_t addr;
+    atbus::channel::make_address("ipv4://127.0.0.1:16389", addr);
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_workers_listen(svr, addr));
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_workers_start(svr));
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_workers_start(cli));
+
+    const size_t conn_num = 4;
+    for (size_t i = 0; i < conn_num; ++i) {
+        CASE_EXPECT_EQ(0, atbus::channel::io_stream_workers_connect(cli, addr, i + 1));
+    }
+
+    time_t start_time = time(NULL);
+    while ((cli_data.conns.size() < conn_num || svr_data.conns.size() < conn_num) && time(NULL) - start_time < 8) {
+        atbus::channel::io_stream_workers_recv(svr, io_stream_workers_test_fn, &svr_data, 0, NULL);
+        atbus::channel::io_stream_workers_recv(cli, io_stream_workers_test_fn, &cli_data, 0, NULL);
+    }
+    CASE_EXPECT_EQ(conn_num, cli_data.conns.size());
+    CASE_EXPECT_EQ(conn_num, svr_data.conns.size());
+    CASE_EXPECT_EQ(0, svr_data.tokens.size());
+
+    // 连接结果带回了调用方传入的token
+    std::sort(cli_data.tokens.begin(), cli_data.tokens.end());
+    for (size_t i = 0; i < cli_data.tokens.size(); ++i) {
+        CASE_EXPECT_EQ(i + 1, cli_data.tokens[i]);
+    }
+
+    // 数据内容和长度相关，接收端可以校验
+    // 服务端只在客户端发不出去时才处理事件，io线程会阻塞等待事件通道的空间
+    const size_t msg_num = 2000;
+    size_t sent_bytes = 0;
+    std::vector<unsigned char> buf;
+    for (size_t i = 0; i < msg_num && !cli_data.conns.empty();) {
+        buf.resize(1 + (i * 97) % 8000);
+        for (size_t j = 0; j < buf.size(); ++j) {
+            buf[j] = static_cast<unsigned char>(buf.size() + j);
+        }
+
+        uint64_t conn_id = cli_data.conns[i % cli_data.conns.size()];
+        int res;
+        if (i & 0x01) {
+            // 直接打包到命令通道里
+            atbus::channel::mem_reserved_block_t block;
+            res = atbus::channel::io_stream_workers_send_reserve(cli, conn_id, buf.size(), &block);
+            if (0 == res) {
+                CASE_EXPECT_EQ(buf.size(), block.len);
+                CASE_EXPECT_EQ(buf.size(), block.length[0]);
+                memcpy(block.buffer[0], &buf[0], buf.size());
+                res = atbus::channel::io_stream_workers_send_commit(cli, conn_id, &block);
+            }
+        } else {
+            res = atbus::channel::io_stream_workers_send(cli, conn_id, &buf[0], buf.size());
+        }
+        if (EN_ATBUS_ERR_BUFF_LIMIT == res) {
+            atbus::channel::io_stream_workers_recv(svr, io_stream_workers_test_fn, &svr_data, 0, NULL);
+            continue;
+        }
+
+        CASE_EXPECT_EQ(0, res);
+        sent_bytes += buf.size();
+        ++i;
+    }
+
+    start_time = time(NULL);
+    while (svr_data.recv_count < msg_num && time(NULL) - start_time < 8) {
+        atbus::channel::io_stream_workers_recv(svr, io_stream_workers_test_fn, &svr_data, 0, NULL);
+    }
+    CASE_EXPECT_EQ(msg_num, svr_data.recv_count);
+    CASE_EXPECT_EQ(sent_bytes, svr_data.recv_bytes);
+
+    // 服务端主动断开，客户端收到断开事件
+    for (size_t i = 0; i < svr_data.conns.size(); ++i) {
+        CASE_EXPECT_EQ(0, atbus::channel::io_stream_workers_disconnect(svr, svr_data.conns[i]));
+    }
+
+    start_time = time(NULL);
+    while (cli_data.disconnected < static_cast<int>(conn_num) && time(NULL) - start_time < 8) {
+        atbus::channel::io_stream_workers_recv(svr, io_stream_workers_test_fn, &svr_data, 0, NULL);
+        atbus::channel::io_stream_workers_recv(cli, io_stream_workers_test_fn, &cli_data, 0, NULL);
+    }
+    CASE_EXPECT_EQ(conn_num, cli_data.disconnected);
+    CASE_EXPECT_EQ(0, svr_data.failed);
+    CASE_EXPECT_EQ(0, cli_data.failed);
+
+    atbus::channel::io_stream_workers_close(cli);
+    atbus::channel::io_stream_workers_close(svr);
+}
@@ -10,6 +10,7 @@
 #include <functional>
 
 #include <detail/libatbus_error.h>
+#include "detail/io_uring.h"
 #include "detail/libatbus_channel_export.h"
 #include "frame/test_macros.h"
 
@@ -20,6 +21,24 @@ static int g_check_flag = 0;
 static std::pair<size_t, size_t> g_recv_rec = std::make_pair(0, 0);
 static std::list<std::pair<size_t, size_t> > g_check_buff_sequence;
 
+// 用例在libuv和io_uring两种收发方式下各跑一次
+static void io_stream_test_init_conf(atbus::channel::io_stream_conf &conf, bool is_io_uring) {
+    atbus::channel::io_stream_init_configure(&conf);
+    conf.is_io_uring = is_io_uring;
+}
+
+// 开启了io_uring并且内核支持时必须真的用上io_uring，否则必须回退到libuv
+static void io_stream_test_check_uring(const atbus::channel::io_stream_channel &channel, bool is_io_uring) {
+    bool expect_uring = false;
+#ifdef ATBUS_CHANNEL_IO_URING
+    if (is_io_uring) {
+        atbus::detail::io_uring_ring ring;
+        expect_uring = 0 == ring.init(8);
+    }
+#endif
+    CASE_EXPECT_EQ(expect_uring, NULL != channel.uring);
+}
+
 #ifdef _WIN32
     #define UNIT_TEST_LISTEN_ADDR "unix://\\\\.\\pipe\\unit_test.sock"
     #define UNIT_TEST_INVALID_ADDR "unix://\\\\.\\pipe\\unit_test.invalid.sock"
@@ -183,14 +202,17 @@ static void recv_callback_check_fn(
     ++g_check_flag;
 }
 
-CASE_TEST(channel, io_stream_unix_basic)
+static void io_stream_unix_basic_run(bool is_io_uring)
 {
     atbus::adapter::loop_t loop;
     uv_loop_init(&loop);
 
+    atbus::channel::io_stream_conf conf;
+    io_stream_test_init_conf(conf, is_io_uring);
+
     atbus::channel::io_stream_channel svr, cli;
-    atbus::channel::io_stream_init(&svr, &loop, NULL);
-    atbus::channel::io_stream_init(&cli, &loop, NULL);
+    atbus::channel::io_stream_init(&svr, &loop, &conf);
+    atbus::channel::io_stream_init(&cli, &loop, &conf);
     CASE_EXPECT_EQ(&loop, svr.ev_loop);
     CASE_EXPECT_EQ(&loop, cli.ev_loop);
 
@@ -258,6 +280,7 @@ CASE_TEST(channel, io_stream_unix_basic)
         CASE_MSG_INFO() << "recv " << g_recv_rec.second << " bytes data with " << g_recv_rec.first << " packages and checked done." << std::endl;
     }
 
+    io_stream_test_check_uring(svr, is_io_uring);
     atbus::channel::io_stream_close(&svr);
     atbus::channel::io_stream_close(&cli);
     CASE_EXPECT_EQ(0, svr.conn_pool.size());
@@ -266,13 +289,124 @@ CASE_TEST(channel, io_stream_unix_basic)
     uv_loop_close(&loop);
 }
 
+CASE_TEST(channel, io_stream_unix_basic) { io_stream_unix_basic_run(false); }
+
+CASE_TEST(channel, io_stream_unix_basic_io_uring) { io_stream_unix_basic_run(true); }
+
+
+static int g_bad_data_count = 0;
+static void recv_bad_data_callback_check_fn(atbus::channel::io_stream_channel *channel, atbus::channel::io_stream_connection *connection,
+                                            int status, void *input, size_t s) {
+    CASE_EXPECT_NE(NULL, channel);
+    CASE_EXPECT_NE(NULL, connection);
+    CASE_EXPECT_EQ(EN_ATBUS_ERR_BAD_DATA, status);
+
+    ++g_bad_data_count;
+    ++g_check_flag;
+}
+
+// 同一台机器上的unix socket可以不计算hash
+static void io_stream_unix_skip_hash_run(bool is_io_uring)
+{
+    atbus::adapter::loop_t loop;
+    uv_loop_init(&loop);
+
+    atbus::channel::io_stream_conf conf;
+    io_stream_test_init_conf(conf, is_io_uring);
+
+    atbus::channel::io_stream_channel svr, cli;
+    atbus::channel::io_stream_init(&svr, &loop, &conf);
+    atbus::channel::io_stream_init(&cli, &loop, &conf);
+    CASE_EXPECT_EQ(atbus::channel::io_stream_hash_mode_t::EN_HM_OPTIONAL, svr.conf.unix_frame_hash_mode);
+
+    g_check_flag = 0;
+
+    setup_channel(svr, UNIT_TEST_LISTEN_ADDR, NULL);
+    CASE_EXPECT_EQ(1, g_check_flag);
+
+    setup_channel(cli, NULL, UNIT_TEST_LISTEN_ADDR);
+    int check_flag = g_check_flag;
+    while (g_check_flag - check_flag < 2) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+
+    atbus::channel::io_stream_connection *svr_conn = NULL;
+    for (atbus::channel::io_stream_channel::conn_pool_t::iterator it = svr.conn_pool.begin(); it != svr.conn_pool.end(); ++it) {
+        // 跳过listen的socket
+        if (it->second->addr.address != UNIT_TEST_LISTEN_ADDR) {
+            svr_conn = it->second.get();
+        }
+    }
+    CASE_EXPECT_NE(NULL, svr_conn);
+    if (NULL == svr_conn) {
+        atbus::channel::io_stream_close(&svr);
+        atbus::channel::io_stream_close(&cli);
+        uv_loop_close(&loop);
+        return;
+    }
+    CASE_EXPECT_EQ(atbus::channel::io_stream_hash_mode_t::EN_HM_OPTIONAL, svr_conn->hash_mode);
+
+    svr.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_RECVED] = recv_callback_check_fn;
+    char *buf = get_test_buffer();
+    atbus::channel::io_stream_connection *cli_conn = cli.conn_pool.begin()->second.get();
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_set_skip_hash(cli_conn, true));
+
+    // 小数据包和大数据包都能正确接收
+    check_flag = g_check_flag;
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_send(cli_conn, buf, 13));
+    g_check_buff_sequence.push_back(std::make_pair(0, 13));
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_send(cli_conn, buf + 1024, 56 * 1024 + 3));
+    g_check_buff_sequence.push_back(std::make_pair(1024, 56 * 1024 + 3));
+    while (g_check_flag - check_flag < 2) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+
+    // 要求hash校验的连接不接受不带hash的帧
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_set_hash_mode(svr_conn, atbus::channel::io_stream_hash_mode_t::EN_HM_REQUIRED));
+    svr.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_RECVED] = recv_bad_data_callback_check_fn;
+    g_bad_data_count = 0;
+    check_flag = g_check_flag;
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_send(cli_conn, buf, 100));
+    while (g_check_flag - check_flag < 1) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+    CASE_EXPECT_EQ(1, g_bad_data_count);
+
+    // 关闭后恢复正常的帧
+    svr.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_RECVED] = recv_callback_check_fn;
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_set_skip_hash(cli_conn, false));
+    check_flag = g_check_flag;
+    CASE_EXPECT_EQ(0, atbus::channel::io_stream_send(cli_conn, buf + 13, 28));
+    g_check_buff_sequence.push_back(std::make_pair(13, 28));
+    while (g_check_flag - check_flag < 1) {
+        uv_run(&loop, UV_RUN_ONCE);
+    }
+
+    CASE_EXPECT_EQ(EN_ATBUS_ERR_PARAMS, atbus::channel::io_stream_set_hash_mode(svr_conn, 3));
+
+    io_stream_test_check_uring(svr, is_io_uring);
+    atbus::channel::io_stream_close(&svr);
+    atbus::channel::io_stream_close(&cli);
+    CASE_EXPECT_EQ(0, svr.conn_pool.size());
+    CASE_EXPECT_EQ(0, cli.conn_pool.size());
+
+    uv_loop_close(&loop);
+}
+
+CASE_TEST(channel, io_stream_unix_skip_hash) { io_stream_unix_skip_hash_run(false); }
+
+CASE_TEST(channel, io_stream_unix_skip_hash_io_uring) { io_stream_unix_skip_hash_run(true); }
+
 
 // reset by peer(client)
-CASE_TEST(channel, io_stream_unix_reset_by_client)
+static void io_stream_unix_reset_by_client_run(bool is_io_uring)
 {
+    atbus::channel::io_stream_conf conf;
+    io_stream_test_init_conf(conf, is_io_uring);
+
     atbus::channel::io_stream_channel svr, cli;
-    atbus::channel::io_stream_init(&svr, NULL, NULL);
-    atbus::channel::io_stream_init(&cli, NULL, NULL);
+    atbus::channel::io_stream_init(&svr, NULL, &conf);
+    atbus::channel::io_stream_init(&cli, NULL, &conf);
 
     svr.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_DISCONNECTED] = disconnected_callback_test_fn;
 
@@ -294,6 +428,7 @@ CASE_TEST(channel, io_stream_unix_reset_by_client)
     CASE_EXPECT_NE(0, cli.conn_pool.size());
 
     check_flag = g_check_flag;
+    io_stream_test_check_uring(svr, is_io_uring);
     atbus::channel::io_stream_close(&cli);
     CASE_EXPECT_EQ(0, cli.conn_pool.size());
 
@@ -307,12 +442,19 @@ CASE_TEST(channel, io_stream_unix_reset_by_client)
     CASE_EXPECT_EQ(0, svr.conn_pool.size());
 }
 
+CASE_TEST(channel, io_stream_unix_reset_by_client) { io_stream_unix_reset_by_client_run(false); }
+
+CASE_TEST(channel, io_stream_unix_reset_by_client_io_uring) { io_stream_unix_reset_by_client_run(true); }
+
 // reset by peer(server)
-CASE_TEST(channel, io_stream_unix_reset_by_server)
+static void io_stream_unix_reset_by_server_run(bool is_io_uring)
 {
+    atbus::channel::io_stream_conf conf;
+    io_stream_test_init_conf(conf, is_io_uring);
+
     atbus::channel::io_stream_channel svr, cli;
-    atbus::channel::io_stream_init(&svr, NULL, NULL);
-    atbus::channel::io_stream_init(&cli, NULL, NULL);
+    atbus::channel::io_stream_init(&svr, NULL, &conf);
+    atbus::channel::io_stream_init(&cli, NULL, &conf);
 
     cli.evt.callbacks[atbus::channel::io_stream_callback_evt_t::EN_FN_DISCONNECTED] = disconnected_callback_test_fn;
 
@@ -334,6 +476,7 @@ CASE_TEST(channel, io_stream_unix_reset_by_server)
     CASE_EXPECT_NE(0, cli.conn_pool.size());
 
     check_flag = g_check_flag;
+    io_stream_test_check_uring(svr, is_io_uring);
     atbus::channel::io_stream_close(&svr);
     CASE_EXPECT_EQ(0, svr.conn_pool.size());
 
@@ -346,6 +489,10 @@ CASE_TEST(channel, io_stream_unix_reset_by_server)
     atbus::channel::io_stream_close(&cli);
 }
 
+CASE_TEST(channel, io_stream_unix_reset_by_server) { io_stream_unix_reset_by_server_run(false); }
+
+CASE_TEST(channel, io_stream_unix_reset_by_server_io_uring) { io_stream_unix_reset_by_server_run(true); }
+
 static void recv_size_err_callback_check_fn(
     atbus::channel::io_stream_channel* channel,         // 事件触发的channel
     atbus::channel::io_stream_connection* connection,   // 事件触发的连接
@@ -373,11 +520,11 @@ static void recv_size_err_callback_check_fn(
 }
 
 // buffer recv/send size limit
-CASE_TEST(channel, io_stream_unix_size_extended)
+static void io_stream_unix_size_extended_run(bool is_io_uring)
 {
     atbus::channel::io_stream_channel svr, cli;
     atbus::channel::io_stream_conf conf;
-    atbus::channel::io_stream_init_configure(&conf);
+    io_stream_test_init_conf(conf, is_io_uring);
     conf.send_buffer_limit_size = conf.recv_buffer_max_size + 1;
 
     atbus::channel::io_stream_init(&svr, NULL, &conf);
@@ -432,10 +579,15 @@ CASE_TEST(channel, io_stream_unix_size_extended)
     CASE_EXPECT_EQ(0, cli.conn_pool.size());
     CASE_EXPECT_EQ(1, svr.conn_pool.size());
 
+    io_stream_test_check_uring(svr, is_io_uring);
     atbus::channel::io_stream_close(&cli);
     atbus::channel::io_stream_close(&svr);
 }
 
+CASE_TEST(channel, io_stream_unix_size_extended) { io_stream_unix_size_extended_run(false); }
+
+CASE_TEST(channel, io_stream_unix_size_extended_io_uring) { io_stream_unix_size_extended_run(true); }
+
 static void connect_failed_callback_test_fn(
     atbus::channel::io_stream_channel* channel,         // 事件触发的channel
     atbus::channel::io_stream_connection* connection,   // 事件触发的连接
@@ -457,10 +609,13 @@ static void connect_failed_callback_test_fn(
 }
 
 // connect failed
-CASE_TEST(channel, io_stream_unix_connect_failed)
+static void io_stream_unix_connect_failed_run(bool is_io_uring)
 {
+    atbus::channel::io_stream_conf conf;
+    io_stream_test_init_conf(conf, is_io_uring);
+
     atbus::channel::io_stream_channel cli;
-    atbus::channel::io_stream_init(&cli, NULL, NULL);
+    atbus::channel::io_stream_init(&cli, NULL, &conf);
 
     int check_flag = g_check_flag = 0;
 
@@ -478,4 +633,8 @@ CASE_TEST(channel, io_stream_unix_connect_failed)
     atbus::channel::io_stream_close(&cli);
 }
 
+CASE_TEST(channel, io_stream_unix_connect_failed) { io_stream_unix_connect_failed_run(false); }
+
+CASE_TEST(channel, io_stream_unix_connect_failed_io_uring) { io_stream_unix_connect_failed_run(true); }
+
 #endif
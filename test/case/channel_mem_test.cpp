@@ -1,5 +1,6 @@
 ﻿#include "config/compiler_features.h"
 #include "lock/atomic_int_type.h"
+#include <cctype>
 #include <chrono>
 #include <cstdio>
 #include <cstdlib>
@@ -17,6 +18,10 @@
 #include "frame/test_macros.h"
 #include <detail/libatbus_error.h>
 
+#ifdef ATBUS_CHANNEL_DOORBELL
+#include <sys/socket.h>
+#endif
+
 
 
 CASE_TEST(channel, mem_siso) {
@@ -124,6 +129,853 @@ CASE_TEST(channel, mem_siso) {
     delete[] buffer;
 }
 
+CASE_TEST(channel, mem_reserve_commit) {
+    using namespace atbus::channel;
+    const size_t buffer_len = 64 * 1024; // 64KB，保证数据区会回绕
+    char *buffer = new char[buffer_len];
+
+    mem_channel *channel = NULL;
+
+    CASE_EXPECT_EQ(0, mem_init(buffer, buffer_len, &channel, NULL));
+    CASE_EXPECT_NE(NULL, channel);
+
+    char recv_buf[4096];
+    size_t wrap_times = 0;
+    for (size_t i = 0; i < 2048; ++i) {
+        size_t len = 1 + (i * 97) % 3000;
+        char c = static_cast<char>(i & 0x7F);
+
+        mem_reserved_block_t block;
+        CASE_EXPECT_EQ(0, mem_send_reserve(channel, len, &block));
+        CASE_EXPECT_EQ(len, block.length[0] + block.length[1]);
+        if (NULL != block.buffer[1]) {
+            ++wrap_times;
+        }
+
+        memset(block.buffer[0], c, block.length[0]);
+        if (NULL != block.buffer[1]) {
+            memset(block.buffer[1], c, block.length[1]);
+        }
+        CASE_EXPECT_EQ(0, mem_send_commit(channel, &block));
+
+        size_t recv_len = 0;
+        CASE_EXPECT_EQ(0, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+        CASE_EXPECT_EQ(len, recv_len);
+        for (size_t j = 0; j < recv_len; ++j) {
+            if (recv_buf[j] != c) {
+                CASE_EXPECT_EQ(c, recv_buf[j]);
+                break;
+            }
+        }
+    }
+
+    CASE_EXPECT_GT(wrap_times, 0);
+
+    // 超出容量
+    {
+        mem_reserved_block_t block;
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_BUFF_LIMIT, mem_send_reserve(channel, buffer_len, &block));
+    }
+
+    delete[] buffer;
+}
+
+CASE_TEST(channel, mem_peek_release) {
+    using namespace atbus::channel;
+    const size_t buffer_len = 64 * 1024; // 64KB，保证数据区会回绕
+    char *buffer = new char[buffer_len];
+
+    mem_channel *channel = NULL;
+
+    CASE_EXPECT_EQ(0, mem_init(buffer, buffer_len, &channel, NULL));
+    CASE_EXPECT_NE(NULL, channel);
+
+    char send_buf[4096];
+    size_t wrap_times = 0;
+    for (size_t i = 0; i < 2048; ++i) {
+        size_t len = 1 + (i * 97) % 3000;
+        char c = static_cast<char>(i & 0x7F);
+        memset(send_buf, c, len);
+        CASE_EXPECT_EQ(0, mem_send(channel, send_buf, len));
+
+        mem_recv_block_t block;
+        CASE_EXPECT_EQ(0, mem_recv_peek(channel, &block));
+        CASE_EXPECT_EQ(len, block.len);
+        CASE_EXPECT_EQ(len, block.length[0] + block.length[1]);
+        if (block.length[1] > 0) {
+            ++wrap_times;
+        }
+
+        // 释放前再次读取还是同一个数据块
+        {
+            mem_recv_block_t again;
+            CASE_EXPECT_EQ(0, mem_recv_peek(channel, &again));
+            CASE_EXPECT_EQ(block.buffer[0], again.buffer[0]);
+            CASE_EXPECT_EQ(block.len, again.len);
+        }
+
+        for (size_t j = 0; j < 2; ++j) {
+            const char *data = reinterpret_cast<const char *>(block.buffer[j]);
+            for (size_t k = 0; k < block.length[j]; ++k) {
+                if (data[k] != c) {
+                    CASE_EXPECT_EQ(c, data[k]);
+                    break;
+                }
+            }
+        }
+
+        CASE_EXPECT_EQ(0, mem_recv_release(channel, &block));
+        // 重复释放
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_PARAMS, mem_recv_release(channel, &block));
+    }
+
+    CASE_EXPECT_GT(wrap_times, 0);
+
+    {
+        mem_recv_block_t block;
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_NO_DATA, mem_recv_peek(channel, &block));
+    }
+
+    delete[] buffer;
+}
+
+CASE_TEST(channel, mem_peek_wrapped_checksum) {
+    using namespace atbus::channel;
+    const size_t buffer_len = 64 * 1024;
+    char *buffer = new char[buffer_len];
+
+    // 发送端按连续内存计算校验码，回绕的数据块在接收端分段校验，两者必须一致
+    char send_buf[3000];
+    for (uint32_t mode = 0; mode < mem_checksum_t::EN_MCS_MAX; ++mode) {
+        mem_channel *channel = NULL;
+        CASE_EXPECT_EQ(0, mem_init(buffer, buffer_len, &channel, NULL));
+        CASE_EXPECT_EQ(0, mem_set_checksum(channel, mode));
+
+        size_t wrap_times = 0;
+        for (size_t i = 0; i < 1024; ++i) {
+            size_t len = 1 + (i * 97) % sizeof(send_buf);
+            for (size_t k = 0; k < len; ++k) {
+                send_buf[k] = static_cast<char>((i + k * 13) & 0xFF);
+            }
+            CASE_EXPECT_EQ(0, mem_send(channel, send_buf, len));
+
+            mem_recv_block_t block;
+            CASE_EXPECT_EQ(0, mem_recv_peek(channel, &block));
+            CASE_EXPECT_EQ(len, block.len);
+
+            // 数据都直接指向通道内存，没有拷贝
+            size_t offset = 0;
+            for (size_t j = 0; j < 2; ++j) {
+                if (0 == block.length[j]) {
+                    continue;
+                }
+
+                const char *data = reinterpret_cast<const char *>(block.buffer[j]);
+                CASE_EXPECT_TRUE(data >= buffer && data + block.length[j] <= buffer + buffer_len);
+                CASE_EXPECT_EQ(0, memcmp(send_buf + offset, data, block.length[j]));
+                offset += block.length[j];
+            }
+
+            if (block.length[1] > 0) {
+                ++wrap_times;
+            }
+            CASE_EXPECT_EQ(0, mem_recv_release(channel, &block));
+        }
+
+        CASE_EXPECT_GT(wrap_times, 0);
+    }
+
+    delete[] buffer;
+}
+
+CASE_TEST(channel, mem_recv_batch) {
+    using namespace atbus::channel;
+    const size_t buffer_len = 64 * 1024; // 64KB，保证数据区会回绕
+    char *buffer = new char[buffer_len];
+
+    mem_channel *channel = NULL;
+
+    CASE_EXPECT_EQ(0, mem_init(buffer, buffer_len, &channel, NULL));
+    CASE_EXPECT_NE(NULL, channel);
+
+    char send_buf[256];
+    size_t send_index = 0, recv_index = 0;
+    for (size_t round = 0; round < 256; ++round) {
+        // 每轮写入多个小包，再批量读出
+        size_t send_num = 1 + round % 40;
+        for (size_t i = 0; i < send_num; ++i, ++send_index) {
+            size_t len = 16 + send_index % 200;
+            memset(send_buf, static_cast<char>(send_index & 0x7F), len);
+            CASE_EXPECT_EQ(0, mem_send(channel, send_buf, len));
+        }
+
+        mem_recv_block_t blocks[16];
+        while (recv_index < send_index) {
+            size_t count = 0;
+            CASE_EXPECT_EQ(0, mem_recv_batch(channel, blocks, 16, &count));
+            CASE_EXPECT_GT(count, 0);
+            CASE_EXPECT_LE(count, 16);
+            if (0 == count) {
+                break;
+            }
+
+            for (size_t i = 0; i < count; ++i, ++recv_index) {
+                CASE_EXPECT_EQ(16 + recv_index % 200, blocks[i].len);
+                CASE_EXPECT_EQ(blocks[i].len, blocks[i].length[0] + blocks[i].length[1]);
+
+                char c = static_cast<char>(recv_index & 0x7F);
+                const char *data = reinterpret_cast<const char *>(blocks[i].buffer[0]);
+                CASE_EXPECT_EQ(c, data[0]);
+                if (blocks[i].length[1] > 0) {
+                    data = reinterpret_cast<const char *>(blocks[i].buffer[1]);
+                    CASE_EXPECT_EQ(c, data[blocks[i].length[1] - 1]);
+                } else {
+                    CASE_EXPECT_EQ(c, data[blocks[i].length[0] - 1]);
+                }
+            }
+
+            CASE_EXPECT_EQ(0, mem_recv_batch_release(channel, blocks, count));
+        }
+    }
+
+    CASE_EXPECT_EQ(send_index, recv_index);
+    {
+        size_t count = 0;
+        mem_recv_block_t block;
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_NO_DATA, mem_recv_batch(channel, &block, 1, &count));
+        CASE_EXPECT_EQ(0, count);
+    }
+
+    delete[] buffer;
+}
+
+CASE_TEST(channel, mem_send_batch) {
+    using namespace atbus::channel;
+    const size_t buffer_len = 64 * 1024; // 64KB，保证数据区会回绕
+    char *buffer = new char[buffer_len];
+
+    mem_channel *channel = NULL;
+
+    CASE_EXPECT_EQ(0, mem_init(buffer, buffer_len, &channel, NULL));
+    CASE_EXPECT_NE(NULL, channel);
+
+    char send_buf[64][256];
+    channel_iovec_t iov[64];
+    char recv_buf[256];
+    size_t send_index = 0, recv_index = 0;
+    for (size_t round = 0; round < 256; ++round) {
+        size_t send_num = 1 + round % 64;
+        for (size_t i = 0; i < send_num; ++i) {
+            iov[i].len = 16 + (send_index + i) % 200;
+            iov[i].base = send_buf[i];
+            memset(send_buf[i], static_cast<char>((send_index + i) & 0x7F), iov[i].len);
+        }
+
+        size_t sent_count = 0;
+        CASE_EXPECT_EQ(0, mem_send_batch(channel, iov, send_num, &sent_count));
+        CASE_EXPECT_EQ(send_num, sent_count);
+        send_index += sent_count;
+
+        while (recv_index < send_index) {
+            size_t recv_len = 0;
+            CASE_EXPECT_EQ(0, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+            CASE_EXPECT_EQ(16 + recv_index % 200, recv_len);
+            CASE_EXPECT_EQ(static_cast<char>(recv_index & 0x7F), recv_buf[0]);
+            CASE_EXPECT_EQ(static_cast<char>(recv_index & 0x7F), recv_buf[recv_len - 1]);
+            ++recv_index;
+        }
+    }
+
+    // 空间不足时只发送前面一部分
+    {
+        for (size_t i = 0; i < 64; ++i) {
+            iov[i].len = 256;
+            iov[i].base = send_buf[0];
+        }
+
+        size_t sent_sum = 0, sent_count = 0;
+        int res = 0;
+        while (0 == res) {
+            res = mem_send_batch(channel, iov, 64, &sent_count);
+            sent_sum += sent_count;
+        }
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_BUFF_LIMIT, res);
+        CASE_EXPECT_EQ(0, sent_count);
+        CASE_EXPECT_GT(sent_sum, 0);
+
+        for (size_t i = 0; i < sent_sum; ++i) {
+            size_t recv_len = 0;
+            CASE_EXPECT_EQ(0, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+            CASE_EXPECT_EQ(256, recv_len);
+        }
+
+        size_t recv_len = 0;
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_NO_DATA, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+    }
+
+    delete[] buffer;
+}
+
+// 批量发送中间的数据块初始化时发生写冲突，接收端要直接跳过没写入的数据块，不能等到写入超时
+CASE_TEST(channel, mem_send_batch_conflict) {
+    using namespace atbus::channel;
+    const size_t buffer_len = 64 * 1024;
+    char *buffer = new char[buffer_len];
+
+    mem_channel *channel = NULL;
+
+    CASE_EXPECT_EQ(0, mem_init(buffer, buffer_len, &channel, NULL));
+    CASE_EXPECT_NE(NULL, channel);
+
+    // 加上数据头以后每条消息占两个node
+    char send_buf[3][ATBUS_MACRO_DATA_NODE_SIZE];
+    channel_iovec_t iov[3];
+    for (size_t i = 0; i < 3; ++i) {
+        memset(send_buf[i], static_cast<char>('a' + i), sizeof(send_buf[i]));
+        iov[i].base = send_buf[i];
+        iov[i].len = sizeof(send_buf[i]);
+    }
+
+    // 通道头部对齐到4KB，后面是每个node的头部(flag, operation_seq)
+    // 在第二条消息的第二个node上伪造一个其他写者的操作序号
+    uint32_t *node_heads = reinterpret_cast<uint32_t *>(buffer + 4 * 1024);
+    node_heads[3 * 2 + 1] = 1;
+
+    size_t sent_count = 0;
+    CASE_EXPECT_EQ(0, mem_send_batch(channel, iov, 3, &sent_count));
+    CASE_EXPECT_EQ(3, sent_count);
+
+    for (size_t i = 0; i < 3; ++i) {
+        char recv_buf[ATBUS_MACRO_DATA_NODE_SIZE];
+        size_t recv_len = 0;
+        CASE_EXPECT_EQ(0, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+        CASE_EXPECT_EQ(sizeof(recv_buf), recv_len);
+        CASE_EXPECT_EQ(static_cast<char>('a' + i), recv_buf[0]);
+        CASE_EXPECT_EQ(static_cast<char>('a' + i), recv_buf[recv_len - 1]);
+    }
+
+    size_t recv_len = 0;
+    char recv_buf[ATBUS_MACRO_DATA_NODE_SIZE];
+    CASE_EXPECT_EQ(EN_ATBUS_ERR_NO_DATA, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+
+    delete[] buffer;
+}
+
+CASE_TEST(channel, mem_sendv) {
+    using namespace atbus::channel;
+    const size_t buffer_len = 64 * 1024; // 64KB，保证数据区会回绕
+    char *buffer = new char[buffer_len];
+
+    typedef int (*init_fn_t)(void *, size_t, mem_channel **, const mem_conf *);
+    init_fn_t init_fns[] = {mem_init, mem_init_v1, mem_init_record};
+
+    char send_buf[1024];
+    char recv_buf[1024];
+    for (size_t i = 0; i < sizeof(send_buf); ++i) {
+        send_buf[i] = static_cast<char>(rand());
+    }
+
+    for (size_t f = 0; f < sizeof(init_fns) / sizeof(init_fns[0]); ++f) {
+        mem_channel *channel = NULL;
+        CASE_EXPECT_EQ(0, init_fns[f](buffer, buffer_len, &channel, NULL));
+        CASE_EXPECT_NE(NULL, channel);
+
+        for (size_t round = 0; round < 1024; ++round) {
+            // 拆成若干段，包括空的数据段
+            channel_iovec_t iov[4];
+            size_t total_len = 1 + (round * 37) % sizeof(send_buf);
+            size_t off = 0;
+            for (size_t i = 0; i < 4; ++i) {
+                iov[i].base = send_buf + off;
+                iov[i].len = 3 == i ? total_len - off : (total_len - off) / (2 + round % 3);
+                off += iov[i].len;
+            }
+
+            CASE_EXPECT_EQ(0, mem_sendv(channel, iov, 4));
+
+            size_t recv_len = 0;
+            CASE_EXPECT_EQ(0, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+            CASE_EXPECT_EQ(total_len, recv_len);
+            CASE_EXPECT_EQ(0, memcmp(send_buf, recv_buf, total_len));
+        }
+    }
+
+    delete[] buffer;
+}
+
+CASE_TEST(channel, mem_v1_compat) {
+    using namespace atbus::channel;
+    const size_t buffer_len = 64 * 1024; // 64KB，保证数据区会回绕
+    char *buffer = new char[buffer_len];
+
+    mem_channel *channel = NULL;
+
+    CASE_EXPECT_EQ(0, mem_init_v1(buffer, buffer_len, &channel, NULL));
+    CASE_EXPECT_NE(NULL, channel);
+
+    // attach能识别旧版本的通道头
+    {
+        mem_channel *attached = NULL;
+        CASE_EXPECT_EQ(0, mem_attach(buffer, buffer_len, &attached, NULL));
+        CASE_EXPECT_EQ(channel, attached);
+    }
+
+    char send_buf[1024];
+    char recv_buf[1024];
+    for (size_t round = 0; round < 1024; ++round) {
+        size_t len = 1 + (round * 37) % 1000;
+        memset(send_buf, static_cast<char>(round & 0x7F), len);
+        CASE_EXPECT_EQ(0, mem_send(channel, send_buf, len));
+
+        size_t recv_len = 0;
+        CASE_EXPECT_EQ(0, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+        CASE_EXPECT_EQ(len, recv_len);
+        CASE_EXPECT_EQ(static_cast<char>(round & 0x7F), recv_buf[recv_len - 1]);
+    }
+
+    delete[] buffer;
+}
+
+CASE_TEST(channel, mem_magic_case_insensitive) {
+    using namespace atbus::channel;
+    const size_t buffer_len = 64 * 1024;
+    char *buffer = new char[buffer_len];
+
+    typedef int (*init_fn_t)(void *, size_t, mem_channel **, const mem_conf *);
+    init_fn_t init_fns[] = {mem_init, mem_init_record};
+    const char *magics[] = {"ATBUSMM2", "ATBUSREC"};
+
+    char send_buf[256];
+    char recv_buf[256];
+    for (size_t f = 0; f < sizeof(init_fns) / sizeof(init_fns[0]); ++f) {
+        mem_channel *channel = NULL;
+        CASE_EXPECT_EQ(0, init_fns[f](buffer, buffer_len, &channel, NULL));
+        CASE_EXPECT_EQ(0, mem_set_checksum(channel, mem_checksum_t::EN_MCS_CRC32C));
+
+        // 魔术串改成小写，attach接受的通道头必须按同样的格式读写
+        char *magic = NULL;
+        for (size_t i = 0; i + 8 <= 256; ++i) {
+            if (0 == memcmp(buffer + i, magics[f], 8)) {
+                magic = buffer + i;
+                break;
+            }
+        }
+        CASE_EXPECT_NE(NULL, magic);
+        if (NULL == magic) {
+            continue;
+        }
+        for (size_t i = 0; i < 8; ++i) {
+            magic[i] = static_cast<char>(tolower(magic[i]));
+        }
+
+        mem_channel *attached = NULL;
+        CASE_EXPECT_EQ(0, mem_attach(buffer, buffer_len, &attached, NULL));
+        CASE_EXPECT_EQ(channel, attached);
+        CASE_EXPECT_EQ(mem_checksum_t::EN_MCS_CRC32C, mem_get_checksum(attached));
+
+        for (size_t round = 0; round < 512; ++round) {
+            size_t len = 1 + (round * 37) % sizeof(send_buf);
+            memset(send_buf, static_cast<char>(round & 0x7F), len);
+            CASE_EXPECT_EQ(0, mem_send(attached, send_buf, len));
+
+            size_t recv_len = 0;
+            CASE_EXPECT_EQ(0, mem_recv(attached, recv_buf, sizeof(recv_buf), &recv_len));
+            CASE_EXPECT_EQ(len, recv_len);
+            CASE_EXPECT_EQ(0, memcmp(send_buf, recv_buf, len));
+        }
+    }
+
+    delete[] buffer;
+}
+
+CASE_TEST(channel, mem_fill_drain) {
+    using namespace atbus::channel;
+    const size_t buffer_len = 64 * 1024;
+    char *buffer = new char[buffer_len];
+
+    typedef int (*init_fn_t)(void *, size_t, mem_channel **, const mem_conf *);
+    init_fn_t init_fns[] = {mem_init, mem_init_v1, mem_init_record};
+
+    char send_buf[1000];
+    char recv_buf[1024];
+    memset(send_buf, 0x5A, sizeof(send_buf));
+    for (size_t f = 0; f < sizeof(init_fns) / sizeof(init_fns[0]); ++f) {
+        mem_channel *channel = NULL;
+        CASE_EXPECT_EQ(0, init_fns[f](buffer, buffer_len, &channel, NULL));
+
+        // 写满后读空再写满，写端缓存的读游标和读端缓存的写游标都要能刷新
+        size_t first_sent = 0;
+        for (int i = 0; i < 4; ++i) {
+            size_t sent = 0;
+            while (0 == mem_send(channel, send_buf, sizeof(send_buf))) {
+                ++sent;
+            }
+            CASE_EXPECT_GT(sent, 0);
+            if (0 == i) {
+                first_sent = sent;
+            }
+            // 每一轮可写入的数量不会因为缓存的游标变少
+            CASE_EXPECT_GE(sent + 1, first_sent);
+
+            size_t used_size = 0, capacity = 0;
+            CASE_EXPECT_EQ(0, mem_get_usage(channel, &used_size, &capacity));
+            CASE_EXPECT_GE(used_size, sent * sizeof(send_buf));
+            CASE_EXPECT_LE(used_size, capacity);
+
+            size_t recv_len = 0;
+            for (size_t j = 0; j < sent; ++j) {
+                CASE_EXPECT_EQ(0, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+                CASE_EXPECT_EQ(sizeof(send_buf), recv_len);
+            }
+            CASE_EXPECT_EQ(EN_ATBUS_ERR_NO_DATA, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+            CASE_EXPECT_EQ(0, mem_get_usage(channel, &used_size, NULL));
+            CASE_EXPECT_EQ(0, used_size);
+        }
+    }
+
+    delete[] buffer;
+}
+
+CASE_TEST(channel, mem_checksum_modes) {
+    using namespace atbus::channel;
+    const size_t buffer_len = 64 * 1024;
+    char *buffer = new char[buffer_len];
+
+    // v1通道头只支持murmur3
+    {
+        mem_channel *channel = NULL;
+        CASE_EXPECT_EQ(0, mem_init_v1(buffer, buffer_len, &channel, NULL));
+        CASE_EXPECT_EQ(0, mem_set_checksum(channel, mem_checksum_t::EN_MCS_MURMUR3));
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_PARAMS, mem_set_checksum(channel, mem_checksum_t::EN_MCS_CRC32C));
+        CASE_EXPECT_EQ(mem_checksum_t::EN_MCS_MURMUR3, mem_get_checksum(channel));
+    }
+
+    typedef int (*init_fn_t)(void *, size_t, mem_channel **, const mem_conf *);
+    init_fn_t init_fns[] = {mem_init, mem_init_record};
+
+    char send_buf[1000];
+    char recv_buf[1024];
+    for (size_t f = 0; f < sizeof(init_fns) / sizeof(init_fns[0]); ++f) {
+        for (uint32_t mode = 0; mode < mem_checksum_t::EN_MCS_MAX; ++mode) {
+            mem_channel *channel = NULL;
+            CASE_EXPECT_EQ(0, init_fns[f](buffer, buffer_len, &channel, NULL));
+            CASE_EXPECT_EQ(mem_checksum_t::EN_MCS_MURMUR3, mem_get_checksum(channel));
+            CASE_EXPECT_EQ(0, mem_set_checksum(channel, mode));
+            CASE_EXPECT_EQ(mode, mem_get_checksum(channel));
+
+            // attach以后读到的是同一个校验方式
+            {
+                mem_channel *attached = NULL;
+                CASE_EXPECT_EQ(0, mem_attach(buffer, buffer_len, &attached, NULL));
+                CASE_EXPECT_EQ(mode, mem_get_checksum(attached));
+            }
+
+            // 足够多轮保证数据块会在通道尾部回绕
+            size_t recv_len = 0;
+            for (size_t round = 0; round < 512; ++round) {
+                size_t len = 1 + (round * 37) % sizeof(send_buf);
+                // 每个字节都不一样，分段校验拼错位置时才能发现
+                for (size_t i = 0; i < len; ++i) {
+                    send_buf[i] = static_cast<char>((round + mode + i * 7) & 0xFF);
+                }
+
+                if (round & 0x01) {
+                    CASE_EXPECT_EQ(0, mem_send(channel, send_buf, len));
+                } else {
+                    mem_reserved_block_t block;
+                    CASE_EXPECT_EQ(0, mem_send_reserve(channel, len, &block));
+                    memcpy(block.buffer[0], send_buf, block.length[0]);
+                    if (block.length[1] > 0) {
+                        memcpy(block.buffer[1], send_buf + block.length[0], block.length[1]);
+                    }
+                    CASE_EXPECT_EQ(0, mem_send_commit(channel, &block));
+                }
+
+                CASE_EXPECT_EQ(0, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+                CASE_EXPECT_EQ(len, recv_len);
+                CASE_EXPECT_EQ(0, memcmp(send_buf, recv_buf, len));
+            }
+
+            // 提交后再改数据，只有校验数据内容的方式能发现
+            {
+                memset(send_buf, 0x3C, 64);
+                mem_reserved_block_t block;
+                CASE_EXPECT_EQ(0, mem_send_reserve(channel, 64, &block));
+                memcpy(block.buffer[0], send_buf, block.length[0]);
+                if (block.length[1] > 0) {
+                    memcpy(block.buffer[1], send_buf + block.length[0], block.length[1]);
+                }
+                CASE_EXPECT_EQ(0, mem_send_commit(channel, &block));
+                static_cast<char *>(block.buffer[0])[0] ^= 0x01;
+
+                int res = mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len);
+                if (mem_checksum_t::EN_MCS_NONE == mode || mem_checksum_t::EN_MCS_HEADER == mode) {
+                    CASE_EXPECT_EQ(0, res);
+                    CASE_EXPECT_EQ(64, recv_len);
+                } else {
+                    CASE_EXPECT_EQ(EN_ATBUS_ERR_BAD_DATA, res);
+                }
+            }
+        }
+    }
+
+    delete[] buffer;
+}
+
+CASE_TEST(channel, mem_doorbell) {
+    using namespace atbus::channel;
+    const size_t buffer_len = 64 * 1024;
+    char *buffer = new char[buffer_len];
+
+    // v1通道头没有门铃
+    {
+        mem_channel *channel = NULL;
+        CASE_EXPECT_EQ(0, mem_init_v1(buffer, buffer_len, &channel, NULL));
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_ACCESS_DENY, mem_set_doorbell(channel, "libatbus_unit_test_doorbell"));
+        CASE_EXPECT_FALSE(mem_doorbell_sleep(channel));
+    }
+
+    typedef int (*init_fn_t)(void *, size_t, mem_channel **, const mem_conf *);
+    init_fn_t init_fns[] = {mem_init, mem_init_record};
+
+    char send_buf[128] = {0};
+    char recv_buf[128];
+    for (size_t f = 0; f < sizeof(init_fns) / sizeof(init_fns[0]); ++f) {
+        mem_channel *channel = NULL;
+        CASE_EXPECT_EQ(0, init_fns[f](buffer, buffer_len, &channel, NULL));
+
+        // 没有设置门铃时不能休眠
+        CASE_EXPECT_FALSE(mem_doorbell_sleep(channel));
+
+        std::string too_long(256, 'a');
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_PARAMS, mem_set_doorbell(channel, too_long.c_str()));
+
+#ifdef ATBUS_CHANNEL_DOORBELL
+        const char *name = "libatbus_unit_test_doorbell";
+        atbus::adapter::fd_t fd = -1;
+        CASE_EXPECT_EQ(0, doorbell_open(name, &fd));
+        CASE_EXPECT_EQ(0, mem_set_doorbell(channel, name));
+
+        // 通道为空时可以休眠，发送数据以后门铃的fd可读
+        CASE_EXPECT_TRUE(mem_doorbell_sleep(channel));
+        CASE_EXPECT_EQ(0, mem_send(channel, send_buf, sizeof(send_buf)));
+        CASE_EXPECT_EQ(1, recv(fd, recv_buf, sizeof(recv_buf), MSG_DONTWAIT));
+
+        // 有数据时不能休眠，也不会再按门铃
+        CASE_EXPECT_FALSE(mem_doorbell_sleep(channel));
+        CASE_EXPECT_EQ(0, mem_send(channel, send_buf, sizeof(send_buf)));
+        CASE_EXPECT_EQ(-1, recv(fd, recv_buf, sizeof(recv_buf), MSG_DONTWAIT));
+
+        size_t recv_len = 0;
+        CASE_EXPECT_EQ(0, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+        CASE_EXPECT_EQ(0, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+
+        // 醒来以后发送端不再按门铃
+        CASE_EXPECT_TRUE(mem_doorbell_sleep(channel));
+        mem_doorbell_wakeup(channel);
+        CASE_EXPECT_EQ(0, mem_send(channel, send_buf, sizeof(send_buf)));
+        CASE_EXPECT_EQ(-1, recv(fd, recv_buf, sizeof(recv_buf), MSG_DONTWAIT));
+        CASE_EXPECT_EQ(0, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+
+        // 关闭门铃
+        CASE_EXPECT_EQ(0, mem_set_doorbell(channel, NULL));
+        CASE_EXPECT_FALSE(mem_doorbell_sleep(channel));
+        CASE_EXPECT_EQ(0, doorbell_close(fd));
+#endif
+    }
+
+    delete[] buffer;
+}
+
+CASE_TEST(channel, mem_record_siso) {
+    using namespace atbus::channel;
+    const size_t buffer_len = 64 * 1024; // 64KB，保证数据区会回绕并出现末尾的空记录
+    char *buffer = new char[buffer_len];
+
+    mem_channel *channel = NULL;
+
+    CASE_EXPECT_EQ(0, mem_init_record(buffer, buffer_len, &channel, NULL));
+    CASE_EXPECT_NE(NULL, channel);
+
+    // attach能识别变长记录格式
+    {
+        mem_channel *attached = NULL;
+        CASE_EXPECT_EQ(0, mem_attach(buffer, buffer_len, &attached, NULL));
+        CASE_EXPECT_EQ(channel, attached);
+    }
+
+    char send_buf[1024];
+    char recv_buf[1024];
+    size_t send_index = 0, recv_index = 0;
+    for (size_t round = 0; round < 4096; ++round) {
+        // 长度不是对齐单位的整数倍，并且每轮都不一样
+        size_t len = 1 + (round * 37) % 1000;
+        memset(send_buf, static_cast<char>(round & 0x7F), len);
+
+        if (round & 0x01) {
+            CASE_EXPECT_EQ(0, mem_send(channel, send_buf, len));
+        } else {
+            mem_reserved_block_t block;
+            CASE_EXPECT_EQ(0, mem_send_reserve(channel, len, &block));
+            // 变长记录的数据区一定是连续的
+            CASE_EXPECT_EQ(len, block.length[0]);
+            CASE_EXPECT_EQ(0, block.length[1]);
+            memcpy(block.buffer[0], send_buf, len);
+            CASE_EXPECT_EQ(0, mem_send_commit(channel, &block));
+        }
+        ++send_index;
+
+        // 每3个消息用不同的方式读一次
+        if (2 != round % 3) {
+            continue;
+        }
+
+        if (round & 0x01) {
+            while (recv_index < send_index) {
+                size_t recv_len = 0;
+                CASE_EXPECT_EQ(0, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+                CASE_EXPECT_EQ(1 + (recv_index * 37) % 1000, recv_len);
+                CASE_EXPECT_EQ(static_cast<char>(recv_index & 0x7F), recv_buf[0]);
+                CASE_EXPECT_EQ(static_cast<char>(recv_index & 0x7F), recv_buf[recv_len - 1]);
+                ++recv_index;
+            }
+        } else {
+            mem_recv_block_t blocks[4];
+            size_t count = 0;
+            CASE_EXPECT_EQ(0, mem_recv_batch(channel, blocks, 4, &count));
+            CASE_EXPECT_EQ(send_index - recv_index, count);
+            for (size_t i = 0; i < count; ++i) {
+                CASE_EXPECT_EQ(1 + ((recv_index + i) * 37) % 1000, blocks[i].len);
+                CASE_EXPECT_EQ(0, blocks[i].length[1]);
+                CASE_EXPECT_EQ(static_cast<char>((recv_index + i) & 0x7F), ((const char *)blocks[i].buffer[0])[0]);
+            }
+            CASE_EXPECT_EQ(0, mem_recv_batch_release(channel, blocks, count));
+            recv_index += count;
+        }
+    }
+
+    size_t recv_len = 0;
+    for (; recv_index < send_index; ++recv_index) {
+        CASE_EXPECT_EQ(0, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+        CASE_EXPECT_EQ(1 + (recv_index * 37) % 1000, recv_len);
+    }
+    CASE_EXPECT_EQ(EN_ATBUS_ERR_NO_DATA, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+
+    // 批量发送，空间不足时只发送前面一部分
+    {
+        channel_iovec_t iov[64];
+        for (size_t i = 0; i < 64; ++i) {
+            iov[i].len = 100 + i;
+            iov[i].base = send_buf;
+        }
+
+        size_t sent_sum = 0, sent_count = 0;
+        int res = 0;
+        while (0 == res) {
+            res = mem_send_batch(channel, iov, 64, &sent_count);
+            sent_sum += sent_count;
+        }
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_BUFF_LIMIT, res);
+        CASE_EXPECT_EQ(0, sent_count);
+        CASE_EXPECT_GT(sent_sum, 0);
+
+        for (size_t i = 0; i < sent_sum; ++i) {
+            CASE_EXPECT_EQ(0, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+            CASE_EXPECT_GE(recv_len, 100);
+            CASE_EXPECT_LT(recv_len, 164);
+        }
+
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_NO_DATA, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+    }
+
+    // 单个消息最多可以用满保护区以外的整个数据区
+    {
+        size_t capacity = 0;
+        CASE_EXPECT_EQ(0, mem_get_usage(channel, NULL, &capacity));
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_BUFF_LIMIT, mem_send(channel, buffer, capacity));
+
+        size_t big_len = capacity - 64;
+        char *big_send_buf = new char[big_len];
+        char *big_recv_buf = new char[big_len];
+        for (size_t i = 0; i < 3; ++i) {
+            memset(big_send_buf, static_cast<char>(0x30 + i), big_len);
+
+            // 写游标不在数据区开头时先单独写入末尾的空记录，接收端跳过以后才能放下整个消息
+            int res = mem_send(channel, big_send_buf, big_len);
+            if (0 != i) {
+                CASE_EXPECT_EQ(EN_ATBUS_ERR_BUFF_LIMIT, res);
+            }
+            if (EN_ATBUS_ERR_BUFF_LIMIT == res) {
+                CASE_EXPECT_EQ(EN_ATBUS_ERR_NO_DATA, mem_recv(channel, big_recv_buf, big_len, &recv_len));
+                res = mem_send(channel, big_send_buf, big_len);
+            }
+            CASE_EXPECT_EQ(0, res);
+
+            CASE_EXPECT_EQ(0, mem_recv(channel, big_recv_buf, big_len, &recv_len));
+            CASE_EXPECT_EQ(big_len, recv_len);
+            CASE_EXPECT_EQ(0, memcmp(big_send_buf, big_recv_buf, big_len));
+        }
+
+        // 批量发送也会先写入末尾的空记录
+        {
+            channel_iovec_t iov[2];
+            iov[0].base = big_send_buf;
+            iov[0].len = big_len;
+            iov[1].base = send_buf;
+            iov[1].len = 100;
+
+            size_t sent_count = 0;
+            CASE_EXPECT_EQ(0, mem_send(channel, send_buf, 100));
+            CASE_EXPECT_EQ(0, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+            CASE_EXPECT_EQ(EN_ATBUS_ERR_BUFF_LIMIT, mem_send_batch(channel, iov, 2, &sent_count));
+            CASE_EXPECT_EQ(0, sent_count);
+            CASE_EXPECT_EQ(EN_ATBUS_ERR_NO_DATA, mem_recv(channel, big_recv_buf, big_len, &recv_len));
+            CASE_EXPECT_EQ(0, mem_send_batch(channel, iov, 1, &sent_count));
+            CASE_EXPECT_EQ(1, sent_count);
+            CASE_EXPECT_EQ(0, mem_recv(channel, big_recv_buf, big_len, &recv_len));
+            CASE_EXPECT_EQ(big_len, recv_len);
+        }
+
+        delete[] big_send_buf;
+        delete[] big_recv_buf;
+    }
+
+    delete[] buffer;
+}
+
+CASE_TEST(channel, mem_record_timeout) {
+    using namespace atbus::channel;
+    const size_t buffer_len = 16 * 1024;
+    char *buffer = new char[buffer_len];
+
+    mem_channel *channel = NULL;
+    CASE_EXPECT_EQ(0, mem_init_record(buffer, buffer_len, &channel, NULL));
+
+    // 预留后不提交，接收端超时后跳过这个记录
+    mem_reserved_block_t block;
+    CASE_EXPECT_EQ(0, mem_send_reserve(channel, 100, &block));
+    CASE_EXPECT_EQ(0, mem_send(channel, "hello", 5));
+
+    char recv_buf[256];
+    size_t recv_len = 0;
+    int res = EN_ATBUS_ERR_NO_DATA;
+    for (int i = 0; i < 1000 && EN_ATBUS_ERR_NO_DATA == res; ++i) {
+        res = mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len);
+        if (EN_ATBUS_ERR_NO_DATA == res) {
+            CASE_THREAD_SLEEP_MS(1);
+        }
+    }
+
+    CASE_EXPECT_EQ(0, res);
+    CASE_EXPECT_EQ(5, recv_len);
+    CASE_EXPECT_EQ(0, memcmp(recv_buf, "hello", 5));
+
+    // 被跳过的记录不会再被读到
+    CASE_EXPECT_EQ(EN_ATBUS_ERR_NO_DATA, mem_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+
+    delete[] buffer;
+}
+
 #if defined(UTIL_CONFIG_COMPILER_CXX_LAMBDAS) && UTIL_CONFIG_COMPILER_CXX_LAMBDAS
 
 CASE_TEST(channel, mem_miso) {
@@ -0,0 +1,84 @@
+﻿#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include <unistd.h>
+
+#include "common/string_oprs.h"
+
+#include "detail/libatbus_channel_export.h"
+#include "frame/test_macros.h"
+#include <detail/libatbus_error.h>
+
+#ifdef ATBUS_CHANNEL_SHM_POSIX
+
+static void channel_shm_posix_test_run(const char *name, int flags) {
+    using namespace atbus::channel;
+    const size_t buffer_len = 512 * 1024;
+
+    shm_posix_unlink(name);
+    CASE_EXPECT_EQ(EN_ATBUS_ERR_SHM_NOT_FOUND, shm_posix_attach(name, buffer_len, NULL, NULL, flags));
+
+    shm_channel *channel = NULL;
+    CASE_EXPECT_EQ(0, shm_posix_init(name, buffer_len, &channel, NULL, flags));
+    CASE_EXPECT_NE(NULL, channel);
+
+    char send_buf[1000];
+    char recv_buf[1024];
+    for (size_t i = 0; i < sizeof(send_buf); ++i) {
+        send_buf[i] = static_cast<char>(i & 0x7F);
+    }
+    CASE_EXPECT_EQ(0, shm_send(channel, send_buf, sizeof(send_buf)));
+
+    // 解除映射后重新附加，数据还在共享内存里
+    CASE_EXPECT_EQ(0, shm_posix_close(name));
+    CASE_EXPECT_EQ(EN_ATBUS_ERR_SHM_NOT_FOUND, shm_posix_close(name));
+
+    // 附加时以已存在的长度为准，期望长度更大也可以附加
+    channel = NULL;
+    CASE_EXPECT_EQ(0, shm_posix_attach(name, buffer_len * 2, &channel, NULL, flags));
+    CASE_EXPECT_NE(NULL, channel);
+
+    size_t recv_len = 0;
+    CASE_EXPECT_EQ(0, shm_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+    CASE_EXPECT_EQ(sizeof(send_buf), recv_len);
+    CASE_EXPECT_EQ(0, memcmp(send_buf, recv_buf, sizeof(send_buf)));
+    CASE_EXPECT_EQ(EN_ATBUS_ERR_NO_DATA, shm_recv(channel, recv_buf, sizeof(recv_buf), &recv_len));
+
+    CASE_EXPECT_EQ(0, shm_posix_close(name));
+    CASE_EXPECT_EQ(0, shm_posix_unlink(name));
+    CASE_EXPECT_EQ(EN_ATBUS_ERR_SHM_NOT_FOUND, shm_posix_unlink(name));
+}
+
+CASE_TEST(channel, shm_posix_siso) {
+    char name[64] = {0};
+    UTIL_STRFUNC_SNPRINTF(name, sizeof(name), "atbus-unit-test-%d", static_cast<int>(getpid()));
+    channel_shm_posix_test_run(name, atbus::channel::shm_posix_flag_t::EN_SPF_NONE);
+
+    // 预先填充页表和锁定内存不影响读写
+    channel_shm_posix_test_run(name, atbus::channel::shm_posix_flag_t::EN_SPF_HUGEPAGE |
+                                         atbus::channel::shm_posix_flag_t::EN_SPF_POPULATE |
+                                         atbus::channel::shm_posix_flag_t::EN_SPF_MLOCK);
+}
+
+CASE_TEST(channel, shm_posix_file_path) {
+    // 带目录的名称当作文件路径，hugetlbfs挂载点下的文件也是这样使用的
+    char name[64] = {0};
+    UTIL_STRFUNC_SNPRINTF(name, sizeof(name), "/tmp/atbus-unit-test-%d.shm", static_cast<int>(getpid()));
+    channel_shm_posix_test_run(name, atbus::channel::shm_posix_flag_t::EN_SPF_POPULATE);
+
+    // 比通道头部还短的共享内存不能附加
+    FILE *f = fopen(name, "wb");
+    CASE_EXPECT_NE(NULL, f);
+    if (NULL != f) {
+        fwrite("atbus", 1, 5, f);
+        fclose(f);
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_CHANNEL_SIZE_TOO_SMALL,
+                       atbus::channel::shm_posix_attach(name, 512 * 1024, NULL, NULL, atbus::channel::shm_posix_flag_t::EN_SPF_NONE));
+        CASE_EXPECT_EQ(EN_ATBUS_ERR_SHM_NOT_FOUND, atbus::channel::shm_posix_close(name));
+        remove(name);
+    }
+}
+
+#endif
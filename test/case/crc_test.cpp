@@ -0,0 +1,92 @@
+﻿#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <detail/crc32.h>
+#include <detail/crc64.h>
+#include <detail/xxhash64.h>
+
+#include "frame/test_macros.h"
+
+// 逐位计算的参考实现
+static uint32_t crc_test_ref32(uint32_t poly, uint32_t crc, const unsigned char *s, size_t l) {
+    for (size_t i = 0; i < l; ++i) {
+        crc ^= s[i];
+        for (int k = 0; k < 8; ++k) {
+            crc = (crc >> 1) ^ ((crc & 1) ? poly : 0);
+        }
+    }
+    return crc;
+}
+
+static uint64_t crc_test_ref64(uint64_t crc, const unsigned char *s, size_t l) {
+    for (size_t i = 0; i < l; ++i) {
+        crc ^= s[i];
+        for (int k = 0; k < 8; ++k) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0x95AC9329AC4BC9B5ULL : 0);
+        }
+    }
+    return crc;
+}
+
+CASE_TEST(crc, check_value) {
+    const unsigned char *s = reinterpret_cast<const unsigned char *>("123456789");
+    CASE_EXPECT_EQ(0xCBF43926, ~atbus::detail::crc32(0xFFFFFFFF, s, 9));
+    CASE_EXPECT_EQ(0xE3069283, ~atbus::detail::crc32c(0xFFFFFFFF, s, 9));
+    CASE_EXPECT_EQ(0xE9C6D914C4B8D9CAULL, atbus::detail::crc64(0, s, 9));
+}
+
+CASE_TEST(crc, accelerated_equals_portable) {
+    std::vector<unsigned char> buffer(4096 + 16);
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = static_cast<unsigned char>(rand());
+    }
+
+    // 覆盖不对齐的起始地址、折叠的边界和查表的尾部
+    size_t lens[] = {0, 1, 7, 8, 15, 16, 63, 64, 65, 127, 128, 129, 191, 255, 256, 257, 1000, 4096};
+    for (size_t off = 0; off < 8; ++off) {
+        for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); ++i) {
+            const unsigned char *s = &buffer[off];
+            size_t l = lens[i];
+            uint32_t seed32 = static_cast<uint32_t>(rand());
+            uint64_t seed64 = (static_cast<uint64_t>(rand()) << 32) ^ static_cast<uint64_t>(rand());
+
+            uint32_t expect32 = crc_test_ref32(0xEDB88320, seed32, s, l);
+            CASE_EXPECT_EQ(expect32, atbus::detail::crc32(seed32, s, l));
+            CASE_EXPECT_EQ(expect32, atbus::detail::crc32_portable(seed32, s, l));
+
+            expect32 = crc_test_ref32(0x82F63B78, seed32, s, l);
+            CASE_EXPECT_EQ(expect32, atbus::detail::crc32c(seed32, s, l));
+            CASE_EXPECT_EQ(expect32, atbus::detail::crc32c_portable(seed32, s, l));
+
+            uint64_t expect64 = crc_test_ref64(seed64, s, l);
+            CASE_EXPECT_EQ(expect64, atbus::detail::crc64(seed64, s, l));
+            CASE_EXPECT_EQ(expect64, atbus::detail::crc64_portable(seed64, s, l));
+        }
+    }
+}
+
+CASE_TEST(crc, xxhash64_update) {
+    CASE_EXPECT_EQ(0xEF46DB3751D8E999ULL, atbus::detail::xxhash64(0, "", 0));
+    CASE_EXPECT_EQ(0x44BC2CF5AD770999ULL, atbus::detail::xxhash64(0, "abc", 3));
+
+    std::vector<unsigned char> buffer(1000);
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        buffer[i] = static_cast<unsigned char>(rand());
+    }
+
+    // 分段的位置覆盖块内、块边界和只有尾部的情况
+    size_t lens[] = {0, 1, 31, 32, 33, 64, 100, 1000};
+    for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); ++i) {
+        size_t l = lens[i];
+        uint64_t seed = static_cast<uint64_t>(rand());
+        uint64_t expect = atbus::detail::xxhash64(seed, &buffer[0], l);
+        for (size_t split = 0; split <= l; split += 1 + split / 4) {
+            atbus::detail::xxhash64_state state;
+            atbus::detail::xxhash64_init(state, seed);
+            atbus::detail::xxhash64_update(state, &buffer[0], split);
+            atbus::detail::xxhash64_update(state, &buffer[0] + split, l - split);
+            CASE_EXPECT_EQ(expect, atbus::detail::xxhash64_digest(state));
+        }
+    }
+}
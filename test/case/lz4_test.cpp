@@ -0,0 +1,87 @@
+﻿#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include <detail/lz4.h>
+
+#include "frame/test_macros.h"
+
+static void lz4_test_fill(std::vector<unsigned char> &buffer, int mode) {
+    const char *text = "{\"from\":10001,\"to\":10002,\"router\":[],\"content\":\"hello world\"}";
+    size_t text_len = strlen(text);
+    for (size_t i = 0; i < buffer.size(); ++i) {
+        switch (mode) {
+        case 0:
+            buffer[i] = 0;
+            break;
+        case 1:
+            buffer[i] = static_cast<unsigned char>(text[i % text_len]);
+            break;
+        default:
+            buffer[i] = static_cast<unsigned char>(rand());
+            break;
+        }
+    }
+}
+
+CASE_TEST(lz4, decompress_reference_block) {
+    // "abc" + 偏移3长度10的匹配 + 最后5字节字面量
+    const unsigned char block[] = {0x36, 'a', 'b', 'c', 0x03, 0x00, 0x50, 'b', 'c', 'a', 'b', 'c'};
+    char out[18];
+    CASE_EXPECT_TRUE(atbus::detail::lz4_decompress(block, sizeof(block), out, sizeof(out)));
+    CASE_EXPECT_EQ(0, memcmp(out, "abcabcabcabcabcabc", sizeof(out)));
+
+    // 长度必须刚好一致
+    CASE_EXPECT_FALSE(atbus::detail::lz4_decompress(block, sizeof(block), out, sizeof(out) - 1));
+}
+
+CASE_TEST(lz4, round_trip) {
+    size_t lens[] = {1, 12, 13, 100, 4096, 65536 + 100, 200000};
+    for (int mode = 0; mode < 3; ++mode) {
+        for (size_t i = 0; i < sizeof(lens) / sizeof(lens[0]); ++i) {
+            std::vector<unsigned char> src(lens[i]);
+            lz4_test_fill(src, mode);
+
+            std::vector<unsigned char> dst(atbus::detail::lz4_compress_bound(src.size()));
+            size_t dst_len = atbus::detail::lz4_compress(&src[0], src.size(), &dst[0], dst.size());
+            CASE_EXPECT_NE(0, dst_len);
+            CASE_EXPECT_LE(dst_len, dst.size());
+            if (mode < 2 && src.size() >= 4096) {
+                CASE_EXPECT_LT(dst_len, src.size() / 4);
+            }
+
+            std::vector<unsigned char> back(src.size());
+            CASE_EXPECT_TRUE(atbus::detail::lz4_decompress(&dst[0], dst_len, &back[0], back.size()));
+            CASE_EXPECT_TRUE(src == back);
+        }
+    }
+}
+
+CASE_TEST(lz4, bad_data) {
+    std::vector<unsigned char> src(4096);
+    lz4_test_fill(src, 1);
+
+    std::vector<unsigned char> dst(atbus::detail::lz4_compress_bound(src.size()));
+    size_t dst_len = atbus::detail::lz4_compress(&src[0], src.size(), &dst[0], dst.size());
+    CASE_EXPECT_NE(0, dst_len);
+
+    // 输出缓冲区不足
+    CASE_EXPECT_EQ(0, atbus::detail::lz4_compress(&src[0], src.size(), &dst[0], dst_len - 1));
+
+    std::vector<unsigned char> back(src.size());
+    // 截断
+    CASE_EXPECT_FALSE(atbus::detail::lz4_decompress(&dst[0], dst_len - 1, &back[0], back.size()));
+    CASE_EXPECT_FALSE(atbus::detail::lz4_decompress(&dst[0], dst_len / 2, &back[0], back.size()));
+
+    // 偏移超过已输出的数据
+    const unsigned char bad_offset[] = {0x10, 'a', 0x02, 0x00, 0x50, 'a', 'a', 'a', 'a', 'a'};
+    char out[10];
+    CASE_EXPECT_FALSE(atbus::detail::lz4_decompress(bad_offset, sizeof(bad_offset), out, sizeof(out)));
+
+    // 随机破坏的数据不能越界
+    for (int i = 0; i < 256; ++i) {
+        std::vector<unsigned char> broken(dst.begin(), dst.begin() + dst_len);
+        broken[static_cast<size_t>(rand()) % broken.size()] = static_cast<unsigned char>(rand());
+        atbus::detail::lz4_decompress(&broken[0], broken.size(), &back[0], back.size());
+    }
+}
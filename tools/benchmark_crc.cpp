@@ -0,0 +1,92 @@
+﻿#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+
+#include "algorithm/murmur_hash.h"
+#include "detail/crc32.h"
+#include "detail/crc64.h"
+#include "detail/xxhash64.h"
+
+// 防止编译器把结果没有被使用的计算优化掉
+static volatile uint64_t g_sink = 0;
+
+typedef uint64_t (*benchmark_fn_t)(const unsigned char *s, size_t l);
+
+static uint64_t bench_crc32(const unsigned char *s, size_t l) { return atbus::detail::crc32(0xFFFFFFFF, s, l); }
+static uint64_t bench_crc32_portable(const unsigned char *s, size_t l) { return atbus::detail::crc32_portable(0xFFFFFFFF, s, l); }
+static uint64_t bench_crc32c(const unsigned char *s, size_t l) { return atbus::detail::crc32c(0xFFFFFFFF, s, l); }
+static uint64_t bench_crc32c_portable(const unsigned char *s, size_t l) { return atbus::detail::crc32c_portable(0xFFFFFFFF, s, l); }
+static uint64_t bench_crc64(const unsigned char *s, size_t l) { return atbus::detail::crc64(0, s, l); }
+static uint64_t bench_crc64_portable(const unsigned char *s, size_t l) { return atbus::detail::crc64_portable(0, s, l); }
+static uint64_t bench_xxhash64(const unsigned char *s, size_t l) { return atbus::detail::xxhash64(0, s, l); }
+static uint64_t bench_murmur3(const unsigned char *s, size_t l) { return util::hash::murmur_hash3_x86_32(s, static_cast<int>(l), 0); }
+
+struct benchmark_case_t {
+    const char *name;
+    benchmark_fn_t fn;
+};
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && (0 == strcmp("-h", argv[1]) || 0 == strcmp("--help", argv[1]))) {
+        printf("usage: %s [data size] [total MB per case]\n", argv[0]);
+        printf("example: %s 16384 2048\n", argv[0]);
+        return 0;
+    }
+
+    size_t data_size = 16 * 1024;
+    size_t total_mb = 1024;
+    if (argc > 1) data_size = (size_t)strtol(argv[1], NULL, 10);
+    if (argc > 2) total_mb = (size_t)strtol(argv[2], NULL, 10);
+    if (0 == data_size) data_size = 1;
+    if (0 == total_mb) total_mb = 1;
+
+    // 多分配一个字节，从奇数地址开始计算，模拟没有对齐的数据
+    unsigned char *buffer = new unsigned char[data_size + 1];
+    srand(static_cast<unsigned>(time(NULL)));
+    for (size_t i = 0; i <= data_size; ++i) {
+        buffer[i] = static_cast<unsigned char>(rand());
+    }
+
+    benchmark_case_t cases[] = {
+        {"crc32", bench_crc32},     {"crc32(slicing-by-8)", bench_crc32_portable},
+        {"crc32c", bench_crc32c},   {"crc32c(slicing-by-8)", bench_crc32c_portable},
+        {"crc64", bench_crc64},     {"crc64(slicing-by-8)", bench_crc64_portable},
+        {"xxhash64", bench_xxhash64}, {"murmur3_x86_32", bench_murmur3},
+    };
+
+    // 同一个输入，加速版本和便携版本的结果必须一致
+    if (bench_crc32(buffer + 1, data_size) != bench_crc32_portable(buffer + 1, data_size) ||
+        bench_crc32c(buffer + 1, data_size) != bench_crc32c_portable(buffer + 1, data_size) ||
+        bench_crc64(buffer + 1, data_size) != bench_crc64_portable(buffer + 1, data_size)) {
+        std::cerr << "[  FAILED  ] accelerated and portable crc mismatch" << std::endl;
+        delete[] buffer;
+        return 1;
+    }
+
+    size_t loops = (total_mb * 1024 * 1024) / data_size;
+    if (0 == loops) loops = 1;
+
+    std::cout << "[ RUNNING  ] data size: " << data_size << " Bytes, loops: " << loops << std::endl;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+        uint64_t sum = 0;
+        clock_t begin = clock();
+        for (size_t j = 0; j < loops; ++j) {
+            sum += cases[i].fn(buffer + 1, data_size);
+        }
+        clock_t end = clock();
+        g_sink = g_sink + sum;
+
+        double secs = static_cast<double>(end - begin) / CLOCKS_PER_SEC;
+        if (secs <= 0.0) secs = 1.0 / CLOCKS_PER_SEC;
+        double mbps = static_cast<double>(data_size) * static_cast<double>(loops) / secs / (1024.0 * 1024.0);
+        std::cout << "[ RUNNING  ] " << std::setw(22) << std::left << cases[i].name << std::right << std::setw(12) << std::fixed
+                  << std::setprecision(1) << mbps << " MB/s, " << std::setprecision(1)
+                  << (secs * 1000000000.0 / static_cast<double>(loops)) << " ns/op" << std::endl;
+    }
+
+    delete[] buffer;
+    return 0;
+}
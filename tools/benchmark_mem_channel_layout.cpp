@@ -0,0 +1,176 @@
+﻿#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <memory>
+#include <numeric>
+#include <thread>
+
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "config/compiler_features.h"
+#include "detail/libatbus_channel_export.h"
+#include "lock/atomic_int_type.h"
+#include <detail/libatbus_error.h>
+
+
+#ifdef max
+#undef max
+#endif
+
+#if defined(UTIL_CONFIG_COMPILER_CXX_LAMBDAS) && UTIL_CONFIG_COMPILER_CXX_LAMBDAS
+
+// 把线程绑定到指定的CPU上，用于对比同一个物理核、跨核和跨CPU插槽的情况
+static void bind_cpu(std::thread &thd, int cpu) {
+#if defined(__linux__)
+    if (cpu < 0) {
+        return;
+    }
+
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu, &cpuset);
+    if (0 != pthread_setaffinity_np(thd.native_handle(), sizeof(cpu_set_t), &cpuset)) {
+        fprintf(stderr, "bind thread to cpu %d failed\n", cpu);
+    }
+#else
+    (void)thd;
+    (void)cpu;
+#endif
+}
+
+int main(int argc, char *argv[]) {
+    if (argc < 2) {
+        printf("usage: %s <v1|v2|record> [producer cpu] [consumer cpu] [message size] [seconds] [channel size]\n", argv[0]);
+        printf("example: compare %s v1 0 <cpu on another socket> with %s v2 0 <cpu on another socket>\n", argv[0], argv[0]);
+        return 0;
+    }
+
+    using namespace atbus::channel;
+    int producer_cpu = -1;
+    int consumer_cpu = -1;
+    size_t msg_size = 64;
+    int secs = 10;
+    size_t buffer_len = 64 * 1024 * 1024; // 64MB
+    if (argc > 2) producer_cpu = (int)strtol(argv[2], NULL, 10);
+    if (argc > 3) consumer_cpu = (int)strtol(argv[3], NULL, 10);
+    if (argc > 4) msg_size = (size_t)strtol(argv[4], NULL, 10);
+    if (argc > 5) secs = (int)strtol(argv[5], NULL, 10);
+    if (argc > 6) buffer_len = (size_t)strtol(argv[6], NULL, 10);
+    if (0 == msg_size) msg_size = 1;
+
+    char *buffer = new char[buffer_len];
+    mem_channel *channel = NULL;
+    int res;
+    if (0 == strcmp("v1", argv[1])) {
+        res = mem_init_v1(buffer, buffer_len, &channel, NULL);
+    } else if (0 == strcmp("record", argv[1])) {
+        res = mem_init_record(buffer, buffer_len, &channel, NULL);
+    } else {
+        res = mem_init(buffer, buffer_len, &channel, NULL);
+    }
+
+    if (res < 0) {
+        fprintf(stderr, "mem_init failed, ret: %d\n", res);
+        delete[] buffer;
+        return res;
+    }
+
+    util::lock::atomic_int_type<int> running;
+    running.store(1);
+    util::lock::atomic_int_type<size_t> sum_send_times;
+    sum_send_times.store(0);
+    util::lock::atomic_int_type<size_t> sum_send_full;
+    sum_send_full.store(0);
+    util::lock::atomic_int_type<size_t> sum_recv_times;
+    sum_recv_times.store(0);
+    util::lock::atomic_int_type<size_t> sum_recv_empty;
+    sum_recv_empty.store(0);
+
+    // 写线程，满了就原地重试，只统计通道本身的开销
+    std::thread write_thread([&] {
+        char *buf = new char[msg_size];
+        memset(buf, 0x5A, msg_size);
+        size_t send_times = 0, send_full = 0;
+        while (running.load()) {
+            if (0 == mem_send(channel, buf, msg_size)) {
+                ++send_times;
+            } else {
+                ++send_full;
+            }
+
+            if (0 == ((send_times + send_full) & 0xFFF)) {
+                sum_send_times.store(send_times);
+                sum_send_full.store(send_full);
+            }
+        }
+
+        sum_send_times.store(send_times);
+        sum_send_full.store(send_full);
+        delete[] buf;
+    });
+
+    // 读线程
+    std::thread read_thread([&] {
+        char *buf = new char[msg_size];
+        size_t recv_times = 0, recv_empty = 0;
+        while (running.load()) {
+            size_t len = 0;
+            if (0 == mem_recv(channel, buf, msg_size, &len)) {
+                ++recv_times;
+            } else {
+                ++recv_empty;
+            }
+
+            if (0 == ((recv_times + recv_empty) & 0xFFF)) {
+                sum_recv_times.store(recv_times);
+                sum_recv_empty.store(recv_empty);
+            }
+        }
+
+        sum_recv_times.store(recv_times);
+        sum_recv_empty.store(recv_empty);
+        delete[] buf;
+    });
+
+    bind_cpu(write_thread, producer_cpu);
+    bind_cpu(read_thread, consumer_cpu);
+
+    size_t last_recv_times = 0;
+    for (int i = 1; i <= secs; ++i) {
+        std::this_thread::sleep_for(std::chrono::seconds(1));
+        size_t recv_times = sum_recv_times.load();
+
+        std::cout << "[ RUNNING  ] NO." << i << " s, layout: " << argv[1] << ", " << (recv_times - last_recv_times) << " msg/s, "
+                  << ((recv_times - last_recv_times) * msg_size / (1UL << 20)) << " MB/s" << std::endl;
+        last_recv_times = recv_times;
+    }
+
+    running.store(0);
+    write_thread.join();
+    read_thread.join();
+
+    std::cout << "[ RUNNING  ] total: send " << sum_send_times.load() << " times, full " << sum_send_full.load() << " times, recv "
+              << sum_recv_times.load() << " times, empty " << sum_recv_empty.load() << " times, " << (sum_recv_times.load() / secs)
+              << " msg/s" << std::endl;
+
+    delete[] buffer;
+    return 0;
+}
+
+#else
+
+int main(int argc, char *argv[]) {
+    std::cerr << "this benckmark code require your compiler support lambda and c++11/thread" << std::endl;
+    return 0;
+}
+
+#endif